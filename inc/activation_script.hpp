@@ -0,0 +1,65 @@
+#ifndef ACTIVATION_SCRIPT_H
+#define ACTIVATION_SCRIPT_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+#include "env_path_item.hpp"
+#include "persistent_path_list.hpp"
+#include "path_launcher.hpp"
+
+enum ShellKind {
+    SHELL_CMD,        // .cmd，用 call 执行
+    SHELL_POWERSHELL, // .ps1，用 . 执行
+    SHELL_BASH,       // .sh，用 source 执行（bash/zsh/sh）
+    SHELL_FISH,       // .fish，用 source 执行
+    SHELL_COUNT
+};
+
+// 一个Path状态对应的激活/还原脚本，每种shell一对
+typedef struct ActivationSnippets_s {
+    std::string activate[SHELL_COUNT];
+    std::string deactivate[SHELL_COUNT];
+} ActivationSnippets_t;
+
+// 生成只修改当前shell中PATH的脚本，不写注册表、不广播。
+// 激活前把原来的PATH保存在 QUICKMANPATH_OLD_PATH 中（已保存时不覆盖，可以在状态之间直接切换），还原时恢复并删除它。
+// 脚本内容按来源缓存，规则与PathLauncher相同；写入文件时内容不变则不改写，shell钩子可以按修改时间判断是否需要重新source
+class ActivationScripts
+{
+public:
+    typedef PathLauncher::Expander Expander;
+    typedef std::shared_ptr<const ActivationSnippets_t> SnippetsPtr;
+
+private:
+    struct FileEntry {
+        std::filesystem::file_time_type mtime;
+        uintmax_t size;
+        SnippetsPtr snippets;
+    };
+
+    Expander expander;
+    PersistentPathList cachedSystem;
+    PersistentPathList cachedUser;
+    SnippetsPtr tableSnippets;
+    std::unordered_map<std::string, FileEntry> fileSnippets;
+
+public:
+    void setExpander(Expander exp);
+    void invalidate();
+
+    SnippetsPtr forTables(const PersistentPathList &system, const PersistentPathList &user);
+    SnippetsPtr forFile(const std::filesystem::path &file); // 读取失败或文件不记录顺序（旧版本的.json）时返回nullptr
+
+    static ActivationSnippets_t generate(const std::vector<std::string> &entries);
+    static const char *extension(ShellKind shell); // 带'.'
+    // 默认目录：pathVars.json 所在目录下的 activate
+    static std::filesystem::path defaultDirectory();
+    // 写入 dir/<name>.<ext> 和 dir/<name>-off.<ext>，written为实际改写的文件数
+    static bool writeFiles(const ActivationSnippets_t &snippets, const std::filesystem::path &dir,
+                           const std::string &name, size_t &written);
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef DIFF_WINDOW_H
+#define DIFF_WINDOW_H
+#include <functional>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Choice.H>
+#include <FL/Fl_Button.H>
+#include <FL/Fl_Box.H>
+#include <FL/Fl_Text_Display.H>
+#include <FL/Fl_Text_Buffer.H>
+#include "path_diff.hpp"
+
+// 快照比较窗口：选择新旧两份Path快照，显示新增、删除、移动和启用状态的变化
+class DiffWindow : public Fl_Double_Window
+{
+public:
+    enum Source {
+        SOURCE_TABLES,     // 当前表格，包含未应用的修改
+        SOURCE_REGISTRY,   // 注册表中的当前值
+        SOURCE_STATE_FILE, // pathVars.json
+        SOURCE_OTHER_FILE  // 选择一个 .json 或导出的顺序文件
+    };
+    // 由主窗口提供表格和注册表的内容
+    typedef std::function<bool(Source source, PathSnapshot_t &snapshot)> Loader;
+
+private:
+    Loader loader;
+    PathDiff differ;
+    Fl_Choice *beforeChoice;
+    Fl_Choice *afterChoice;
+    Fl_Button *compareButton;
+    Fl_Text_Buffer *buffer;
+    Fl_Text_Display *display;
+    Fl_Box *statusBox;
+
+    bool loadSnapshot(Source source, PathSnapshot_t &snapshot);
+    static void compareCallback(Fl_Widget *w, void *data);
+
+public:
+    DiffWindow(Loader snapshotLoader, PathDiff::Expander expander);
+    ~DiffWindow();
+    void compare();
+};
+
+#endif
@@ -0,0 +1,73 @@
+#ifndef ENV_EXPANDER_H
+#define ENV_EXPANDER_H
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+
+// 注册表中的一个环境变量
+typedef struct EnvVariable_s {
+    std::string name;
+    std::string value;
+    bool expandable; // REG_EXPAND_SZ，值中的%VAR%需要展开
+} EnvVariable_t;
+
+// 按Windows的规则展开%VAR%：用户变量优先于系统变量，两者都没有时查进程环境（例如USERPROFILE）；
+// 变量名不区分大小写，未定义的引用原样保留。
+// 变量的值和每个展开过的字符串都会缓存，并记录它依赖的变量（包括间接引用和尚未定义的变量）；
+// 变量变化时只丢弃依赖它的缓存，并返回需要重新展开的字符串。
+// 互相引用形成环的变量不展开，保留为%VAR%。只能在一个线程中使用。
+class EnvExpander
+{
+public:
+    enum Scope {
+        SCOPE_SYSTEM,
+        SCOPE_USER
+    };
+    typedef std::function<bool(const std::string &name, std::string &value)> Fallback;
+
+private:
+    struct Definition {
+        std::string name; // 原始大小写
+        std::string value;
+        bool expandable;
+    };
+    struct Expansion {
+        std::string value;
+        std::vector<std::string> deps; // 小写变量名
+        bool defined;                  // 变量有定义（只用于变量）
+        bool cyclic;                   // 引用了环中的变量
+    };
+
+    std::unordered_map<std::string, Definition> scopes[2]; // 小写变量名 -> 定义
+    Fallback fallback;
+    std::unordered_map<std::string, Expansion> variableMemo; // 小写变量名 -> 展开后的值
+    std::unordered_map<std::string, Expansion> textMemo;     // 原始字符串 -> 展开结果
+    std::unordered_map<std::string, std::unordered_set<std::string>> dependents; // 小写变量名 -> 依赖它的字符串
+    std::unordered_set<std::string> cyclicNames; // 在引用环中的变量
+    bool cyclesDirty;
+
+    const Definition *lookup(const std::string &lowerName) const;
+    static std::vector<std::string> references(const std::string &text); // 文本中引用的变量（小写）
+    void findCycles();
+    Expansion expandVariable(const std::string &name);
+    Expansion expandText(const std::string &text);
+    std::vector<std::string> invalidate(const std::vector<std::string> &lowerNames);
+
+public:
+    EnvExpander();
+
+    void setFallback(Fallback lookup); // 进程环境中的变量，不跟踪变化
+    // 整体替换一个作用域的变量，只有值变化的变量影响缓存；返回需要重新展开的字符串
+    std::vector<std::string> setVariables(Scope scope, const std::vector<EnvVariable_t> &variables);
+    std::vector<std::string> setVariable(Scope scope, const EnvVariable_t &variable);
+    std::vector<std::string> removeVariable(Scope scope, const std::string &name);
+
+    std::string expand(const std::string &text);
+    bool isCyclic(const std::string &text); // 展开时遇到了环中的变量
+    std::vector<std::string> cyclicVariables();
+    size_t memoSize() const;
+};
+
+#endif
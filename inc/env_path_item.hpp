@@ -0,0 +1,10 @@
+#ifndef ENV_PATH_ITEM_H
+#define ENV_PATH_ITEM_H
+#include <string>
+
+typedef struct EnvPathItem_s {
+    std::string path;
+    bool enabled;
+} EnvPathItem_t;
+
+#endif
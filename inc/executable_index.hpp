@@ -0,0 +1,108 @@
+#ifndef EXECUTABLE_INDEX_H
+#define EXECUTABLE_INDEX_H
+#include <string>
+#include <vector>
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include "thread_pool.hpp"
+
+// 一个PATH条目的遮蔽情况
+typedef struct ShadowEntry_s {
+    std::string path;      // 原始条目（未展开）
+    bool user;             // 来自用户Path还是系统Path
+    bool scanned;          // 目录是否已扫描完成
+    bool duplicate;        // 与前面的条目指向同一目录，整个条目都不会被用到
+    size_t commandCount;   // 目录中的可执行命令数
+    size_t effectiveCount; // 其中实际生效（没有被前面目录中的同名命令遮蔽）的数量
+    size_t shadowingCount; // 遮蔽了后面目录中同名命令的次数
+} ShadowEntry_t;
+
+// 在多个目录中都存在的命令，files按PATH顺序排列，第一个生效
+typedef struct ShadowConflict_s {
+    std::string command;
+    std::vector<std::string> files;
+} ShadowConflict_t;
+
+// 可执行文件索引：命令名 -> 按PATH顺序包含它的目录。
+// 每个目录只在第一次出现时在线程池中扫描一次，列表按目录缓存；
+// 启用/禁用/移动条目只调整参与的目录和它们的顺序，不重新扫描。
+// 扫描完成后调用resultsReady通知（由调用方转到主线程），主线程再调用drain()合并；
+// 除resultsReady外所有方法都只能在主线程调用。
+class ExecutableIndex
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+private:
+    typedef struct Listing_s {
+        std::vector<std::string> commands; // 命令名（Windows下小写、去掉扩展名）
+        std::vector<std::string> files;    // 与commands对应的文件名，同名时按PATHEXT顺序取第一个
+    } Listing_t;
+
+    struct Directory {
+        std::string expanded;
+        Listing_t listing;
+        bool scanned;
+        bool scanning;
+        bool active;     // 是否在当前顺序中
+        size_t position; // 在当前顺序中第一次出现的位置
+    };
+
+    Expander expander;
+    std::function<void()> resultsReady; // 在工作线程调用
+    std::vector<std::string> extensions;
+    std::vector<Directory> directories;                    // 只增不减，下标即目录编号
+    std::unordered_map<std::string, size_t> directoryIds;  // normalizePathKey -> 目录编号
+    std::vector<std::string> orderPaths;                   // 当前顺序中的原始条目
+    std::vector<size_t> orderIds;                          // 与orderPaths对应的目录编号
+    size_t systemCount;                                    // orderPaths中前systemCount个来自系统Path
+    std::unordered_map<std::string, std::vector<size_t>> commandDirs; // 命令名 -> 包含它的活动目录（无序）
+    std::vector<ShadowEntry_t> entries;                    // 与orderPaths对应
+    std::unordered_map<std::string, size_t> entryIndex;    // entryKey -> entries中第一次出现的下标
+    std::mutex finishedMutex;
+    std::vector<std::pair<size_t, Listing_t>> finished;    // 工作线程写，主线程取走
+    ThreadPool pool; // 放在最后，析构时最先停止
+
+    static std::string entryKey(const std::string &rawPath, bool user);
+    size_t directoryId(const std::string &rawPath);
+    void activate(size_t id);
+    void deactivate(size_t id);
+    void addCommands(size_t id);
+    void removeCommands(size_t id);
+    void scan(size_t id);
+    size_t winnerOf(const std::vector<size_t> &dirs) const; // 位置最靠前的目录
+    void rebuildEntries();
+
+    static Listing_t listDirectory(const std::string &expandedPath, const std::vector<std::string> &extensions);
+
+public:
+    explicit ExecutableIndex(size_t threadCount = 0);
+
+    void setExpander(Expander exp);
+    void setResultsReady(std::function<void()> callback);
+
+    // 设置生效的PATH顺序（系统在前、用户在后，只含启用的条目），只扫描新出现的目录
+    void setOrder(const std::vector<std::string> &systemPaths, const std::vector<std::string> &userPaths);
+    void rescanAll(); // 目录内容可能已变化，丢弃缓存的列表重新扫描
+    size_t drain();   // 合并扫描结果，返回本次合并的目录数
+    bool isScanning() const;
+
+    // 按PATH顺序返回命令对应的全部文件，第一个即实际运行的文件
+    std::vector<std::string> resolve(const std::string &command) const;
+    const std::vector<ShadowEntry_t> &shadowEntries() const;
+    std::vector<ShadowConflict_t> conflicts() const; // 按命令名排序
+    // 条目中的命令全部被前面的目录遮蔽，或与前面的条目重复
+    bool isFullyShadowed(const std::string &rawPath, bool user) const;
+    std::string formatReport() const;
+
+    // 供查找开销估算使用，位置均为当前顺序中的下标
+    std::string commandKey(const std::string &command) const; // 命令名 -> 索引中的键
+    size_t probesPerDirectory() const; // 在一个目录中找不到时尝试的文件数（PATHEXT扩展名个数）
+    // 包含该命令的条目位置（升序）和在该目录中找到前尝试的文件数
+    void lookupCommand(const std::string &key, std::vector<std::pair<size_t, size_t>> &hits) const;
+    // 必须保持的先后关系：两个条目有同名命令，或后者与前者重复
+    void precedencePairs(std::vector<std::pair<size_t, size_t>> &pairs) const;
+};
+
+#endif
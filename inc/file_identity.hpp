@@ -0,0 +1,63 @@
+#ifndef FILE_IDENTITY_H
+#define FILE_IDENTITY_H
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+// 目录的物理身份：Windows为卷序列号+文件ID，其它平台为st_dev+st_ino。
+// 通过联接点、符号链接或8.3短文件名访问同一个目录时身份相同。
+typedef struct FileIdentity_s {
+    uint64_t volume;
+    uint64_t fileId;
+
+    bool operator==(const struct FileIdentity_s &other) const
+    {
+        return volume == other.volume && fileId == other.fileId;
+    }
+    bool operator!=(const struct FileIdentity_s &other) const
+    {
+        return !(*this == other);
+    }
+} FileIdentity_t;
+
+struct FileIdentityHash {
+    size_t operator()(const FileIdentity_t &id) const
+    {
+        return std::hash<uint64_t>()(id.volume * 0x9e3779b97f4a7c15ULL ^ id.fileId);
+    }
+};
+
+// 以展开后的路径为键缓存身份。取身份需要打开目录，代价较高；
+// 再次查询时先取不打开目录的属性（Windows GetFileAttributesEx，其它平台lstat）作为指纹，
+// 指纹没变就直接用缓存。可以在多个线程中同时使用。
+class FileIdentityCache
+{
+private:
+    typedef struct Stamp_s {
+        uint64_t values[3];
+        bool operator==(const struct Stamp_s &other) const
+        {
+            return values[0] == other.values[0] && values[1] == other.values[1] && values[2] == other.values[2];
+        }
+    } Stamp_t;
+
+    struct Entry {
+        FileIdentity_t identity;
+        Stamp_t stamp;
+    };
+
+    std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+
+    static bool queryStamp(const std::string &expandedPath, Stamp_t &stamp);
+
+public:
+    // 返回false表示路径不存在或无法打开
+    bool lookup(const std::string &expandedPath, FileIdentity_t &identity);
+    void clear();
+
+    static bool queryIdentity(const std::string &expandedPath, FileIdentity_t &identity);
+};
+
+#endif
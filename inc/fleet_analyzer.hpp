@@ -0,0 +1,94 @@
+#ifndef FLEET_ANALYZER_H
+#define FLEET_ANALYZER_H
+#include <mutex>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include <unordered_map>
+
+// 多线程共用的路径字符串表：按规范化后的写法去重，每个目录只存一份，以32位编号引用。
+// 分成多个分片各自加锁，低位是分片号，高位是分片内的序号
+class PathInternTable
+{
+private:
+    static const unsigned shardBits = 6;
+    static const size_t shardCount = size_t(1) << shardBits;
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, uint32_t> ids; // 规范化写法 -> 编号
+        std::vector<std::string> spellings;            // 第一次出现时的原始写法
+    };
+    Shard shards[shardCount];
+
+public:
+    uint32_t intern(const std::string &key, const std::string &spelling);
+    const std::string &spelling(uint32_t id) const; // 全部插入结束后调用
+    uint32_t idLimit() const;                       // 所有编号都小于它
+    size_t size() const;
+};
+
+// 从许多机器收集来的 pathVars.json（或文本列表）离线分析：
+// 并行读取并把路径放进同一张字符串表，用MinHash签名和分段LSH按Path相似度聚类，
+// 报告离群的机器、大多数机器共有的目录前缀，以及与基准配置的差异
+class FleetAnalyzer
+{
+public:
+    static const size_t signatureSize = 64;
+    static const size_t bandRows = 4; // 16段×4行，相似度约0.5以上的机器大概率落进同一个桶
+
+    typedef struct Machine_s {
+        std::string name;          // 相对于目录的路径，不含扩展名
+        bool readable;
+        size_t systemCount;        // 启用的条目数
+        size_t userCount;
+        std::vector<uint32_t> ids; // 两侧启用条目的编号，排序去重
+        uint32_t signature[signatureSize];
+    } Machine_t;
+
+    typedef struct Cluster_s {
+        std::vector<size_t> members;
+        size_t corePaths; // 至少一半成员都有的路径数
+    } Cluster_t;
+
+    typedef struct Options_s {
+        double threshold;      // 估计的Jaccard相似度不低于它才合并为一类
+        size_t minClusterSize; // 小于它的类中的机器视为离群
+        size_t threads;        // 0表示按CPU核数
+    } Options_t;
+
+private:
+    PathInternTable table;
+    std::vector<Machine_t> machines;
+    std::vector<uint32_t> frequency; // 编号 -> 拥有该路径的机器数
+    std::vector<Cluster_t> clusters; // 按成员数从多到少
+    std::vector<size_t> clusterOf;   // 机器 -> 所在类
+    std::vector<uint32_t> golden;    // 基准配置的编号，排序去重
+    std::string goldenName;
+    Options_t options;
+    double loadSeconds;
+    double clusterSeconds;
+
+    void loadMachine(const std::filesystem::path &file, Machine_t &machine);
+    static double estimate(const Machine_t &a, const Machine_t &b);
+    void buildClusters();
+
+    void reportClusters(std::ostringstream &out) const;
+    void reportOutliers(std::ostringstream &out) const;
+    void reportPrefixes(std::ostringstream &out) const;
+    void reportDrift(std::ostringstream &out) const;
+
+public:
+    FleetAnalyzer();
+
+    // 递归读取目录下的 .json/.txt 文件并完成聚类
+    bool analyze(const std::filesystem::path &dir, const Options_t &analyzeOptions);
+    bool setGolden(const std::filesystem::path &file); // 在analyze之前或之后调用都可以
+
+    const std::vector<Machine_t> &machineList() const;
+    const std::vector<Cluster_t> &clusterList() const;
+    std::string formatReport() const;
+};
+
+#endif
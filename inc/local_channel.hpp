@@ -0,0 +1,64 @@
+#ifndef LOCAL_CHANNEL_H
+#define LOCAL_CHANNEL_H
+#include <string>
+
+// 本机进程间的按行通信：Windows下为命名管道，其它平台为UNIX域套接字。
+// 只允许当前用户连接（管道名带用户名，套接字文件权限为0600）。
+// Windows下服务端总是预先留着一个等待连接的管道实例，正在处理一个连接时其它客户端也能连上并排队
+class LocalConnection
+{
+private:
+#ifdef _WIN32
+    void *handle; // HANDLE
+    bool serverSide;
+    void *ioEvent;      // 服务端的管道实例以重叠方式读写，用这个事件等待完成
+    unsigned timeoutMs; // 服务端读写的超时，0为不超时
+    bool stalled;       // 读写超时过，关闭时不再等对方读完
+#else
+    int fd;
+#endif
+    std::string buffer; // 已读入但还没取走的字节
+
+    friend class LocalServer;
+
+public:
+    LocalConnection();
+    ~LocalConnection();
+    LocalConnection(const LocalConnection &) = delete;
+    LocalConnection &operator=(const LocalConnection &) = delete;
+
+    bool connect(const std::string &name);
+    bool isOpen() const;
+    void close();
+    // 读写超时（毫秒，0为不超时），超时时readLine和write返回false；Windows下只对服务端的连接有效
+    void setTimeout(unsigned milliseconds);
+    bool readLine(std::string &line); // 不含结尾的'\n'，连接关闭返回false
+    bool write(const std::string &data);
+};
+
+class LocalServer
+{
+private:
+    std::string channelName;
+#ifdef _WIN32
+    void *nextPipe; // 下一个等待连接的管道实例
+#else
+    int fd;
+#endif
+
+public:
+    LocalServer();
+    ~LocalServer();
+    LocalServer(const LocalServer &) = delete;
+    LocalServer &operator=(const LocalServer &) = delete;
+
+    // 已有服务端在监听时返回false
+    bool listen(const std::string &name);
+    bool accept(LocalConnection &connection); // 阻塞到有客户端连接
+    void close();
+
+    // 当前用户的默认通道名
+    static std::string defaultName();
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef PATH_ALIAS_DETECTOR_H
+#define PATH_ALIAS_DETECTOR_H
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include "file_identity.hpp"
+#include "path_list_model.hpp"
+#include "path_health_scanner.hpp"
+
+// 找出通过联接点、符号链接或8.3短文件名指向前面某个条目同一物理目录的条目。
+// 按系统在前、用户在后的生效顺序只看启用的条目；写法相同的重复条目不算别名。
+// 身份来自PathHealthScanner的检查结果，尚未检查完的条目暂不参与。
+class PathAliasDetector
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+private:
+    std::unordered_map<std::string, std::string> aliases; // entryKey -> 前面的同一目录条目
+    size_t systemCount;
+    size_t userCount;
+
+    static std::string entryKey(const std::string &rawPath, bool user);
+
+public:
+    PathAliasDetector();
+
+    void update(const PathListModel &system, const PathListModel &user,
+                const PathHealthScanner &scanner, const Expander &expander);
+    // 是别名时返回它指向的前面的条目，否则返回nullptr
+    const std::string *aliasOf(const std::string &rawPath, bool user) const;
+    size_t count(bool user) const;
+};
+
+#endif
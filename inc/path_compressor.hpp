@@ -0,0 +1,60 @@
+#ifndef PATH_COMPRESSOR_H
+#define PATH_COMPRESSOR_H
+#include <string>
+#include <vector>
+#include <functional>
+
+// Path中引用的一个变量
+typedef struct PathVariable_s {
+    std::string name;
+    std::string value;  // 替换掉的目录前缀
+    bool existing;      // 已定义的变量（例如%SystemRoot%），不需要新建
+    size_t uses;        // 引用它的条目数
+    size_t saved;       // 节省的字符数
+} PathVariable_t;
+
+// 提取多个条目共有的目录前缀，改写成%VAR%引用以缩短Path的原始长度。
+// 前缀只在路径分量边界处截取；每个条目最多引用一个变量，取节省最多的那个；
+// 按"再加一个变量能多节省多少字符"贪心选择，已有的变量不占新建名额。
+// 已经含有%的条目保持原样。
+class PathCompressor
+{
+public:
+    typedef std::function<bool(const std::string &)> NameCheck;
+
+private:
+    struct Candidate {
+        std::string key;   // 比较用（Windows下小写、统一为'\'）
+        std::string value; // 原始写法
+        std::string name;
+        bool existing;
+        std::vector<size_t> entries; // 以它为前缀的条目
+    };
+
+    std::vector<Candidate> existingVariables;
+    NameCheck nameInUse;
+    size_t maxNewVariables;
+    size_t minGain; // 新建一个变量至少要节省的字符数
+
+    static std::string compareKey(const std::string &path);
+    static bool isSeparator(char ch);
+    std::string makeName(const std::string &prefix, const std::vector<std::string> &taken) const;
+
+public:
+    explicit PathCompressor(size_t maxNew = 8, size_t minimumGain = 16);
+
+    // 可以直接引用的已有变量，value为展开后的目录
+    void addExistingVariable(const std::string &name, const std::string &value);
+    // 新变量名已被占用时返回true，用于避开已有的环境变量
+    void setNameInUse(NameCheck check);
+
+    // entries为启用的条目（原始写法），rewritten与之一一对应；返回改写后用';'连接的长度
+    size_t compress(const std::vector<std::string> &entries, std::vector<std::string> &rewritten,
+                    std::vector<PathVariable_t> &variables) const;
+
+    static size_t joinedLength(const std::vector<std::string> &entries);
+    static std::string formatPreview(const std::string &title, const std::vector<std::string> &entries,
+                                     const std::vector<std::string> &rewritten, const std::vector<PathVariable_t> &variables);
+};
+
+#endif
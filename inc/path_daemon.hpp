@@ -0,0 +1,86 @@
+#ifndef PATH_DAEMON_H
+#define PATH_DAEMON_H
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+#include "env_path_item.hpp"
+#include "path_list_model.hpp"
+#include "path_state_store.hpp"
+#include "local_channel.hpp"
+#include "path_guard.hpp"
+
+// 常驻模式：启动时读一次注册表、pathVars.json 和已保存的状态，之后全部留在内存中，
+// 通过本机管道/套接字按行接受命令，查询不读注册表，切换状态不重新解析文件。
+//
+// 协议：每个请求一行，回复第一行为 "OK [说明]" 或 "ERR 原因"，之后是若干数据行，以一个空行结束。
+//   ping                  OK
+//   query                 state <名字|->、applied <yes|no>，然后每行 <system|user> <on|off> <path>
+//   states                每行一个已保存的状态名（状态目录中的.txt文本列表），当前状态前加'*'
+//   switch <name>         把表格替换为已保存的状态并写回 pathVars.json（内容相同时跳过）
+//   save <name>           把表格当前内容保存为状态
+//   apply                 把启用的条目写入注册表（仅Windows），与内存中的注册表副本相同的一侧跳过
+//   reload                重新读取注册表、pathVars.json 和状态目录
+//   guard                 守护模式的状态 on|off [revert]，然后每行一条待确认或最近自动还原的修改：
+//                         <pending|reverted> <id> <system|user>，之后是 "  + path"、"  - path" 或 "  reordered"
+//   approve <id>          接受一条待确认的修改：重新固定这一侧，并把注册表合并进表格
+//   reject <id>           还原一条待确认的修改
+//   shutdown              回复后退出
+// 守护模式固定启动时表格中启用的条目；apply写入注册表前重新固定，switch只改表格不改固定的内容
+class PathDaemon
+{
+private:
+    struct SavedState {
+        std::filesystem::file_time_type mtime;
+        uintmax_t size;
+        std::vector<EnvPathItem_t> systemPaths;
+        std::vector<EnvPathItem_t> userPaths;
+        uint64_t hash;
+    };
+
+    PathListModel systemModel;
+    PathListModel userModel;
+    PathStateStore store; // 在模型之后声明，先于模型析构
+    std::vector<EnvPathItem_t> registrySystem; // 启动或应用、重新读取时的注册表内容
+    std::vector<EnvPathItem_t> registryUser;
+    std::filesystem::path statesDir;
+    std::map<std::string, SavedState> states;
+    std::string currentState; // 空表示不是某个已保存的状态
+    uint64_t currentHash;
+    // query的回复按表格版本缓存
+    PersistentPathList queriedSystem;
+    PersistentPathList queriedUser;
+    std::string queryReply;
+    bool stopping;
+    PathGuard guard; // 最后声明，先于表格析构（停止监视线程）
+
+    void scanStates();
+    void readRegistry();
+    bool loadTables();
+    std::string query();
+    std::string listStates() const;
+    std::string switchTo(const std::string &name);
+    std::string saveAs(const std::string &name);
+    std::string apply();
+    std::string guardStatus() const;
+    std::string approve(const std::string &id);
+    std::string reject(const std::string &id);
+
+public:
+    PathDaemon();
+
+    // 读取注册表（Windows）、状态文件和状态目录（默认为 pathVars.json 所在目录下的 states）
+    bool open(const std::filesystem::path &stateDirectory = std::filesystem::path());
+    std::string handle(const std::string &request); // 处理一行请求，返回完整回复
+    bool stopRequested() const;
+    // 固定表格中启用的条目并开始监视注册表（仅Windows）；autoRevert为false时修改记为待确认
+    bool startGuard(bool autoRevert, PathGuard::Notify onChange);
+    // 在name上监听并逐个处理连接，直到收到shutdown；一个连接可以连续发送多个请求，空闲超过5秒后断开，
+    // 期间其它客户端的连接排队等待
+    bool serve(const std::string &name);
+
+    static uint64_t hashOf(const std::vector<EnvPathItem_t> &systemPaths, const std::vector<EnvPathItem_t> &userPaths);
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef PATH_DIFF_H
+#define PATH_DIFF_H
+#include <string>
+#include <vector>
+#include <functional>
+#include "env_path_item.hpp"
+
+// 一份Path快照：来自保存的状态文件、注册表或当前表格
+typedef struct PathSnapshot_s {
+    std::string name;
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    bool ordered; // 旧版本的 pathVars.json 按路径排序保存，不记录顺序
+} PathSnapshot_t;
+
+// 两份快照之间的一处差异
+typedef struct PathDiffEntry_s {
+    enum Kind {
+        INSERTED,
+        REMOVED,
+        MOVED,   // 位置变化，也包括在系统和用户Path之间移动
+        TOGGLED, // 启用状态变化
+        RESPELLED // 规范化后相同，写法不同（大小写、分隔符、结尾分隔符）
+    } kind;
+    std::string path;      // 新快照中的写法（删除时为旧的写法）
+    std::string oldPath;
+    bool oldUser;
+    bool newUser;
+    size_t oldIndex;       // 在旧快照对应Path中的行号，新增时无意义
+    size_t newIndex;       // 在新快照对应Path中的行号，删除时无意义
+    bool oldEnabled;
+    bool newEnabled;
+} PathDiffEntry_t;
+
+// 比较两份快照。每个Path的条目序列按规范化后的写法比较，
+// 用线性空间的Myers算法求最短编辑脚本：先去掉首尾相同的部分和只在一边出现的条目，
+// 代价过高时（大段重排）退而取当前最好的对角线，保证上万条目时仍能即时给出结果。
+// 删除和插入的同一目录合并为移动。
+class PathDiff
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+private:
+    struct Partition {
+        long xmid;
+        long ymid;
+        bool loMinimal;
+        bool hiMinimal;
+    };
+
+    // 一次比较的工作状态
+    const std::vector<int> *xv;
+    const std::vector<int> *yv;
+    std::vector<long> fdiag;
+    std::vector<long> bdiag;
+    long diagOffset;
+    long tooExpensive;
+    std::vector<char> *xChanged;
+    std::vector<char> *yChanged;
+
+    Expander expander;
+
+    void diag(long xoff, long xlim, long yoff, long ylim, bool findMinimal, Partition &part);
+    void compareSeq(long xoff, long xlim, long yoff, long ylim, bool findMinimal);
+    std::string keyOf(const std::string &path) const;
+
+public:
+    PathDiff();
+
+    void setExpander(Expander exp); // 设置后按展开结果比较，%JAVA_HOME%\bin 与实际目录视为相同
+
+    // 对两个整数序列求差异，xOut/yOut标出不在公共子序列中的元素
+    void diffSequences(const std::vector<int> &x, const std::vector<int> &y,
+                       std::vector<char> &xOut, std::vector<char> &yOut);
+
+    std::vector<PathDiffEntry_t> compare(const PathSnapshot_t &before, const PathSnapshot_t &after);
+    static std::string formatReport(const PathSnapshot_t &before, const PathSnapshot_t &after,
+                                    const std::vector<PathDiffEntry_t> &entries);
+};
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef PATH_GUARD_H
+#define PATH_GUARD_H
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <cstdint>
+#include <functional>
+#include "env_path_item.hpp"
+
+// 守护模式：固定一份系统和用户Path（启用的条目），在后台监视注册表中的两个Environment键，
+// 发现安装程序等外部修改后自动还原，或者记为待确认的修改，由用户接受或还原。
+// 监视线程阻塞在注册表的变化通知上，空闲时不占CPU；一串连续的写入等安静一段时间后只检查一次。
+// 每侧先比较整个值的哈希，和固定的内容相同（包括自己还原时的写入）时不做逐条比较
+class PathGuard
+{
+public:
+    typedef struct GuardChange_s {
+        size_t id;
+        bool user;
+        std::vector<std::string> added;   // 注册表中有、固定内容中没有的条目
+        std::vector<std::string> removed; // 固定内容中有、注册表中没有的条目
+        bool reordered;                   // 条目相同但顺序变了
+        std::vector<EnvPathItem_t> current; // 修改后注册表中的内容
+        bool reverted;                    // 已经自动还原
+    } GuardChange_t;
+
+    // 把一侧的内容写回注册表，Windows下默认为setSystemPath/setUserPath
+    typedef std::function<bool(bool user, const std::vector<EnvPathItem_t> &items)> Writer;
+    // 在监视线程中调用，发现修改（已还原或待确认）后通知
+    typedef std::function<void(const GuardChange_t &change)> Notify;
+
+private:
+    mutable std::mutex mutex;
+    std::vector<EnvPathItem_t> pinned[2]; // 0系统，1用户，只含启用的条目
+    uint64_t pinnedHash[2];
+    bool pinnedSet;
+    bool autoRevert;
+    unsigned debounceMs;
+    size_t nextId;
+    std::vector<GuardChange_t> pending; // 每侧最多一条，新的修改替换旧的
+    std::vector<GuardChange_t> recent;  // 最近自动还原的修改，只保留最后几条
+    Writer writer;
+    Notify notify;
+    std::thread watcher;
+    std::atomic<bool> running;
+    void *stopEvent; // Windows下的HANDLE
+
+    void watchLoop();
+    static GuardChange_t diff(const std::vector<EnvPathItem_t> &pinnedItems, const std::vector<EnvPathItem_t> &current);
+
+public:
+    PathGuard();
+    ~PathGuard();
+    PathGuard(const PathGuard &) = delete;
+    PathGuard &operator=(const PathGuard &) = delete;
+
+    // 固定两侧的内容（禁用的条目忽略），keepPending为false时清空待确认的修改。
+    // 保留时，写入后注册表与新固定的内容一致的一侧由监视线程在看到这次写入时清掉
+    void pin(const std::vector<EnvPathItem_t> &systemPaths, const std::vector<EnvPathItem_t> &userPaths,
+             bool keepPending = false);
+    void setAutoRevert(bool enabled);
+    bool autoReverts() const;
+    void setDebounce(unsigned milliseconds);
+    void setWriter(Writer write);
+
+    // 启动监视线程（仅Windows，其它平台返回false）；需要先pin
+    bool start(Notify onChange);
+    void stop();
+    bool isRunning() const;
+
+    // 检查一侧在注册表中的当前内容，有修改时返回true。监视线程在去抖后调用
+    bool observe(bool user, const std::vector<EnvPathItem_t> &current);
+
+    std::vector<GuardChange_t> pendingChanges() const;
+    std::vector<GuardChange_t> recentReverts() const;
+    // 接受：以注册表中的新内容为准重新固定这一侧
+    bool approve(size_t id, GuardChange_t *accepted = nullptr);
+    // 拒绝：把这一侧写回固定的内容
+    bool reject(size_t id);
+
+    static uint64_t hashOf(const std::vector<EnvPathItem_t> &items); // 只计启用的条目
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef PATH_HEALTH_SCANNER_H
+#define PATH_HEALTH_SCANNER_H
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include "thread_pool.hpp"
+#include "file_identity.hpp"
+#include "path_list_model.hpp"
+
+typedef enum PathHealth_e {
+    HEALTH_UNKNOWN = 0,   // 尚未检查完
+    HEALTH_OK,            // 存在、是目录、可以列出内容
+    HEALTH_MISSING,       // 不存在
+    HEALTH_NOT_DIRECTORY, // 存在但不是目录
+    HEALTH_NO_ACCESS,     // 没有权限列出内容
+    HEALTH_TIMEOUT        // 超时（通常是无法访问的网络共享）
+} PathHealth_t;
+
+// 后台检查每个路径条目是否指向可用的目录。
+// 检查在线程池中并行进行，结果以路径为键缓存，条目变化时只检查新出现的路径。
+// 工作线程完成检查后调用resultsReady通知（由调用方转到主线程，例如Fl::awake），
+// 主线程再调用drain()把结果合并进缓存；status()/drain()只能在主线程调用。
+class PathHealthScanner
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+private:
+    struct Watch {
+        PathListModel *model;
+        int subscription;
+    };
+
+    // 一个路径的检查结果；目录正常时同时取得它的物理身份，用于识别别名
+    struct Result {
+        PathHealth_t health;
+        bool hasIdentity;
+        FileIdentity_t identity;
+    };
+
+    Expander expander;                  // 检查前展开%VAR%，在主线程调用
+    std::function<void()> resultsReady; // 在工作线程调用
+    std::chrono::milliseconds probeTimeout;
+    std::vector<Watch> watches;
+    std::unordered_map<std::string, Result> results; // 主线程
+    std::unordered_set<std::string> pending;         // 主线程
+    std::unordered_set<std::string> stale;           // 检查期间展开结果变了，结果到达后丢弃并重新检查
+    std::shared_ptr<FileIdentityCache> identityCache; // 超时放弃的网络检查线程可能晚于本对象结束，共享持有
+    std::mutex finishedMutex;
+    std::vector<std::pair<std::string, Result>> finished; // 工作线程写，主线程取走
+    ThreadPool pool; // 放在最后，析构时最先停止，保证任务不会访问已销毁的成员
+
+    void onModelChange(PathListModel *model, const PathListChange_t &change);
+    void post(const std::string &path, const Result &result);
+    static Result probeWithIdentity(const std::string &expandedPath, FileIdentityCache &cache);
+
+public:
+    explicit PathHealthScanner(size_t threadCount = 0);
+    ~PathHealthScanner();
+
+    void setExpander(Expander exp);
+    void setResultsReady(std::function<void()> callback);
+    void setProbeTimeout(std::chrono::milliseconds timeout);
+
+    // 订阅模型：新增的条目和整体替换后的条目会自动检查
+    void watch(PathListModel *model);
+    void unwatchAll();
+
+    void request(const std::string &path); // 已有结果或正在检查时跳过
+    void recheck(const std::string &path); // 引用的变量变化后按新的展开结果重新检查
+    void rescanAll();                      // 清空缓存后重新检查所有订阅模型中的条目
+    size_t drain();                        // 返回本次合并的结果数
+    PathHealth_t status(const std::string &path) const;
+    // 目录正常时返回它的物理身份
+    bool identity(const std::string &path, FileIdentity_t &id) const;
+
+    // 同步检查一个已展开的路径，不带超时
+    static PathHealth_t probe(const std::string &expandedPath);
+    // 网络路径可能长时间阻塞，需要带超时检查
+    static bool isNetworkPath(const std::string &expandedPath);
+    static const char *describe(PathHealth_t health);
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef PATH_LAUNCHER_H
+#define PATH_LAUNCHER_H
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+#include "env_path_item.hpp"
+#include "persistent_path_list.hpp"
+
+// 子进程的环境块：当前进程的环境变量，其中PATH替换为给定的值。
+// 按变量名排序（Windows按不区分大小写的顺序），所有"名=值\0"连续存放在一次分配好大小的缓冲区中，
+// 以额外的'\0'结尾，可以直接作为CreateProcess的lpEnvironment；POSIX下另外提供指向各项的envp数组。
+class EnvironmentBlock
+{
+private:
+    std::vector<char> data;
+    std::vector<char *> pointers; // 指向data中的各项，以nullptr结尾
+    std::string pathValue;
+
+public:
+    explicit EnvironmentBlock(const std::string &path);
+
+    const char *block() const;
+    size_t blockSize() const;
+    char *const *envp() const;
+    const std::string &path() const;
+};
+
+// 用指定的Path状态启动程序，不修改注册表，也不广播WM_SETTINGCHANGE。
+// 环境块按来源缓存：表格以两个持久化列表的版本为键（O(1)判断是否修改过），
+// 文件以路径、修改时间和大小为键；变量或进程环境变化后调用invalidate()。
+class PathLauncher
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+    typedef std::shared_ptr<const EnvironmentBlock> BlockPtr;
+
+private:
+    struct FileEntry {
+        std::filesystem::file_time_type mtime;
+        uintmax_t size;
+        BlockPtr block;
+    };
+
+    Expander expander;
+    PersistentPathList cachedSystem;
+    PersistentPathList cachedUser;
+    BlockPtr tableBlock;
+    std::unordered_map<std::string, FileEntry> fileBlocks;
+
+public:
+    // 新进程中PATH的各项：系统在前，用户在后，只含启用的条目，按expander展开
+    static std::vector<std::string> effectiveEntries(const std::vector<EnvPathItem_t> &systemPaths,
+                                                     const std::vector<EnvPathItem_t> &userPaths,
+                                                     const Expander &expander);
+
+    void setExpander(Expander exp);
+    void invalidate();
+
+    // 按表格当前内容（含未应用的修改）
+    BlockPtr blockFor(const PersistentPathList &system, const PersistentPathList &user);
+    // 按导出的文本列表或 pathVars.json，读取失败返回nullptr；旧版本的 pathVars.json 不记录顺序，同样返回nullptr
+    BlockPtr blockForFile(const std::filesystem::path &file);
+
+    // 在block的PATH中查找程序并启动。wait为false时立即返回；为true时等待结束并取得退出码
+    static bool launch(const EnvironmentBlock &block, const std::vector<std::string> &args, bool wait,
+                       int &exitCode, std::string &error);
+    // 把一行命令拆成参数，支持双引号
+    static std::vector<std::string> splitCommandLine(const std::string &commandLine);
+};
+
+#endif
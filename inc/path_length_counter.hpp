@@ -0,0 +1,53 @@
+#ifndef PATH_LENGTH_COUNTER_H
+#define PATH_LENGTH_COUNTER_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "path_list_model.hpp"
+
+// 跟踪一个Path中启用条目用';'连接后的长度（原始写法和展开后）。
+// 订阅模型变化，切换、增加、删除、恢复一行时只调整该行的贡献，不重新连接字符串；
+// 整体替换时才全部重算。变量变化时只重算引用了它的条目。
+class PathLengthCounter
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+private:
+    struct Row {
+        uint32_t raw;
+        uint32_t expanded;
+        bool counted; // 未删除且启用
+    };
+
+    PathListModel *model;
+    int subscription;
+    Expander expander;
+    std::vector<Row> rows; // 与模型的行一一对应（含墓碑）
+    size_t rawSum;
+    size_t expandedSum;
+    size_t enabled;
+
+    Row measure(size_t index) const;
+    void add(const Row &row);
+    void subtract(const Row &row);
+    void onModelChange(const PathListChange_t &change);
+    void recount();
+
+public:
+    PathLengthCounter();
+    ~PathLengthCounter();
+
+    void setExpander(Expander exp);
+    void attach(PathListModel *target); // nullptr表示解除订阅
+    void reexpand(const std::vector<std::string> &rawPaths); // 这些条目的展开结果变了
+
+    size_t enabledCount() const;
+    size_t rawLength() const;      // 写入注册表的值的长度
+    size_t expandedLength() const; // 展开后的长度
+    // 进程PATH由系统Path和用户Path依次连接而成
+    static size_t effectiveLength(const PathLengthCounter &system, const PathLengthCounter &user);
+};
+
+#endif
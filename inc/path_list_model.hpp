@@ -0,0 +1,111 @@
+#ifndef PATH_LIST_MODEL_H
+#define PATH_LIST_MODEL_H
+#include <vector>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include "env_path_item.hpp"
+#include "persistent_path_list.hpp"
+
+// 路径列表的变化通知
+typedef struct PathListChange_s {
+    enum Kind {
+        INSERT,  // index处插入了一行
+        REMOVE,  // index处的行被打上墓碑
+        RESTORE, // index处的墓碑被恢复
+        TOGGLE,  // index处的启用状态变化
+        EDIT,    // index处的路径文本被修改
+        MOVE,    // index处的行移动到了toIndex
+        RESET,   // 整体替换（批量替换、撤销/重做），下标全部失效
+        COMPACT  // 墓碑被压缩掉，下标全部失效但可见内容不变
+    } kind;
+    size_t index;
+    size_t toIndex;
+} PathListChange_t;
+
+// 一个Path变量（系统或用户）的全部条目。
+// PathTable从这里渲染，MainWindow和持久化层订阅变化；
+// 所有修改都通过这里进行，并自动记录撤销历史。
+class PathListModel
+{
+public:
+    typedef std::function<void(const PathListChange_t &)> Listener;
+
+private:
+    // 一步历史；link非0时与另一个模型中link相同的一步同时撤销/重做。
+    // counts是从list到下一个版本liveCounts的净变化，撤销/重做时按它调整，不重新统计全部条目
+    struct HistoryStep {
+        PersistentPathList list;
+        unsigned long link;
+        std::vector<std::pair<std::string, long>> counts;
+    };
+
+    PersistentPathList entries;
+    std::vector<HistoryStep> undoStack; // 撤销历史，各版本之间共享未修改的节点
+    std::vector<HistoryStep> redoStack;
+    PathListModel *linkedModel; // 最近一次联动批量修改的另一个模型
+    std::unordered_map<std::string, size_t> liveCounts; // 未删除的路径 -> 出现次数
+    std::unordered_map<std::string, long> pendingCounts; // 撤销栈顶一步之后liveCounts的变化，尚未并入该步
+    std::vector<std::pair<int, Listener>> listeners;
+    int nextListenerId;
+    int batchDepth;          // beginBatch/endBatch嵌套层数
+    PersistentPathList batchStart; // 批量修改开始前的版本
+
+    void record(); // 修改前调用：不在批量修改中时记录一步历史
+    void notify(PathListChange_t::Kind kind, size_t index, size_t toIndex = 0);
+    void restoreStep(std::vector<HistoryStep> &from, std::vector<HistoryStep> &to, bool followLink);
+    void closeStep(); // 把pendingCounts并入撤销栈顶的一步
+    void applyCounts(const std::vector<std::pair<std::string, long>> &counts, long sign);
+    void rebuildCounts();
+    void countAdd(const std::string &path);
+    void countRemove(const std::string &path);
+
+public:
+    PathListModel();
+
+    int subscribe(Listener listener); // 返回订阅号
+    void unsubscribe(int id);
+
+    const PersistentPathList &list() const;
+    size_t size() const;      // 包含墓碑
+    size_t liveSize() const;
+    const EnvPathItem_t &at(size_t index) const;
+    bool isDeleted(size_t index) const;
+    size_t liveToIndex(size_t liveRow) const;
+    bool contains(const std::string &path) const; // O(1)
+    size_t find(const std::string &path) const;   // 未找到返回npos
+    size_t deletedCount() const;
+    void toVector(std::vector<EnvPathItem_t> &out) const; // 跳过墓碑
+    void enabledPaths(std::vector<std::string> &out) const; // 按顺序追加未删除且启用的路径
+
+    // 多个修改合并为一步撤销
+    void beginBatch();
+    void endBatch();
+    // 两个模型的批量修改合并为一步：在任一表格中撤销/重做时另一个表格跟着撤销/重做
+    static void beginLinkedBatch(PathListModel &first, PathListModel &second);
+    static void endLinkedBatch(PathListModel &first, PathListModel &second);
+
+    void append(const EnvPathItem_t &item);
+    void appendAll(std::vector<EnvPathItem_t> &&items); // 批量追加，作为一步撤销，只通知一次RESET
+    void setEnabled(size_t index, bool enabled);
+    void setEnabledRows(const std::vector<size_t> &rows, bool enabled); // 作为一步撤销，只通知一次RESET
+    void setPath(size_t index, const std::string &path);
+    // 批量改写（下标, 新路径），作为一步撤销，只通知一次RESET
+    void setPaths(const std::vector<std::pair<size_t, std::string>> &edits);
+    void remove(size_t index);
+    void restore(size_t index);
+    void move(size_t from, size_t to);
+    void replaceAll(std::vector<EnvPathItem_t> &&items);
+    void permute(const std::vector<size_t> &order); // order[i]为排到第i行的原下标（含墓碑），作为一步撤销
+    void clearHistory(); // 丢弃撤销/重做历史，常驻进程反复整体替换时避免历史无限增长
+    void compact(); // 去掉墓碑，不进入撤销历史
+
+    bool canUndo() const;
+    bool canRedo() const;
+    void undo();
+    void redo();
+
+    static const size_t npos = static_cast<size_t>(-1);
+};
+
+#endif
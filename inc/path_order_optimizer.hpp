@@ -0,0 +1,52 @@
+#ifndef PATH_ORDER_OPTIMIZER_H
+#define PATH_ORDER_OPTIMIZER_H
+#include <string>
+#include <vector>
+#include <istream>
+#include <unordered_map>
+
+// 命令查找开销估算与按使用频率调整PATH顺序。
+// 启动一个命令时按顺序在每个目录中依次尝试各PATHEXT扩展名，直到找到为止；
+// 一次启动的开销按尝试的文件数计算。调整顺序时保持所有同名命令的先后关系不变，
+// 因此每个命令实际运行的文件不变，只是排在它前面的目录变少。
+class PathOrderOptimizer
+{
+private:
+    typedef struct Command_s {
+        std::string name;
+        double weight;  // 使用次数
+        size_t winner;  // 生效的条目位置
+        size_t probes;  // 在生效目录中找到前尝试的文件数
+    } Command_t;
+
+    size_t entryCount;
+    size_t probesPerMiss;
+    size_t segmentEnd; // 系统条目数：只在[0,segmentEnd)和[segmentEnd,entryCount)内部调整
+    std::vector<Command_t> commands;
+    std::vector<double> entryWeight;                // 每个条目作为生效目录的使用次数
+    std::vector<std::vector<size_t>> predecessors;  // 必须排在它前面的条目
+    double totalWeight;
+
+public:
+    PathOrderOptimizer(size_t entries, size_t probesPerDirectory, size_t systemEntries);
+
+    // hits为包含该命令的条目位置（升序）和在该目录中尝试的文件数，为空时忽略
+    void addCommand(const std::string &name, double weight, const std::vector<std::pair<size_t, size_t>> &hits);
+    void addPrecedence(size_t before, size_t after);
+
+    double totalUsage() const;
+    // 按给定顺序（order[i]为排在第i位的条目）计算平均每次启动尝试的文件数
+    double expectedProbes(const std::vector<size_t> &order) const;
+    // 在保持先后关系的前提下，把使用多的目录尽量往前排，没有命中的目录往后排
+    std::vector<size_t> optimize() const;
+    bool respectsPrecedence(const std::vector<size_t> &order) const;
+
+    std::string formatReport(const std::vector<std::string> &entryNames, const std::vector<size_t> &proposed,
+                             size_t unresolvedCommands, double unresolvedUsage) const;
+
+    // 读取命令使用记录：每行一个命令行（PowerShell/bash/zsh历史），或 "次数 命令" 形式的统计；
+    // 取每行第一个词作为命令，带路径的调用不搜索PATH，忽略
+    static void parseUsageHistory(std::istream &in, std::unordered_map<std::string, double> &usage);
+};
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef PATH_POLICY_H
+#define PATH_POLICY_H
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <filesystem>
+#include <unordered_map>
+#include "path_list_model.hpp"
+
+// Path合规规则。规则文件每行一条，'#'开头为注释，模式可以加双引号：
+//   block-apply                          有error级规则不满足时拒绝应用
+//   error first   "C:\Corp\Tools"        生效顺序中第一个启用的条目必须匹配
+//   error forbid  system "%USERPROFILE%\*"  不允许出现匹配的条目（例如系统Path中的用户可写目录）
+//   warn  order   "*\miniconda*" "*\python*"  匹配后者的条目不能出现在匹配前者的条目之前
+//   warn  require user "*\bin"           至少有一个匹配的条目
+// first/forbid/order/require后面可以加 system 或 user 只检查一侧，默认按系统在前、用户在后的生效顺序检查两侧。
+// 模式中的%VAR%在加载时展开，'*'匹配任意字符（含分隔符），'?'匹配一个字符，与条目一样按规范化后的写法比较。
+//
+// 加载时所有模式编译为分段的通配程序；每个不同的条目只匹配一次，结果以位图缓存。
+// attach后订阅两个模型，按变化的类型和下标增量更新：forbid/require只调整变化的行，first只看最前面两个启用的行，
+// order只在变化的行匹配它的模式时整条重查；整体替换和压缩墓碑时才全部重新检查
+class PathPolicy
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+    enum RuleKind {
+        RULE_FIRST,
+        RULE_REQUIRE,
+        RULE_FORBID,
+        RULE_ORDER
+    };
+
+    typedef struct PolicyRule_s {
+        RuleKind kind;
+        bool error;      // error级，否则为warn
+        int scope;       // 0两侧，1系统，2用户
+        size_t pattern;  // 模式下标
+        size_t other;    // order规则的第二个模式
+        size_t line;     // 规则文件中的行号
+        std::string text; // 规则原文，显示在表格和报告中
+    } PolicyRule_t;
+
+    typedef struct PolicyViolation_s {
+        size_t rule;
+        bool user;    // 所在表格
+        size_t index; // 模型下标，npos表示没有具体的行（例如缺少必需的目录）
+    } PolicyViolation_t;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+private:
+    // 以'*'切分后的各段，段内'?'匹配任意一个字符
+    struct Glob {
+        std::vector<std::string> pieces;
+        bool leadingStar;
+        bool trailingStar;
+    };
+
+    struct Row {
+        bool active;                 // 未删除且启用
+        const uint64_t *mask;        // 匹配的模式位图，指向maskCache中的值
+        std::vector<uint64_t> rules; // 该行不满足的规则位图
+    };
+
+    Expander expander;
+    std::vector<std::string> rawPatterns; // 规则文件中的写法，变量变化后重新编译
+    std::vector<Glob> globs;
+    std::vector<PolicyRule_t> rules;
+    bool blockApply;
+    std::filesystem::path sourceFile;
+    size_t maskWords;
+    std::unordered_map<std::string, std::vector<uint64_t>> maskCache; // 原始写法 -> 匹配的模式位图
+    PersistentPathList checkedSystem;
+    PersistentPathList checkedUser;
+    bool checked;
+    PathListModel *models[2]; // attach的系统和用户模型
+    int subscriptions[2];
+    std::vector<Row> rowStates[2];     // 与两个模型的行一一对应（含墓碑）
+    std::vector<char> missing;         // 每条规则：没有具体的行可以标出的不满足（first/require找不到条目）
+    std::vector<size_t> requireCounts; // require规则：满足的行数
+    size_t violationTotal;
+    size_t errorTotal;
+    mutable bool listDirty;
+    mutable std::vector<PolicyViolation_t> violations; // 需要时才按规则和生效顺序整理
+
+    static Glob compileGlob(const std::string &pattern);
+    static bool matchPiece(const std::string &text, size_t pos, const std::string &piece);
+    static bool matchGlob(const Glob &glob, const std::string &text);
+    void compilePatterns();
+    const std::vector<uint64_t> &maskOf(const std::string &rawPath);
+    void measure(const PathListModel &model, size_t index, Row &row);
+    void setViolation(int side, size_t index, size_t rule, bool on);
+    void setMissing(size_t rule, bool on);
+    void checkRule(size_t rule); // 整条规则重新检查
+    void checkFirst(size_t rule);
+    void checkOrder(size_t rule);
+    void checkRow(int side, size_t index, bool wasActive, const uint64_t *oldMask); // 一行变化后
+    void rebuild(const PathListModel &system, const PathListModel &user);
+    void onModelChange(int side, const PathListChange_t &change);
+
+public:
+    PathPolicy();
+    ~PathPolicy();
+
+    void setExpander(Expander exp);
+    // 解析规则文本并编译，出错时error为"第N行：原因"，原有规则不变
+    bool compile(const std::string &text, std::string &error);
+    bool load(const std::filesystem::path &file, std::string &error);
+    const std::filesystem::path &filePath() const;
+    void clear();
+    // 变量变化后重新展开模式并清空匹配缓存
+    void invalidate();
+
+    // 两个模型自上次检查后没有变化时直接返回false
+    bool evaluate(const PathListModel &system, const PathListModel &user);
+    // 订阅两个模型，之后每次修改都增量检查；nullptr表示解除订阅
+    void attach(PathListModel *system, PathListModel *user);
+
+    bool empty() const;
+    size_t ruleCount() const;
+    const std::vector<PolicyRule_t> &ruleList() const;
+    const std::vector<PolicyViolation_t> &violationList() const;
+    size_t violationCount() const;
+    size_t errorCount() const;
+    bool blocksApply() const; // 设置了block-apply且有error级规则不满足
+    // 该行不满足的第一条规则，没有时返回nullptr
+    const PolicyRule_t *violationAt(size_t index, bool user) const;
+    std::string formatReport() const;
+
+    // 默认位置：pathVars.json 所在目录下的 policy.rules
+    static std::filesystem::path defaultFilePath();
+};
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef PATH_REWRITER_H
+#define PATH_REWRITER_H
+#include <regex>
+#include <string>
+#include <vector>
+#include "path_list_model.hpp"
+#include "path_tags.hpp"
+
+// 两个表格中所有条目的批量查找替换（例如升级工具链后把 C:\Python39 改成 C:\Python311）。
+// 表格内容就是保存到 pathVars.json 的内容，禁用的条目同样改写，已删除的行跳过。
+// 模式只编译一次，并提取出每个匹配都必须包含的一段字面文本：
+// 不含这段文本的条目直接跳过，只有少数候选才交给正则引擎，10万个条目的一遍扫描在毫秒级。
+// 先plan生成预览，确认后commit把两个表格的修改合并为一步撤销，并把标签从旧写法移到新写法
+class PathRewriter
+{
+public:
+    typedef struct Rewrite_s {
+        bool user;
+        size_t index; // 模型下标
+        std::string before;
+        std::string after;
+    } Rewrite_t;
+
+    typedef struct RewriteStats_s {
+        size_t scanned;    // 检查过的条目数
+        size_t candidates; // 通过字面文本预筛的条目数
+        double milliseconds;
+    } RewriteStats_t;
+
+private:
+    bool compiled;
+    bool useRegex;   // 否则查找文本按字面匹配
+    bool ignoreCase; // 与Windows文件名比较一致；字面匹配和预筛只折叠ASCII字母
+    std::regex pattern;
+    std::string findText;
+    std::string replacement; // 正则模式下可以用$1、$&等引用匹配的内容
+    std::string literal;     // 预筛用的字面文本，ignoreCase时为小写；为空时不预筛。字面模式下就是查找文本
+    std::vector<Rewrite_t> rewrites;
+    RewriteStats_t stats;
+    PersistentPathList plannedSystem; // plan时的版本，commit时表格已变化则拒绝
+    PersistentPathList plannedUser;
+
+    size_t findLiteral(const std::string &text, const std::string &needle, size_t from) const;
+    bool rewriteCandidate(const std::string &path, std::string &out) const; // 已通过预筛
+    void planModel(const PathListModel &model, bool user);
+
+public:
+    PathRewriter();
+
+    // 出错时error为正则表达式的错误说明，原有模式不变
+    bool compile(const std::string &find, const std::string &replace, bool regex, bool caseInsensitive,
+                 std::string &error);
+    // 正则表达式中每个匹配都必须包含的最长一段字面文本，无法确定时返回空串
+    static std::string requiredLiteral(const std::string &regexText);
+    const std::string &prefilter() const;
+
+    // 改写一个条目，没有匹配时返回false
+    bool rewrite(const std::string &path, std::string &out) const;
+
+    size_t plan(const PathListModel &system, const PathListModel &user);
+    const std::vector<Rewrite_t> &rewriteList() const;
+    const RewriteStats_t &lastStats() const;
+    // 两个表格自plan以来有修改时返回false，不做任何改动。tags不为空时同时移动被改写条目的标签
+    bool commit(PathListModel &system, PathListModel &user, PathTags *tags = nullptr) const;
+    std::string formatPreview(size_t maxRows = 2000) const;
+};
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef PATH_STATE_STORE_H
+#define PATH_STATE_STORE_H
+#include <map>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "env_path_item.hpp"
+#include "path_list_model.hpp"
+#include "path_tags.hpp"
+
+// pathVars.json 的读写。
+// 订阅系统和用户两个模型，有修改时标记为脏，保存时一次性序列化，未修改则跳过写盘。
+// 条目标签也保存在同一个文件中，随状态文件一起加载，标签有修改同样需要保存。
+class PathStateStore
+{
+private:
+    std::filesystem::path jsonFilePath;
+    PathListModel *systemModel;
+    PathListModel *userModel;
+    int systemSubscription;
+    int userSubscription;
+    bool dirty;
+    PathTags pathTags;
+    unsigned long savedTags; // 上次加载或保存时标签的修改计数
+
+    static void mergeEntries(const std::vector<EnvPathItem_t> &registry,
+                             const std::vector<EnvPathItem_t> &file,
+                             std::vector<EnvPathItem_t> &merged);
+
+public:
+    PathStateStore();
+    ~PathStateStore();
+
+    // 默认位置 %USERPROFILE%/AppData/Local/QuickManPath/pathVars.json，获取用户目录失败时返回空路径
+    static std::filesystem::path defaultFilePath();
+
+    // 读取/写入任意一个同格式的文件；tags为空时不读写标签。
+    // 条目按顺序写成 [{"path": ..., "enabled": ...}] 数组；旧版本写的是 {路径: 是否启用}，读出时按路径排序，
+    // 这时ordered为false
+    static bool readFile(const std::filesystem::path &file,
+                         std::vector<EnvPathItem_t> &systemPaths,
+                         std::vector<EnvPathItem_t> &userPaths,
+                         std::map<std::string, std::vector<std::string>> *tags = nullptr,
+                         bool *ordered = nullptr);
+    static bool writeFile(const std::filesystem::path &file,
+                          const std::vector<EnvPathItem_t> &systemPaths,
+                          const std::vector<EnvPathItem_t> &userPaths,
+                          const std::map<std::string, std::vector<std::string>> *tags = nullptr);
+
+    // 保留顺序的纯文本格式：[system]/[user] 分节，每行一个路径，禁用的条目以 "# " 开头
+    static bool readPathList(const std::filesystem::path &file,
+                             std::vector<EnvPathItem_t> &systemPaths,
+                             std::vector<EnvPathItem_t> &userPaths);
+    static bool writePathList(const std::filesystem::path &file,
+                              const std::vector<EnvPathItem_t> &systemPaths,
+                              const std::vector<EnvPathItem_t> &userPaths);
+    // 按扩展名读取上面两种格式之一（.json 为 pathVars.json 格式）。
+    // 旧版本的 pathVars.json 按路径排序保存，读出的顺序不是原来的顺序；决定命令解析结果的场合只接受保留顺序的文件
+    static bool readAnyFile(const std::filesystem::path &file,
+                            std::vector<EnvPathItem_t> &systemPaths,
+                            std::vector<EnvPathItem_t> &userPaths,
+                            bool *ordered = nullptr);
+    // 文件是否保留顺序：文本列表总是保留；.json 要读出来看格式，读取失败时返回true，由调用方报告无法读取
+    static bool isOrderedFile(const std::filesystem::path &file);
+
+    // 打开状态文件，目录或文件不存在时创建默认内容
+    bool open(const std::filesystem::path &file);
+    const std::filesystem::path &filePath() const;
+    bool load(std::vector<EnvPathItem_t> &systemPaths, std::vector<EnvPathItem_t> &userPaths); // 同时读入标签
+    // 打开默认位置的状态文件并与注册表中的路径合并：按注册表中的顺序，只在文件中的条目（禁用的、尚未应用的）
+    // 接在文件中它前面最近的注册表条目之后，保留文件中的启用状态。
+    // 界面和命令行共用；读取文件失败时返回false，输出中仍包含注册表中的路径
+    bool loadMerged(const std::vector<EnvPathItem_t> &registrySystem, const std::vector<EnvPathItem_t> &registryUser,
+                    std::vector<EnvPathItem_t> &systemPaths, std::vector<EnvPathItem_t> &userPaths);
+
+    void attach(PathListModel *system, PathListModel *user);
+    void detach();
+    bool isDirty() const;
+    PathTags &tags();
+    bool save(); // 把已订阅模型的当前内容写回文件
+};
+
+#endif
@@ -3,38 +3,104 @@
 #include <vector>
 #include <string>
 #include <FL/Fl_Table_Row.H>
-
-typedef struct EnvPathItem_s {
-    std::string path;
-    bool enabled;
-} EnvPathItem_t;
+#include "env_path_item.hpp"
+#include "path_list_model.hpp"
+#include "path_health_scanner.hpp"
+#include "executable_index.hpp"
+#include "path_alias_detector.hpp"
+#include "env_expander.hpp"
+#include "path_policy.hpp"
+#include "path_tags.hpp"
 
 class PathTable : public Fl_Table_Row
 {
 private:
-    std::vector<EnvPathItem_t> envPaths;
+    PathListModel *model; // 数据来源，墓碑行保留在模型中直到应用后压缩
+    int modelSubscription;
+    const PathHealthScanner *healthScanner; // 提供每行的目录状态图标，可以为空
+    const ExecutableIndex *executableIndex; // 提供遮蔽信息，全部被遮蔽的条目灰显，可以为空
+    const PathAliasDetector *aliasDetector; // 提供别名信息，别名条目后面标出它指向的条目，可以为空
+    EnvExpander *envExpander; // 带%VAR%的条目后面显示展开结果，可以为空
+    const PathPolicy *policy; // 不满足策略规则的行在左侧标色并注明规则，可以为空
+    const PathTags *tags; // 条目所属的标签显示在路径后面，可以为空
+    bool userScope; // 本表格是用户Path还是系统Path，查询遮蔽和别名信息时使用
     std::vector<uint8_t> delBtnClicked;
-    int selectedRow; // 跟踪被选中的行，-1表示没有选中
+    std::vector<uint8_t> rowSelected; // 每行的选中标记，与模型下标一一对应
+    size_t selectedCount; // 当前选中的行数
+    int anchorRow; // Shift范围选择的起点（显示行号），-1表示没有
     void (*focusCallback)(PathTable*); // 焦点变化回调函数
-    
-    // 用于定时器回调的数据结构
+
+    // 用于定时器回调的数据结构，从固定大小的池中分配，不走堆
     struct ButtonData {
-        int row;
+        size_t index;
         PathTable* table;
+        bool inUse;
     };
-    
+    static const int buttonPoolSize = 4;
+    ButtonData buttonPool[buttonPoolSize];
+    bool compactDeferred; // 按钮动画期间要求的压缩，最后一个按钮复位时再做
+
     // 静态回调函数用于处理按钮点击动画
     static void resetButtonState(void *data);
-    
+    // 空闲时压缩已确认的墓碑
+    static void compactIdle(void *data);
+
+    size_t rowToIndex(int R) const; // 显示行号 -> 模型下标
+    // 模型变化时同步选中状态等，并请求重绘（多次请求只会合并为一次重绘）
+    void onModelChange(const PathListChange_t &change);
+    // 整体替换后让选中状态等与模型长度一致
+    void syncRowState();
+
+    // 根据鼠标位置计算所在的单元格，返回false表示不在数据单元格上
+    bool hitCell(int &R, int &C);
+    // 按照键盘修饰键更新选中状态：普通点击单选，Ctrl切换，Shift范围选择
+    void clickSelect(int R);
+    // 弹出右键菜单
+    void showContextMenu();
+    // 压缩掉所有墓碑
+    void compactRows();
+
 public:
     PathTable(int X, int Y, int W, int H, const char *L = 0);
+    ~PathTable();
     void setFocusCallback(void (*callback)(PathTable*)); // 设置焦点回调
-    void getPaths(std::vector<EnvPathItem_t> &outPathList);
-    void setPaths(const std::vector<EnvPathItem_t> &pathList);
+    void setModel(PathListModel *pathModel); // 传入nullptr解除订阅
+    PathListModel *getModel() const;
+    void setHealthScanner(const PathHealthScanner *scanner);
+    void setUserScope(bool user);
+    void setExecutableIndex(const ExecutableIndex *index);
+    void setEnvExpander(EnvExpander *expander);
+    void setAliasDetector(const PathAliasDetector *detector);
+    void setPolicy(const PathPolicy *pathPolicy);
+    void setTags(const PathTags *pathTags);
     void draw_cell(TableContext context, int R, int C, int X, int Y, int W, int H) override;
     size_t getPathLength();
     void clearSelection(); // 清除选中状态
-    
+
+    // 批量操作，均只询问一次、重绘一次
+    size_t getSelectedCount() const;
+    std::vector<size_t> getSelectedIndices() const; // 选中行的模型下标
+    void selectAll();
+    void setSelectedEnabled(bool enabled);
+    void deleteSelected();
+    void moveSelected(int delta); // 选中的行整体上移(-1)或下移(1)一行
+
+    // 删除所有指向前面已有目录的别名条目（可撤销）
+    size_t getAliasCount() const;
+    void removeAliases();
+
+    // 墓碑：恢复全部或单个已删除的行；应用成功后确认删除并在空闲时压缩
+    size_t getDeletedCount() const;
+    void restoreDeleted();
+    void restoreDeletedAt(size_t index); // 模型下标
+    void commitDeletes();
+
+    // 撤销/重做，Ctrl+Z / Ctrl+Y
+    bool canUndo() const;
+    bool canRedo() const;
+    void undo();
+    void redo();
+
     // 添加handle方法以更好地控制事件处理
     int handle(int event) override;
 };
@@ -0,0 +1,60 @@
+#ifndef PATH_TAGS_H
+#define PATH_TAGS_H
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "path_list_model.hpp"
+
+// 条目标签：一个工具链往往占好几个目录（bin、libnvvp、Scripts……），打上同一个标签后可以一起启用或禁用。
+// 标签按规范化后的写法记录目录，与所在表格和行号无关，保存在 pathVars.json 的 "tags" 中。
+// 每个表格按模型版本缓存各标签的成员位图和启用位图，切换标签时按64位字并行算出要变化的行，
+// 再由模型一次改完、只通知一次
+class PathTags
+{
+private:
+    struct RowBits {
+        const PathListModel *model;
+        PersistentPathList list; // 位图对应的模型版本
+        unsigned long revision;  // 位图对应的标签版本
+        std::vector<std::vector<uint64_t>> members; // 与tagPaths的顺序一致
+        std::vector<uint64_t> enabled; // 未删除且启用的行
+    };
+
+    std::map<std::string, std::vector<std::string>> tagPaths; // 标签 -> 目录的原始写法，按规范化写法去重
+    std::unordered_map<std::string, std::vector<std::string>> keyTags; // 规范化写法 -> 所属标签，按名称排序
+    unsigned long revision;
+    mutable std::vector<RowBits> cache; // 每个模型一份
+
+    void rebuildKeys();
+    const RowBits &bitsFor(const PathListModel &model) const;
+    size_t tagSlot(const std::string &tag) const; // tagPaths中的序号，没有时返回npos
+
+public:
+    PathTags();
+
+    void assign(const std::map<std::string, std::vector<std::string>> &data);
+    const std::map<std::string, std::vector<std::string>> &data() const;
+    unsigned long changeCount() const; // 每次修改加一，用于判断是否需要保存
+
+    bool add(const std::string &tag, const std::string &path);    // 已有时返回false
+    bool remove(const std::string &tag, const std::string &path); // 最后一个目录移除后标签也删除
+    bool removeTag(const std::string &tag);
+    // 条目改写后把标签从旧写法移到新写法（旧写法, 新写法），所有改写同时生效；返回移动的标签成员数
+    size_t rename(const std::vector<std::pair<std::string, std::string>> &renames);
+    std::vector<std::string> tagNames() const;
+    const std::vector<std::string> *tagsOf(const std::string &path) const; // 没有标签时返回nullptr
+    static bool validName(const std::string &tag); // 非空，不含空白和'/'
+
+    // 标签在该表格中的行数（不含已删除的行）和其中启用的行数
+    void count(const std::string &tag, const PathListModel &model, size_t &members, size_t &enabledCount) const;
+    // 把标签的全部行设为启用或禁用，作为一步撤销；返回状态变化的行数
+    size_t setEnabled(const std::string &tag, bool enabled, PathListModel &model) const;
+    // 两个表格一起切换，任一表格中撤销时两边一起撤销
+    size_t setEnabled(const std::string &tag, bool enabled, PathListModel &system, PathListModel &user) const;
+
+    static const size_t npos = static_cast<size_t>(-1);
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef PATH_TRANSFER_H
+#define PATH_TRANSFER_H
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include "env_path_item.hpp"
+#include "path_list_model.hpp"
+
+// 批量导入/导出的文件格式
+enum PathFileFormat {
+    PATH_FORMAT_REG,        // 注册表编辑器导出的 .reg（Environment键下的Path值）
+    PATH_FORMAT_TEXT,       // 每行一个路径，可用 [system]/[user] 分节，"# " 开头为禁用
+    PATH_FORMAT_JSON_LINES  // 每行一个JSON：字符串，或 {"path":..., "enabled":..., "scope":"system"|"user"}
+};
+
+typedef struct PathRecord_s {
+    std::string path;
+    bool enabled;
+    bool user;
+} PathRecord_t;
+
+typedef struct PathImportResult_s {
+    size_t records;    // 文件中读出的条目
+    size_t added;      // 去重后追加到表格的条目
+    size_t duplicates; // 与已有条目或前面的记录重复
+    size_t errors;     // 无法解析的行
+} PathImportResult_t;
+
+// 流式解析：按任意大小的块喂入数据，每解析出一个条目就回调一次，不需要把整个文件读进内存。
+// .reg 文件通常是带BOM的UTF-16LE，边读边转成UTF-8；hex(2)形式的REG_EXPAND_SZ值跨多行时也逐字节解码
+class PathImporter
+{
+public:
+    typedef std::function<void(const PathRecord_t &)> Sink;
+
+private:
+    enum RegScope {
+        OTHER_KEY, // 不是环境变量所在的键
+        SYSTEM_KEY,
+        USER_KEY
+    };
+
+    PathFileFormat format;
+    Sink sink;
+    bool defaultUser;
+    bool user;                // 文本格式当前分节
+    bool started;             // 是否已检查过BOM
+    bool utf16;
+    std::string pendingBytes; // 检查BOM前收到的字节，或UTF-16中不足一个码元的字节
+    std::u16string wideLine;  // UTF-16文件中还没读到换行的部分
+    std::string line;
+    size_t errorCount;
+
+    // .reg 解析状态
+    RegScope regScope;
+    bool inHexValue;          // 正在读取跨行的hex(2)值
+    bool hexDone;             // 已读到结尾的0，后面的字节忽略
+    int hexLowByte;           // 一个UTF-16码元的低字节，-1表示还没有
+    std::u16string hexEntry;
+
+    void emit(const std::string &path, bool enabled, bool inUser);
+    void emitList(const std::string &value, bool enabled, bool inUser); // 按';'拆分后逐个回调
+    void appendBytes(const char *data, size_t size); // 已按单字节编码的数据，按行切分
+    void appendWide(const char *data, size_t size);  // UTF-16LE数据，按行切分
+    void processLine(std::string &text);
+    void processTextLine(std::string &text);
+    void processJsonLine(const std::string &text);
+    void processRegLine(const std::string &text);
+    void parseHexBytes(const std::string &text, size_t pos);
+    void hexCodeUnit(char16_t unit);
+    void flushHexEntry();
+
+public:
+    PathImporter(PathFileFormat fileFormat, Sink recordSink, bool unsectionedUser = false);
+
+    void feed(const char *data, size_t size);
+    void finish();
+    size_t errors() const;
+
+    static PathFileFormat formatOf(const std::filesystem::path &file); // 按扩展名：.reg、.jsonl/.ndjson，其余按文本
+    static bool readFile(const std::filesystem::path &file, PathFileFormat fileFormat, bool unsectionedUser,
+                         const Sink &recordSink, size_t &errorCount);
+    // 读取文件，按规范化后的写法与两个模型中已有的条目及前面的记录去重，每个模型一次性追加
+    static bool importInto(const std::filesystem::path &file, PathFileFormat fileFormat, bool unsectionedUser,
+                           PathListModel &systemModel, PathListModel &userModel, PathImportResult_t &result);
+};
+
+// 导出为上述格式之一。.reg 只包含启用的条目，写成UTF-16LE的REG_EXPAND_SZ，保留%VAR%
+class PathExporter
+{
+public:
+    static bool writeFile(const std::filesystem::path &file, PathFileFormat fileFormat,
+                          const std::vector<EnvPathItem_t> &systemPaths,
+                          const std::vector<EnvPathItem_t> &userPaths);
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef PATH_TRIE_H
+#define PATH_TRIE_H
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <functional>
+#include <unordered_map>
+#include "path_list_model.hpp"
+
+// 两个表格中启用的条目按路径分量组成的前缀树，用于找出：
+// 同一目录重复出现（包括只差结尾分隔符、大小写或%VAR%写法不同）、同时出现在系统和用户Path中、
+// 以及互为上下级目录的条目。订阅两个表格的模型，增加、删除、恢复、切换或修改一行时只增删该行对应的条目；
+// 整体替换（撤销/重做、批量修改）时按出现次数对比该表格，只增删有变化的部分，不重建整棵树。
+class PathTrie
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+    typedef struct Entry_s {
+        std::string path; // 原始写法
+        bool user;
+        size_t count; // 在该表格中出现的次数
+    } Entry_t;
+
+    // 同一目录的全部写法
+    typedef struct Group_s {
+        std::string key;
+        std::vector<Entry_t> entries;
+        size_t total;          // 出现总次数
+        bool crossTable;       // 系统和用户Path中都有
+        bool trailingOnly;     // 写法只差结尾分隔符
+    } Group_t;
+
+    // 上级目录和它下面的条目；PATH不递归搜索，两者都有效，只作提示
+    typedef struct Nested_s {
+        Entry_t ancestor;
+        Entry_t descendant;
+    } Nested_t;
+
+private:
+    struct Node {
+        std::unordered_map<std::string, std::unique_ptr<Node>> children;
+        Node *parent;
+        std::map<std::pair<bool, std::string>, size_t> holders; // (是否用户, 原始写法) -> 次数
+        size_t subtree; // 本节点及所有下级的条目数，为0时删除节点
+        std::string key;
+    };
+    struct Held {
+        size_t count;
+        Node *node;
+    };
+    struct Row {
+        std::string path; // 计入树中时的原始写法，未计入时为空
+        bool counted;     // 未删除且启用
+    };
+    struct Side {
+        PathListModel *model;
+        int subscription;
+        std::vector<Row> rows; // 与模型的行一一对应（含墓碑）
+    };
+
+    Expander expander;
+    Node root;
+    std::map<std::pair<bool, std::string>, Held> held; // 当前在树中的条目
+    size_t nodes;
+    Side sides[2]; // 0系统，1用户
+
+    std::vector<std::string> components(const std::string &key) const;
+    void insert(bool user, const std::string &rawPath, size_t count);
+    void erase(bool user, const std::string &rawPath, size_t count);
+    void clear();
+    Row measure(const PathListModel &model, size_t index) const;
+    void onModelChange(int side, const PathListChange_t &change);
+    void resync(int side); // 整体替换后与行的镜像对比出现次数，只增删有变化的条目
+    static Entry_t makeEntry(const std::pair<const std::pair<bool, std::string>, size_t> &holder);
+    static bool differsOnlyInTrailing(const std::string &a, const std::string &b);
+
+public:
+    PathTrie();
+    ~PathTrie();
+    PathTrie(const PathTrie &) = delete;
+    PathTrie &operator=(const PathTrie &) = delete;
+
+    void setExpander(Expander exp); // 按新的展开方式重建
+    // 跟踪两个表格中启用的条目，nullptr表示解除订阅
+    void attach(PathListModel *system, PathListModel *user);
+    // 这些原始写法的展开结果变了，按新的结果移到对应的节点
+    void reexpand(const std::vector<std::string> &rawPaths);
+
+    std::vector<Group_t> duplicateGroups() const;
+    std::vector<Nested_t> nestedEntries() const; // 每个条目只对应最近的上级条目
+    // 按系统在前、用户在后的顺序，同一目录只保留第一次出现的启用条目，返回其余各行的下标
+    void redundantRows(const PathListModel &system, const PathListModel &user,
+                       std::vector<size_t> &systemRows, std::vector<size_t> &userRows) const;
+    size_t nodeCount() const;
+
+    std::string formatReport() const;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef PATH_UTILS_H
+#define PATH_UTILS_H
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// 与平台无关的路径字符串工具，不访问文件系统
+
+// 环境变量值的上限（字符数，含结尾'\0'），超过后进程环境块中的Path会被截断
+constexpr size_t pathValueLimit = 32767;
+// 旧版系统属性对话框、setx等工具能处理的Path长度
+constexpr size_t pathLegacyLimit = 2047;
+
+// ASCII范围内转小写（Windows文件名比较不区分大小写）
+std::string toLowerAscii(const std::string &value);
+// 用于比较的目录键：统一为'\'分隔、去掉结尾分隔符，Windows下转小写
+std::string normalizePathKey(const std::string &path);
+// 按分隔符切分并去掉空段，例如PATHEXT、PATH
+std::vector<std::string> splitList(const std::string &value, char separator);
+// 可执行文件扩展名列表（小写，带'.'），Windows取PATHEXT，其它平台为空表示按可执行权限判断
+std::vector<std::string> executableExtensions();
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef PERSISTENT_PATH_LIST_H
+#define PERSISTENT_PATH_LIST_H
+#include <vector>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include "env_path_item.hpp"
+
+// 不可变的路径列表，基于按下标寻址的持久化AVL树。
+// 每次修改只复制根到目标节点路径上的O(log n)个节点，其余节点在新旧版本之间共享，
+// 因此保存任意多个历史版本的代价很低，适合做撤销/重做。
+// 每个节点带一个墓碑标记，并统计子树中未删除的行数，用于显示行号到下标的换算。
+class PersistentPathList
+{
+private:
+    struct Node;
+    typedef std::shared_ptr<const Node> NodePtr;
+    typedef std::shared_ptr<const EnvPathItem_t> ItemPtr;
+
+    struct Node {
+        ItemPtr item;
+        bool deleted;
+        int height;
+        size_t size;
+        size_t live;
+        NodePtr left;
+        NodePtr right;
+    };
+
+    NodePtr root;
+
+    explicit PersistentPathList(NodePtr r);
+
+    static int heightOf(const NodePtr &n);
+    static size_t sizeOf(const NodePtr &n);
+    static size_t liveOf(const NodePtr &n);
+    static NodePtr makeNode(const ItemPtr &item, bool deleted, const NodePtr &left, const NodePtr &right);
+    static NodePtr balance(const ItemPtr &item, bool deleted, const NodePtr &left, const NodePtr &right);
+    static NodePtr build(const std::vector<EnvPathItem_t> &items, size_t lo, size_t hi);
+    static NodePtr build(std::vector<EnvPathItem_t> &&items, size_t lo, size_t hi);
+    static NodePtr join(const NodePtr &left, const ItemPtr &item, const NodePtr &right);
+    static NodePtr insertAt(const NodePtr &n, size_t index, const ItemPtr &item);
+    static NodePtr eraseAt(const NodePtr &n, size_t index);
+    static NodePtr replaceAt(const NodePtr &n, size_t index, const ItemPtr &item, bool deleted);
+    static const Node *nodeAt(const NodePtr &n, size_t index);
+    static void collect(const NodePtr &n, std::vector<EnvPathItem_t> &out, bool includeDeleted);
+    static void visitLive(const NodePtr &n, size_t &index,
+                          const std::function<void(size_t, const EnvPathItem_t &)> &visit);
+
+public:
+    PersistentPathList();
+    explicit PersistentPathList(const std::vector<EnvPathItem_t> &items);
+    explicit PersistentPathList(std::vector<EnvPathItem_t> &&items); // 移动字符串，不复制
+
+    size_t size() const;      // 包含墓碑的总行数
+    size_t liveSize() const;  // 未删除的行数
+    bool empty() const;
+
+    const EnvPathItem_t &at(size_t index) const;
+    bool isDeleted(size_t index) const;
+    size_t liveToIndex(size_t liveRow) const; // 第liveRow个未删除的行对应的下标
+
+    // 以下操作都返回新版本，原版本保持不变
+    PersistentPathList set(size_t index, const EnvPathItem_t &item) const;
+    PersistentPathList setEnabled(size_t index, bool enabled) const;
+    PersistentPathList setDeleted(size_t index, bool deleted) const;
+    PersistentPathList insert(size_t index, const EnvPathItem_t &item) const;
+    PersistentPathList pushBack(const EnvPathItem_t &item) const;
+    PersistentPathList appended(std::vector<EnvPathItem_t> &&items) const; // 批量追加，O(m + log n)
+    PersistentPathList erase(size_t index) const; // 物理删除，用于移动
+    PersistentPathList move(size_t from, size_t to) const; // 移动后该行位于to
+    PersistentPathList compacted() const; // 去掉所有墓碑，O(n)重建
+
+    // 两个版本是否共享同一棵树（O(1)判断是否发生过修改）
+    bool sameAs(const PersistentPathList &other) const;
+
+    // 按顺序导出，默认跳过墓碑
+    void toVector(std::vector<EnvPathItem_t> &out, bool includeDeleted = false) const;
+    // 按顺序访问未删除的行（下标含墓碑），一次中序遍历，比逐行at(i)少O(log n)的查找
+    void forEachLive(const std::function<void(size_t index, const EnvPathItem_t &item)> &visit) const;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef TEXT_REPORT_WINDOW_H
+#define TEXT_REPORT_WINDOW_H
+#include <string>
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Text_Display.H>
+#include <FL/Fl_Text_Buffer.H>
+
+// 只读的文本报告窗口，等宽字体显示，关闭时自行销毁
+class TextReportWindow : public Fl_Double_Window
+{
+private:
+    Fl_Text_Buffer *buffer;
+    Fl_Text_Display *display;
+
+    static void closeCallback(Fl_Widget *w, void *data);
+
+public:
+    TextReportWindow(int W, int H, const char *title);
+    ~TextReportWindow();
+    void setText(const std::string &text);
+
+    // 创建并显示一个报告窗口
+    static TextReportWindow *open(const char *title, const std::string &text);
+};
+
+#endif
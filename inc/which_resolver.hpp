@@ -0,0 +1,68 @@
+#ifndef WHICH_RESOLVER_H
+#define WHICH_RESOLVER_H
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <unordered_map>
+#include "thread_pool.hpp"
+
+// 命令在搜索路径中的一个匹配
+typedef struct WhichHit_s {
+    std::string file; // 完整文件路径
+    size_t entry;     // 所在条目在搜索路径中的下标
+} WhichHit_t;
+
+// 按给定的搜索路径把命令名解析成实际会运行的文件（第一个匹配）。
+// 目录列表按目录缓存，用目录的修改时间判断是否需要重新列出；
+// 两次检查修改时间之间的查询直接使用缓存结果，不访问文件系统。
+// 只能在一个线程中使用，缓存不命中时在内部线程池中并行检查各目录。
+class WhichResolver
+{
+public:
+    typedef std::function<std::string(const std::string &)> Expander;
+
+private:
+    struct Listing {
+        std::unordered_map<std::string, std::string> files; // 比较用的文件名（Windows下小写）-> 实际文件名
+        std::filesystem::file_time_type mtime;
+        bool exists;
+    };
+
+    Expander expander;
+    std::vector<std::string> extensions;
+    std::vector<std::string> rawPaths;   // 搜索路径的原始条目
+    std::vector<std::string> searchDirs; // 展开后的目录
+    std::vector<std::string> searchKeys; // normalizePathKey
+    std::unordered_map<std::string, Listing> listings;                // 目录键 -> 列表
+    std::unordered_map<std::string, std::vector<WhichHit_t>> memo;    // 命令 -> 结果，目录有变化时清空
+    std::chrono::milliseconds revalidateInterval;
+    std::chrono::steady_clock::time_point lastValidated;
+    bool validated; // 当前搜索路径是否检查过
+    size_t enumerations; // 累计列出目录的次数
+    ThreadPool pool;
+
+    void revalidate(); // 检查所有目录的修改时间，重新列出有变化的目录
+    std::vector<std::string> candidates(const std::string &command) const;
+
+    static Listing listDirectory(const std::string &expandedPath, const std::vector<std::string> &extensions);
+
+public:
+    explicit WhichResolver(size_t threadCount = 0);
+
+    void setExpander(Expander exp);
+    // 两次检查目录修改时间的最小间隔，0表示每次查询都检查
+    void setRevalidateInterval(std::chrono::milliseconds interval);
+    // 搜索顺序：系统在前、用户在后，只含启用的条目；内容不变时保留缓存结果
+    void setSearchPath(const std::vector<std::string> &paths);
+    const std::vector<std::string> &searchPath() const;
+    void invalidate(); // 下次查询时重新检查所有目录
+    void reexpand(const std::vector<std::string> &changedPaths); // 这些条目的展开结果变了
+
+    // 返回全部匹配，第一个即实际运行的文件；命令中带路径分隔符时不搜索
+    std::vector<WhichHit_t> resolve(const std::string &command);
+    size_t enumerationCount() const;
+};
+
+#endif
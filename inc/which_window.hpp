@@ -0,0 +1,25 @@
+#ifndef WHICH_WINDOW_H
+#define WHICH_WINDOW_H
+#include <FL/Fl_Double_Window.H>
+#include <FL/Fl_Input.H>
+#include <FL/Fl_Hold_Browser.H>
+#include <FL/Fl_Box.H>
+#include "which_resolver.hpp"
+
+// 命令查找窗口：输入命令名，实时显示按当前表格内容（含未应用的修改）会运行的文件
+class WhichWindow : public Fl_Double_Window
+{
+private:
+    WhichResolver *resolver;
+    Fl_Input *commandInput;
+    Fl_Hold_Browser *resultBrowser;
+    Fl_Box *statusBox;
+
+    static void inputCallback(Fl_Widget *w, void *data);
+
+public:
+    WhichWindow(WhichResolver *whichResolver);
+    void refresh(); // 搜索路径变化后重新查询当前输入
+};
+
+#endif
@@ -2,12 +2,21 @@
 #define _GET_PATH_ENV_
 #include <vector>
 #include <string>
-#include "path_tabel.hpp"
+#include "env_path_item.hpp"
+#include "env_expander.hpp"
 
 std::vector<EnvPathItem_t> getSystemPath();
 std::vector<EnvPathItem_t> getUserPath();
 bool setSystemPath(const std::vector<EnvPathItem_t>& systemPaths);
 bool setUserPath(const std::vector<EnvPathItem_t>& userPaths);
+// 要写入的启用条目与注册表中读出的值相同，可以跳过写入（只改用户Path时不需要管理员权限）
+bool sameAsRegistry(const std::vector<EnvPathItem_t> &items, const std::vector<EnvPathItem_t> &registry);
+// 读取系统或用户的全部环境变量（不含Path本身）
+std::vector<EnvVariable_t> getEnvironmentVariables(bool system);
+// 写入系统或用户环境变量（REG_SZ），同时更新当前进程的环境
+bool setEnvironmentVariableValue(const std::string &name, const std::string &value, bool system);
 int getTitleBarHeight();
+std::string expandEnvironmentString(const std::string &value); // 用当前进程的环境变量展开%VAR%
+bool attachParentConsole(); // 从命令行启动时把stdout/stderr接到父进程的控制台
 
 #endif
\ No newline at end of file
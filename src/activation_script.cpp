@@ -0,0 +1,284 @@
+#include "activation_script.hpp"
+#include "path_state_store.hpp"
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+static const char savedVariable[] = "QUICKMANPATH_OLD_PATH";
+// cmd一行最多8191个字符，较长的PATH分几行追加
+static const size_t cmdLineChunk = 4000;
+
+void ActivationScripts::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+    invalidate();
+}
+
+void ActivationScripts::invalidate()
+{
+    tableSnippets.reset();
+    fileSnippets.clear();
+}
+
+ActivationScripts::SnippetsPtr ActivationScripts::forTables(const PersistentPathList &system,
+                                                            const PersistentPathList &user)
+{
+    if (tableSnippets && cachedSystem.sameAs(system) && cachedUser.sameAs(user))
+    {
+        return tableSnippets;
+    }
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    system.toVector(systemPaths);
+    user.toVector(userPaths);
+    tableSnippets = std::make_shared<const ActivationSnippets_t>(
+        generate(PathLauncher::effectiveEntries(systemPaths, userPaths, expander)));
+    cachedSystem = system;
+    cachedUser = user;
+    return tableSnippets;
+}
+
+ActivationScripts::SnippetsPtr ActivationScripts::forFile(const fs::path &file)
+{
+    std::error_code ec;
+    fs::file_time_type mtime = fs::last_write_time(file, ec);
+    uintmax_t size = ec ? 0 : fs::file_size(file, ec);
+    if (ec)
+    {
+        return nullptr;
+    }
+    std::string key = file.string();
+    auto it = fileSnippets.find(key);
+    if (it != fileSnippets.end() && it->second.mtime == mtime && it->second.size == size)
+    {
+        return it->second.snippets;
+    }
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    bool ordered = false;
+    if (!PathStateStore::readAnyFile(file, systemPaths, userPaths, &ordered) || !ordered)
+    {
+        return nullptr;
+    }
+    SnippetsPtr snippets = std::make_shared<const ActivationSnippets_t>(
+        generate(PathLauncher::effectiveEntries(systemPaths, userPaths, expander)));
+    fileSnippets[key] = FileEntry{mtime, size, snippets};
+    return snippets;
+}
+
+#ifdef _WIN32
+// Git Bash/MSYS中的写法：C:\dir -> /c/dir，\\server\share -> //server/share
+static std::string posixStyle(const std::string &path)
+{
+    std::string out = path;
+    for (auto &c : out)
+    {
+        if (c == '\\')
+            c = '/';
+    }
+    if (out.size() >= 2 && out[1] == ':' && isalpha(static_cast<unsigned char>(out[0])))
+    {
+        out = "/" + std::string(1, static_cast<char>(tolower(static_cast<unsigned char>(out[0])))) + out.substr(2);
+    }
+    return out;
+}
+#else
+static std::string posixStyle(const std::string &path)
+{
+    return path;
+}
+#endif
+
+// .cmd中'%'要写成"%%"；值放在 set "名=值" 的引号内，其余特殊字符不需要转义
+static std::string cmdEscape(const std::string &value)
+{
+    std::string out;
+    for (char c : value)
+    {
+        out.push_back(c);
+        if (c == '%')
+            out.push_back('%');
+    }
+    return out;
+}
+
+// PowerShell单引号字符串中'写成''
+static std::string powerShellQuote(const std::string &value)
+{
+    std::string out = "'";
+    for (char c : value)
+    {
+        out.push_back(c);
+        if (c == '\'')
+            out.push_back('\'');
+    }
+    out.push_back('\'');
+    return out;
+}
+
+// sh单引号字符串中不能转义，'写成'\''
+static std::string shellQuote(const std::string &value)
+{
+    std::string out = "'";
+    for (char c : value)
+    {
+        if (c == '\'')
+            out += "'\\''";
+        else
+            out.push_back(c);
+    }
+    out.push_back('\'');
+    return out;
+}
+
+// fish单引号字符串中只有\'和\\需要转义
+static std::string fishQuote(const std::string &value)
+{
+    std::string out = "'";
+    for (char c : value)
+    {
+        if (c == '\'' || c == '\\')
+            out.push_back('\\');
+        out.push_back(c);
+    }
+    out.push_back('\'');
+    return out;
+}
+
+ActivationSnippets_t ActivationScripts::generate(const std::vector<std::string> &entries)
+{
+    ActivationSnippets_t snippets;
+    std::string var = savedVariable;
+
+    // cmd：按条目边界分行，每行不超过cmdLineChunk
+    std::ostringstream cmd;
+    cmd << "@if not defined " << var << " set \"" << var << "=%PATH%\"\r\n";
+    std::string line;
+    bool first = true;
+    for (const auto &entry : entries)
+    {
+        std::string part = (line.empty() && first ? "" : ";") + cmdEscape(entry);
+        if (!line.empty() && line.size() + part.size() > cmdLineChunk)
+        {
+            cmd << "@set \"PATH=" << (first ? "" : "%PATH%") << line << "\"\r\n";
+            first = false;
+            line.clear();
+        }
+        line += part;
+    }
+    cmd << "@set \"PATH=" << (first ? "" : "%PATH%") << line << "\"\r\n";
+    snippets.activate[SHELL_CMD] = cmd.str();
+    snippets.deactivate[SHELL_CMD] = "@if defined " + var + " set \"PATH=%" + var + "%\"\r\n" +
+                                     "@set \"" + var + "=\"\r\n";
+
+    std::string windowsPath;
+    std::string posixPath;
+    for (const auto &entry : entries)
+    {
+        if (!windowsPath.empty())
+        {
+            windowsPath.push_back(';');
+            posixPath.push_back(':');
+        }
+        windowsPath += entry;
+        posixPath += posixStyle(entry);
+    }
+#ifndef _WIN32
+    windowsPath = posixPath; // 非Windows下的pwsh同样用':'分隔
+#endif
+    snippets.activate[SHELL_POWERSHELL] =
+        "if (-not (Test-Path Env:" + var + ")) { $env:" + var + " = $env:PATH }\r\n" +
+        "$env:PATH = " + powerShellQuote(windowsPath) + "\r\n";
+    snippets.deactivate[SHELL_POWERSHELL] =
+        "if (Test-Path Env:" + var + ") { $env:PATH = $env:" + var + "; Remove-Item Env:" + var + " }\r\n";
+
+    // 改PATH后清除命令位置缓存
+    snippets.activate[SHELL_BASH] =
+        "if [ -z \"${" + var + "+x}\" ]; then export " + var + "=\"$PATH\"; fi\n" +
+        "export PATH=" + shellQuote(posixPath) + "\n" +
+        "hash -r 2>/dev/null || true\n";
+    snippets.deactivate[SHELL_BASH] =
+        "if [ -n \"${" + var + "+x}\" ]; then export PATH=\"$" + var + "\"; unset " + var + "; fi\n" +
+        "hash -r 2>/dev/null || true\n";
+
+    // fish中PATH是列表，名字以PATH结尾的变量导出时用':'连接
+    std::string fishList;
+    for (const auto &entry : entries)
+    {
+        fishList += " " + fishQuote(posixStyle(entry));
+    }
+    snippets.activate[SHELL_FISH] =
+        "if not set -q " + var + "; set -gx " + var + " $PATH; end\n" +
+        "set -gx PATH" + fishList + "\n";
+    snippets.deactivate[SHELL_FISH] =
+        "if set -q " + var + "; set -gx PATH $" + var + "; set -e " + var + "; end\n";
+    return snippets;
+}
+
+const char *ActivationScripts::extension(ShellKind shell)
+{
+    switch (shell)
+    {
+    case SHELL_CMD:
+        return ".cmd";
+    case SHELL_POWERSHELL:
+        return ".ps1";
+    case SHELL_BASH:
+        return ".sh";
+    default:
+        return ".fish";
+    }
+}
+
+fs::path ActivationScripts::defaultDirectory()
+{
+    fs::path state = PathStateStore::defaultFilePath();
+    return state.empty() ? fs::path() : state.parent_path() / "activate";
+}
+
+// 内容相同时不改写，保持修改时间不变
+static bool writeIfChanged(const fs::path &file, const std::string &content, size_t &written)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (in)
+    {
+        std::ostringstream existing;
+        existing << in.rdbuf();
+        if (existing.str() == content)
+        {
+            return true;
+        }
+    }
+    in.close();
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out || !out.write(content.data(), static_cast<std::streamsize>(content.size())))
+    {
+        return false;
+    }
+    written++;
+    return true;
+}
+
+bool ActivationScripts::writeFiles(const ActivationSnippets_t &snippets, const fs::path &dir, const std::string &name,
+                                   size_t &written)
+{
+    written = 0;
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec)
+    {
+        return false;
+    }
+    for (int shell = 0; shell < SHELL_COUNT; shell++)
+    {
+        const char *ext = extension(static_cast<ShellKind>(shell));
+        if (!writeIfChanged(dir / (name + ext), snippets.activate[shell], written) ||
+            !writeIfChanged(dir / (name + "-off" + ext), snippets.deactivate[shell], written))
+        {
+            return false;
+        }
+    }
+    return true;
+}
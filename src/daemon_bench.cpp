@@ -0,0 +1,182 @@
+// 常驻模式的延迟测试：连接 QuickManPathCli daemon，反复发送请求并统计往返延迟分位数。
+// 默认测 ping、query，以及在前两个已保存的状态之间来回切换（需要至少两个状态）。
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "local_channel.hpp"
+
+typedef struct Stats_s {
+    double minUs;
+    double p50Us;
+    double p90Us;
+    double p99Us;
+    double maxUs;
+    double meanUs;
+    size_t failures;
+} Stats_t;
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: QuickManPathDaemonBench [options]\n"
+            "  --request \"line\"   request to time, repeatable; \"switch\" alone alternates between the first two\n"
+            "                     saved states (default: ping, query, switch)\n"
+            "  --iterations N     timed round trips per request (default 1000)\n"
+            "  --warmup N         untimed round trips per request (default 20)\n"
+            "  --reconnect        open a new connection for every request\n"
+            "  --channel NAME     pipe or socket to connect to (default: the daemon's default)\n");
+}
+
+// 发送一行并读完回复，回复以"OK"开头时返回true
+static bool roundTrip(LocalConnection &connection, const std::string &request, std::vector<std::string> *lines)
+{
+    if (!connection.write(request + "\n"))
+        return false;
+    std::string line;
+    bool first = true;
+    bool ok = false;
+    while (connection.readLine(line))
+    {
+        if (line.empty())
+            return ok;
+        if (first)
+            ok = line.compare(0, 2, "OK") == 0;
+        else if (lines)
+            lines->push_back(line);
+        first = false;
+    }
+    return false;
+}
+
+static Stats_t summarize(std::vector<double> &samples, size_t failures)
+{
+    Stats_t stats = {0, 0, 0, 0, 0, 0, failures};
+    if (samples.empty())
+    {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t rank = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+        return samples[rank];
+    };
+    double sum = 0;
+    for (double v : samples)
+    {
+        sum += v;
+    }
+    stats.minUs = samples.front();
+    stats.p50Us = percentile(0.50);
+    stats.p90Us = percentile(0.90);
+    stats.p99Us = percentile(0.99);
+    stats.maxUs = samples.back();
+    stats.meanUs = sum / samples.size();
+    return stats;
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<std::string> requests;
+    size_t iterations = 1000;
+    size_t warmup = 20;
+    bool reconnect = false;
+    std::string channel = LocalServer::defaultName();
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--request" && hasValue)
+            requests.push_back(argv[++i]);
+        else if (arg == "--iterations" && hasValue)
+            iterations = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--warmup" && hasValue)
+            warmup = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--channel" && hasValue)
+            channel = argv[++i];
+        else if (arg == "--reconnect")
+            reconnect = true;
+        else
+        {
+            usage();
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+    }
+    if (requests.empty())
+    {
+        requests = {"ping", "query", "switch"};
+    }
+
+    LocalConnection connection;
+    if (!connection.connect(channel))
+    {
+        fprintf(stderr, "cannot connect to the daemon on %s (start it with QuickManPathCli daemon)\n", channel.c_str());
+        return 1;
+    }
+    // "switch"在前两个状态之间来回切换，结束后切回开始时的状态
+    std::vector<std::string> states;
+    std::string startState;
+    bool wantsSwitch = std::find(requests.begin(), requests.end(), "switch") != requests.end();
+    if (wantsSwitch)
+    {
+        std::vector<std::string> lines;
+        roundTrip(connection, "states", &lines);
+        for (auto &line : lines)
+        {
+            if (!line.empty() && line[0] == '*')
+            {
+                line.erase(0, 1);
+                startState = line;
+            }
+            states.push_back(line);
+        }
+        if (states.size() < 2)
+        {
+            fprintf(stderr, "skipping switch: the daemon needs at least two saved states (QuickManPathCli send save <name>)\n");
+            requests.erase(std::remove(requests.begin(), requests.end(), "switch"), requests.end());
+        }
+    }
+
+    printf("%zu round trips per request%s, latency in microseconds\n", iterations,
+           reconnect ? " (new connection each)" : "");
+    printf("%-32s %9s %9s %9s %9s %9s %9s %6s\n", "request", "min", "p50", "p90", "p99", "max", "mean", "fail");
+    int rc = 0;
+    for (const auto &request : requests)
+    {
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        size_t failures = 0;
+        for (size_t i = 0; i < warmup + iterations; i++)
+        {
+            std::string line = request == "switch" ? "switch " + states[i % 2] : request;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = (!reconnect || connection.connect(channel)) && roundTrip(connection, line, nullptr);
+            auto end = std::chrono::steady_clock::now();
+            if (i < warmup)
+                continue;
+            if (!ok)
+            {
+                failures++;
+                if (!connection.isOpen() && !connection.connect(channel))
+                    break;
+                continue;
+            }
+            samples.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+        }
+        Stats_t stats = summarize(samples, failures);
+        printf("%-32s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %6zu\n", request.c_str(), stats.minUs, stats.p50Us,
+               stats.p90Us, stats.p99Us, stats.maxUs, stats.meanUs, stats.failures);
+        if (failures > 0)
+            rc = 1;
+    }
+    if (!startState.empty() && states.size() >= 2)
+    {
+        if (reconnect)
+            connection.connect(channel);
+        roundTrip(connection, "switch " + startState, nullptr);
+    }
+    return rc;
+}
@@ -0,0 +1,96 @@
+#include "diff_window.hpp"
+#include "path_state_store.hpp"
+#include <FL/Fl_Native_File_Chooser.H>
+#include <FL/fl_ask.H>
+#include <chrono>
+#include <string>
+
+DiffWindow::DiffWindow(Loader snapshotLoader, PathDiff::Expander expander)
+    : Fl_Double_Window(760, 480, "比较Path快照"), loader(std::move(snapshotLoader))
+{
+    differ.setExpander(std::move(expander));
+
+    const char *sources = "当前表格（未应用）|注册表|pathVars.json|其它文件...";
+    beforeChoice = new Fl_Choice(40, 10, 250, 25, "旧:");
+    beforeChoice->add(sources);
+    beforeChoice->value(SOURCE_REGISTRY);
+    afterChoice = new Fl_Choice(330, 10, 250, 25, "新:");
+    afterChoice->add(sources);
+    afterChoice->value(SOURCE_TABLES);
+    compareButton = new Fl_Button(660, 10, 90, 25, "比较");
+    compareButton->callback(compareCallback, this);
+
+    buffer = new Fl_Text_Buffer();
+    display = new Fl_Text_Display(10, 45, 740, 395);
+    display->buffer(buffer);
+    display->textfont(FL_COURIER);
+
+    statusBox = new Fl_Box(10, 445, 740, 25);
+    statusBox->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
+    end();
+    resizable(display);
+}
+
+DiffWindow::~DiffWindow()
+{
+    display->buffer(nullptr);
+    delete buffer;
+}
+
+void DiffWindow::compareCallback(Fl_Widget *w, void *data)
+{
+    static_cast<DiffWindow *>(data)->compare();
+}
+
+bool DiffWindow::loadSnapshot(Source source, PathSnapshot_t &snapshot)
+{
+    std::filesystem::path file;
+    if (source == SOURCE_STATE_FILE)
+    {
+        file = PathStateStore::defaultFilePath();
+    }
+    else if (source == SOURCE_OTHER_FILE)
+    {
+        Fl_Native_File_Chooser chooser;
+        chooser.title("选择Path快照");
+        chooser.type(Fl_Native_File_Chooser::BROWSE_FILE);
+        chooser.filter("Path快照\t*.{json,txt}");
+        if (chooser.show() != 0)
+        {
+            return false;
+        }
+        file = chooser.filename();
+    }
+    else
+    {
+        return loader && loader(source, snapshot);
+    }
+
+    snapshot.name = file.string();
+    // 旧版本的 pathVars.json 按路径排序保存，其余保留顺序
+    if (!PathStateStore::readAnyFile(file, snapshot.systemPaths, snapshot.userPaths, &snapshot.ordered))
+    {
+        fl_alert("无法读取文件：%s", snapshot.name.c_str());
+        return false;
+    }
+    return true;
+}
+
+void DiffWindow::compare()
+{
+    PathSnapshot_t before;
+    PathSnapshot_t after;
+    if (!loadSnapshot(static_cast<Source>(beforeChoice->value()), before) ||
+        !loadSnapshot(static_cast<Source>(afterChoice->value()), after))
+    {
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<PathDiffEntry_t> entries = differ.compare(before, after);
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    buffer->text(PathDiff::formatReport(before, after, entries).c_str());
+    std::string status = "共 " + std::to_string(entries.size()) + " 处差异，用时 " + std::to_string(elapsed.count()) + " 毫秒";
+    statusBox->copy_label(status.c_str());
+}
@@ -0,0 +1,326 @@
+#include "env_expander.hpp"
+#include "path_utils.hpp"
+#include <algorithm>
+
+EnvExpander::EnvExpander() : cyclesDirty(true)
+{
+}
+
+void EnvExpander::setFallback(Fallback lookup)
+{
+    fallback = std::move(lookup);
+    variableMemo.clear();
+    textMemo.clear();
+    dependents.clear();
+}
+
+const EnvExpander::Definition *EnvExpander::lookup(const std::string &lowerName) const
+{
+    // 用户变量覆盖同名的系统变量
+    for (int scope : {SCOPE_USER, SCOPE_SYSTEM})
+    {
+        auto it = scopes[scope].find(lowerName);
+        if (it != scopes[scope].end())
+            return &it->second;
+    }
+    return nullptr;
+}
+
+std::vector<std::string> EnvExpander::references(const std::string &text)
+{
+    std::vector<std::string> names;
+    size_t pos = 0;
+    while ((pos = text.find('%', pos)) != std::string::npos)
+    {
+        size_t close = text.find('%', pos + 1);
+        if (close == std::string::npos)
+            break;
+        if (close == pos + 1)
+        {
+            pos = close; // "%%"：第二个%可能是下一个引用的开头
+            continue;
+        }
+        names.push_back(toLowerAscii(text.substr(pos + 1, close - pos - 1)));
+        pos = close + 1;
+    }
+    return names;
+}
+
+void EnvExpander::findCycles()
+{
+    cyclicNames.clear();
+    cyclesDirty = false;
+
+    // Tarjan强连通分量：多于一个变量的分量或引用自身的变量都在环中
+    std::vector<std::string> names;
+    for (const auto &scope : scopes)
+    {
+        for (const auto &item : scope)
+        {
+            if (lookup(item.first) == &item.second)
+                names.push_back(item.first);
+        }
+    }
+    std::unordered_map<std::string, size_t> index;
+    std::unordered_map<std::string, size_t> low;
+    std::unordered_set<std::string> onStack;
+    std::vector<std::string> stack;
+    size_t counter = 0;
+
+    std::function<void(const std::string &)> visit = [&](const std::string &name) {
+        index[name] = low[name] = counter++;
+        stack.push_back(name);
+        onStack.insert(name);
+        const Definition *def = lookup(name);
+        bool selfLoop = false;
+        if (def->expandable)
+        {
+            for (const auto &ref : references(def->value))
+            {
+                if (!lookup(ref))
+                    continue; // 进程环境中的变量已经展开，不会形成环
+                if (ref == name)
+                    selfLoop = true;
+                if (!index.count(ref))
+                {
+                    visit(ref);
+                    low[name] = (std::min)(low[name], low[ref]);
+                }
+                else if (onStack.count(ref))
+                {
+                    low[name] = (std::min)(low[name], index[ref]);
+                }
+            }
+        }
+        if (low[name] != index[name])
+            return;
+        std::vector<std::string> component;
+        while (true)
+        {
+            std::string top = stack.back();
+            stack.pop_back();
+            onStack.erase(top);
+            component.push_back(top);
+            if (top == name)
+                break;
+        }
+        if (component.size() > 1 || selfLoop)
+            cyclicNames.insert(component.begin(), component.end());
+    };
+    for (const auto &name : names)
+    {
+        if (!index.count(name))
+            visit(name);
+    }
+}
+
+EnvExpander::Expansion EnvExpander::expandVariable(const std::string &name)
+{
+    std::string lower = toLowerAscii(name);
+    auto memo = variableMemo.find(lower);
+    if (memo != variableMemo.end())
+        return memo->second;
+    if (cyclesDirty)
+        findCycles();
+
+    Expansion result{std::string(), std::vector<std::string>(1, lower), false, false};
+    const Definition *def = lookup(lower);
+    if (cyclicNames.count(lower))
+    {
+        // 环中任何一个变量变化都可能打破环
+        result.cyclic = true;
+        result.deps.assign(cyclicNames.begin(), cyclicNames.end());
+    }
+    else if (def)
+    {
+        result.defined = true;
+        if (def->expandable)
+        {
+            Expansion inner = expandText(def->value);
+            result.value = std::move(inner.value);
+            result.deps.insert(result.deps.end(), inner.deps.begin(), inner.deps.end());
+            result.cyclic = inner.cyclic;
+        }
+        else
+        {
+            result.value = def->value;
+        }
+    }
+    else if (fallback)
+    {
+        result.defined = fallback(name, result.value);
+    }
+    variableMemo.emplace(lower, result);
+    return result;
+}
+
+EnvExpander::Expansion EnvExpander::expandText(const std::string &text)
+{
+    Expansion result{std::string(), std::vector<std::string>(), true, false};
+    result.value.reserve(text.size());
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        size_t open = text.find('%', pos);
+        size_t close = open == std::string::npos ? std::string::npos : text.find('%', open + 1);
+        if (close == std::string::npos)
+        {
+            result.value.append(text, pos, std::string::npos);
+            break;
+        }
+        result.value.append(text, pos, open - pos);
+        if (close == open + 1)
+        {
+            result.value.push_back('%');
+            pos = close;
+            continue;
+        }
+        std::string name = text.substr(open + 1, close - open - 1);
+        Expansion variable = expandVariable(name);
+        // 未定义或在环中的引用原样保留
+        if (variable.defined)
+            result.value += variable.value;
+        else
+            result.value.append(text, open, close - open + 1);
+        result.deps.insert(result.deps.end(), variable.deps.begin(), variable.deps.end());
+        result.cyclic = result.cyclic || variable.cyclic;
+        pos = close + 1;
+    }
+    std::sort(result.deps.begin(), result.deps.end());
+    result.deps.erase(std::unique(result.deps.begin(), result.deps.end()), result.deps.end());
+    return result;
+}
+
+std::string EnvExpander::expand(const std::string &text)
+{
+    if (text.find('%') == std::string::npos)
+        return text;
+    auto memo = textMemo.find(text);
+    if (memo != textMemo.end())
+        return memo->second.value;
+    Expansion result = expandText(text);
+    for (const auto &dep : result.deps)
+    {
+        dependents[dep].insert(text);
+    }
+    return textMemo.emplace(text, std::move(result)).first->second.value;
+}
+
+bool EnvExpander::isCyclic(const std::string &text)
+{
+    if (text.find('%') == std::string::npos)
+        return false;
+    expand(text);
+    return textMemo[text].cyclic;
+}
+
+std::vector<std::string> EnvExpander::cyclicVariables()
+{
+    if (cyclesDirty)
+        findCycles();
+    std::vector<std::string> names;
+    for (const auto &lower : cyclicNames)
+    {
+        names.push_back(lookup(lower)->name);
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+size_t EnvExpander::memoSize() const
+{
+    return textMemo.size();
+}
+
+std::vector<std::string> EnvExpander::invalidate(const std::vector<std::string> &lowerNames)
+{
+    std::vector<std::string> affected;
+    if (lowerNames.empty())
+        return affected;
+    cyclesDirty = true;
+    std::unordered_set<std::string> changed(lowerNames.begin(), lowerNames.end());
+    auto dependsOnChange = [&changed](const Expansion &expansion) {
+        for (const auto &dep : expansion.deps)
+        {
+            if (changed.count(dep))
+                return true;
+        }
+        return false;
+    };
+
+    // 依赖记录包含间接引用，所以只需要看直接记录的变量名
+    for (auto it = variableMemo.begin(); it != variableMemo.end();)
+    {
+        if (dependsOnChange(it->second))
+            it = variableMemo.erase(it);
+        else
+            ++it;
+    }
+    for (const auto &name : lowerNames)
+    {
+        auto dep = dependents.find(name);
+        if (dep == dependents.end())
+            continue;
+        std::vector<std::string> texts(dep->second.begin(), dep->second.end());
+        for (const auto &text : texts)
+        {
+            auto memo = textMemo.find(text);
+            if (memo == textMemo.end())
+                continue;
+            for (const auto &other : memo->second.deps)
+            {
+                auto list = dependents.find(other);
+                if (list == dependents.end())
+                    continue;
+                list->second.erase(text);
+                if (list->second.empty())
+                    dependents.erase(list);
+            }
+            textMemo.erase(memo);
+            affected.push_back(text);
+        }
+    }
+    return affected;
+}
+
+std::vector<std::string> EnvExpander::setVariables(Scope scope, const std::vector<EnvVariable_t> &variables)
+{
+    std::unordered_map<std::string, Definition> next;
+    for (const auto &variable : variables)
+    {
+        next[toLowerAscii(variable.name)] = Definition{variable.name, variable.value, variable.expandable};
+    }
+    std::vector<std::string> changed;
+    for (const auto &item : next)
+    {
+        auto old = scopes[scope].find(item.first);
+        if (old == scopes[scope].end() || old->second.value != item.second.value ||
+            old->second.expandable != item.second.expandable)
+            changed.push_back(item.first);
+    }
+    for (const auto &item : scopes[scope])
+    {
+        if (!next.count(item.first))
+            changed.push_back(item.first);
+    }
+    scopes[scope].swap(next);
+    return invalidate(changed);
+}
+
+std::vector<std::string> EnvExpander::setVariable(Scope scope, const EnvVariable_t &variable)
+{
+    std::string lower = toLowerAscii(variable.name);
+    auto old = scopes[scope].find(lower);
+    if (old != scopes[scope].end() && old->second.value == variable.value && old->second.expandable == variable.expandable)
+        return std::vector<std::string>();
+    scopes[scope][lower] = Definition{variable.name, variable.value, variable.expandable};
+    return invalidate(std::vector<std::string>(1, lower));
+}
+
+std::vector<std::string> EnvExpander::removeVariable(Scope scope, const std::string &name)
+{
+    std::string lower = toLowerAscii(name);
+    if (!scopes[scope].erase(lower))
+        return std::vector<std::string>();
+    return invalidate(std::vector<std::string>(1, lower));
+}
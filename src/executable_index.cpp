@@ -0,0 +1,500 @@
+#include "executable_index.hpp"
+#include "path_utils.hpp"
+#include <filesystem>
+#include <algorithm>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+ExecutableIndex::ExecutableIndex(size_t threadCount)
+    : extensions(executableExtensions()),
+      systemCount(0),
+      pool(threadCount != 0 ? threadCount : (std::thread::hardware_concurrency() > 4 ? std::thread::hardware_concurrency() : 4))
+{
+}
+
+void ExecutableIndex::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+}
+
+void ExecutableIndex::setResultsReady(std::function<void()> callback)
+{
+    resultsReady = std::move(callback);
+}
+
+std::string ExecutableIndex::entryKey(const std::string &rawPath, bool user)
+{
+    return (user ? "U|" : "S|") + rawPath;
+}
+
+size_t ExecutableIndex::directoryId(const std::string &rawPath)
+{
+    std::string expanded = expander ? expander(rawPath) : rawPath;
+    std::string key = normalizePathKey(expanded);
+    auto it = directoryIds.find(key);
+    if (it != directoryIds.end())
+    {
+        return it->second;
+    }
+    size_t id = directories.size();
+    directories.push_back(Directory{expanded, Listing_t(), false, false, false, 0});
+    directoryIds.emplace(key, id);
+    return id;
+}
+
+void ExecutableIndex::addCommands(size_t id)
+{
+    for (const auto &command : directories[id].listing.commands)
+    {
+        commandDirs[command].push_back(id);
+    }
+}
+
+void ExecutableIndex::removeCommands(size_t id)
+{
+    for (const auto &command : directories[id].listing.commands)
+    {
+        auto it = commandDirs.find(command);
+        if (it == commandDirs.end())
+            continue;
+        auto &dirs = it->second;
+        dirs.erase(std::remove(dirs.begin(), dirs.end(), id), dirs.end());
+        if (dirs.empty())
+            commandDirs.erase(it);
+    }
+}
+
+void ExecutableIndex::activate(size_t id)
+{
+    Directory &dir = directories[id];
+    dir.active = true;
+    if (dir.scanned)
+    {
+        addCommands(id);
+    }
+    else if (!dir.scanning)
+    {
+        scan(id);
+    }
+}
+
+void ExecutableIndex::deactivate(size_t id)
+{
+    Directory &dir = directories[id];
+    dir.active = false;
+    if (dir.scanned)
+    {
+        removeCommands(id);
+    }
+}
+
+void ExecutableIndex::scan(size_t id)
+{
+    directories[id].scanning = true;
+    std::string expanded = directories[id].expanded;
+    std::vector<std::string> exts = extensions;
+    pool.submit([this, id, expanded, exts]() {
+        Listing_t listing = listDirectory(expanded, exts);
+        bool wasEmpty;
+        {
+            std::lock_guard<std::mutex> lock(finishedMutex);
+            wasEmpty = finished.empty();
+            finished.emplace_back(id, std::move(listing));
+        }
+        // 一批结果只通知一次
+        if (wasEmpty && resultsReady)
+        {
+            resultsReady();
+        }
+    });
+}
+
+void ExecutableIndex::setOrder(const std::vector<std::string> &systemPaths, const std::vector<std::string> &userPaths)
+{
+    std::vector<std::string> newPaths;
+    newPaths.reserve(systemPaths.size() + userPaths.size());
+    newPaths.insert(newPaths.end(), systemPaths.begin(), systemPaths.end());
+    newPaths.insert(newPaths.end(), userPaths.begin(), userPaths.end());
+
+    std::vector<size_t> newIds;
+    newIds.reserve(newPaths.size());
+    for (const auto &raw : newPaths)
+    {
+        newIds.push_back(directoryId(raw));
+    }
+
+    // 只有进出顺序的目录需要增删命令；留下的目录只更新位置
+    std::vector<uint8_t> keep(directories.size(), 0);
+    for (size_t i = 0; i < newIds.size(); i++)
+    {
+        if (!keep[newIds[i]])
+        {
+            keep[newIds[i]] = 1;
+            directories[newIds[i]].position = i;
+        }
+    }
+    for (size_t id : orderIds)
+    {
+        if (directories[id].active && !keep[id])
+            deactivate(id);
+    }
+    for (size_t id : newIds)
+    {
+        if (!directories[id].active)
+            activate(id);
+    }
+
+    orderPaths.swap(newPaths);
+    orderIds.swap(newIds);
+    systemCount = systemPaths.size();
+    rebuildEntries();
+}
+
+void ExecutableIndex::rescanAll()
+{
+    for (size_t id = 0; id < directories.size(); id++)
+    {
+        Directory &dir = directories[id];
+        if (dir.scanned && dir.active)
+        {
+            removeCommands(id);
+        }
+        dir.scanned = false;
+        dir.listing = Listing_t();
+        if (dir.active && !dir.scanning)
+        {
+            scan(id);
+        }
+    }
+    rebuildEntries();
+}
+
+size_t ExecutableIndex::drain()
+{
+    std::vector<std::pair<size_t, Listing_t>> batch;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        batch.swap(finished);
+    }
+    if (batch.empty())
+    {
+        return 0;
+    }
+    for (auto &item : batch)
+    {
+        Directory &dir = directories[item.first];
+        if (dir.scanned && dir.active)
+        {
+            removeCommands(item.first);
+        }
+        dir.listing = std::move(item.second);
+        dir.scanned = true;
+        dir.scanning = false;
+        if (dir.active)
+        {
+            addCommands(item.first);
+        }
+    }
+    rebuildEntries();
+    return batch.size();
+}
+
+bool ExecutableIndex::isScanning() const
+{
+    for (size_t id : orderIds)
+    {
+        if (directories[id].scanning)
+            return true;
+    }
+    return false;
+}
+
+size_t ExecutableIndex::winnerOf(const std::vector<size_t> &dirs) const
+{
+    size_t winner = dirs.front();
+    for (size_t id : dirs)
+    {
+        if (directories[id].position < directories[winner].position)
+            winner = id;
+    }
+    return winner;
+}
+
+void ExecutableIndex::rebuildEntries()
+{
+    entries.clear();
+    entries.reserve(orderPaths.size());
+    entryIndex.clear();
+    for (size_t i = 0; i < orderPaths.size(); i++)
+    {
+        size_t id = orderIds[i];
+        const Directory &dir = directories[id];
+        ShadowEntry_t entry{orderPaths[i], i >= systemCount, dir.scanned, dir.position != i, 0, 0, 0};
+        if (!entry.duplicate && dir.scanned)
+        {
+            entry.commandCount = dir.listing.commands.size();
+            for (const auto &command : dir.listing.commands)
+            {
+                auto it = commandDirs.find(command);
+                if (it == commandDirs.end() || winnerOf(it->second) != id)
+                    continue;
+                entry.effectiveCount++;
+                entry.shadowingCount += it->second.size() - 1;
+            }
+        }
+        entryIndex.emplace(entryKey(entry.path, entry.user), entries.size());
+        entries.push_back(std::move(entry));
+    }
+}
+
+std::string ExecutableIndex::commandKey(const std::string &command) const
+{
+    if (extensions.empty())
+    {
+        return command;
+    }
+    std::string name = toLowerAscii(command);
+    // 带了PATHEXT中的扩展名时按去掉扩展名的命令查找
+    for (const auto &ext : extensions)
+    {
+        if (name.size() > ext.size() && name.compare(name.size() - ext.size(), ext.size(), ext) == 0)
+        {
+            name.resize(name.size() - ext.size());
+            break;
+        }
+    }
+    return name;
+}
+
+size_t ExecutableIndex::probesPerDirectory() const
+{
+    return extensions.empty() ? 1 : extensions.size();
+}
+
+void ExecutableIndex::lookupCommand(const std::string &key, std::vector<std::pair<size_t, size_t>> &hits) const
+{
+    hits.clear();
+    auto it = commandDirs.find(key);
+    if (it == commandDirs.end())
+    {
+        return;
+    }
+    for (size_t id : it->second)
+    {
+        const Listing_t &listing = directories[id].listing;
+        auto pos = std::lower_bound(listing.commands.begin(), listing.commands.end(), key);
+        size_t probes = 1;
+        if (!extensions.empty() && pos != listing.commands.end() && *pos == key)
+        {
+            // 按PATHEXT顺序尝试，找到的扩展名之前的都落空
+            const std::string &file = listing.files[pos - listing.commands.begin()];
+            std::string ext = toLowerAscii(file.substr(file.rfind('.')));
+            probes = std::find(extensions.begin(), extensions.end(), ext) - extensions.begin() + 1;
+        }
+        hits.emplace_back(directories[id].position, probes);
+    }
+    std::sort(hits.begin(), hits.end());
+}
+
+void ExecutableIndex::precedencePairs(std::vector<std::pair<size_t, size_t>> &pairs) const
+{
+    pairs.clear();
+    for (const auto &pair : commandDirs)
+    {
+        std::vector<size_t> positions;
+        positions.reserve(pair.second.size());
+        for (size_t id : pair.second)
+        {
+            positions.push_back(directories[id].position);
+        }
+        std::sort(positions.begin(), positions.end());
+        // 相邻两两约束即可，传递后覆盖全部先后关系
+        for (size_t i = 1; i < positions.size(); i++)
+        {
+            pairs.emplace_back(positions[i - 1], positions[i]);
+        }
+    }
+    for (size_t i = 0; i < orderIds.size(); i++)
+    {
+        size_t first = directories[orderIds[i]].position;
+        if (first != i)
+            pairs.emplace_back(first, i);
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+}
+
+std::vector<std::string> ExecutableIndex::resolve(const std::string &command) const
+{
+    std::vector<std::string> files;
+    std::string name = commandKey(command);
+    auto it = commandDirs.find(name);
+    if (it == commandDirs.end())
+    {
+        return files;
+    }
+    std::vector<size_t> dirs = it->second;
+    std::sort(dirs.begin(), dirs.end(), [this](size_t a, size_t b) {
+        return directories[a].position < directories[b].position;
+    });
+    for (size_t id : dirs)
+    {
+        const Listing_t &listing = directories[id].listing;
+        auto pos = std::lower_bound(listing.commands.begin(), listing.commands.end(), name);
+        if (pos == listing.commands.end() || *pos != name)
+            continue;
+        fs::path file = fs::path(directories[id].expanded) / listing.files[pos - listing.commands.begin()];
+        files.push_back(file.string());
+    }
+    return files;
+}
+
+const std::vector<ShadowEntry_t> &ExecutableIndex::shadowEntries() const
+{
+    return entries;
+}
+
+std::vector<ShadowConflict_t> ExecutableIndex::conflicts() const
+{
+    std::vector<ShadowConflict_t> result;
+    for (const auto &pair : commandDirs)
+    {
+        if (pair.second.size() > 1)
+        {
+            result.push_back(ShadowConflict_t{pair.first, resolve(pair.first)});
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const ShadowConflict_t &a, const ShadowConflict_t &b) {
+        return a.command < b.command;
+    });
+    return result;
+}
+
+bool ExecutableIndex::isFullyShadowed(const std::string &rawPath, bool user) const
+{
+    auto it = entryIndex.find(entryKey(rawPath, user));
+    if (it == entryIndex.end())
+    {
+        return false;
+    }
+    const ShadowEntry_t &entry = entries[it->second];
+    return entry.duplicate || (entry.scanned && entry.commandCount > 0 && entry.effectiveCount == 0);
+}
+
+std::string ExecutableIndex::formatReport() const
+{
+    std::ostringstream out;
+    size_t scannedCount = 0;
+    for (const auto &entry : entries)
+    {
+        if (entry.scanned)
+            scannedCount++;
+    }
+    std::vector<ShadowConflict_t> list = conflicts();
+    out << "生效的PATH条目 " << entries.size() << " 个（已扫描 " << scannedCount << " 个），命令 "
+        << commandDirs.size() << " 个，其中 " << list.size() << " 个在多个目录中出现\n\n";
+
+    out << "各条目（按PATH顺序）:\n";
+    for (const auto &entry : entries)
+    {
+        out << (entry.user ? "[用户] " : "[系统] ") << entry.path;
+        if (entry.duplicate)
+        {
+            out << "    与前面的条目重复，不会被用到\n";
+            continue;
+        }
+        if (!entry.scanned)
+        {
+            out << "    扫描中\n";
+            continue;
+        }
+        out << "    命令 " << entry.commandCount << "，生效 " << entry.effectiveCount
+            << "，遮蔽后面 " << entry.shadowingCount << " 个";
+        if (entry.commandCount > 0 && entry.effectiveCount == 0)
+            out << "    全部被遮蔽";
+        out << "\n";
+    }
+
+    out << "\n同名命令（第一个生效）:\n";
+    for (const auto &conflict : list)
+    {
+        out << conflict.command << "\n";
+        for (size_t i = 0; i < conflict.files.size(); i++)
+        {
+            out << (i == 0 ? "  -> " : "     ") << conflict.files[i] << "\n";
+        }
+    }
+    return out.str();
+}
+
+ExecutableIndex::Listing_t ExecutableIndex::listDirectory(const std::string &expandedPath, const std::vector<std::string> &extensions)
+{
+    // 命令名 -> (扩展名优先级, 文件名)
+    std::unordered_map<std::string, std::pair<size_t, std::string>> best;
+    std::error_code ec;
+    fs::directory_iterator it(fs::path(expandedPath), ec);
+    fs::directory_iterator end;
+    for (; !ec && it != end; it.increment(ec))
+    {
+        std::error_code statEc;
+        if (!it->is_regular_file(statEc))
+            continue;
+        std::string fileName;
+        try
+        {
+            fileName = it->path().filename().string();
+        }
+        catch (...)
+        {
+            continue; // 文件名无法转换为当前代码页
+        }
+
+        std::string command;
+        size_t rank = 0;
+        if (extensions.empty())
+        {
+            // 没有PATHEXT的平台按可执行权限判断
+            fs::perms perms = it->status(statEc).permissions();
+            if (statEc || (perms & (fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec)) == fs::perms::none)
+                continue;
+            command = fileName;
+        }
+        else
+        {
+            size_t dot = fileName.rfind('.');
+            if (dot == std::string::npos || dot == 0)
+                continue;
+            std::string ext = toLowerAscii(fileName.substr(dot));
+            auto extIt = std::find(extensions.begin(), extensions.end(), ext);
+            if (extIt == extensions.end())
+                continue;
+            rank = extIt - extensions.begin();
+            command = toLowerAscii(fileName.substr(0, dot));
+        }
+
+        auto found = best.find(command);
+        if (found == best.end())
+            best.emplace(std::move(command), std::make_pair(rank, std::move(fileName)));
+        else if (rank < found->second.first)
+            found->second = std::make_pair(rank, std::move(fileName));
+    }
+
+    // 按命令名排序，resolve时二分查找
+    std::vector<std::pair<std::string, std::string>> sorted;
+    sorted.reserve(best.size());
+    for (auto &pair : best)
+    {
+        sorted.emplace_back(pair.first, std::move(pair.second.second));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    Listing_t listing;
+    listing.commands.reserve(sorted.size());
+    listing.files.reserve(sorted.size());
+    for (auto &pair : sorted)
+    {
+        listing.commands.push_back(std::move(pair.first));
+        listing.files.push_back(std::move(pair.second));
+    }
+    return listing;
+}
@@ -0,0 +1,98 @@
+#include "file_identity.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+bool FileIdentityCache::queryIdentity(const std::string &expandedPath, FileIdentity_t &identity)
+{
+#ifdef _WIN32
+    // 打开目录需要FILE_FLAG_BACKUP_SEMANTICS；不请求读写权限，只取属性
+    HANDLE handle = CreateFileA(expandedPath.c_str(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    BY_HANDLE_FILE_INFORMATION info;
+    BOOL ok = GetFileInformationByHandle(handle, &info);
+    CloseHandle(handle);
+    if (!ok)
+    {
+        return false;
+    }
+    identity.volume = info.dwVolumeSerialNumber;
+    identity.fileId = (static_cast<uint64_t>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    return true;
+#else
+    struct stat st;
+    if (stat(expandedPath.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    identity.volume = static_cast<uint64_t>(st.st_dev);
+    identity.fileId = static_cast<uint64_t>(st.st_ino);
+    return true;
+#endif
+}
+
+bool FileIdentityCache::queryStamp(const std::string &expandedPath, Stamp_t &stamp)
+{
+#ifdef _WIN32
+    // 不跟随联接点，联接点被改指向时属性和时间会变化
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExA(expandedPath.c_str(), GetFileExInfoStandard, &data))
+    {
+        return false;
+    }
+    stamp.values[0] = data.dwFileAttributes;
+    stamp.values[1] = (static_cast<uint64_t>(data.ftCreationTime.dwHighDateTime) << 32) | data.ftCreationTime.dwLowDateTime;
+    stamp.values[2] = (static_cast<uint64_t>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    return true;
+#else
+    // lstat不跟随符号链接，链接被重建时inode会变化
+    struct stat st;
+    if (lstat(expandedPath.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    stamp.values[0] = static_cast<uint64_t>(st.st_ino);
+    stamp.values[1] = static_cast<uint64_t>(st.st_mtime);
+    stamp.values[2] = static_cast<uint64_t>(st.st_ctime);
+    return true;
+#endif
+}
+
+bool FileIdentityCache::lookup(const std::string &expandedPath, FileIdentity_t &identity)
+{
+    Stamp_t stamp;
+    if (!queryStamp(expandedPath, stamp))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries.erase(expandedPath);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(expandedPath);
+        if (it != entries.end() && it->second.stamp == stamp)
+        {
+            identity = it->second.identity;
+            return true;
+        }
+    }
+    if (!queryIdentity(expandedPath, identity))
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    entries[expandedPath] = Entry{identity, stamp};
+    return true;
+}
+
+void FileIdentityCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+}
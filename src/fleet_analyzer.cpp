@@ -0,0 +1,510 @@
+#include "fleet_analyzer.hpp"
+#include "path_state_store.hpp"
+#include "path_utils.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+// 每个任务读取的文件数，避免每个文件一个任务的调度开销
+static const size_t filesPerTask = 32;
+// 报告中各列表最多列出的行数
+static const size_t reportLimit = 20;
+
+uint32_t PathInternTable::intern(const std::string &key, const std::string &spelling)
+{
+    size_t shardIndex = std::hash<std::string>()(key) & (shardCount - 1);
+    Shard &shard = shards[shardIndex];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.ids.find(key);
+    if (it != shard.ids.end())
+    {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>((shard.spellings.size() << shardBits) | shardIndex);
+    shard.ids.emplace(key, id);
+    shard.spellings.push_back(spelling);
+    return id;
+}
+
+const std::string &PathInternTable::spelling(uint32_t id) const
+{
+    return shards[id & (shardCount - 1)].spellings[id >> shardBits];
+}
+
+uint32_t PathInternTable::idLimit() const
+{
+    size_t largest = 0;
+    for (const auto &shard : shards)
+    {
+        largest = (std::max)(largest, shard.spellings.size());
+    }
+    return static_cast<uint32_t>(largest << shardBits);
+}
+
+size_t PathInternTable::size() const
+{
+    size_t total = 0;
+    for (const auto &shard : shards)
+    {
+        total += shard.spellings.size();
+    }
+    return total;
+}
+
+static uint64_t mix64(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+FleetAnalyzer::FleetAnalyzer() : options{0.8, 2, 0}, loadSeconds(0), clusterSeconds(0)
+{
+}
+
+void FleetAnalyzer::loadMachine(const fs::path &file, Machine_t &machine)
+{
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    machine.readable = PathStateStore::readAnyFile(file, systemPaths, userPaths);
+    machine.systemCount = 0;
+    machine.userCount = 0;
+    machine.ids.clear();
+    machine.ids.reserve(systemPaths.size() + userPaths.size());
+    for (const auto &item : systemPaths)
+    {
+        if (item.enabled)
+        {
+            machine.ids.push_back(table.intern(normalizePathKey(item.path), item.path));
+            machine.systemCount++;
+        }
+    }
+    for (const auto &item : userPaths)
+    {
+        if (item.enabled)
+        {
+            machine.ids.push_back(table.intern(normalizePathKey(item.path), item.path));
+            machine.userCount++;
+        }
+    }
+    std::sort(machine.ids.begin(), machine.ids.end());
+    machine.ids.erase(std::unique(machine.ids.begin(), machine.ids.end()), machine.ids.end());
+
+    // MinHash：每个哈希函数取集合中的最小值，两台机器某一位相同的概率等于它们的Jaccard相似度
+    for (size_t i = 0; i < signatureSize; i++)
+    {
+        uint64_t seed = mix64(i + 1);
+        uint32_t lowest = UINT32_MAX;
+        for (uint32_t id : machine.ids)
+        {
+            lowest = (std::min)(lowest, static_cast<uint32_t>(mix64(id ^ seed)));
+        }
+        machine.signature[i] = lowest;
+    }
+}
+
+double FleetAnalyzer::estimate(const Machine_t &a, const Machine_t &b)
+{
+    size_t same = 0;
+    for (size_t i = 0; i < signatureSize; i++)
+    {
+        if (a.signature[i] == b.signature[i])
+            same++;
+    }
+    return static_cast<double>(same) / signatureSize;
+}
+
+static size_t findRoot(std::vector<size_t> &parent, size_t x)
+{
+    while (parent[x] != x)
+    {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+// 分段LSH：签名分成若干段，任意一段完全相同的机器成为候选，估计相似度达到阈值的合并（单链接）。
+// 同一个桶里只与第一台比较，总比较次数与机器数成正比
+void FleetAnalyzer::buildClusters()
+{
+    size_t n = machines.size();
+    std::vector<size_t> parent(n);
+    std::iota(parent.begin(), parent.end(), 0);
+    std::unordered_map<uint64_t, size_t> buckets;
+    buckets.reserve(n);
+    for (size_t band = 0; band < signatureSize / bandRows; band++)
+    {
+        buckets.clear();
+        for (size_t m = 0; m < n; m++)
+        {
+            const Machine_t &machine = machines[m];
+            if (!machine.readable)
+                continue;
+            uint64_t key = mix64(band);
+            for (size_t r = 0; r < bandRows; r++)
+            {
+                key = mix64(key ^ machine.signature[band * bandRows + r]);
+            }
+            auto inserted = buckets.emplace(key, m);
+            if (inserted.second)
+                continue;
+            size_t first = inserted.first->second;
+            if (estimate(machines[first], machine) >= options.threshold)
+            {
+                size_t a = findRoot(parent, first);
+                size_t b = findRoot(parent, m);
+                if (a != b)
+                    parent[(std::max)(a, b)] = (std::min)(a, b);
+            }
+        }
+    }
+
+    std::unordered_map<size_t, size_t> indexOfRoot;
+    clusters.clear();
+    for (size_t m = 0; m < n; m++)
+    {
+        if (!machines[m].readable)
+            continue;
+        size_t root = findRoot(parent, m);
+        auto it = indexOfRoot.emplace(root, clusters.size()).first;
+        if (it->second == clusters.size())
+            clusters.push_back(Cluster_t{std::vector<size_t>(), 0});
+        clusters[it->second].members.push_back(m);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster_t &a, const Cluster_t &b) {
+        return a.members.size() > b.members.size();
+    });
+    clusterOf.assign(n, SIZE_MAX);
+    std::unordered_map<uint32_t, size_t> counts;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        counts.clear();
+        for (size_t m : clusters[c].members)
+        {
+            clusterOf[m] = c;
+            for (uint32_t id : machines[m].ids)
+                counts[id]++;
+        }
+        for (const auto &count : counts)
+        {
+            if (count.second * 2 >= clusters[c].members.size())
+                clusters[c].corePaths++;
+        }
+    }
+}
+
+bool FleetAnalyzer::analyze(const fs::path &dir, const Options_t &analyzeOptions)
+{
+    options = analyzeOptions;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<fs::path> files;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::string ext = toLowerAscii(it->path().extension().string());
+        std::error_code typeError;
+        if ((ext == ".json" || ext == ".txt") && it->is_regular_file(typeError))
+            files.push_back(it->path());
+    }
+    if (ec && files.empty())
+    {
+        return false;
+    }
+    std::sort(files.begin(), files.end());
+
+    machines.assign(files.size(), Machine_t());
+    {
+        ThreadPool pool(options.threads);
+        for (size_t first = 0; first < files.size(); first += filesPerTask)
+        {
+            size_t last = (std::min)(first + filesPerTask, files.size());
+            pool.submit([this, &files, first, last]() {
+                for (size_t i = first; i < last; i++)
+                    loadMachine(files[i], machines[i]);
+            });
+        }
+        pool.waitIdle();
+    }
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        fs::path relative = files[i].lexically_relative(dir);
+        machines[i].name = relative.replace_extension().generic_string();
+    }
+
+    frequency.assign(table.idLimit(), 0);
+    for (const auto &machine : machines)
+    {
+        for (uint32_t id : machine.ids)
+            frequency[id]++;
+    }
+    auto loaded = std::chrono::steady_clock::now();
+    buildClusters();
+    auto clustered = std::chrono::steady_clock::now();
+    loadSeconds = std::chrono::duration<double>(loaded - start).count();
+    clusterSeconds = std::chrono::duration<double>(clustered - loaded).count();
+    return true;
+}
+
+bool FleetAnalyzer::setGolden(const fs::path &file)
+{
+    Machine_t machine;
+    loadMachine(file, machine);
+    if (!machine.readable)
+    {
+        return false;
+    }
+    golden = std::move(machine.ids);
+    goldenName = file.filename().string();
+    return true;
+}
+
+const std::vector<FleetAnalyzer::Machine_t> &FleetAnalyzer::machineList() const
+{
+    return machines;
+}
+
+const std::vector<FleetAnalyzer::Cluster_t> &FleetAnalyzer::clusterList() const
+{
+    return clusters;
+}
+
+void FleetAnalyzer::reportClusters(std::ostringstream &out) const
+{
+    out << "\nclusters (estimated similarity >= " << options.threshold << "):\n";
+    for (size_t c = 0; c < clusters.size() && c < reportLimit; c++)
+    {
+        const Cluster_t &cluster = clusters[c];
+        if (cluster.members.size() < options.minClusterSize)
+            break;
+        std::string examples;
+        for (size_t i = 0; i < cluster.members.size() && i < 3; i++)
+        {
+            examples += (i ? ", " : "") + machines[cluster.members[i]].name;
+        }
+        out << "  #" << std::left << std::setw(3) << c + 1 << std::right << " " << std::setw(6) << cluster.members.size()
+            << " machines  " << std::setw(4) << cluster.corePaths << " core paths  e.g. " << examples
+            << (cluster.members.size() > 3 ? ", ..." : "") << "\n";
+    }
+}
+
+// 离群：所在类太小。给出最相近的大类和只有它自己有的路径
+void FleetAnalyzer::reportOutliers(std::ostringstream &out) const
+{
+    std::vector<size_t> outliers;
+    size_t largeClusters = 0;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        if (clusters[c].members.size() >= options.minClusterSize)
+            largeClusters = c + 1;
+        else
+            outliers.insert(outliers.end(), clusters[c].members.begin(), clusters[c].members.end());
+    }
+    std::sort(outliers.begin(), outliers.end());
+    out << "\noutliers (" << outliers.size() << " machine(s) in clusters smaller than " << options.minClusterSize << "):\n";
+    for (size_t i = 0; i < outliers.size() && i < reportLimit; i++)
+    {
+        const Machine_t &machine = machines[outliers[i]];
+        double best = 0;
+        size_t nearest = SIZE_MAX;
+        for (size_t c = 0; c < largeClusters; c++)
+        {
+            double similarity = estimate(machine, machines[clusters[c].members[0]]);
+            if (similarity > best)
+            {
+                best = similarity;
+                nearest = c;
+            }
+        }
+        std::string unique;
+        size_t uniqueCount = 0;
+        for (uint32_t id : machine.ids)
+        {
+            if (frequency[id] != 1)
+                continue;
+            if (uniqueCount++ < 3)
+                unique += (unique.empty() ? "" : ", ") + table.spelling(id);
+        }
+        out << "  " << std::left << std::setw(32) << machine.name << std::right;
+        if (nearest == SIZE_MAX)
+            out << " no similar cluster";
+        else
+            out << " nearest #" << nearest + 1 << " (" << best << ")";
+        if (uniqueCount > 0)
+            out << "  " << uniqueCount << " unique: " << unique << (uniqueCount > 3 ? ", ..." : "");
+        out << "\n";
+    }
+    if (outliers.size() > reportLimit)
+        out << "  ... " << outliers.size() - reportLimit << " more\n";
+}
+
+// 目录前缀按机器数统计；只列出再往下一级机器数就会减少的前缀
+void FleetAnalyzer::reportPrefixes(std::ostringstream &out) const
+{
+    // 每个不同的路径只切分一次，前缀也放进一张表
+    std::unordered_map<std::string, uint32_t> prefixIds;
+    std::vector<std::string> prefixNames;
+    std::vector<size_t> prefixDepth;
+    std::vector<std::vector<uint32_t>> prefixesOf(frequency.size());
+    for (uint32_t id = 0; id < frequency.size(); id++)
+    {
+        if (frequency[id] == 0)
+            continue;
+        std::string key = normalizePathKey(table.spelling(id));
+        size_t depth = 0;
+        for (size_t pos = key.find_first_of("\\/", 1); pos != std::string::npos; pos = key.find_first_of("\\/", pos + 1))
+        {
+            depth++;
+            if (pos == 2 && key[1] == ':')
+                continue; // 只有盘符的前缀没有意义
+            auto inserted = prefixIds.emplace(key.substr(0, pos), static_cast<uint32_t>(prefixNames.size()));
+            if (inserted.second)
+            {
+                prefixNames.push_back(inserted.first->first);
+                prefixDepth.push_back(depth);
+            }
+            prefixesOf[id].push_back(inserted.first->second);
+        }
+    }
+    std::vector<size_t> machineCount(prefixNames.size(), 0);
+    std::vector<uint32_t> seen;
+    for (const auto &machine : machines)
+    {
+        seen.clear();
+        for (uint32_t id : machine.ids)
+            seen.insert(seen.end(), prefixesOf[id].begin(), prefixesOf[id].end());
+        std::sort(seen.begin(), seen.end());
+        seen.erase(std::unique(seen.begin(), seen.end()), seen.end());
+        for (uint32_t p : seen)
+            machineCount[p]++;
+    }
+    // 有同样多机器的下一级前缀时，上一级不再单独列出
+    std::vector<bool> covered(prefixNames.size(), false);
+    for (const auto &pair : prefixIds)
+    {
+        const std::string &name = pair.first;
+        size_t cut = name.find_last_of("\\/");
+        if (cut == std::string::npos)
+            continue;
+        auto parent = prefixIds.find(name.substr(0, cut));
+        if (parent != prefixIds.end() && machineCount[parent->second] == machineCount[pair.second])
+            covered[parent->second] = true;
+    }
+    size_t readable = 0;
+    for (const auto &machine : machines)
+        readable += machine.readable ? 1 : 0;
+    std::vector<uint32_t> order;
+    for (uint32_t p = 0; p < prefixNames.size(); p++)
+    {
+        if (!covered[p] && machineCount[p] * 2 >= readable && readable > 0)
+            order.push_back(p);
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (machineCount[a] != machineCount[b])
+            return machineCount[a] > machineCount[b];
+        if (prefixDepth[a] != prefixDepth[b])
+            return prefixDepth[a] > prefixDepth[b];
+        return prefixNames[a] < prefixNames[b];
+    });
+    out << "\ncommon prefixes (on at least half of the machines):\n";
+    for (size_t i = 0; i < order.size() && i < reportLimit; i++)
+    {
+        out << "  " << std::setw(6) << machineCount[order[i]] << "  " << prefixNames[order[i]] << "\n";
+    }
+}
+
+void FleetAnalyzer::reportDrift(std::ostringstream &out) const
+{
+    if (goldenName.empty())
+        return;
+    out << "\ndrift from " << goldenName << " (" << golden.size() << " paths):\n";
+    std::unordered_map<uint32_t, size_t> missingCount;
+    std::unordered_map<uint32_t, size_t> extraCount;
+    struct Distance {
+        double jaccard;
+        size_t machine;
+        size_t missing;
+        size_t extra;
+    };
+    std::vector<Distance> distances;
+    size_t exact = 0;
+    for (size_t m = 0; m < machines.size(); m++)
+    {
+        const Machine_t &machine = machines[m];
+        if (!machine.readable)
+            continue;
+        // 两个有序集合归并
+        size_t i = 0, j = 0, common = 0, missing = 0, extra = 0;
+        while (i < golden.size() || j < machine.ids.size())
+        {
+            if (j == machine.ids.size() || (i < golden.size() && golden[i] < machine.ids[j]))
+            {
+                missingCount[golden[i++]]++;
+                missing++;
+            }
+            else if (i == golden.size() || machine.ids[j] < golden[i])
+            {
+                extraCount[machine.ids[j++]]++;
+                extra++;
+            }
+            else
+            {
+                common++;
+                i++;
+                j++;
+            }
+        }
+        size_t all = common + missing + extra;
+        double jaccard = all ? static_cast<double>(common) / all : 1.0;
+        if (missing == 0 && extra == 0)
+            exact++;
+        distances.push_back(Distance{jaccard, m, missing, extra});
+    }
+    out << "  " << exact << " of " << distances.size() << " machine(s) match exactly\n";
+
+    auto topCounts = [this, &out](const std::unordered_map<uint32_t, size_t> &counts, const char *title) {
+        std::vector<std::pair<size_t, uint32_t>> sorted;
+        for (const auto &count : counts)
+            sorted.push_back({count.second, count.first});
+        std::sort(sorted.begin(), sorted.end(), [this](const std::pair<size_t, uint32_t> &a, const std::pair<size_t, uint32_t> &b) {
+            return a.first != b.first ? a.first > b.first : table.spelling(a.second) < table.spelling(b.second);
+        });
+        if (!sorted.empty())
+            out << "  " << title << ":\n";
+        for (size_t i = 0; i < sorted.size() && i < reportLimit; i++)
+            out << "    " << std::setw(6) << sorted[i].first << "  " << table.spelling(sorted[i].second) << "\n";
+    };
+    topCounts(missingCount, "most often missing");
+    topCounts(extraCount, "most common additions");
+
+    std::sort(distances.begin(), distances.end(), [this](const Distance &a, const Distance &b) {
+        return a.jaccard != b.jaccard ? a.jaccard < b.jaccard : machines[a.machine].name < machines[b.machine].name;
+    });
+    out << "  furthest from the golden profile:\n";
+    for (size_t i = 0; i < distances.size() && i < reportLimit && distances[i].jaccard < 1.0; i++)
+    {
+        out << "    " << distances[i].jaccard << "  " << std::left << std::setw(32) << machines[distances[i].machine].name
+            << std::right << " -" << distances[i].missing << " +" << distances[i].extra << "\n";
+    }
+}
+
+std::string FleetAnalyzer::formatReport() const
+{
+    size_t unreadable = 0;
+    for (const auto &machine : machines)
+        unreadable += machine.readable ? 0 : 1;
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2);
+    out << machines.size() << " machine(s), " << unreadable << " unreadable, " << table.size() << " distinct paths, "
+        << clusters.size() << " cluster(s); loaded in " << loadSeconds << "s, clustered in " << clusterSeconds << "s\n";
+    reportClusters(out);
+    reportOutliers(out);
+    reportPrefixes(out);
+    reportDrift(out);
+    return out.str();
+}
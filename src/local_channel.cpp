@@ -0,0 +1,357 @@
+#include "local_channel.hpp"
+#include "path_state_store.hpp"
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#endif
+
+static const size_t bufferSize = 64 * 1024;
+
+#ifdef _WIN32
+// 在重叠方式打开的管道上读写一次，最多等timeoutMs；超时时取消这次读写
+static bool overlappedIo(HANDLE handle, HANDLE event, bool reading, char *data, DWORD size, DWORD &done,
+                         unsigned timeoutMs, bool &timedOut)
+{
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = event;
+    done = 0;
+    BOOL ok = reading ? ReadFile(handle, data, size, NULL, &overlapped) : WriteFile(handle, data, size, NULL, &overlapped);
+    if (!ok && GetLastError() != ERROR_IO_PENDING)
+        return false;
+    if (WaitForSingleObject(event, timeoutMs ? timeoutMs : INFINITE) != WAIT_OBJECT_0)
+    {
+        CancelIo(handle);
+        GetOverlappedResult(handle, &overlapped, &done, TRUE); // 等取消完成后overlapped才能释放
+        timedOut = true;
+        return false;
+    }
+    return GetOverlappedResult(handle, &overlapped, &done, FALSE) && done > 0;
+}
+
+static HANDLE createInstance(const std::string &name, bool first)
+{
+    // 第一个实例独占名字，别的进程不能抢先创建同名管道冒充服务端
+    DWORD openMode = PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | (first ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0);
+    return CreateNamedPipeA(name.c_str(), openMode,
+                            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+                            PIPE_UNLIMITED_INSTANCES, bufferSize, bufferSize, 0, NULL);
+}
+#endif
+
+LocalConnection::LocalConnection()
+#ifdef _WIN32
+    : handle(INVALID_HANDLE_VALUE), serverSide(false), ioEvent(NULL), timeoutMs(0), stalled(false)
+#else
+    : fd(-1)
+#endif
+{
+}
+
+LocalConnection::~LocalConnection()
+{
+    close();
+}
+
+bool LocalConnection::isOpen() const
+{
+#ifdef _WIN32
+    return handle != INVALID_HANDLE_VALUE;
+#else
+    return fd >= 0;
+#endif
+}
+
+void LocalConnection::close()
+{
+    buffer.clear();
+#ifdef _WIN32
+    if (handle == INVALID_HANDLE_VALUE)
+        return;
+    if (serverSide)
+    {
+        // 对方一直不读时FlushFileBuffers会一直等下去
+        if (!stalled)
+            FlushFileBuffers(handle);
+        DisconnectNamedPipe(handle);
+    }
+    CloseHandle(handle);
+    handle = INVALID_HANDLE_VALUE;
+    if (ioEvent)
+        CloseHandle(ioEvent);
+    ioEvent = NULL;
+    timeoutMs = 0;
+    stalled = false;
+#else
+    if (fd < 0)
+        return;
+    ::close(fd);
+    fd = -1;
+#endif
+}
+
+bool LocalConnection::connect(const std::string &name)
+{
+    close();
+#ifdef _WIN32
+    // 所有管道实例都忙时等待空出来；服务端刚接受一个连接、还没换上下一个实例时稍等再试
+    for (int attempt = 0; attempt < 5; attempt++)
+    {
+        handle = CreateFileA(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (handle != INVALID_HANDLE_VALUE)
+        {
+            serverSide = false;
+            return true;
+        }
+        DWORD error = GetLastError();
+        if (error == ERROR_PIPE_BUSY)
+        {
+            if (!WaitNamedPipeA(name.c_str(), 2000))
+                break;
+        }
+        else if (error == ERROR_FILE_NOT_FOUND && attempt < 2)
+        {
+            Sleep(20);
+        }
+        else
+        {
+            break;
+        }
+    }
+    return false;
+#else
+    sockaddr_un addr = {};
+    if (name.size() >= sizeof(addr.sun_path))
+        return false;
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+    {
+        close();
+        return false;
+    }
+    return true;
+#endif
+}
+
+void LocalConnection::setTimeout(unsigned milliseconds)
+{
+#ifdef _WIN32
+    timeoutMs = milliseconds;
+#else
+    if (fd < 0)
+        return;
+    timeval tv;
+    tv.tv_sec = milliseconds / 1000;
+    tv.tv_usec = (milliseconds % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+#endif
+}
+
+bool LocalConnection::readLine(std::string &line)
+{
+    size_t searched = 0;
+    for (;;)
+    {
+        size_t newline = buffer.find('\n', searched);
+        if (newline != std::string::npos)
+        {
+            line.assign(buffer, 0, newline);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            buffer.erase(0, newline + 1);
+            return true;
+        }
+        searched = buffer.size();
+        char chunk[4096];
+#ifdef _WIN32
+        DWORD got = 0;
+        if (handle == INVALID_HANDLE_VALUE)
+            return false;
+        if (ioEvent ? !overlappedIo(handle, ioEvent, true, chunk, sizeof(chunk), got, timeoutMs, stalled)
+                    : !ReadFile(handle, chunk, sizeof(chunk), &got, NULL) || got == 0)
+            return false;
+#else
+        if (fd < 0)
+            return false;
+        ssize_t got = ::read(fd, chunk, sizeof(chunk));
+        if (got <= 0)
+            return false;
+#endif
+        buffer.append(chunk, static_cast<size_t>(got));
+    }
+}
+
+bool LocalConnection::write(const std::string &data)
+{
+    size_t done = 0;
+    while (done < data.size())
+    {
+#ifdef _WIN32
+        DWORD wrote = 0;
+        char *start = const_cast<char *>(data.data()) + done;
+        DWORD size = static_cast<DWORD>(data.size() - done);
+        if (handle == INVALID_HANDLE_VALUE)
+            return false;
+        if (ioEvent ? !overlappedIo(handle, ioEvent, false, start, size, wrote, timeoutMs, stalled)
+                    : !WriteFile(handle, start, size, &wrote, NULL))
+            return false;
+#else
+        if (fd < 0)
+            return false;
+        ssize_t wrote = ::send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+        if (wrote <= 0)
+            return false;
+#endif
+        done += static_cast<size_t>(wrote);
+    }
+    return true;
+}
+
+LocalServer::LocalServer()
+#ifdef _WIN32
+    : nextPipe(INVALID_HANDLE_VALUE)
+#else
+    : fd(-1)
+#endif
+{
+}
+
+LocalServer::~LocalServer()
+{
+    close();
+}
+
+bool LocalServer::listen(const std::string &name)
+{
+    close();
+#ifdef _WIN32
+    // 已有服务端时创建第一个实例会失败
+    nextPipe = createInstance(name, true);
+    if (nextPipe == INVALID_HANDLE_VALUE)
+        return false;
+    channelName = name;
+    return true;
+#else
+    // 能连上说明已经有服务端
+    LocalConnection probe;
+    if (probe.connect(name))
+        return false;
+    channelName = name;
+    sockaddr_un addr = {};
+    if (name.size() >= sizeof(addr.sun_path))
+        return false;
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, name.c_str(), name.size() + 1);
+    unlink(name.c_str()); // 上次异常退出留下的套接字文件
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return false;
+    mode_t oldMask = umask(077);
+    bool ok = bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0 && ::listen(fd, 8) == 0;
+    umask(oldMask);
+    if (!ok)
+    {
+        close();
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool LocalServer::accept(LocalConnection &connection)
+{
+    connection.close();
+#ifdef _WIN32
+    if (channelName.empty())
+        return false;
+    if (nextPipe == INVALID_HANDLE_VALUE)
+        nextPipe = createInstance(channelName, false);
+    HANDLE event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (nextPipe == INVALID_HANDLE_VALUE || !event)
+    {
+        if (event)
+            CloseHandle(event);
+        return false;
+    }
+    HANDLE pipe = static_cast<HANDLE>(nextPipe);
+    for (;;)
+    {
+        OVERLAPPED overlapped = {};
+        overlapped.hEvent = event;
+        DWORD ignored = 0;
+        DWORD error = ConnectNamedPipe(pipe, &overlapped) ? ERROR_SUCCESS : GetLastError();
+        if (error == ERROR_IO_PENDING)
+            error = GetOverlappedResult(pipe, &overlapped, &ignored, TRUE) ? ERROR_SUCCESS : GetLastError();
+        if (error == ERROR_SUCCESS || error == ERROR_PIPE_CONNECTED)
+            break;
+        if (error != ERROR_NO_DATA)
+        {
+            CloseHandle(event);
+            return false;
+        }
+        // 客户端连上后又关闭了，断开后继续等
+        DisconnectNamedPipe(pipe);
+    }
+    // 处理这个连接之前先换上下一个实例，其它客户端不会找不到管道
+    nextPipe = createInstance(channelName, false);
+    connection.handle = pipe;
+    connection.serverSide = true;
+    connection.ioEvent = event;
+    return true;
+#else
+    if (fd < 0)
+        return false;
+    int client = ::accept(fd, nullptr, nullptr);
+    if (client < 0)
+        return false;
+    connection.fd = client;
+    return true;
+#endif
+}
+
+void LocalServer::close()
+{
+#ifdef _WIN32
+    if (nextPipe != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(static_cast<HANDLE>(nextPipe));
+        nextPipe = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+        unlink(channelName.c_str());
+    }
+#endif
+    channelName.clear();
+}
+
+std::string LocalServer::defaultName()
+{
+#ifdef _WIN32
+    char user[256];
+    DWORD len = sizeof(user);
+    if (!GetUserNameA(user, &len))
+        return "\\\\.\\pipe\\QuickManPath";
+    return std::string("\\\\.\\pipe\\QuickManPath-") + user;
+#else
+    const char *runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime)
+        return std::string(runtime) + "/quickmanpath.sock";
+    std::filesystem::path state = PathStateStore::defaultFilePath();
+    return state.empty() ? std::string() : (state.parent_path() / "daemon.sock").string();
+#endif
+}
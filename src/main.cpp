@@ -6,17 +6,43 @@
 #include <FL/Fl_Button.H>
 #include <FL/Fl_Group.H>
 #include <FL/Fl_Pack.H>
+#include <FL/Fl_Menu_Bar.H>
+#include <FL/Fl_Native_File_Chooser.H>
 #include <FL/fl_ask.H>
 #include <FL/fl_image.H>
 #include <FL/x.H>
 #include <windows.h>
 #include <filesystem>
+#include <algorithm>
 #include <map>
+#include <unordered_map>
 #include <fstream>
+#include <cstring>
+#include <cstdio>
 #include "path_tabel.hpp"
+#include "path_list_model.hpp"
+#include "path_state_store.hpp"
+#include "path_health_scanner.hpp"
+#include "path_alias_detector.hpp"
+#include "path_trie.hpp"
+#include "path_compressor.hpp"
+#include "env_expander.hpp"
+#include "path_length_counter.hpp"
+#include "path_transfer.hpp"
+#include "path_launcher.hpp"
+#include "activation_script.hpp"
+#include "path_policy.hpp"
+#include "path_rewriter.hpp"
+#include "path_utils.hpp"
+#include "executable_index.hpp"
+#include "text_report_window.hpp"
+#include "which_resolver.hpp"
+#include "which_window.hpp"
+#include "diff_window.hpp"
+#include "path_order_optimizer.hpp"
 #include "win_env_utils.hpp"
-#include "nlohmann/json.hpp"
 
+constexpr int menuBarH = 25;
 constexpr int groupH = 350;
 constexpr int tabelH = 300;
 constexpr int labelH = 25;
@@ -25,6 +51,7 @@ constexpr int labelLeftMargin = 10;
 constexpr int labelTopMargin = 10;
 constexpr int tabelLeftMargin = 10;
 constexpr int buttonWholeH = 40;
+constexpr int statusBarH = 22;
 constexpr int buttonH = 25;
 constexpr int buttonW = 90;
 constexpr int fixedCellW = 60;
@@ -41,10 +68,43 @@ private:
     Fl_Button *newSystemButton;
     Fl_Box *systemLabel;
     Fl_Box *userLabel;
+    Fl_Menu_Bar *menuBar;
     Fl_Pack *mainPack;
     Fl_Group *systemGroup;
     Fl_Group *userGroup;
     Fl_Group *buttonGroup;
+    Fl_Box *statusBar;
+    PathTable *lastFocusedTable; // 最近获得焦点的表格，撤销/重做作用于它
+    PathListModel systemModel;
+    PathListModel userModel;
+    PathLengthCounter systemLength; // 在模型之后声明，先于模型析构
+    PathLengthCounter userLength;
+    PathStateStore stateStore; // 订阅两个模型，退出时写回 pathVars.json
+    bool unapplied; // 是否有尚未应用到注册表的修改
+    PathHealthScanner healthScanner; // 后台检查目录状态，先于模型析构
+    ExecutableIndex exeIndex; // 各目录中的可执行文件，用于遮蔽分析
+    EnvExpander envExpander; // 注册表中的系统和用户变量，展开条目中的%VAR%并缓存结果
+    PathAliasDetector aliasDetector; // 通过联接/符号链接指向同一目录的条目，随健康扫描结果更新
+    PathTrie pathTrie; // 启用条目的路径前缀树，用于查找重复和上下级条目
+    std::vector<std::pair<PathVariable_t, bool>> pendingVariables; // 压缩时新建的变量（是否系统变量），应用时写入注册表
+    WhichResolver whichResolver; // 查找命令，搜索路径随表格内容更新
+    PathLauncher launcher; // 按表格或快照文件中的Path启动程序，环境块按来源缓存
+    std::string lastLaunchCommand;
+    ActivationScripts activationScripts; // 只修改当前shell的激活脚本，按来源缓存
+    PathPolicy policy; // 合规规则，每次修改后重新检查，不满足的行在表格中标出
+    PathRewriter rewriter; // 批量查找替换，保留上一次的查找和替换内容
+    // "标签"菜单中每个标签的操作，菜单项的user_data指向这里，重建菜单前整体替换
+    struct TagAction {
+        MainWindow *win;
+        std::string tag;
+        int kind; // 0全部启用，1全部禁用，2删除标签
+    };
+    std::vector<TagAction> tagActions;
+    std::string lastTag;
+    std::string lastRewriteFind;
+    std::string lastRewriteReplace;
+    WhichWindow *whichWindow; // 第一次使用时创建
+    DiffWindow *diffWindow; // 第一次使用时创建
 
     static void refreshCallback(Fl_Widget *w, void *data)
     {
@@ -64,23 +124,18 @@ private:
         const char *newPath = fl_input("请输入新的用户环境变量路径:", "");
         if (newPath && strlen(newPath) > 0)
         {
-            // 获取当前用户路径
-            std::vector<EnvPathItem_t> userPaths;
-            win->userPathTable->getPaths(userPaths);
-
             // 检查路径是否已存在
-            for(auto &item : userPaths)
+            if (win->userModel.contains(newPath))
             {
-                if (item.path == newPath)
-                {
-                    fl_alert("该路径已存在于用户环境变量中！");
-                    return;
-                }
+                fl_alert("该路径已存在于用户环境变量中！");
+                return;
+            }
+            if (!win->confirmNewDirectory(newPath))
+            {
+                return;
             }
 
-            userPaths.push_back(EnvPathItem_t{newPath, true}); // 默认启用
-            win->userPathTable->setPaths(userPaths);
-
+            win->userModel.append(EnvPathItem_t{newPath, true}); // 默认启用
         }
     }
 
@@ -90,24 +145,77 @@ private:
         const char *newPath = fl_input("请输入新的系统环境变量路径:", "");
         if (newPath && strlen(newPath) > 0)
         {
-            // 获取当前系统路径
-            std::vector<EnvPathItem_t> systemPaths;
-            win->systemPathTable->getPaths(systemPaths);
-
             // 检查路径是否已存在
-            for(auto &item : systemPaths)
+            if (win->systemModel.contains(newPath))
             {
-                if (item.path == newPath)
-                {
-                    fl_alert("该路径已存在于系统环境变量中！");
-                    return;
-                }
+                fl_alert("该路径已存在于系统环境变量中！");
+                return;
+            }
+            if (!win->confirmNewDirectory(newPath))
+            {
+                return;
             }
-            systemPaths.push_back(EnvPathItem_t{newPath, true}); // 默认启用
-            win->systemPathTable->setPaths(systemPaths);
+            win->systemModel.append(EnvPathItem_t{newPath, true}); // 默认启用
         }
     }
 
+    // 写法不同但展开后是同一目录时（例如%JAVA_HOME%\bin和C:\jdk17\bin）询问是否仍然添加
+    bool confirmNewDirectory(const std::string &newPath)
+    {
+        std::string key = normalizePathKey(envExpander.expand(newPath));
+        const PathListModel *models[2] = {&systemModel, &userModel};
+        for (int m = 0; m < 2; m++)
+        {
+            for (size_t i = 0; i < models[m]->size(); i++)
+            {
+                if (models[m]->isDeleted(i) || normalizePathKey(envExpander.expand(models[m]->at(i).path)) != key)
+                    continue;
+                return fl_choice("该路径展开后与%s中的 %s 是同一目录，仍然添加？", "取消", "添加", 0,
+                                 m == 0 ? "系统环境变量" : "用户环境变量", models[m]->at(i).path.c_str()) == 1;
+            }
+        }
+        return true;
+    }
+
+    std::string expandPath(const std::string &value)
+    {
+        return envExpander.expand(value);
+    }
+
+    // 从注册表重新读取变量，只有引用了变化变量的条目需要重新展开
+    void loadVariables()
+    {
+        std::vector<std::string> affected = envExpander.setVariables(EnvExpander::SCOPE_SYSTEM, getEnvironmentVariables(true));
+        std::vector<std::string> userAffected = envExpander.setVariables(EnvExpander::SCOPE_USER, getEnvironmentVariables(false));
+        affected.insert(affected.end(), userAffected.begin(), userAffected.end());
+        reexpandEntries(affected);
+    }
+
+    void reexpandEntries(const std::vector<std::string> &affected)
+    {
+        if (affected.empty())
+        {
+            return;
+        }
+        for (const auto &raw : affected)
+        {
+            if (systemModel.contains(raw) || userModel.contains(raw))
+                healthScanner.recheck(raw);
+        }
+        pathTrie.reexpand(affected);
+        whichResolver.reexpand(affected);
+        systemLength.reexpand(affected);
+        userLength.reexpand(affected);
+        launcher.invalidate();
+        activationScripts.invalidate();
+        policy.invalidate();
+        policy.evaluate(systemModel, userModel);
+        updateStatus();
+        scheduleIndexUpdate(); // 可执行文件索引在更新顺序时按新的展开结果取目录
+        systemPathTable->redraw();
+        userPathTable->redraw();
+    }
+
     static void closeCallback(Fl_Widget *w, void *data)
     {
         MainWindow *win = static_cast<MainWindow *>(data);
@@ -116,150 +224,857 @@ private:
         win = nullptr;
     }
 
-    // 处理PathTable焦点切换
-    void handleTableFocus(PathTable* focusedTable)
+    // 工作线程通过Fl::awake转到主线程，取走检查结果后重绘一次
+    static void healthAwake(void *data)
     {
-        if (focusedTable == systemPathTable)
+        MainWindow *win = static_cast<MainWindow *>(data);
+        if (win->healthScanner.drain() > 0)
         {
-            userPathTable->clearSelection();
+            win->updateAliases();
+            win->systemPathTable->redraw();
+            win->userPathTable->redraw();
         }
-        else if (focusedTable == userPathTable)
+    }
+
+    static void indexAwake(void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        if (win->exeIndex.drain() > 0)
         {
-            systemPathTable->clearSelection();
+            win->systemPathTable->redraw();
+            win->userPathTable->redraw();
         }
     }
 
-    void initPaths()
+    // 批量修改会连续产生多个通知，稍后合并为一次索引更新
+    static void indexTimeout(void *data)
     {
-        namespace fs = std::filesystem;
-        using json = nlohmann::json;
+        static_cast<MainWindow *>(data)->updateEffectivePath();
+    }
 
-        // 获取用户目录
-        char *userProfile = nullptr;
-        size_t len = 0;
-        if (_dupenv_s(&userProfile, &len, "USERPROFILE") != 0 || userProfile == nullptr)
+    void scheduleIndexUpdate()
+    {
+        if (!Fl::has_timeout(indexTimeout, this))
         {
-            fl_alert("无法获取用户目录！");
+            Fl::add_timeout(0.1, indexTimeout, this);
+        }
+    }
+
+    // 按系统在前、用户在后的顺序把启用的条目交给索引和命令查找，只有新出现的目录会被扫描
+    void updateAliases()
+    {
+        aliasDetector.update(systemModel, userModel, healthScanner, [this](const std::string &value) { return expandPath(value); });
+    }
+
+    static void removeAliasesCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        win->updateAliases();
+        if (win->aliasDetector.count(false) + win->aliasDetector.count(true) == 0)
+        {
+            fl_message("没有发现指向同一目录的条目");
             return;
         }
+        win->systemPathTable->removeAliases();
+        win->userPathTable->removeAliases();
+    }
 
-        // 使用 userProfile
-        fs::path appDataPath = fs::path(userProfile) / "AppData/Local/QuickManPath";
+    void updateEffectivePath()
+    {
+        std::vector<std::string> systemPaths;
+        std::vector<std::string> userPaths;
+        systemModel.enabledPaths(systemPaths);
+        userModel.enabledPaths(userPaths);
+        exeIndex.setOrder(systemPaths, userPaths);
+        updateAliases();
+        systemPaths.insert(systemPaths.end(), userPaths.begin(), userPaths.end());
+        whichResolver.setSearchPath(systemPaths);
+        if (whichWindow && whichWindow->shown())
+        {
+            whichWindow->refresh();
+        }
+        systemPathTable->redraw();
+        userPathTable->redraw();
+    }
 
-        // 释放分配的内存
-        free(userProfile);
+    static void shadowReportCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        win->updateEffectivePath();
+        TextReportWindow::open("可执行文件遮蔽分析", win->exeIndex.formatReport());
+    }
 
-        fs::path jsonFilePath = appDataPath / "pathVars.json";
+    static void cleanUpCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        win->cleanUpDuplicates();
+    }
 
-        // 如果目录不存在，则创建
-        if (!fs::exists(appDataPath))
+    // 同一目录的多个写法（重复、只差结尾分隔符、系统和用户Path中都有）只保留第一次出现的条目
+    void cleanUpDuplicates()
+    {
+        std::vector<size_t> systemRows;
+        std::vector<size_t> userRows;
+        pathTrie.redundantRows(systemModel, userModel, systemRows, userRows);
+        TextReportWindow::open("重复条目分析", pathTrie.formatReport());
+        size_t total = systemRows.size() + userRows.size();
+        if (total == 0)
+        {
+            return;
+        }
+        std::string question = "是否删除 " + std::to_string(total) + " 个重复条目？\n删除后可以撤销，应用后才写入注册表。";
+        if (fl_choice("%s", "取消", "删除", 0, question.c_str()) != 1)
         {
-            fs::create_directories(appDataPath);
+            return;
+        }
+        // 两个表格的删除作为一步，在任一表格中撤销时一起恢复
+        PathListModel::beginLinkedBatch(systemModel, userModel);
+        for (size_t row : systemRows)
+        {
+            systemModel.remove(row);
         }
+        for (size_t row : userRows)
+        {
+            userModel.remove(row);
+        }
+        PathListModel::endLinkedBatch(systemModel, userModel);
+    }
+
+    static void compressCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        win->compressPaths();
+    }
 
-        // 如果文件不存在，则创建并写入默认内容
-        if (!fs::exists(jsonFilePath))
+    // 把共有的目录前缀提取成%VAR%，缩短Path的原始长度；预览确认后改写表格中的条目
+    void compressPaths()
+    {
+        PathListModel *models[2] = {&systemModel, &userModel};
+        std::vector<std::string> entries[2];
+        std::vector<std::string> rewritten[2];
+        std::vector<PathVariable_t> variables[2];
+        std::string preview;
+        bool changed = false;
+        for (int m = 0; m < 2; m++)
+        {
+            PathCompressor compressor;
+            // 系统Path只能引用系统级的变量，用户Path还可以引用用户目录
+            std::vector<const char *> known = {"SystemRoot", "ProgramFiles", "ProgramFiles(x86)", "ProgramData"};
+            if (m == 1)
+            {
+                known.insert(known.end(), {"USERPROFILE", "LOCALAPPDATA", "APPDATA"});
+            }
+            for (const char *name : known)
+            {
+                std::string reference = std::string("%") + name + "%";
+                std::string value = envExpander.expand(reference);
+                if (value != reference)
+                    compressor.addExistingVariable(name, value);
+            }
+            // 用户变量会覆盖同名的系统变量，两边新建的变量也不能重名
+            const std::vector<PathVariable_t> &systemVariables = variables[0];
+            compressor.setNameInUse([this, m, &systemVariables](const std::string &name) {
+                std::string reference = "%" + name + "%";
+                if (envExpander.expand(reference) != reference)
+                    return true;
+                for (const auto &variable : systemVariables)
+                {
+                    if (m == 1 && toLowerAscii(variable.name) == toLowerAscii(name))
+                        return true;
+                }
+                return false;
+            });
+            models[m]->enabledPaths(entries[m]);
+            compressor.compress(entries[m], rewritten[m], variables[m]);
+            changed = changed || rewritten[m] != entries[m];
+            preview += PathCompressor::formatPreview(m == 0 ? "系统Path" : "用户Path", entries[m], rewritten[m], variables[m]);
+            preview += "\n";
+        }
+        TextReportWindow::open("压缩Path长度", preview);
+        if (!changed || fl_choice("是否按预览改写条目？\n改写后可以撤销；新变量在应用时与Path一起写入注册表，Path仍以REG_EXPAND_SZ保存。",
+                                  "取消", "改写", 0) != 1)
         {
-            json defaultJson = {
-                {"systemPaths", std::map<std::string, bool>()},
-                {"userPaths", std::map<std::string, bool>()}
-            };
-            std::ofstream outFile(jsonFilePath);
-            outFile << defaultJson.dump(4); // 格式化输出
-            outFile.close();
+            return;
         }
 
-        // 读取 JSON 文件
-        std::ifstream inFile(jsonFilePath);
-        json pathData;
-        inFile >> pathData;
-        inFile.close();
+        for (int m = 0; m < 2; m++)
+        {
+            // 新变量先加入展开引擎，表格中的改写条目才能展开和检查
+            for (const auto &variable : variables[m])
+            {
+                if (variable.existing)
+                    continue;
+                envExpander.setVariable(m == 0 ? EnvExpander::SCOPE_SYSTEM : EnvExpander::SCOPE_USER,
+                                        EnvVariable_t{variable.name, variable.value, false});
+                // 撤销后再压缩可能得到同名的变量，只保留最新的定义
+                std::string lowerName = toLowerAscii(variable.name);
+                pendingVariables.erase(std::remove_if(pendingVariables.begin(), pendingVariables.end(),
+                                                      [&](const std::pair<PathVariable_t, bool> &pending) {
+                                                          return pending.second == (m == 0) &&
+                                                                 toLowerAscii(pending.first.name) == lowerName;
+                                                      }),
+                                       pendingVariables.end());
+                pendingVariables.push_back(std::make_pair(variable, m == 0));
+            }
+            // 启用的行与enabledPaths的顺序一致
+            size_t next = 0;
+            models[m]->beginBatch();
+            for (size_t i = 0; i < models[m]->size() && next < rewritten[m].size(); i++)
+            {
+                if (models[m]->isDeleted(i) || !models[m]->at(i).enabled)
+                    continue;
+                models[m]->setPath(i, rewritten[m][next++]);
+            }
+            models[m]->endBatch();
+        }
+    }
 
-        // 从 JSON 数据中加载路径
-        auto preSystemPaths = pathData.value("systemPaths", std::map<std::string, bool>());
-        auto preUserPaths = pathData.value("userPaths", std::map<std::string, bool>());
+    static void optimizeOrderCallback(Fl_Widget *w, void *data)
+    {
+        static_cast<MainWindow *>(data)->optimizeOrder();
+    }
 
-        // load local path
-        auto locSystemPaths = getSystemPath();
-        auto locUserPaths = getUserPath();
+    // 导入命令使用记录，估算当前顺序的查找开销并给出保持遮蔽关系的建议顺序
+    void optimizeOrder()
+    {
+        updateEffectivePath();
+        exeIndex.drain();
+        if (exeIndex.isScanning())
+        {
+            fl_message("正在扫描PATH中的目录，请稍后再试。");
+            return;
+        }
 
-        // 合并 preSystemPaths 和 locSystemPaths
-        for (const auto &envItem : locSystemPaths)
+        Fl_Native_File_Chooser chooser(Fl_Native_File_Chooser::BROWSE_FILE);
+        chooser.title("选择命令历史或使用统计（例如 PowerShell 的 ConsoleHost_history.txt）");
+        chooser.filter("文本文件\t*.{txt,log,history}\n所有文件\t*");
+        if (chooser.show() != 0)
         {
-            preSystemPaths[envItem.path] = envItem.enabled;
+            return;
         }
+        std::ifstream in(chooser.filename());
+        if (!in.is_open())
+        {
+            fl_alert("无法打开文件！");
+            return;
+        }
+        std::unordered_map<std::string, double> history;
+        PathOrderOptimizer::parseUsageHistory(in, history);
 
-        // 合并 preUserPaths 和 locUserPaths
-        for (const auto &envItem : locUserPaths)
+        // 同一命令的不同写法（大小写、带扩展名）合并
+        std::unordered_map<std::string, double> usage;
+        for (const auto &pair : history)
         {
-            preUserPaths[envItem.path] = envItem.enabled;
+            usage[exeIndex.commandKey(pair.first)] += pair.second;
         }
 
-        std::vector<EnvPathItem_t> systemPathVec;
-        for (const auto &pair : preSystemPaths)
+        const std::vector<ShadowEntry_t> &entries = exeIndex.shadowEntries();
+        size_t systemCount = 0;
+        std::vector<std::string> names;
+        for (const auto &entry : entries)
         {
-            systemPathVec.push_back(EnvPathItem_t{pair.first, pair.second});
+            if (!entry.user)
+                systemCount++;
+            names.push_back((entry.user ? "[用户] " : "[系统] ") + entry.path);
         }
-        systemPathTable->setPaths(systemPathVec);
-        std::vector<EnvPathItem_t> userPathVec;
-        for (const auto &pair : preUserPaths)
+
+        PathOrderOptimizer optimizer(entries.size(), exeIndex.probesPerDirectory(), systemCount);
+        size_t unresolved = 0;
+        double unresolvedUsage = 0.0;
+        std::vector<std::pair<size_t, size_t>> hits;
+        for (const auto &pair : usage)
+        {
+            exeIndex.lookupCommand(pair.first, hits);
+            if (hits.empty())
+            {
+                unresolved++;
+                unresolvedUsage += pair.second;
+                continue;
+            }
+            optimizer.addCommand(pair.first, pair.second, hits);
+        }
+        std::vector<std::pair<size_t, size_t>> pairs;
+        exeIndex.precedencePairs(pairs);
+        for (const auto &pair : pairs)
+        {
+            optimizer.addPrecedence(pair.first, pair.second);
+        }
+
+        std::vector<size_t> proposed = optimizer.optimize();
+        TextReportWindow::open("PATH查找开销分析", optimizer.formatReport(names, proposed, unresolved, unresolvedUsage));
+
+        bool changed = false;
+        for (size_t i = 0; i < proposed.size(); i++)
+        {
+            changed = changed || proposed[i] != i;
+        }
+        if (changed && fl_choice("是否按建议顺序调整表格中的条目？\n调整后可以撤销，应用后才写入注册表。", "取消", "调整", 0) == 1)
         {
-            userPathVec.push_back(EnvPathItem_t{pair.first, pair.second});
+            applyProposedOrder(proposed, systemCount);
         }
-        userPathTable->setPaths(userPathVec);
     }
 
-    void refreshPaths()
+    // 把生效顺序中的新位置映射回两个表格：启用的行按建议顺序重排，禁用和已删除的行留在原位
+    void applyProposedOrder(const std::vector<size_t> &proposed, size_t systemCount)
     {
-        // load local path
-        auto locSystemPaths = getSystemPath();
-        auto locUserPaths = getUserPath();
+        PathListModel *models[2] = {&systemModel, &userModel};
+        size_t offset = 0;
+        for (int m = 0; m < 2; m++)
+        {
+            PathListModel &model = *models[m];
+            std::vector<size_t> enabledRows;
+            for (size_t i = 0; i < model.size(); i++)
+            {
+                if (!model.isDeleted(i) && model.at(i).enabled)
+                    enabledRows.push_back(i);
+            }
+            size_t segmentEnd = m == 0 ? systemCount : proposed.size();
+            if (enabledRows.size() != segmentEnd - offset)
+            {
+                fl_alert("表格内容已经变化，请重新分析。");
+                return;
+            }
 
-        std::vector<EnvPathItem_t> curSystemPaths;
-        systemPathTable->getPaths(curSystemPaths);
-        std::vector<EnvPathItem_t> curUserPaths;
-        userPathTable->getPaths(curUserPaths);
+            std::vector<size_t> order(model.size());
+            for (size_t i = 0; i < model.size(); i++)
+            {
+                order[i] = i;
+            }
+            for (size_t k = 0; k < enabledRows.size(); k++)
+            {
+                order[enabledRows[k]] = enabledRows[proposed[offset + k] - offset];
+            }
+            model.permute(order);
+            offset = segmentEnd;
+        }
+    }
+
+    // 按表格当前顺序（含未应用的修改）导出为文本，可作为基准测试的候选
+    static void exportOrderCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        Fl_Native_File_Chooser chooser(Fl_Native_File_Chooser::BROWSE_SAVE_FILE);
+        chooser.title("导出当前顺序");
+        chooser.filter("文本文件\t*.txt");
+        chooser.options(Fl_Native_File_Chooser::SAVEAS_CONFIRM);
+        chooser.preset_file("path_order.txt");
+        if (chooser.show() != 0)
+        {
+            return;
+        }
+        std::vector<EnvPathItem_t> systemPaths;
+        std::vector<EnvPathItem_t> userPaths;
+        win->systemModel.toVector(systemPaths);
+        win->userModel.toVector(userPaths);
+        if (!PathStateStore::writePathList(chooser.filename(), systemPaths, userPaths))
+        {
+            fl_alert("无法写入文件！");
+        }
+    }
+
+    // 批量导入：.reg、文本列表或JSON Lines，按规范化后的写法去重，每个表格一次性追加
+    static void importCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        Fl_Native_File_Chooser chooser(Fl_Native_File_Chooser::BROWSE_FILE);
+        chooser.title("导入条目");
+        chooser.filter("注册表文件\t*.reg\n文本列表\t*.txt\nJSON Lines\t*.{jsonl,ndjson}\n所有文件\t*");
+        if (chooser.show() != 0)
+        {
+            return;
+        }
+        // 文本中没有分节的条目导入到当前表格
+        bool user = win->lastFocusedTable != win->systemPathTable;
+        PathImportResult_t result;
+        if (!PathImporter::importInto(chooser.filename(), PathImporter::formatOf(chooser.filename()), user,
+                                      win->systemModel, win->userModel, result))
+        {
+            fl_alert("无法读取文件！");
+            return;
+        }
+        std::string summary = "读取 " + std::to_string(result.records) + " 条，新增 " + std::to_string(result.added) +
+                              " 条，跳过重复 " + std::to_string(result.duplicates) + " 条";
+        if (result.errors > 0)
+        {
+            summary += "\n有 " + std::to_string(result.errors) + " 行无法解析，已忽略";
+        }
+        fl_message("%s", summary.c_str());
+    }
+
+    static void exportCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        Fl_Native_File_Chooser chooser(Fl_Native_File_Chooser::BROWSE_SAVE_FILE);
+        chooser.title("导出条目");
+        chooser.filter("注册表文件\t*.reg\n文本列表\t*.txt\nJSON Lines\t*.jsonl");
+        chooser.options(Fl_Native_File_Chooser::SAVEAS_CONFIRM);
+        if (chooser.show() != 0)
+        {
+            return;
+        }
+        // 没有输入扩展名时按选中的过滤器补上
+        static const char *extensions[] = {".reg", ".txt", ".jsonl"};
+        std::filesystem::path file = chooser.filename();
+        int filter = chooser.filter_value();
+        if (file.extension().empty() && filter >= 0 && filter < 3)
+        {
+            file += extensions[filter];
+        }
+        std::vector<EnvPathItem_t> systemPaths;
+        std::vector<EnvPathItem_t> userPaths;
+        win->systemModel.toVector(systemPaths);
+        win->userModel.toVector(userPaths);
+        if (!PathExporter::writeFile(file, PathImporter::formatOf(file), systemPaths, userPaths))
+        {
+            fl_alert("无法写入文件！");
+        }
+    }
+
+    // 用给定的环境块启动一个程序，不修改注册表
+    void launchWith(const PathLauncher::BlockPtr &block, const char *prompt)
+    {
+        const char *input = fl_input("%s", lastLaunchCommand.c_str(), prompt);
+        if (!input || !*input)
+        {
+            return;
+        }
+        lastLaunchCommand = input;
+        int exitCode = 0;
+        std::string error;
+        if (!PathLauncher::launch(*block, PathLauncher::splitCommandLine(lastLaunchCommand), false, exitCode, error))
+        {
+            fl_alert("无法启动程序：%s", error.c_str());
+        }
+    }
+
+    static void launchTablesCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        win->launchWith(win->launcher.blockFor(win->systemModel.list(), win->userModel.list()),
+                        "按当前表格（含未应用的修改）中的Path运行：");
+    }
+
+    static void launchFileCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        Fl_Native_File_Chooser chooser(Fl_Native_File_Chooser::BROWSE_FILE);
+        chooser.title("选择Path快照");
+        chooser.filter("Path快照\t*.{txt,json}");
+        if (chooser.show() != 0)
+        {
+            return;
+        }
+        PathLauncher::BlockPtr block = win->launcher.blockForFile(chooser.filename());
+        if (!block)
+        {
+            fl_alert(PathStateStore::isOrderedFile(chooser.filename())
+                         ? "无法读取文件！"
+                         : "这个 pathVars.json 由旧版本保存，不记录顺序，请先导出为文本列表。");
+            return;
+        }
+        win->launchWith(block, "按快照文件中的Path运行：");
+    }
 
-        // 合并 preSystemPaths 和 locSystemPaths
-        for (const auto &envItem : locSystemPaths)
+    static void activationCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        int source = fl_choice("为哪个Path状态生成激活脚本？", "取消", "当前表格", "快照文件");
+        ActivationScripts::SnippetsPtr snippets;
+        std::string name = "current";
+        if (source == 1)
         {
-            bool found = false;
-            for(auto &item : curSystemPaths)
+            snippets = win->activationScripts.forTables(win->systemModel.list(), win->userModel.list());
+        }
+        else if (source == 2)
+        {
+            Fl_Native_File_Chooser chooser(Fl_Native_File_Chooser::BROWSE_FILE);
+            chooser.title("选择Path快照");
+            chooser.filter("Path快照\t*.{txt,json}");
+            if (chooser.show() != 0)
             {
-                if (item.path == envItem.path)
-                {
-                    item.enabled = envItem.enabled;
-                    found = true;
-                    break;
-                }
+                return;
             }
-            if(!found)
+            snippets = win->activationScripts.forFile(chooser.filename());
+            name = std::filesystem::path(chooser.filename()).stem().string();
+            if (!snippets)
             {
-                curSystemPaths.push_back(envItem);
+                fl_alert(PathStateStore::isOrderedFile(chooser.filename())
+                             ? "无法读取文件！"
+                             : "这个 pathVars.json 由旧版本保存，不记录顺序，请先导出为文本列表。");
+                return;
             }
         }
+        else
+        {
+            return;
+        }
+        std::filesystem::path dir = ActivationScripts::defaultDirectory();
+        size_t written = 0;
+        if (dir.empty() || !ActivationScripts::writeFiles(*snippets, dir, name, written))
+        {
+            fl_alert("无法写入激活脚本！");
+            return;
+        }
+        std::string base = (dir / name).string();
+        fl_message("已生成到 %s（更新了%zu个文件）\n\n"
+                   "cmd:         call \"%s.cmd\"\n"
+                   "PowerShell:  . \"%s.ps1\"\n"
+                   "bash/zsh:    source \"%s.sh\"\n"
+                   "fish:        source \"%s.fish\"\n\n"
+                   "还原时执行同名的 -off 脚本。",
+                   dir.string().c_str(), written, base.c_str(), base.c_str(), base.c_str(), base.c_str());
+    }
+
+    // 加载规则文件后立即检查并重绘表格
+    bool loadPolicy(const std::filesystem::path &file)
+    {
+        std::string error;
+        if (!policy.load(file, error))
+        {
+            fl_alert("无法加载策略规则 %s\n%s", file.string().c_str(), error.c_str());
+            return false;
+        }
+        policy.evaluate(systemModel, userModel);
+        updateStatus();
+        systemPathTable->redraw();
+        userPathTable->redraw();
+        return true;
+    }
 
-        // 合并 preUserPaths 和 locUserPaths
-        for (const auto &envItem : locUserPaths)
+    static void loadPolicyCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        Fl_Native_File_Chooser chooser(Fl_Native_File_Chooser::BROWSE_FILE);
+        chooser.title("选择策略规则文件");
+        chooser.filter("策略规则\t*.rules\n所有文件\t*");
+        if (chooser.show() != 0)
         {
-            bool found = false;
-            for(auto &item : curUserPaths)
+            return;
+        }
+        win->loadPolicy(chooser.filename());
+    }
+
+    static void policyReportCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        win->policy.evaluate(win->systemModel, win->userModel);
+        TextReportWindow::open("策略检查结果", win->policy.formatReport());
+    }
+
+    static void rewriteCallback(Fl_Widget *w, void *data)
+    {
+        static_cast<MainWindow *>(data)->rewriteEntries();
+    }
+
+    // 两个表格中所有条目的查找替换，预览确认后作为一步撤销改写（保存时一并写回 pathVars.json）
+    void rewriteEntries()
+    {
+        const char *input = fl_input("查找（例如 C:\\Python39）：", lastRewriteFind.c_str());
+        if (!input || !*input)
+        {
+            return;
+        }
+        lastRewriteFind = input;
+        input = fl_input("替换为（正则表达式中可以用 $1 引用分组）：", lastRewriteReplace.c_str());
+        if (!input)
+        {
+            return;
+        }
+        lastRewriteReplace = input;
+        int mode = fl_choice("按什么方式匹配查找内容？\n都不区分大小写。", "取消", "纯文本", "正则表达式");
+        if (mode == 0)
+        {
+            return;
+        }
+        std::string error;
+        if (!rewriter.compile(lastRewriteFind, lastRewriteReplace, mode == 2, true, error))
+        {
+            fl_alert("%s", error.c_str());
+            return;
+        }
+        size_t count = rewriter.plan(systemModel, userModel);
+        TextReportWindow::open("批量替换预览", rewriter.formatPreview());
+        if (count == 0)
+        {
+            return;
+        }
+        std::string question = "是否改写 " + std::to_string(count) + " 个条目？\n两个表格的修改作为一步撤销，应用后才写入注册表。";
+        if (fl_choice("%s", "取消", "改写", 0, question.c_str()) != 1)
+        {
+            return;
+        }
+        if (!rewriter.commit(systemModel, userModel, &stateStore.tags()))
+        {
+            fl_alert("表格内容已经变化，请重新替换。");
+        }
+    }
+
+    // 菜单标签中'\\'、'_'、'&'有特殊含义
+    static std::string menuLabel(const std::string &text)
+    {
+        std::string label;
+        for (char c : text)
+        {
+            if (c == '\\' || c == '_')
+                label += '\\';
+            else if (c == '&')
+                label += '&';
+            label += c;
+        }
+        return label;
+    }
+
+    // 标签增删后重建"标签"菜单：固定的两项，之后每个标签一个子菜单
+    void rebuildTagMenu()
+    {
+        int index = menuBar->find_index("标签");
+        if (index >= 0)
+            menuBar->clear_submenu(index);
+        std::vector<std::string> names = stateStore.tags().tagNames();
+        tagActions.clear();
+        tagActions.reserve(names.size() * 3); // 菜单项保存元素地址，之后不能再扩容
+        menuBar->add("标签/为所选条目添加标签...", FL_CTRL + 't', addTagCallback, this);
+        menuBar->add("标签/从所选条目移除标签...", 0, removeTagCallback, this,
+                     names.empty() ? FL_MENU_INACTIVE : FL_MENU_DIVIDER);
+        const char *labels[3] = {"/全部启用", "/全部禁用", "/删除标签..."};
+        for (const auto &name : names)
+        {
+            for (int kind = 0; kind < 3; kind++)
             {
-                if (item.path == envItem.path)
-                {
-                    item.enabled = envItem.enabled;
-                    found = true;
-                    break;
-                }
+                tagActions.push_back(TagAction{this, name, kind});
+                std::string label = "标签/" + menuLabel(name) + labels[kind];
+                menuBar->add(label.c_str(), 0, tagActionCallback, &tagActions.back());
+            }
+        }
+    }
+
+    void tagsChanged()
+    {
+        rebuildTagMenu();
+        systemPathTable->redraw();
+        userPathTable->redraw();
+    }
+
+    static void addTagCallback(Fl_Widget *w, void *data)
+    {
+        static_cast<MainWindow *>(data)->tagSelection(true);
+    }
+
+    static void removeTagCallback(Fl_Widget *w, void *data)
+    {
+        static_cast<MainWindow *>(data)->tagSelection(false);
+    }
+
+    // 给最近使用的表格中选中的条目加上或去掉一个标签
+    void tagSelection(bool add)
+    {
+        // 弹出对话框会清除选择，先取出选中的行
+        std::vector<size_t> rows = lastFocusedTable ? lastFocusedTable->getSelectedIndices() : std::vector<size_t>();
+        if (rows.empty())
+        {
+            fl_message("请先在表格中选中条目。");
+            return;
+        }
+        PathListModel &model = *lastFocusedTable->getModel();
+        PathTags &tags = stateStore.tags();
+        std::string suggestion = lastTag;
+        const std::vector<std::string> *current = tags.tagsOf(model.at(rows[0]).path);
+        if (!add && current)
+            suggestion = current->front();
+        const char *input = fl_input(add ? "为 %d 个条目添加标签（不含空格和'/'）：" : "从 %d 个条目移除标签：",
+                                     suggestion.c_str(), static_cast<int>(rows.size()));
+        if (!input)
+        {
+            return;
+        }
+        std::string tag = input;
+        if (!PathTags::validName(tag))
+        {
+            fl_alert("标签名不能为空，也不能含空格或'/'。");
+            return;
+        }
+        lastTag = tag;
+        for (size_t row : rows)
+        {
+            if (add)
+                tags.add(tag, model.at(row).path);
+            else
+                tags.remove(tag, model.at(row).path);
+        }
+        tagsChanged();
+    }
+
+    static void tagActionCallback(Fl_Widget *w, void *data)
+    {
+        TagAction *action = static_cast<TagAction *>(data);
+        MainWindow *win = action->win;
+        std::string tag = action->tag; // 删除标签会重建菜单和tagActions
+        if (action->kind == 2)
+        {
+            if (fl_choice("是否删除标签 %s？\n只删除标签，不影响其中的条目。", "取消", "删除", 0, tag.c_str()) != 1)
+                return;
+            win->stateStore.tags().removeTag(tag);
+            win->tagsChanged();
+            return;
+        }
+        // 两个表格中的成员按位图一次切换，作为一步撤销
+        win->stateStore.tags().setEnabled(tag, action->kind == 0, win->systemModel, win->userModel);
+    }
+
+    static void whichCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        win->updateEffectivePath();
+        if (!win->whichWindow)
+        {
+            win->whichWindow = new WhichWindow(&win->whichResolver);
+        }
+        win->whichWindow->show();
+    }
+
+    // 比较窗口需要的两种快照：当前表格和注册表，文件由窗口自己读取
+    bool loadSnapshot(DiffWindow::Source source, PathSnapshot_t &snapshot)
+    {
+        snapshot.ordered = true;
+        if (source == DiffWindow::SOURCE_TABLES)
+        {
+            snapshot.name = "当前表格";
+            systemModel.toVector(snapshot.systemPaths);
+            userModel.toVector(snapshot.userPaths);
+        }
+        else
+        {
+            snapshot.name = "注册表";
+            snapshot.systemPaths = getSystemPath();
+            snapshot.userPaths = getUserPath();
+        }
+        return true;
+    }
+
+    static void diffCallback(Fl_Widget *w, void *data)
+    {
+        MainWindow *win = static_cast<MainWindow *>(data);
+        if (!win->diffWindow)
+        {
+            win->diffWindow = new DiffWindow(
+                [win](DiffWindow::Source source, PathSnapshot_t &snapshot) { return win->loadSnapshot(source, snapshot); },
+                [win](const std::string &value) { return win->expandPath(value); });
+        }
+        win->diffWindow->show();
+    }
+
+    // 处理PathTable焦点切换
+    void handleTableFocus(PathTable* focusedTable)
+    {
+        lastFocusedTable = focusedTable;
+        if (focusedTable == systemPathTable)
+        {
+            userPathTable->clearSelection();
+        }
+        else if (focusedTable == userPathTable)
+        {
+            systemPathTable->clearSelection();
+        }
+    }
+
+    // 模型有修改时在标题栏标记未应用
+    void onModelChange(const PathListChange_t &change)
+    {
+        // 压缩墓碑不改变内容
+        if (change.kind == PathListChange_t::COMPACT)
+        {
+            return;
+        }
+        scheduleIndexUpdate();
+        updateStatus();
+        if (!unapplied)
+        {
+            unapplied = true;
+            label("QuickManPath *");
+        }
+    }
+
+    // 状态栏：生效PATH展开后的长度、两个Path各自写入注册表的长度及离上限的余量
+    void updateStatus()
+    {
+        size_t effective = PathLengthCounter::effectiveLength(systemLength, userLength);
+        size_t systemRaw = systemLength.rawLength();
+        size_t userRaw = userLength.rawLength();
+        auto headroom = [](size_t length, size_t limit) {
+            return length <= limit ? "余 " + std::to_string(limit - length) : "超出 " + std::to_string(length - limit);
+        };
+        std::string text = "生效PATH（展开后）" + std::to_string(effective) + " / " + std::to_string(pathValueLimit - 1) +
+                           "（" + headroom(effective, pathValueLimit - 1) + "）    系统Path " + std::to_string(systemRaw) +
+                           "    用户Path " + std::to_string(userRaw) + "    旧工具上限 " + std::to_string(pathLegacyLimit) +
+                           "（" + headroom((std::max)(systemRaw, userRaw), pathLegacyLimit) + "）";
+        if (!policy.empty())
+        {
+            size_t violations = policy.violationCount();
+            text += violations == 0 ? "    策略：全部满足" : "    策略：" + std::to_string(violations) + "处不满足";
+        }
+        statusBar->copy_label(text.c_str());
+        if (effective >= pathValueLimit || policy.errorCount() > 0)
+            statusBar->labelcolor(FL_RED);
+        else if (systemRaw > pathLegacyLimit || userRaw > pathLegacyLimit)
+            statusBar->labelcolor(fl_rgb_color(227, 140, 0));
+        else
+            statusBar->labelcolor(FL_FOREGROUND_COLOR);
+    }
+
+    void initPaths()
+    {
+        if (PathStateStore::defaultFilePath().empty())
+        {
+            fl_alert("无法获取用户目录！");
+            return;
+        }
+
+        std::vector<EnvPathItem_t> systemPathVec;
+        std::vector<EnvPathItem_t> userPathVec;
+        if (!stateStore.loadMerged(getSystemPath(), getUserPath(), systemPathVec, userPathVec))
+        {
+            fl_alert("无法读取路径数据 JSON 文件！");
+        }
+
+        // 先订阅，合并了注册表内容的初始状态退出时也会写回
+        stateStore.attach(&systemModel, &userModel);
+        systemModel.replaceAll(std::move(systemPathVec));
+        userModel.replaceAll(std::move(userPathVec));
+    }
+
+    // 把注册表中的路径合并进模型：已有的同步启用状态，没有的追加，整体作为一步撤销
+    static void mergeRegistryPaths(PathListModel &model, const std::vector<EnvPathItem_t> &locPaths)
+    {
+        model.beginBatch();
+        for (const auto &envItem : locPaths)
+        {
+            size_t index = model.find(envItem.path);
+            if (index != PathListModel::npos)
+            {
+                model.setEnabled(index, envItem.enabled);
             }
-            if(!found)
+            else
             {
-                curUserPaths.push_back(envItem);
+                model.append(envItem);
             }
         }
+        model.endBatch();
+    }
+
+    void refreshPaths()
+    {
+        // 变量可能在此期间被其它程序修改
+        loadVariables();
 
-        systemPathTable->setPaths(curSystemPaths);
-        userPathTable->setPaths(curUserPaths);
+        // load local path
+        auto locSystemPaths = getSystemPath();
+        auto locUserPaths = getUserPath();
+
+        mergeRegistryPaths(systemModel, locSystemPaths);
+        mergeRegistryPaths(userModel, locUserPaths);
+        healthScanner.rescanAll(); // 目录可能在此期间被创建或删除
+        exeIndex.rescanAll();
+        whichResolver.invalidate();
         fl_message("刷新成功！");
     }
 
@@ -268,15 +1083,89 @@ private:
         //1. 获取当前path及其状态，如果EnvPathItem_t.enable，则应用，否则不应用，
         //2. 注意当前系统的path，如果其被修改为disable，或者不在path里面，删除
         std::vector<EnvPathItem_t> curSystemPaths;
-        systemPathTable->getPaths(curSystemPaths);
+        systemModel.toVector(curSystemPaths);
         std::vector<EnvPathItem_t> curUserPaths;
-        userPathTable->getPaths(curUserPaths);
+        userModel.toVector(curUserPaths);
+
+        // 超过上限的Path在新进程中会被截断，提前提示而不是只报告失败
+        const char *names[2] = {"系统Path", "用户Path"};
+        const PathLengthCounter *counters[2] = {&systemLength, &userLength};
+        std::string warnings;
+        for (int m = 0; m < 2; m++)
+        {
+            size_t length = counters[m]->rawLength();
+            if (length + 1 > pathValueLimit)
+            {
+                fl_alert("%s长度 %zu 超过环境变量上限 %zu，未写入。\n请删除条目或使用\"工具/压缩Path长度\"。",
+                         names[m], length, pathValueLimit - 1);
+                return;
+            }
+            if (length > pathLegacyLimit)
+            {
+                warnings += std::string(names[m]) + "长度 " + std::to_string(length) + " 超过旧工具上限 " +
+                            std::to_string(pathLegacyLimit) + "，setx和旧版编辑对话框会截断它\n";
+            }
+        }
+        size_t effective = PathLengthCounter::effectiveLength(systemLength, userLength);
+        if (effective + 1 > pathValueLimit)
+        {
+            warnings += "系统和用户Path展开后合计 " + std::to_string(effective) + "，超过环境变量上限 " +
+                        std::to_string(pathValueLimit - 1) + "，新进程中PATH末尾的条目会丢失\n";
+        }
+        policy.evaluate(systemModel, userModel);
+        if (policy.blocksApply())
+        {
+            fl_alert("有 %zu 处不满足error级策略规则，未写入。\n详见\"工具/策略检查结果\"。", policy.errorCount());
+            return;
+        }
+        if (!policy.violationList().empty())
+        {
+            warnings += "有 " + std::to_string(policy.violationList().size()) + " 处不满足策略规则\n";
+        }
+        if (!warnings.empty() && fl_choice("%s\n仍然应用？", "取消", "应用", 0, warnings.c_str()) != 1)
+        {
+            return;
+        }
+
+        // 压缩时新建的变量要先于引用它们的Path写入；压缩被撤销后没有条目再引用的变量不写入，避免留下孤立的变量
+        std::string liveText;
+        for (const auto *items : {&curSystemPaths, &curUserPaths})
+        {
+            for (const auto &item : *items)
+            {
+                liveText += toLowerAscii(item.path);
+                liveText += ';';
+            }
+        }
+        for (size_t i = 0; i < pendingVariables.size(); i++)
+        {
+            const PathVariable_t &variable = pendingVariables[i].first;
+            bool system = pendingVariables[i].second;
+            if (liveText.find("%" + toLowerAscii(variable.name) + "%") == std::string::npos)
+            {
+                envExpander.removeVariable(system ? EnvExpander::SCOPE_SYSTEM : EnvExpander::SCOPE_USER, variable.name);
+                continue;
+            }
+            if (!setEnvironmentVariableValue(variable.name, variable.value, system))
+            {
+                fl_alert("无法写入变量 %s！", variable.name.c_str());
+                return;
+            }
+        }
+        pendingVariables.clear();
+        launcher.invalidate(); // 写入变量时也更新了当前进程的环境
+        activationScripts.invalidate();
 
         bool res0 = setSystemPath(curSystemPaths);
         bool res1 = setUserPath(curUserPaths);
 
         if(res0 && res1)
         {
+            // 已删除的路径正式生效，不再提供恢复
+            systemPathTable->commitDeletes();
+            userPathTable->commitDeletes();
+            unapplied = false;
+            label("QuickManPath");
             fl_message("路径应用成功！");
         }
         else
@@ -286,7 +1175,7 @@ private:
     }
 
 public:
-    MainWindow(int W, int H, int titleBarH, const char *L = 0) : Fl_Window(W, H, L)
+    MainWindow(int W, int H, int titleBarH, const char *L = 0) : Fl_Window(W, H, L), lastFocusedTable(nullptr), unapplied(false), whichWindow(nullptr), diffWindow(nullptr)
     {
         // 设置窗口为双缓冲模式以减少闪烁
         // set_output();
@@ -296,8 +1185,27 @@ public:
 
         // 设置窗口图标将在窗口显示后进行
 
+        // 菜单栏
+        menuBar = new Fl_Menu_Bar(0, 0, W, menuBarH);
+        menuBar->add("工具/查找命令...", FL_CTRL + 'f', whichCallback, this);
+        menuBar->add("工具/可执行文件遮蔽分析...", 0, shadowReportCallback, this);
+        menuBar->add("工具/清理重复条目...", 0, cleanUpCallback, this);
+        menuBar->add("工具/压缩Path长度...", 0, compressCallback, this);
+        menuBar->add("工具/删除目录别名", 0, removeAliasesCallback, this);
+        menuBar->add("工具/按使用频率优化顺序...", 0, optimizeOrderCallback, this);
+        menuBar->add("工具/导出当前顺序...", 0, exportOrderCallback, this);
+        menuBar->add("工具/比较Path快照...", 0, diffCallback, this);
+        menuBar->add("工具/批量替换条目...", FL_CTRL + 'h', rewriteCallback, this);
+        menuBar->add("工具/导入条目...", 0, importCallback, this);
+        menuBar->add("工具/导出条目...", 0, exportCallback, this);
+        menuBar->add("工具/按当前表格运行程序...", 0, launchTablesCallback, this);
+        menuBar->add("工具/按快照文件运行程序...", 0, launchFileCallback, this);
+        menuBar->add("工具/生成Shell激活脚本...", 0, activationCallback, this);
+        menuBar->add("工具/加载策略规则...", 0, loadPolicyCallback, this);
+        menuBar->add("工具/策略检查结果...", 0, policyReportCallback, this);
+
         // 创建主布局容器 - 垂直排列
-        mainPack = new Fl_Pack(0, 0, W, H);
+        mainPack = new Fl_Pack(0, menuBarH, W, H - menuBarH);
         mainPack->type(Fl_Pack::VERTICAL);
         mainPack->spacing(0); // 组间无间距
         mainPack->begin();
@@ -311,6 +1219,7 @@ public:
         userLabel->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
 
         userPathTable = new PathTable(tabelLeftMargin, labelWholeH, W - tabelLeftMargin * 2, tabelH);
+        userPathTable->setModel(&userModel);
         userPathTable->cols(4);
         userPathTable->col_width(0, fixedCellW);
         userPathTable->col_width(1, W - fixedCellW * 3 - tabelLeftMargin * 2);
@@ -337,6 +1246,7 @@ public:
         systemLabel->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
         
         systemPathTable = new PathTable(tabelLeftMargin, labelWholeH, W - tabelLeftMargin * 2, tabelH);
+        systemPathTable->setModel(&systemModel);
         systemPathTable->cols(4);
         systemPathTable->col_width(0, fixedCellW);
         systemPathTable->col_width(1, W - fixedCellW * 3 - tabelLeftMargin * 2);
@@ -354,6 +1264,12 @@ public:
         systemGroup->end();
         systemGroup->resizable(systemPathTable);
 
+        // 状态栏 - 表格下方显示长度统计
+        statusBar = new Fl_Box(0, 0, W, statusBarH);
+        statusBar->box(FL_THIN_DOWN_BOX);
+        statusBar->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
+        statusBar->labelsize(12);
+
         // 按钮组 - 放在底部，固定高度
         buttonGroup = new Fl_Group(0, 0, W, buttonWholeH);
         buttonGroup->box(FL_FLAT_BOX);
@@ -387,68 +1303,111 @@ public:
         resizable(mainPack);
         // 计算最小宽度：4个按钮 + 3个间距 + 左右边距
         int minWindowWidth = buttonW * 4 + 10 * 3 + 20; // 20是左右边距
-        size_range(minWindowWidth, groupH * 2 + buttonWholeH + titleBarH);
+        size_range(minWindowWidth, groupH * 2 + buttonWholeH + statusBarH + menuBarH + titleBarH);
+
+        // 条目中的%VAR%按注册表中的变量展开，注册表里没有的（例如USERPROFILE）取进程环境
+        envExpander.setFallback([](const std::string &name, std::string &value) {
+            DWORD needed = GetEnvironmentVariableA(name.c_str(), NULL, 0);
+            if (needed == 0)
+                return false;
+            value.assign(needed, '\0');
+            DWORD written = GetEnvironmentVariableA(name.c_str(), &value[0], needed);
+            value.resize(written < needed ? written : 0);
+            return written < needed;
+        });
+        loadVariables();
+        PathHealthScanner::Expander expand = [this](const std::string &value) { return expandPath(value); };
+        // 长度统计先于标题栏标记订阅，状态栏更新时计数已经调整
+        systemLength.setExpander(expand);
+        userLength.setExpander(expand);
+        systemLength.attach(&systemModel);
+        userLength.attach(&userModel);
+        userPathTable->setEnvExpander(&envExpander);
+        systemPathTable->setEnvExpander(&envExpander);
+
+        // 目录状态检查：新增或替换的条目自动检查，结果经Fl::awake送回主线程
+        healthScanner.setExpander(expand);
+        healthScanner.setResultsReady([this]() { Fl::awake(healthAwake, this); });
+        healthScanner.watch(&systemModel);
+        healthScanner.watch(&userModel);
+        userPathTable->setHealthScanner(&healthScanner);
+        systemPathTable->setHealthScanner(&healthScanner);
+
+        // 可执行文件索引：表格中全部被遮蔽的条目灰显
+        exeIndex.setExpander(expand);
+        pathTrie.setExpander(expand);
+        pathTrie.attach(&systemModel, &userModel); // 随每行的变化更新
+        whichResolver.setExpander(expand);
+        launcher.setExpander(expand);
+        activationScripts.setExpander(expand);
+        exeIndex.setResultsReady([this]() { Fl::awake(indexAwake, this); });
+        userPathTable->setUserScope(true);
+        systemPathTable->setUserScope(false);
+        userPathTable->setExecutableIndex(&exeIndex);
+        systemPathTable->setExecutableIndex(&exeIndex);
+        userPathTable->setAliasDetector(&aliasDetector);
+        systemPathTable->setAliasDetector(&aliasDetector);
+        policy.setExpander(expand);
+        userPathTable->setPolicy(&policy);
+        systemPathTable->setPolicy(&policy);
+        userPathTable->setTags(&stateStore.tags());
+        systemPathTable->setTags(&stateStore.tags());
 
         // 初始加载数据
         initPaths();
+        rebuildTagMenu();
+        std::filesystem::path policyFile = PathPolicy::defaultFilePath();
+        if (!policyFile.empty() && std::filesystem::exists(policyFile))
+        {
+            loadPolicy(policyFile);
+        }
+        policy.attach(&systemModel, &userModel); // 之后随每行的变化增量检查
+        policy.evaluate(systemModel, userModel);
+        updateEffectivePath();
+        updateStatus();
+
+        // 初始加载之后才开始跟踪未应用的修改
+        systemModel.subscribe([this](const PathListChange_t &change) { onModelChange(change); });
+        userModel.subscribe([this](const PathListChange_t &change) { onModelChange(change); });
     }
 
     ~MainWindow()
     {
-        namespace fs = std::filesystem;
-        using json = nlohmann::json;
+        Fl::remove_timeout(indexTimeout, this);
+        delete whichWindow;
+        delete diffWindow;
+        // 表格由Fl_Group基类析构，晚于模型成员，这里先解除订阅
+        systemPathTable->setModel(nullptr);
+        userPathTable->setModel(nullptr);
 
-        // 获取用户目录
-        char *userProfile = nullptr;
-        size_t len = 0;
-        if (_dupenv_s(&userProfile, &len, "USERPROFILE") != 0 || userProfile == nullptr)
+        if (stateStore.filePath().empty())
         {
-            fl_alert("无法获取用户目录！");
             return;
         }
-
-        // 使用 userProfile
-        fs::path appDataPath = fs::path(userProfile) / "AppData/Local/QuickManPath";
-
-        // 释放分配的内存
-        free(userProfile);
-
-        fs::path jsonFilePath = appDataPath / "pathVars.json";
-
-        // 获取当前路径数据
-        std::vector<EnvPathItem_t> systemPaths;
-        systemPathTable->getPaths(systemPaths);
-
-        std::vector<EnvPathItem_t> userPaths;
-        userPathTable->getPaths(userPaths);
-
-        // 转换为map格式以便JSON序列化
-        std::map<std::string, bool> systemPathsMap;
-        std::map<std::string, bool> userPathsMap;
-        
-        for (const auto& item : systemPaths) {
-            systemPathsMap[item.path] = item.enabled;
-        }
-        
-        for (const auto& item : userPaths) {
-            userPathsMap[item.path] = item.enabled;
-        }
-
-        // 写入 JSON 文件
-        json pathData = {
-            {"systemPaths", systemPathsMap},
-            {"userPaths", userPathsMap}
-        };
-        std::ofstream outFile(jsonFilePath);
-        if (outFile.is_open())
+        if (stateStore.isDirty() && !stateStore.save())
         {
-            outFile << pathData.dump(4); // 格式化输出
-            outFile.close();
+            fl_alert("无法写入路径数据到 JSON 文件！");
         }
-        else
+    }
+
+    int handle(int event) override
+    {
+        // 表格没有焦点时（例如刚点过按钮），Ctrl+Z / Ctrl+Y 作用于最近使用的表格
+        if (event == FL_SHORTCUT && lastFocusedTable && Fl::event_state(FL_CTRL))
         {
-            fl_alert("无法写入路径数据到 JSON 文件！");
+            int key = Fl::event_key();
+            if (key == 'z' && !Fl::event_state(FL_SHIFT))
+            {
+                lastFocusedTable->undo();
+                return 1;
+            }
+            if (key == 'y' || (key == 'z' && Fl::event_state(FL_SHIFT)))
+            {
+                lastFocusedTable->redo();
+                return 1;
+            }
         }
+        return Fl_Window::handle(event);
     }
 
     void resize(int X, int Y, int W, int H) override
@@ -456,16 +1415,18 @@ public:
         Fl_Window::resize(X, Y, W, H);
         
 
-        int availableHeight = H - buttonWholeH;
+        menuBar->resize(0, 0, W, menuBarH);
+        int availableHeight = H - buttonWholeH - statusBarH - menuBarH;
 
         size_t total_path_len = systemPathTable->getPathLength() + userPathTable->getPathLength() + 2; // 2 is table header
 
         int systemHeight = static_cast<int>((availableHeight - 2 * labelWholeH) * (systemPathTable->getPathLength() + 1) / total_path_len + labelWholeH);
         int userHeight = static_cast<int>((availableHeight - 2 * labelWholeH) * (userPathTable->getPathLength() + 1) / total_path_len + labelWholeH);
 
-        userGroup->resize(0, 0, W, userHeight);
-        systemGroup->resize(0, userHeight, W, systemHeight);
-        buttonGroup->resize(0, availableHeight, W, buttonWholeH);
+        userGroup->resize(0, menuBarH, W, userHeight);
+        systemGroup->resize(0, menuBarH + userHeight, W, systemHeight);
+        statusBar->resize(0, menuBarH + availableHeight, W, statusBarH);
+        buttonGroup->resize(0, menuBarH + availableHeight + statusBarH, W, buttonWholeH);
 
         // 调整 userPathTable 的宽度
         if (userPathTable)
@@ -500,7 +1461,7 @@ public:
             int buttonSpacing = 10; // 按钮间距
             int totalButtonWidth = buttonW * 4 + buttonSpacing * 3; // 4个按钮的总宽度
             int startX = (buttonGroup->w() - totalButtonWidth) / 2; // 起始X坐标，使按钮居中
-            int buttonY = (buttonWholeH - buttonH) / 2; // Y坐标，垂直居中
+            int buttonY = menuBarH + statusBarH + (buttonWholeH - buttonH) / 2; // Y坐标，垂直居中
             
             // 更新所有4个按钮的位置
             newUserButton->position(startX, availableHeight + buttonY);
@@ -511,12 +1472,59 @@ public:
     }
 };
 
+// 命令行：QuickManPath --which <命令>，按保存的表格状态（含未应用的修改）输出会运行的文件
+static int runWhich(const char *command)
+{
+    attachParentConsole();
+    PathStateStore store;
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    store.loadMerged(getSystemPath(), getUserPath(), systemPaths, userPaths);
+
+    std::vector<std::string> searchPath;
+    for (const auto &item : systemPaths)
+    {
+        if (item.enabled)
+            searchPath.push_back(item.path);
+    }
+    for (const auto &item : userPaths)
+    {
+        if (item.enabled)
+            searchPath.push_back(item.path);
+    }
+
+    WhichResolver resolver;
+    resolver.setExpander(expandEnvironmentString);
+    resolver.setSearchPath(searchPath);
+    std::vector<WhichHit_t> hits = resolver.resolve(command);
+    if (hits.empty())
+    {
+        fprintf(stderr, "%s: not found\n", command);
+        return 1;
+    }
+    for (size_t i = 0; i < hits.size(); i++)
+    {
+        // 第一个是实际运行的文件，其余是被它遮蔽的同名文件
+        printf(i == 0 ? "%s\n" : "  (shadowed) %s\n", hits[i].file.c_str());
+    }
+    return 0;
+}
+
 int main(int argc, char **argv)
 {
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--which") == 0)
+        {
+            return runWhich(argv[i + 1]);
+        }
+    }
+
+    Fl::lock(); // 启用多线程支持，后台检查线程需要Fl::awake
     int titleBarHeight = getTitleBarHeight();
     // 计算合适的初始窗口宽度以容纳4个按钮
     int initialWidth = max(700, buttonW * 4 + 10 * 3 + 40); // 4个按钮 + 3个间距 + 额外边距
-    MainWindow *window = new MainWindow(initialWidth, 740, titleBarHeight, "QuickManPath");
+    MainWindow *window = new MainWindow(initialWidth, 740 + menuBarH + statusBarH, titleBarHeight, "QuickManPath");
     window->show(argc, argv);
     
     // 设置窗口图标
@@ -0,0 +1,67 @@
+#include "path_alias_detector.hpp"
+#include "path_utils.hpp"
+
+PathAliasDetector::PathAliasDetector() : systemCount(0), userCount(0)
+{
+}
+
+std::string PathAliasDetector::entryKey(const std::string &rawPath, bool user)
+{
+    return (user ? "U|" : "S|") + rawPath;
+}
+
+void PathAliasDetector::update(const PathListModel &system, const PathListModel &user,
+                               const PathHealthScanner &scanner, const Expander &expander)
+{
+    struct First {
+        std::string raw;
+        std::string key; // 展开并规范化后的写法
+    };
+    std::unordered_map<FileIdentity_t, First, FileIdentityHash> firstSeen;
+    aliases.clear();
+    systemCount = 0;
+    userCount = 0;
+
+    const PathListModel *models[2] = {&system, &user};
+    for (int m = 0; m < 2; m++)
+    {
+        const PathListModel &model = *models[m];
+        for (size_t i = 0; i < model.size(); i++)
+        {
+            if (model.isDeleted(i) || !model.at(i).enabled)
+                continue;
+            const std::string &raw = model.at(i).path;
+            FileIdentity_t identity;
+            if (!scanner.identity(raw, identity))
+                continue;
+            std::string key = normalizePathKey(expander ? expander(raw) : raw);
+            auto it = firstSeen.find(identity);
+            if (it == firstSeen.end())
+            {
+                firstSeen.emplace(identity, First{raw, key});
+                continue;
+            }
+            // 写法相同的只是普通重复
+            if (it->second.key == key)
+                continue;
+            if (aliases.emplace(entryKey(raw, m == 1), it->second.raw).second)
+            {
+                if (m == 1)
+                    userCount++;
+                else
+                    systemCount++;
+            }
+        }
+    }
+}
+
+const std::string *PathAliasDetector::aliasOf(const std::string &rawPath, bool user) const
+{
+    auto it = aliases.find(entryKey(rawPath, user));
+    return it == aliases.end() ? nullptr : &it->second;
+}
+
+size_t PathAliasDetector::count(bool user) const
+{
+    return user ? userCount : systemCount;
+}
@@ -0,0 +1,362 @@
+// PATH查找基准测试：按候选的系统+用户路径顺序设置PATH，反复启动命令并统计延迟分位数。
+// 候选来自 pathVars.json 格式的文件，或界面中"导出当前顺序"生成的文本文件。
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <filesystem>
+#include "path_state_store.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#include "win_env_utils.hpp"
+#else
+#include <spawn.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+static const char pathSeparator = ';';
+#else
+static const char pathSeparator = ':';
+#endif
+
+typedef struct Candidate_s {
+    std::string name;
+    std::string path; // 展开后用分隔符连接的PATH
+    size_t entryCount;
+} Candidate_t;
+
+typedef struct Stats_s {
+    double minUs;
+    double p50Us;
+    double p90Us;
+    double p99Us;
+    double maxUs;
+    double meanUs;
+    size_t failures;
+} Stats_t;
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: QuickManPathBench [options] [candidate ...]\n"
+            "  candidate          pathVars.json-style file, or a text list with [system]/[user] sections\n"
+            "                     (default: the saved pathVars.json)\n"
+            "  --command \"cmd args\" command line to spawn, repeatable (default: generated stub commands)\n"
+            "  --stubs N          number of stub commands to generate (default 3)\n"
+            "  --iterations N     spawns per command per candidate (default 50)\n"
+            "  --warmup N         untimed spawns per command per candidate (default 3)\n");
+}
+
+static std::string expand(const std::string &value)
+{
+#ifdef _WIN32
+    return expandEnvironmentString(value);
+#else
+    return value;
+#endif
+}
+
+static std::vector<std::string> splitArgs(const std::string &commandLine)
+{
+    std::vector<std::string> args;
+    size_t start = 0;
+    while ((start = commandLine.find_first_not_of(' ', start)) != std::string::npos)
+    {
+        size_t end = commandLine.find(' ', start);
+        args.push_back(commandLine.substr(start, end == std::string::npos ? std::string::npos : end - start));
+        start = end;
+    }
+    return args;
+}
+
+static fs::path selfPath()
+{
+#ifdef _WIN32
+    char buffer[MAX_PATH];
+    DWORD len = GetModuleFileNameA(NULL, buffer, MAX_PATH);
+    return fs::path(std::string(buffer, len));
+#else
+    std::error_code ec;
+    return fs::read_symlink("/proc/self/exe", ec);
+#endif
+}
+
+// 把自身复制成若干个桩命令，带 --stub 参数启动时立即退出
+static bool makeStubs(const fs::path &dir, size_t count, std::vector<std::string> &commands)
+{
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    fs::path self = selfPath();
+    if (ec || self.empty())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string name = "qmp_stub_" + std::to_string(i + 1);
+#ifdef _WIN32
+        fs::path target = dir / (name + ".exe");
+#else
+        fs::path target = dir / name;
+#endif
+        fs::copy_file(self, target, fs::copy_options::overwrite_existing, ec);
+        if (ec)
+        {
+            return false;
+        }
+        commands.push_back(name + " --stub");
+    }
+    return true;
+}
+
+// 启动一次并等待结束，命令按当前进程的PATH查找；返回false表示无法启动
+static bool spawnAndWait(const std::vector<std::string> &args)
+{
+#ifdef _WIN32
+    std::string commandLine;
+    for (const auto &arg : args)
+    {
+        if (!commandLine.empty())
+            commandLine += ' ';
+        commandLine += arg;
+    }
+    SECURITY_ATTRIBUTES sa = {sizeof(SECURITY_ATTRIBUTES), NULL, TRUE};
+    HANDLE nul = CreateFileA("NUL", GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, &sa, OPEN_EXISTING, 0, NULL);
+    STARTUPINFOA si = {0};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = nul;
+    si.hStdOutput = nul;
+    si.hStdError = nul;
+    PROCESS_INFORMATION pi = {0};
+    BOOL ok = CreateProcessA(NULL, &commandLine[0], NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi);
+    if (ok)
+    {
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        CloseHandle(pi.hThread);
+        CloseHandle(pi.hProcess);
+    }
+    CloseHandle(nul);
+    return ok != 0;
+#else
+    std::vector<char *> argv;
+    for (const auto &arg : args)
+    {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 0, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    int rc = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0)
+    {
+        return false;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    // 找不到命令时部分实现仍会fork成功，子进程以127退出
+    return !(WIFEXITED(status) && WEXITSTATUS(status) == 127);
+#endif
+}
+
+static void setProcessPath(const std::string &path)
+{
+#ifdef _WIN32
+    SetEnvironmentVariableA("PATH", path.c_str());
+#else
+    setenv("PATH", path.c_str(), 1);
+#endif
+}
+
+static bool loadCandidate(const std::string &file, const std::string &stubDir, Candidate_t &candidate)
+{
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    bool ordered = true;
+    if (!PathStateStore::readAnyFile(file, systemPaths, userPaths, &ordered))
+    {
+        return false;
+    }
+    if (!ordered)
+    {
+        fprintf(stderr, "warning: %s does not record the order, its entries are measured sorted by path\n",
+                file.c_str());
+    }
+    candidate.name = fs::path(file).filename().string();
+    candidate.path.clear();
+    candidate.entryCount = 0;
+    // 与Windows合成进程PATH的方式一致：系统在前，用户在后
+    for (const auto *list : {&systemPaths, &userPaths})
+    {
+        for (const auto &item : *list)
+        {
+            if (!item.enabled)
+                continue;
+            if (!candidate.path.empty())
+                candidate.path += pathSeparator;
+            candidate.path += expand(item.path);
+            candidate.entryCount++;
+        }
+    }
+    // 桩命令放在最后，每次查找都要走完整个PATH
+    if (!stubDir.empty())
+    {
+        if (!candidate.path.empty())
+            candidate.path += pathSeparator;
+        candidate.path += stubDir;
+    }
+    return true;
+}
+
+static Stats_t summarize(std::vector<double> &samples, size_t failures)
+{
+    Stats_t stats = {0, 0, 0, 0, 0, 0, failures};
+    if (samples.empty())
+    {
+        return stats;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t rank = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+        return samples[rank];
+    };
+    double sum = 0;
+    for (double v : samples)
+    {
+        sum += v;
+    }
+    stats.minUs = samples.front();
+    stats.p50Us = percentile(0.50);
+    stats.p90Us = percentile(0.90);
+    stats.p99Us = percentile(0.99);
+    stats.maxUs = samples.back();
+    stats.meanUs = sum / samples.size();
+    return stats;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--stub") == 0)
+    {
+        return 0;
+    }
+
+    std::vector<std::string> files;
+    std::vector<std::string> commands;
+    size_t stubCount = 3;
+    size_t iterations = 50;
+    size_t warmup = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--command" && hasValue)
+            commands.push_back(argv[++i]);
+        else if (arg == "--stubs" && hasValue)
+            stubCount = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--iterations" && hasValue)
+            iterations = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--warmup" && hasValue)
+            warmup = strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--help" || arg == "-h" || arg.compare(0, 2, "--") == 0)
+        {
+            usage();
+            return arg == "--help" || arg == "-h" ? 0 : 2;
+        }
+        else
+            files.push_back(arg);
+    }
+    if (files.empty())
+    {
+        fs::path saved = PathStateStore::defaultFilePath();
+        if (saved.empty() || !fs::exists(saved))
+        {
+            usage();
+            return 2;
+        }
+        files.push_back(saved.string());
+    }
+
+    fs::path stubDir;
+    if (commands.empty())
+    {
+        stubDir = fs::temp_directory_path() / ("qmp_bench_" + std::to_string(static_cast<unsigned long>(
+                                                                    std::chrono::steady_clock::now().time_since_epoch().count())));
+        if (!makeStubs(stubDir, stubCount, commands))
+        {
+            fprintf(stderr, "failed to create stub commands in %s\n", stubDir.string().c_str());
+            return 1;
+        }
+    }
+
+    std::vector<Candidate_t> candidates;
+    for (const auto &file : files)
+    {
+        Candidate_t candidate;
+        if (!loadCandidate(file, stubDir.string(), candidate))
+        {
+            fprintf(stderr, "cannot read candidate %s\n", file.c_str());
+            continue;
+        }
+        candidates.push_back(candidate);
+    }
+
+    printf("%zu command(s), %zu spawns each per candidate, latency in microseconds\n", commands.size(), iterations);
+    printf("%-32s %7s %9s %9s %9s %9s %9s %9s %6s\n", "candidate", "entries", "min", "p50", "p90", "p99", "max", "mean", "fail");
+    int rc = 0;
+    for (const auto &candidate : candidates)
+    {
+        setProcessPath(candidate.path);
+        std::vector<double> samples;
+        samples.reserve(iterations * commands.size());
+        size_t failures = 0;
+        for (const auto &command : commands)
+        {
+            std::vector<std::string> args = splitArgs(command);
+            if (args.empty())
+                continue;
+            for (size_t i = 0; i < warmup; i++)
+            {
+                spawnAndWait(args);
+            }
+            for (size_t i = 0; i < iterations; i++)
+            {
+                auto start = std::chrono::steady_clock::now();
+                bool ok = spawnAndWait(args);
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                if (!ok)
+                {
+                    failures++;
+                    continue;
+                }
+                samples.push_back(std::chrono::duration<double, std::micro>(elapsed).count());
+            }
+        }
+        Stats_t stats = summarize(samples, failures);
+        printf("%-32s %7zu %9.0f %9.0f %9.0f %9.0f %9.0f %9.0f %6zu\n", candidate.name.c_str(), candidate.entryCount,
+               stats.minUs, stats.p50Us, stats.p90Us, stats.p99Us, stats.maxUs, stats.meanUs, stats.failures);
+        if (failures > 0)
+            rc = 1;
+    }
+
+    if (!stubDir.empty())
+    {
+        std::error_code ec;
+        fs::remove_all(stubDir, ec);
+    }
+    return rc;
+}
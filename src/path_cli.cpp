@@ -0,0 +1,755 @@
+// 命令行工具：不创建界面，直接读写保存的表格状态（pathVars.json）和注册表，供脚本反复调用。
+// 与界面共用状态文件的合并、序列化和长度统计，修改的语义与在表格中操作后保存相同。
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "path_list_model.hpp"
+#include "path_state_store.hpp"
+#include "path_length_counter.hpp"
+#include "path_transfer.hpp"
+#include "path_launcher.hpp"
+#include "activation_script.hpp"
+#include "path_daemon.hpp"
+#include "fleet_analyzer.hpp"
+#include "path_policy.hpp"
+#include "path_rewriter.hpp"
+#include "path_utils.hpp"
+#ifdef _WIN32
+#include "win_env_utils.hpp"
+#endif
+
+namespace fs = std::filesystem;
+
+typedef struct Options_s {
+    std::string command;
+    std::vector<std::string> args;
+    bool system;   // 只作用于系统Path
+    bool user;     // 只作用于用户Path
+    bool disabled; // add时以禁用状态加入
+    bool apply;    // 修改保存后立即写入注册表
+    bool regex;    // rewrite的查找内容是正则表达式
+    bool dryRun;   // rewrite只显示预览，不保存
+    bool guard;    // daemon同时监视注册表中的Path
+    bool revert;   // 守护模式下自动还原外部修改
+    std::string state; // run时使用的快照文件，空表示保存的表格状态
+    std::string golden; // fleet的基准配置
+    FleetAnalyzer::Options_t fleet;
+} Options_t;
+
+// 一次调用的表格状态，两个模型与界面中的相同
+typedef struct Session_s {
+    PathListModel systemModel;
+    PathListModel userModel;
+    PathStateStore store; // 在模型之后声明，先于模型析构
+} Session_t;
+
+static void usage()
+{
+    fprintf(stderr,
+            "usage: QuickManPathCli <command> [args] [options]\n"
+            "  list                 print saved entries as <system|user> <row> <on|off> <path>\n"
+            "  add <dir>            append a directory (to the user Path unless --system)\n"
+            "  remove <dir>         remove a directory\n"
+            "  enable <dir|@tag>    enable a directory, or every directory with the tag\n"
+            "  disable <dir|@tag>   disable a directory, or every directory with the tag\n"
+            "  tags                 print each tag as <tag> <enabled>/<entries>, then its directories\n"
+            "  tag <tag> <dir>      tag a directory; tags are kept in pathVars.json\n"
+            "  untag <tag> [dir]    remove a tag from a directory, or the whole tag\n"
+            "  load [file]          replace the saved state with a pathVars.json-style file or a text list\n"
+            "                       (default: the saved pathVars.json, without merging the registry)\n"
+            "  import <file>        append entries from a .reg, .txt or .jsonl/.ndjson file, skipping duplicates\n"
+            "                       (unsectioned entries go to the user Path unless --system)\n"
+            "  export <file>        write the saved state as .reg, .txt or .jsonl by extension\n"
+            "  apply                write the enabled entries of the saved state to the registry\n"
+            "  activate [file]      write activation scripts for cmd, PowerShell, bash and fish that change only the\n"
+            "                       current shell's PATH (from the saved state, or a file); unchanged scripts are\n"
+            "                       not rewritten\n"
+            "  run <program> [args] run a program with the saved state (or --state <file>) as its PATH, without\n"
+            "                       touching the registry; arguments after the program are passed through as-is\n"
+            "  daemon               stay resident and serve ping/query/states/switch/save/apply/reload/shutdown\n"
+            "                       requests over a local pipe (a UNIX socket outside Windows); saved states are\n"
+            "                       read from the states directory next to pathVars.json; with --guard also\n"
+            "                       answers guard/approve <id>/reject <id>\n"
+            "  send <request>       send one request to the resident daemon and print the reply\n"
+            "  check [rules]        check the saved state against policy rules (default: policy.rules next to\n"
+            "                       pathVars.json); exits with 1 when an error-level rule fails\n"
+            "  rewrite <find> <replacement>\n"
+            "                       replace text in every saved entry of both Paths, enabled or not (case-insensitive\n"
+            "                       on Windows); prints each change and the scan time\n"
+            "  fleet <dir>          analyze a directory of pathVars.json files collected from many machines:\n"
+            "                       clusters by PATH similarity, outliers, common prefixes and, with --golden,\n"
+            "                       drift from a reference profile\n"
+            "options:\n"
+            "  --system / --user    restrict to one Path (default: both, add defaults to --user)\n"
+            "  --disabled           add the directory disabled\n"
+            "  --regex              rewrite: <find> is an ECMAScript regex, <replacement> may use $1, $&\n"
+            "  --dry-run            rewrite: print the changes without saving\n"
+            "  --guard              daemon: pin the saved state and watch the registry (Windows) for outside\n"
+            "                       changes to either Path, queued for approve/reject\n"
+            "  --revert             daemon --guard: revert outside changes right away instead of queuing them\n"
+            "  --state <file>       run with a text list (see export) instead of the saved state\n"
+            "  --golden <file>      reference profile for fleet\n"
+            "  --threshold <0..1>   estimated similarity needed to join a fleet cluster (default 0.8)\n"
+            "  --min-cluster <n>    machines in smaller fleet clusters are reported as outliers (default 2)\n"
+            "  --threads <n>        fleet loader threads (default: one per CPU)\n"
+            "  --apply              apply after add/remove/enable/disable/load/import/rewrite; until applied,\n"
+            "                       entries still in the registry are merged back into the saved state on the\n"
+            "                       next call\n");
+}
+
+static bool parseOptions(int argc, char **argv, Options_t &options)
+{
+    options = Options_t{std::string(), std::vector<std::string>(), false, false, false, false, false, false, false,
+                        false, std::string(), std::string(), FleetAnalyzer::Options_t{0.8, 2, 0}};
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (options.command == "run" && (!options.args.empty() || arg == "--"))
+        {
+            // 程序之后的参数原样传给它
+            for (i += options.args.empty() && arg == "--" ? 1 : 0; i < argc; i++)
+                options.args.push_back(argv[i]);
+            break;
+        }
+        if (arg == "--state" || arg == "--golden" || arg == "--threshold" || arg == "--min-cluster" || arg == "--threads")
+        {
+            if (++i >= argc)
+                return false;
+            if (arg == "--state")
+                options.state = argv[i];
+            else if (arg == "--golden")
+                options.golden = argv[i];
+            else if (arg == "--threshold")
+                options.fleet.threshold = atof(argv[i]);
+            else if (arg == "--min-cluster")
+                options.fleet.minClusterSize = strtoul(argv[i], nullptr, 10);
+            else
+                options.fleet.threads = strtoul(argv[i], nullptr, 10);
+        }
+        else if (arg == "--system")
+            options.system = true;
+        else if (arg == "--user")
+            options.user = true;
+        else if (arg == "--disabled")
+            options.disabled = true;
+        else if (arg == "--apply")
+            options.apply = true;
+        else if (arg == "--regex")
+            options.regex = true;
+        else if (arg == "--dry-run")
+            options.dryRun = true;
+        else if (arg == "--guard")
+            options.guard = true;
+        else if (arg == "--revert")
+            options.revert = true;
+        else if (arg.compare(0, 2, "--") == 0 || arg == "-h")
+            return false;
+        else if (options.command.empty())
+            options.command = arg;
+        else
+            options.args.push_back(arg);
+    }
+    return !options.command.empty();
+}
+
+// 读取保存的状态并合并注册表，与界面启动时相同
+static bool loadSession(Session_t &session)
+{
+    std::vector<EnvPathItem_t> registrySystem;
+    std::vector<EnvPathItem_t> registryUser;
+#ifdef _WIN32
+    registrySystem = getSystemPath();
+    registryUser = getUserPath();
+#endif
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    bool ok = session.store.loadMerged(registrySystem, registryUser, systemPaths, userPaths);
+    session.systemModel.replaceAll(std::move(systemPaths));
+    session.userModel.replaceAll(std::move(userPaths));
+    // 加载之后才订阅：只查询时不写盘
+    session.store.attach(&session.systemModel, &session.userModel);
+    return ok;
+}
+
+// 按规范化后的写法查找未删除的行
+static std::vector<size_t> findRows(const PathListModel &model, const std::string &dir)
+{
+    std::vector<size_t> rows;
+    std::string key = normalizePathKey(dir);
+    for (size_t i = 0; i < model.size(); i++)
+    {
+        if (!model.isDeleted(i) && normalizePathKey(model.at(i).path) == key)
+            rows.push_back(i);
+    }
+    return rows;
+}
+
+static std::vector<PathListModel *> targetModels(Session_t &session, const Options_t &options)
+{
+    std::vector<PathListModel *> models;
+    if (options.system || !options.user)
+        models.push_back(&session.systemModel);
+    if (options.user || !options.system)
+        models.push_back(&session.userModel);
+    return models;
+}
+
+static int runList(Session_t &session, const Options_t &options)
+{
+    for (PathListModel *model : targetModels(session, options))
+    {
+        const char *scope = model == &session.systemModel ? "system" : "user";
+        size_t row = 0;
+        for (size_t i = 0; i < model->size(); i++)
+        {
+            if (model->isDeleted(i))
+                continue;
+            const EnvPathItem_t &item = model->at(i);
+            printf("%s\t%zu\t%s\t%s\n", scope, ++row, item.enabled ? "on" : "off", item.path.c_str());
+        }
+    }
+    return 0;
+}
+
+static int runAdd(Session_t &session, const Options_t &options)
+{
+    PathListModel &model = options.system ? session.systemModel : session.userModel;
+    const std::string &dir = options.args[0];
+    std::vector<size_t> rows = findRows(model, dir);
+    if (rows.empty())
+    {
+        model.append(EnvPathItem_t{dir, !options.disabled});
+        return 0;
+    }
+    // 已存在时只调整启用状态，重复调用结果相同
+    for (size_t row : rows)
+    {
+        model.setEnabled(row, !options.disabled);
+    }
+    return 0;
+}
+
+static int runRemove(Session_t &session, const Options_t &options)
+{
+    size_t removed = 0;
+    for (PathListModel *model : targetModels(session, options))
+    {
+        for (size_t row : findRows(*model, options.args[0]))
+        {
+            model->remove(row);
+            removed++;
+        }
+    }
+    if (removed == 0)
+    {
+        fprintf(stderr, "%s: not in the saved Path\n", options.args[0].c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int runSetEnabled(Session_t &session, const Options_t &options, bool enabled)
+{
+    if (options.args[0][0] == '@')
+    {
+        // 标签：按位图一次切换所有成员
+        std::string tag = options.args[0].substr(1);
+        PathTags &tags = session.store.tags();
+        const auto &data = tags.data();
+        if (data.find(tag) == data.end())
+        {
+            fprintf(stderr, "%s: no such tag\n", tag.c_str());
+            return 1;
+        }
+        for (PathListModel *model : targetModels(session, options))
+        {
+            tags.setEnabled(tag, enabled, *model);
+        }
+        return 0;
+    }
+    size_t found = 0;
+    for (PathListModel *model : targetModels(session, options))
+    {
+        for (size_t row : findRows(*model, options.args[0]))
+        {
+            model->setEnabled(row, enabled);
+            found++;
+        }
+    }
+    if (found == 0)
+    {
+        fprintf(stderr, "%s: not in the saved Path\n", options.args[0].c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int runTags(Session_t &session)
+{
+    PathTags &tags = session.store.tags();
+    for (const auto &pair : tags.data())
+    {
+        size_t members = 0;
+        size_t enabledCount = 0;
+        for (const PathListModel *model : {&session.systemModel, &session.userModel})
+        {
+            size_t m = 0;
+            size_t e = 0;
+            tags.count(pair.first, *model, m, e);
+            members += m;
+            enabledCount += e;
+        }
+        printf("%s\t%zu/%zu\n", pair.first.c_str(), enabledCount, members);
+        for (const auto &path : pair.second)
+        {
+            printf("\t%s\n", path.c_str());
+        }
+    }
+    return 0;
+}
+
+static int runTag(Session_t &session, const Options_t &options, bool add)
+{
+    PathTags &tags = session.store.tags();
+    const std::string &tag = options.args[0];
+    if (add && !PathTags::validName(tag))
+    {
+        fprintf(stderr, "%s: tag names cannot be empty or contain spaces or '/'\n", tag.c_str());
+        return 2;
+    }
+    if (add)
+    {
+        if (findRows(session.systemModel, options.args[1]).empty() &&
+            findRows(session.userModel, options.args[1]).empty())
+            fprintf(stderr, "warning: %s is not in the saved Path yet\n", options.args[1].c_str());
+        tags.add(tag, options.args[1]);
+        return 0;
+    }
+    bool removed = options.args.size() == 1 ? tags.removeTag(tag) : tags.remove(tag, options.args[1]);
+    if (!removed)
+    {
+        fprintf(stderr, "%s: not tagged\n", options.args.size() == 1 ? tag.c_str() : options.args[1].c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int runLoad(Session_t &session, const Options_t &options)
+{
+    fs::path file = options.args.empty() ? session.store.filePath() : fs::path(options.args[0]);
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    if (!PathStateStore::readAnyFile(file, systemPaths, userPaths))
+    {
+        fprintf(stderr, "cannot read %s\n", file.string().c_str());
+        return 1;
+    }
+    session.systemModel.replaceAll(std::move(systemPaths));
+    session.userModel.replaceAll(std::move(userPaths));
+    return 0;
+}
+
+static int runImport(Session_t &session, const Options_t &options)
+{
+    PathImportResult_t result;
+    const std::string &file = options.args[0];
+    if (!PathImporter::importInto(file, PathImporter::formatOf(file), !options.system, session.systemModel,
+                                  session.userModel, result))
+    {
+        fprintf(stderr, "cannot read %s\n", file.c_str());
+        return 1;
+    }
+    printf("read %zu, added %zu, skipped %zu duplicate(s)\n", result.records, result.added, result.duplicates);
+    if (result.errors > 0)
+    {
+        fprintf(stderr, "%zu line(s) could not be parsed\n", result.errors);
+    }
+    return 0;
+}
+
+static int runExport(Session_t &session, const Options_t &options)
+{
+    const std::string &file = options.args[0];
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    session.systemModel.toVector(systemPaths);
+    session.userModel.toVector(userPaths);
+    if (!PathExporter::writeFile(file, PathImporter::formatOf(file), systemPaths, userPaths))
+    {
+        fprintf(stderr, "cannot write %s\n", file.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int runApply(Session_t &session)
+{
+#ifdef _WIN32
+    PathLengthCounter systemLength;
+    PathLengthCounter userLength;
+    systemLength.setExpander(expandEnvironmentString);
+    userLength.setExpander(expandEnvironmentString);
+    systemLength.attach(&session.systemModel);
+    userLength.attach(&session.userModel);
+
+    // 与界面中的检查相同：超过上限拒绝写入，超过旧工具上限或展开后过长只提示
+    const char *names[2] = {"system", "user"};
+    const PathLengthCounter *counters[2] = {&systemLength, &userLength};
+    for (int m = 0; m < 2; m++)
+    {
+        size_t length = counters[m]->rawLength();
+        if (length + 1 > pathValueLimit)
+        {
+            fprintf(stderr, "%s Path is %zu characters, over the limit of %zu; nothing written\n", names[m], length,
+                    pathValueLimit - 1);
+            return 1;
+        }
+        if (length > pathLegacyLimit)
+        {
+            fprintf(stderr, "warning: %s Path is %zu characters, setx and the legacy editor truncate it at %zu\n",
+                    names[m], length, pathLegacyLimit);
+        }
+    }
+    size_t effective = PathLengthCounter::effectiveLength(systemLength, userLength);
+    if (effective + 1 > pathValueLimit)
+    {
+        fprintf(stderr, "warning: expanded PATH is %zu characters, entries past %zu are dropped in new processes\n",
+                effective, pathValueLimit - 1);
+    }
+
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    session.systemModel.toVector(systemPaths);
+    session.userModel.toVector(userPaths);
+    if (!sameAsRegistry(systemPaths, getSystemPath()) && !setSystemPath(systemPaths))
+    {
+        fprintf(stderr, "failed to write the system Path (administrator rights are required)\n");
+        return 1;
+    }
+    if (!sameAsRegistry(userPaths, getUserPath()) && !setUserPath(userPaths))
+    {
+        fprintf(stderr, "failed to write the user Path\n");
+        return 1;
+    }
+    return 0;
+#else
+    (void)session;
+    fprintf(stderr, "apply: the registry is only available on Windows\n");
+    return 1;
+#endif
+}
+
+static int runActivate(Session_t &session, const Options_t &options)
+{
+    ActivationScripts scripts;
+#ifdef _WIN32
+    scripts.setExpander(expandEnvironmentString);
+#endif
+    ActivationScripts::SnippetsPtr snippets;
+    std::string name = "current";
+    if (!options.args.empty())
+    {
+        snippets = scripts.forFile(options.args[0]);
+        name = fs::path(options.args[0]).stem().string();
+        if (!snippets)
+        {
+            fprintf(stderr, PathStateStore::isOrderedFile(options.args[0]) ? "cannot read %s\n" :
+                    "%s: this pathVars.json was saved by an older version and does not record the order, use a text list (see export)\n",
+                    options.args[0].c_str());
+            return 1;
+        }
+    }
+    else
+    {
+        snippets = scripts.forTables(session.systemModel.list(), session.userModel.list());
+    }
+    fs::path dir = ActivationScripts::defaultDirectory();
+    size_t written = 0;
+    if (dir.empty() || !ActivationScripts::writeFiles(*snippets, dir, name, written))
+    {
+        fprintf(stderr, "cannot write the activation scripts to %s\n", dir.string().c_str());
+        return 1;
+    }
+    for (int shell = 0; shell < SHELL_COUNT; shell++)
+    {
+        printf("%s\n", (dir / (name + ActivationScripts::extension(static_cast<ShellKind>(shell)))).string().c_str());
+    }
+    return 0;
+}
+
+static int runDaemon(const Options_t &options)
+{
+    std::string name = LocalServer::defaultName();
+    PathDaemon daemon;
+    if (!daemon.open())
+    {
+        fprintf(stderr, "warning: cannot read the saved state, starting from the registry\n");
+    }
+    if (options.guard)
+    {
+        // 在监视线程中打印
+        auto report = [](const PathGuard::GuardChange_t &change) {
+            fprintf(stderr, "guard: %s Path changed (%zu added, %zu removed%s), %s\n", change.user ? "user" : "system",
+                    change.added.size(), change.removed.size(), change.reordered ? ", reordered" : "",
+                    change.reverted ? "reverted" : ("pending as " + std::to_string(change.id)).c_str());
+        };
+        if (!daemon.startGuard(options.revert, report))
+            fprintf(stderr, "warning: guard mode needs the Windows registry, not watching\n");
+    }
+    fprintf(stderr, "listening on %s\n", name.c_str());
+    if (!daemon.serve(name))
+    {
+        fprintf(stderr, "cannot listen on %s (is another daemon running?)\n", name.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int runSend(const Options_t &options)
+{
+    std::string request;
+    for (const auto &arg : options.args)
+    {
+        request += (request.empty() ? "" : " ") + arg;
+    }
+    LocalConnection connection;
+    std::string name = LocalServer::defaultName();
+    if (!connection.connect(name) || !connection.write(request + "\n"))
+    {
+        fprintf(stderr, "cannot connect to the daemon on %s\n", name.c_str());
+        return 1;
+    }
+    std::string line;
+    bool first = true;
+    bool ok = false;
+    while (connection.readLine(line) && !line.empty())
+    {
+        if (first)
+        {
+            ok = line.compare(0, 2, "OK") == 0;
+            first = false;
+            if (ok && line.size() <= 3)
+                continue; // 只有"OK"时不输出
+        }
+        fprintf(ok ? stdout : stderr, "%s\n", line.c_str());
+    }
+    return ok ? 0 : 1;
+}
+
+static int runCheck(Session_t &session, const Options_t &options)
+{
+    fs::path file = options.args.empty() ? PathPolicy::defaultFilePath() : fs::path(options.args[0]);
+    PathPolicy policy;
+#ifdef _WIN32
+    policy.setExpander(expandEnvironmentString);
+#endif
+    std::string error;
+    if (!policy.load(file, error))
+    {
+        fprintf(stderr, "%s: %s\n", file.string().c_str(), error.c_str());
+        return 2;
+    }
+    policy.evaluate(session.systemModel, session.userModel);
+    for (const auto &violation : policy.violationList())
+    {
+        const PathPolicy::PolicyRule_t &rule = policy.ruleList()[violation.rule];
+        printf("%s line %zu: %s\n", rule.error ? "error" : "warn", rule.line, rule.text.c_str());
+        if (violation.index != PathPolicy::npos)
+        {
+            const PathListModel &model = violation.user ? session.userModel : session.systemModel;
+            printf("    %s %s\n", violation.user ? "user" : "system", model.at(violation.index).path.c_str());
+        }
+    }
+    printf("%zu rule(s), %zu violation(s), %zu error(s)\n", policy.ruleCount(), policy.violationList().size(),
+           policy.errorCount());
+    return policy.errorCount() > 0 ? 1 : 0;
+}
+
+static int runRewrite(Session_t &session, const Options_t &options)
+{
+    PathRewriter rewriter;
+    std::string error;
+#ifdef _WIN32
+    bool ignoreCase = true;
+#else
+    bool ignoreCase = false;
+#endif
+    if (!rewriter.compile(options.args[0], options.args[1], options.regex, ignoreCase, error))
+    {
+        fprintf(stderr, "rewrite: %s\n", error.c_str());
+        return 2;
+    }
+    rewriter.plan(session.systemModel, session.userModel);
+    for (const auto &rewrite : rewriter.rewriteList())
+    {
+        printf("%s %s\n    -> %s\n", rewrite.user ? "user" : "system", rewrite.before.c_str(), rewrite.after.c_str());
+    }
+    const PathRewriter::RewriteStats_t &stats = rewriter.lastStats();
+    printf("%zu entr%s rewritten%s (%zu scanned, %zu passed the prefilter \"%s\", %.3f ms)\n",
+           rewriter.rewriteList().size(), rewriter.rewriteList().size() == 1 ? "y" : "ies",
+           options.dryRun ? " (dry run)" : "", stats.scanned, stats.candidates, rewriter.prefilter().c_str(),
+           stats.milliseconds);
+    if (!options.dryRun)
+    {
+        rewriter.commit(session.systemModel, session.userModel, &session.store.tags());
+    }
+    return 0;
+}
+
+static int runFleet(const Options_t &options)
+{
+    FleetAnalyzer analyzer;
+    if (!options.golden.empty() && !analyzer.setGolden(options.golden))
+    {
+        fprintf(stderr, "cannot read %s\n", options.golden.c_str());
+        return 1;
+    }
+    if (!analyzer.analyze(options.args[0], options.fleet))
+    {
+        fprintf(stderr, "cannot read the directory %s\n", options.args[0].c_str());
+        return 1;
+    }
+    fputs(analyzer.formatReport().c_str(), stdout);
+    return 0;
+}
+
+static int runProgram(Session_t &session, const Options_t &options)
+{
+    PathLauncher launcher;
+#ifdef _WIN32
+    launcher.setExpander(expandEnvironmentString);
+#endif
+    PathLauncher::BlockPtr block;
+    if (!options.state.empty())
+    {
+        block = launcher.blockForFile(options.state);
+        if (!block)
+        {
+            fprintf(stderr, PathStateStore::isOrderedFile(options.state) ? "cannot read %s\n" :
+                    "%s: this pathVars.json was saved by an older version and does not record the order, use a text list (see export)\n",
+                    options.state.c_str());
+            return 1;
+        }
+    }
+    else
+    {
+        block = launcher.blockFor(session.systemModel.list(), session.userModel.list());
+    }
+    int exitCode = 0;
+    std::string error;
+    if (!PathLauncher::launch(*block, options.args, true, exitCode, error))
+    {
+        fprintf(stderr, "run: %s\n", error.c_str());
+        return 127;
+    }
+    return exitCode;
+}
+
+int main(int argc, char **argv)
+{
+    Options_t options;
+    if (!parseOptions(argc, argv, options))
+    {
+        usage();
+        return argc > 1 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0) ? 0 : 2;
+    }
+    const std::string &command = options.command;
+    bool needsArg = command == "add" || command == "remove" || command == "enable" || command == "disable" ||
+                    command == "import" || command == "export";
+    bool known = needsArg || command == "list" || command == "load" || command == "apply" || command == "run" ||
+                 command == "activate" || command == "daemon" || command == "send" || command == "fleet" ||
+                 command == "check" || command == "rewrite" || command == "tags" || command == "tag" ||
+                 command == "untag";
+    if (!known || (needsArg && options.args.size() != 1) ||
+        ((command == "load" || command == "activate" || command == "check") && options.args.size() > 1) ||
+        ((command == "list" || command == "apply" || command == "tags") && !options.args.empty()) ||
+        (command == "tag" && options.args.size() != 2) ||
+        (command == "untag" && (options.args.empty() || options.args.size() > 2)) ||
+        (command == "run" && options.args.empty()) || (command == "send" && options.args.empty()) ||
+        (command == "daemon" && !options.args.empty()) || (command == "rewrite" && options.args.size() != 2) ||
+        ((options.regex || options.dryRun) && command != "rewrite") ||
+        ((options.guard || options.revert) && command != "daemon") || (options.revert && !options.guard) || (command == "fleet" && options.args.size() != 1) ||
+        (!options.golden.empty() && command != "fleet") || (!options.state.empty() && command != "run"))
+    {
+        usage();
+        return 2;
+    }
+
+    if (command == "daemon")
+    {
+        return runDaemon(options);
+    }
+    if (command == "send")
+    {
+        return runSend(options);
+    }
+    if (command == "fleet")
+    {
+        return runFleet(options);
+    }
+
+    Session_t session;
+    if (command == "run" && !options.state.empty())
+    {
+        return runProgram(session, options);
+    }
+    if (command == "activate" && !options.args.empty())
+    {
+        return runActivate(session, options);
+    }
+    if (!loadSession(session) && command != "list" && command != "export" && command != "check")
+    {
+        // 状态文件读不出来时不覆盖它
+        fprintf(stderr, "cannot read the saved state %s\n", session.store.filePath().string().c_str());
+        return 1;
+    }
+
+    int rc = 0;
+    if (command == "list")
+        rc = runList(session, options);
+    else if (command == "add")
+        rc = runAdd(session, options);
+    else if (command == "remove")
+        rc = runRemove(session, options);
+    else if (command == "enable")
+        rc = runSetEnabled(session, options, true);
+    else if (command == "disable")
+        rc = runSetEnabled(session, options, false);
+    else if (command == "load")
+        rc = runLoad(session, options);
+    else if (command == "import")
+        rc = runImport(session, options);
+    else if (command == "export")
+        rc = runExport(session, options);
+    else if (command == "rewrite")
+        rc = runRewrite(session, options);
+    else if (command == "tags")
+        rc = runTags(session);
+    else if (command == "tag" || command == "untag")
+        rc = runTag(session, options, command == "tag");
+    else if (command == "run")
+        return runProgram(session, options);
+    else if (command == "activate")
+        return runActivate(session, options);
+    else if (command == "check")
+        return runCheck(session, options);
+    if (rc != 0)
+    {
+        return rc;
+    }
+
+    if (session.store.isDirty() && !session.store.save())
+    {
+        fprintf(stderr, "cannot write %s\n", session.store.filePath().string().c_str());
+        return 1;
+    }
+    if (command == "apply" ||
+        (options.apply && command != "list" && command != "export" && command != "tags" && !options.dryRun))
+    {
+        rc = runApply(session);
+    }
+    return rc;
+}
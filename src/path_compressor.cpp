@@ -0,0 +1,283 @@
+#include "path_compressor.hpp"
+#include "path_utils.hpp"
+#include <sstream>
+#include <cstdint>
+#include <unordered_map>
+
+PathCompressor::PathCompressor(size_t maxNew, size_t minimumGain) : maxNewVariables(maxNew), minGain(minimumGain)
+{
+}
+
+bool PathCompressor::isSeparator(char ch)
+{
+    return ch == '\\' || ch == '/';
+}
+
+std::string PathCompressor::compareKey(const std::string &path)
+{
+    // normalizePathKey逐字符转换，只去掉结尾分隔符，所以键的前缀与原始写法的前缀一一对应
+    return normalizePathKey(path);
+}
+
+void PathCompressor::addExistingVariable(const std::string &name, const std::string &value)
+{
+    if (name.empty() || value.empty() || value.find('%') != std::string::npos)
+        return;
+    existingVariables.push_back(Candidate{compareKey(value), value, name, true, std::vector<size_t>()});
+}
+
+void PathCompressor::setNameInUse(NameCheck check)
+{
+    nameInUse = std::move(check);
+}
+
+std::string PathCompressor::makeName(const std::string &prefix, const std::vector<std::string> &taken) const
+{
+    size_t end = prefix.size();
+    while (end > 0 && isSeparator(prefix[end - 1]))
+        end--;
+    size_t start = end;
+    while (start > 0 && !isSeparator(prefix[start - 1]))
+        start--;
+
+    std::string base = "P_";
+    for (size_t i = start; i < end && base.size() < 14; i++)
+    {
+        char ch = prefix[i];
+        if (ch >= 'a' && ch <= 'z')
+            ch = static_cast<char>(ch - 'a' + 'A');
+        else if (!((ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9')))
+            ch = '_';
+        if (ch == '_' && base.back() == '_')
+            continue;
+        base.push_back(ch);
+    }
+    while (base.size() > 2 && base.back() == '_')
+        base.pop_back();
+    if (base.size() == 2)
+        base += "DIR";
+
+    // 环境变量名不区分大小写
+    auto isTaken = [this, &taken](const std::string &name) {
+        for (const auto &other : taken)
+        {
+            if (toLowerAscii(other) == toLowerAscii(name))
+                return true;
+        }
+        return nameInUse && nameInUse(name);
+    };
+    std::string name = base;
+    for (int suffix = 2; isTaken(name); suffix++)
+    {
+        name = base + "_" + std::to_string(suffix);
+    }
+    return name;
+}
+
+size_t PathCompressor::compress(const std::vector<std::string> &entries, std::vector<std::string> &rewritten,
+                                std::vector<PathVariable_t> &variables) const
+{
+    rewritten = entries;
+    variables.clear();
+
+    std::vector<std::string> keys(entries.size());
+    std::vector<Candidate> candidates;
+    std::unordered_map<std::string, size_t> byKey;
+    std::vector<std::string> taken;
+    for (const auto &existing : existingVariables)
+    {
+        taken.push_back(existing.name);
+    }
+
+    for (size_t e = 0; e < entries.size(); e++)
+    {
+        if (entries[e].find('%') != std::string::npos)
+            continue;
+        keys[e] = compareKey(entries[e]);
+        const std::string &key = keys[e];
+        // 每个分量边界处的前缀，以及整个路径
+        for (size_t p = 1; p <= key.size(); p++)
+        {
+            if (p < key.size() && !isSeparator(key[p]))
+                continue;
+            std::string prefix = key.substr(0, p);
+            auto it = byKey.find(prefix);
+            if (it == byKey.end())
+            {
+                it = byKey.emplace(prefix, candidates.size()).first;
+                candidates.push_back(Candidate{prefix, entries[e].substr(0, p), std::string(), false, std::vector<size_t>()});
+            }
+            candidates[it->second].entries.push_back(e);
+        }
+    }
+    // 同一条目出现在多个共享前缀下时，只有至少两个条目共用的前缀才值得新建变量
+    std::vector<Candidate> pool;
+    for (auto &candidate : candidates)
+    {
+        if (candidate.entries.size() >= 2)
+        {
+            candidate.name = makeName(candidate.value, taken);
+            pool.push_back(std::move(candidate));
+        }
+    }
+    for (const auto &existing : existingVariables)
+    {
+        Candidate candidate = existing;
+        for (size_t e = 0; e < entries.size(); e++)
+        {
+            const std::string &key = keys[e];
+            if (key.empty() || key.size() < candidate.key.size() || key.compare(0, candidate.key.size(), candidate.key) != 0)
+                continue;
+            if (key.size() == candidate.key.size() || isSeparator(key[candidate.key.size()]) || isSeparator(candidate.key.back()))
+                candidate.entries.push_back(e);
+        }
+        if (!candidate.entries.empty())
+            pool.push_back(std::move(candidate));
+    }
+
+    auto saving = [](const Candidate &c) -> size_t {
+        size_t reference = c.name.size() + 2;
+        return c.key.size() > reference ? c.key.size() - reference : 0;
+    };
+
+    // 贪心：每次选能在当前基础上多节省最多字符的变量
+    std::vector<size_t> current(entries.size(), 0);
+    std::vector<uint8_t> chosen(pool.size(), 0);
+    size_t newCount = 0;
+    while (true)
+    {
+        size_t best = pool.size();
+        size_t bestGain = 0;
+        for (size_t c = 0; c < pool.size(); c++)
+        {
+            if (chosen[c] || (!pool[c].existing && newCount >= maxNewVariables))
+                continue;
+            size_t save = saving(pool[c]);
+            size_t gain = 0;
+            for (size_t e : pool[c].entries)
+            {
+                if (save > current[e])
+                    gain += save - current[e];
+            }
+            size_t threshold = pool[c].existing ? 1 : minGain;
+            if (gain >= threshold && gain > bestGain)
+            {
+                best = c;
+                bestGain = gain;
+            }
+        }
+        if (best == pool.size())
+            break;
+        chosen[best] = 1;
+        if (!pool[best].existing)
+            newCount++;
+        size_t save = saving(pool[best]);
+        for (size_t e : pool[best].entries)
+        {
+            if (save > current[e])
+                current[e] = save;
+        }
+    }
+
+    // 选中的新变量之间也不能重名，例如两个不同目录下的bin
+    for (size_t c = 0; c < pool.size(); c++)
+    {
+        if (chosen[c] && !pool[c].existing)
+        {
+            pool[c].name = makeName(pool[c].value, taken);
+            taken.push_back(pool[c].name);
+        }
+    }
+
+    // 每个条目引用节省最多的那个变量
+    std::vector<size_t> assigned(entries.size(), pool.size());
+    std::vector<size_t> assignedSave(entries.size(), 0);
+    for (size_t c = 0; c < pool.size(); c++)
+    {
+        if (!chosen[c])
+            continue;
+        size_t save = saving(pool[c]);
+        for (size_t e : pool[c].entries)
+        {
+            if (save > assignedSave[e])
+            {
+                assigned[e] = c;
+                assignedSave[e] = save;
+            }
+        }
+    }
+
+    std::unordered_map<size_t, size_t> variableOf; // 候选下标 -> variables下标
+    for (size_t e = 0; e < entries.size(); e++)
+    {
+        if (assigned[e] == pool.size())
+            continue;
+        const Candidate &c = pool[assigned[e]];
+        auto it = variableOf.find(assigned[e]);
+        if (it == variableOf.end())
+        {
+            it = variableOf.emplace(assigned[e], variables.size()).first;
+            variables.push_back(PathVariable_t{c.name, c.value, c.existing, 0, 0});
+        }
+        PathVariable_t &variable = variables[it->second];
+        variable.uses++;
+        variable.saved += assignedSave[e];
+        rewritten[e] = "%" + c.name + "%" + entries[e].substr(c.key.size());
+    }
+    return joinedLength(rewritten);
+}
+
+size_t PathCompressor::joinedLength(const std::vector<std::string> &entries)
+{
+    size_t length = 0;
+    for (const auto &entry : entries)
+    {
+        length += entry.size();
+    }
+    return entries.empty() ? 0 : length + entries.size() - 1;
+}
+
+std::string PathCompressor::formatPreview(const std::string &title, const std::vector<std::string> &entries,
+                                          const std::vector<std::string> &rewritten, const std::vector<PathVariable_t> &variables)
+{
+    size_t before = joinedLength(entries);
+    size_t after = joinedLength(rewritten);
+    std::ostringstream out;
+    out << title << "\n";
+    out << "  原始长度 " << before << "  →  改写后 " << after << "（节省 " << before - after << "）\n";
+    out << "  旧工具上限 " << pathLegacyLimit << "：" << (before > pathLegacyLimit ? "改写前超出" : "改写前未超出")
+        << "，" << (after > pathLegacyLimit ? "改写后仍超出" : "改写后未超出") << "\n";
+
+    for (int existing = 0; existing < 2; existing++)
+    {
+        bool header = false;
+        for (const auto &variable : variables)
+        {
+            if (variable.existing != (existing == 1))
+                continue;
+            if (!header)
+            {
+                out << (existing ? "\n  引用已有变量:\n" : "\n  新建变量（REG_SZ）:\n");
+                header = true;
+            }
+            out << "    %" << variable.name << "% = " << variable.value << "    " << variable.uses << " 个条目，节省 "
+                << variable.saved << "\n";
+        }
+    }
+
+    bool changed = false;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i] == rewritten[i])
+            continue;
+        if (!changed)
+        {
+            out << "\n  改写的条目:\n";
+            changed = true;
+        }
+        out << "    " << entries[i] << "\n      → " << rewritten[i] << "\n";
+    }
+    if (!changed)
+        out << "\n  没有可以提取的公共前缀\n";
+    return out.str();
+}
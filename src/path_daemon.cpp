@@ -0,0 +1,413 @@
+#include "path_daemon.hpp"
+#include "path_utils.hpp"
+#include <cstdlib>
+#ifdef _WIN32
+#include "win_env_utils.hpp"
+#endif
+
+namespace fs = std::filesystem;
+
+// 一个连接两次请求之间最多空闲这么久，不让一个连上后不发请求的客户端挡住其它连接
+static const unsigned connectionIdleMs = 5000;
+
+PathDaemon::PathDaemon() : currentHash(0), stopping(false)
+{
+}
+
+// FNV-1a，覆盖两侧的顺序、启用状态和写法
+uint64_t PathDaemon::hashOf(const std::vector<EnvPathItem_t> &systemPaths, const std::vector<EnvPathItem_t> &userPaths)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](unsigned char c) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    };
+    for (const auto *list : {&systemPaths, &userPaths})
+    {
+        for (const auto &item : *list)
+        {
+            mix(item.enabled ? '+' : '-');
+            for (char c : item.path)
+                mix(static_cast<unsigned char>(c));
+            mix('\0');
+        }
+        mix('\n');
+    }
+    return hash;
+}
+
+void PathDaemon::readRegistry()
+{
+#ifdef _WIN32
+    registrySystem = getSystemPath();
+    registryUser = getUserPath();
+#else
+    registrySystem.clear();
+    registryUser.clear();
+#endif
+}
+
+bool PathDaemon::loadTables()
+{
+    store.detach();
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    bool ok = store.loadMerged(registrySystem, registryUser, systemPaths, userPaths);
+    currentHash = hashOf(systemPaths, userPaths);
+    systemModel.replaceAll(std::move(systemPaths));
+    userModel.replaceAll(std::move(userPaths));
+    systemModel.clearHistory();
+    userModel.clearHistory();
+    store.attach(&systemModel, &userModel);
+    return ok;
+}
+
+// 只重新解析修改过的文件
+void PathDaemon::scanStates()
+{
+    std::map<std::string, SavedState> scanned;
+    std::error_code ec;
+    for (fs::directory_iterator it(statesDir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        const fs::path &file = it->path();
+        std::string ext = toLowerAscii(file.extension().string());
+        // 旧版本的 pathVars.json 不记录顺序，切换过去PATH的顺序会变，只读文本列表
+        if (ext != ".txt")
+            continue;
+        std::error_code statError;
+        fs::file_time_type mtime = fs::last_write_time(file, statError);
+        uintmax_t size = statError ? 0 : fs::file_size(file, statError);
+        if (statError)
+            continue;
+        std::string name = file.stem().string();
+        auto old = states.find(name);
+        if (old != states.end() && old->second.mtime == mtime && old->second.size == size)
+        {
+            scanned[name] = std::move(old->second);
+            continue;
+        }
+        SavedState state;
+        if (!PathStateStore::readPathList(file, state.systemPaths, state.userPaths))
+            continue;
+        state.mtime = mtime;
+        state.size = size;
+        state.hash = hashOf(state.systemPaths, state.userPaths);
+        scanned[name] = std::move(state);
+    }
+    states = std::move(scanned);
+
+    currentState.clear();
+    for (const auto &state : states)
+    {
+        if (state.second.hash == currentHash)
+        {
+            currentState = state.first;
+            break;
+        }
+    }
+}
+
+bool PathDaemon::open(const fs::path &stateDirectory)
+{
+    statesDir = stateDirectory;
+    if (statesDir.empty())
+    {
+        fs::path saved = PathStateStore::defaultFilePath();
+        if (saved.empty())
+            return false;
+        statesDir = saved.parent_path() / "states";
+    }
+    readRegistry();
+    bool ok = loadTables();
+    scanStates();
+    return ok;
+}
+
+std::string PathDaemon::query()
+{
+    if (!queryReply.empty() && queriedSystem.sameAs(systemModel.list()) && queriedUser.sameAs(userModel.list()))
+    {
+        return queryReply;
+    }
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    systemModel.toVector(systemPaths);
+    userModel.toVector(userPaths);
+    std::string reply = "OK\nstate " + (currentState.empty() ? std::string("-") : currentState) + "\n";
+#ifdef _WIN32
+    bool applied = sameAsRegistry(systemPaths, registrySystem) && sameAsRegistry(userPaths, registryUser);
+    reply += applied ? "applied yes\n" : "applied no\n";
+#else
+    reply += "applied -\n"; // 没有注册表
+#endif
+    const char *scopes[2] = {"system ", "user "};
+    const std::vector<EnvPathItem_t> *lists[2] = {&systemPaths, &userPaths};
+    for (int m = 0; m < 2; m++)
+    {
+        for (const auto &item : *lists[m])
+        {
+            reply += scopes[m];
+            reply += item.enabled ? "on " : "off ";
+            reply += item.path;
+            reply += '\n';
+        }
+    }
+    reply += '\n';
+    queryReply = reply;
+    queriedSystem = systemModel.list();
+    queriedUser = userModel.list();
+    return queryReply;
+}
+
+std::string PathDaemon::listStates() const
+{
+    std::string reply = "OK\n";
+    for (const auto &state : states)
+    {
+        if (state.first == currentState)
+            reply += '*';
+        reply += state.first;
+        reply += '\n';
+    }
+    return reply + "\n";
+}
+
+std::string PathDaemon::switchTo(const std::string &name)
+{
+    auto it = states.find(name);
+    if (it == states.end())
+    {
+        scanStates(); // 可能是刚加入目录的文件
+        it = states.find(name);
+        if (it == states.end())
+            return "ERR no saved state named " + name + "\n\n";
+    }
+    const SavedState &state = it->second;
+    if (state.hash == currentHash)
+    {
+        currentState = name;
+        return "OK unchanged\n\n";
+    }
+    std::vector<EnvPathItem_t> systemPaths = state.systemPaths;
+    std::vector<EnvPathItem_t> userPaths = state.userPaths;
+    systemModel.replaceAll(std::move(systemPaths));
+    userModel.replaceAll(std::move(userPaths));
+    systemModel.clearHistory();
+    userModel.clearHistory();
+    currentHash = state.hash;
+    currentState = name;
+    if (!store.save())
+        return "ERR cannot write " + store.filePath().string() + "\n\n";
+    return "OK switched\n\n";
+}
+
+std::string PathDaemon::saveAs(const std::string &name)
+{
+    if (name.empty() || name.find_first_of("/\\:*?\"<>|") != std::string::npos || name[0] == '.')
+        return "ERR invalid state name\n\n";
+    std::error_code ec;
+    fs::create_directories(statesDir, ec);
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    systemModel.toVector(systemPaths);
+    userModel.toVector(userPaths);
+    fs::path file = statesDir / (name + ".txt");
+    if (!PathStateStore::writePathList(file, systemPaths, userPaths))
+        return "ERR cannot write " + file.string() + "\n\n";
+    SavedState state;
+    state.mtime = fs::last_write_time(file, ec);
+    state.size = ec ? 0 : fs::file_size(file, ec);
+    state.hash = hashOf(systemPaths, userPaths);
+    state.systemPaths = std::move(systemPaths);
+    state.userPaths = std::move(userPaths);
+    states[name] = std::move(state);
+    currentState = name;
+    queryReply.clear();
+    return "OK\n\n";
+}
+
+std::string PathDaemon::apply()
+{
+#ifdef _WIN32
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    systemModel.toVector(systemPaths);
+    userModel.toVector(userPaths);
+    const std::vector<EnvPathItem_t> *lists[2] = {&systemPaths, &userPaths};
+    // 先固定要写入的内容，守护线程看到这次写入时不会把它当成外部修改
+    for (int m = 0; m < 2; m++)
+    {
+        size_t length = 0;
+        for (const auto &item : *lists[m])
+        {
+            if (item.enabled)
+                length += item.path.size() + (length ? 1 : 0);
+        }
+        if (length + 1 > pathValueLimit)
+            return std::string("ERR ") + (m == 0 ? "system" : "user") + " Path is over the length limit\n\n";
+    }
+    // 还没处理的外部修改保留，写入成功的一侧由监视线程看到写入后清掉
+    if (guard.isRunning())
+        guard.pin(systemPaths, userPaths, true);
+    if (!sameAsRegistry(systemPaths, registrySystem))
+    {
+        if (!setSystemPath(systemPaths))
+        {
+            if (guard.isRunning())
+                guard.pin(registrySystem, registryUser, true);
+            return "ERR failed to write the system Path (administrator rights are required)\n\n";
+        }
+        registrySystem.clear();
+        for (const auto &item : systemPaths)
+        {
+            if (item.enabled)
+                registrySystem.push_back(item);
+        }
+    }
+    if (!sameAsRegistry(userPaths, registryUser))
+    {
+        if (!setUserPath(userPaths))
+        {
+            if (guard.isRunning())
+                guard.pin(registrySystem, registryUser, true);
+            return "ERR failed to write the user Path\n\n";
+        }
+        registryUser.clear();
+        for (const auto &item : userPaths)
+        {
+            if (item.enabled)
+                registryUser.push_back(item);
+        }
+    }
+    queryReply.clear();
+    return "OK\n\n";
+#else
+    return "ERR the registry is only available on Windows\n\n";
+#endif
+}
+
+bool PathDaemon::startGuard(bool autoRevert, PathGuard::Notify onChange)
+{
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    systemModel.toVector(systemPaths);
+    userModel.toVector(userPaths);
+    guard.pin(systemPaths, userPaths);
+    guard.setAutoRevert(autoRevert);
+    return guard.start(std::move(onChange));
+}
+
+std::string PathDaemon::guardStatus() const
+{
+    std::string reply = "OK ";
+    reply += guard.isRunning() ? "on" : "off";
+    reply += guard.autoReverts() ? " revert\n" : "\n";
+    auto describe = [&reply](const char *kind, const PathGuard::GuardChange_t &change) {
+        reply += std::string(kind) + " " + std::to_string(change.id) + (change.user ? " user\n" : " system\n");
+        for (const auto &path : change.added)
+            reply += "  + " + path + "\n";
+        for (const auto &path : change.removed)
+            reply += "  - " + path + "\n";
+        if (change.reordered)
+            reply += "  reordered\n";
+    };
+    for (const auto &change : guard.pendingChanges())
+        describe("pending", change);
+    for (const auto &change : guard.recentReverts())
+        describe("reverted", change);
+    return reply + "\n";
+}
+
+std::string PathDaemon::approve(const std::string &id)
+{
+    if (!guard.approve(strtoul(id.c_str(), nullptr, 10)))
+        return "ERR no pending change " + id + "\n\n";
+    // 与启动时一样把注册表中的新内容合并进表格
+    readRegistry();
+    bool ok = loadTables();
+    queryReply.clear();
+    return ok ? "OK\n\n" : "ERR cannot read " + store.filePath().string() + "\n\n";
+}
+
+std::string PathDaemon::reject(const std::string &id)
+{
+    size_t change = strtoul(id.c_str(), nullptr, 10);
+    bool found = false;
+    for (const auto &pending : guard.pendingChanges())
+        found = found || pending.id == change;
+    if (!found)
+        return "ERR no pending change " + id + "\n\n";
+    if (!guard.reject(change))
+        return "ERR failed to write the registry (the system Path needs administrator rights)\n\n";
+    return "OK\n\n";
+}
+
+std::string PathDaemon::handle(const std::string &request)
+{
+    size_t space = request.find(' ');
+    std::string command = request.substr(0, space);
+    std::string argument = space == std::string::npos ? std::string() : request.substr(space + 1);
+    if (command == "ping")
+        return "OK\n\n";
+    if (command == "query")
+        return query();
+    if (command == "states")
+        return listStates();
+    if (command == "switch" && !argument.empty())
+        return switchTo(argument);
+    if (command == "save" && !argument.empty())
+        return saveAs(argument);
+    if (command == "apply")
+        return apply();
+    if (command == "reload")
+    {
+        readRegistry();
+        bool ok = loadTables();
+        scanStates();
+        queryReply.clear();
+        return ok ? "OK\n\n" : "ERR cannot read " + store.filePath().string() + "\n\n";
+    }
+    if (command == "guard")
+        return guardStatus();
+    if (command == "approve" && !argument.empty())
+        return approve(argument);
+    if (command == "reject" && !argument.empty())
+        return reject(argument);
+    if (command == "shutdown")
+    {
+        stopping = true;
+        return "OK\n\n";
+    }
+    return "ERR unknown request\n\n";
+}
+
+bool PathDaemon::stopRequested() const
+{
+    return stopping;
+}
+
+bool PathDaemon::serve(const std::string &name)
+{
+#ifndef _WIN32
+    std::error_code ec;
+    fs::create_directories(fs::path(name).parent_path(), ec);
+#endif
+    LocalServer server;
+    if (!server.listen(name))
+        return false;
+    LocalConnection connection;
+    while (!stopping && server.accept(connection))
+    {
+        connection.setTimeout(connectionIdleMs);
+        std::string line;
+        while (!stopping && connection.readLine(line))
+        {
+            if (line.empty())
+                continue;
+            if (!connection.write(handle(line)))
+                break;
+        }
+        connection.close();
+    }
+    return true;
+}
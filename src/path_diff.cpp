@@ -0,0 +1,434 @@
+#include "path_diff.hpp"
+#include "path_utils.hpp"
+#include <algorithm>
+#include <climits>
+#include <sstream>
+#include <unordered_map>
+#include <deque>
+
+PathDiff::PathDiff()
+    : xv(nullptr), yv(nullptr), diagOffset(0), tooExpensive(0), xChanged(nullptr), yChanged(nullptr)
+{
+}
+
+void PathDiff::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+}
+
+std::string PathDiff::keyOf(const std::string &path) const
+{
+    return normalizePathKey(expander ? expander(path) : path);
+}
+
+// 在[xoff,xlim)×[yoff,ylim)中找一条最短编辑路径经过的中间点：
+// 从两端同时按编辑次数逐层推进，两边在同一对角线上相遇时即为中点
+void PathDiff::diag(long xoff, long xlim, long yoff, long ylim, bool findMinimal, Partition &part)
+{
+    long *const fd = fdiag.data() + diagOffset;
+    long *const bd = bdiag.data() + diagOffset;
+    const std::vector<int> &x = *xv;
+    const std::vector<int> &y = *yv;
+    const long dmin = xoff - ylim;
+    const long dmax = xlim - yoff;
+    const long fmid = xoff - yoff;
+    const long bmid = xlim - ylim;
+    long fmin = fmid, fmax = fmid;
+    long bmin = bmid, bmax = bmid;
+    const bool odd = ((fmid - bmid) & 1) != 0;
+
+    fd[fmid] = xoff;
+    bd[bmid] = xlim;
+
+    for (long c = 1;; ++c)
+    {
+        // 正向多走一步
+        if (fmin > dmin)
+            fd[--fmin - 1] = -1;
+        else
+            ++fmin;
+        if (fmax < dmax)
+            fd[++fmax + 1] = -1;
+        else
+            --fmax;
+        for (long d = fmax; d >= fmin; d -= 2)
+        {
+            long tlo = fd[d - 1], thi = fd[d + 1];
+            long x0 = tlo < thi ? thi : tlo + 1;
+            long xi = x0, yi = x0 - d;
+            while (xi < xlim && yi < ylim && x[xi] == y[yi])
+            {
+                xi++;
+                yi++;
+            }
+            fd[d] = xi;
+            if (odd && bmin <= d && d <= bmax && bd[d] <= xi)
+            {
+                part = Partition{xi, yi, true, true};
+                return;
+            }
+        }
+
+        // 反向多走一步
+        if (bmin > dmin)
+            bd[--bmin - 1] = LONG_MAX;
+        else
+            ++bmin;
+        if (bmax < dmax)
+            bd[++bmax + 1] = LONG_MAX;
+        else
+            --bmax;
+        for (long d = bmax; d >= bmin; d -= 2)
+        {
+            long tlo = bd[d - 1], thi = bd[d + 1];
+            long x0 = tlo < thi ? tlo : thi - 1;
+            long xi = x0, yi = x0 - d;
+            while (xoff < xi && yoff < yi && x[xi - 1] == y[yi - 1])
+            {
+                xi--;
+                yi--;
+            }
+            bd[d] = xi;
+            if (!odd && fmin <= d && d <= fmax && xi <= fd[d])
+            {
+                part = Partition{xi, yi, true, true};
+                return;
+            }
+        }
+
+        if (findMinimal || c < tooExpensive)
+            continue;
+
+        // 代价过高（大段重排）：不再求最短，取两个方向上走得最远的对角线，结果仍然正确只是可能不是最短
+        long fxybest = -1, fxbest = 0;
+        for (long d = fmax; d >= fmin; d -= 2)
+        {
+            long xi = (std::min)(fd[d], xlim);
+            long yi = xi - d;
+            if (ylim < yi)
+            {
+                xi = ylim + d;
+                yi = ylim;
+            }
+            if (fxybest < xi + yi)
+            {
+                fxybest = xi + yi;
+                fxbest = xi;
+            }
+        }
+        long bxybest = LONG_MAX, bxbest = 0;
+        for (long d = bmax; d >= bmin; d -= 2)
+        {
+            long xi = (std::max)(xoff, bd[d]);
+            long yi = xi - d;
+            if (yi < yoff)
+            {
+                xi = yoff + d;
+                yi = yoff;
+            }
+            if (xi + yi < bxybest)
+            {
+                bxybest = xi + yi;
+                bxbest = xi;
+            }
+        }
+        if ((xlim + ylim) - bxybest < fxybest - (xoff + yoff))
+            part = Partition{fxbest, fxybest - fxbest, true, false};
+        else
+            part = Partition{bxbest, bxybest - bxbest, false, true};
+        return;
+    }
+}
+
+void PathDiff::compareSeq(long xoff, long xlim, long yoff, long ylim, bool findMinimal)
+{
+    const std::vector<int> &x = *xv;
+    const std::vector<int> &y = *yv;
+    // 去掉首尾相同的部分
+    while (xoff < xlim && yoff < ylim && x[xoff] == y[yoff])
+    {
+        xoff++;
+        yoff++;
+    }
+    while (xoff < xlim && yoff < ylim && x[xlim - 1] == y[ylim - 1])
+    {
+        xlim--;
+        ylim--;
+    }
+
+    if (xoff == xlim)
+    {
+        while (yoff < ylim)
+            (*yChanged)[yoff++] = 1;
+    }
+    else if (yoff == ylim)
+    {
+        while (xoff < xlim)
+            (*xChanged)[xoff++] = 1;
+    }
+    else
+    {
+        Partition part;
+        diag(xoff, xlim, yoff, ylim, findMinimal, part);
+        compareSeq(xoff, part.xmid, yoff, part.ymid, part.loMinimal);
+        compareSeq(part.xmid, xlim, part.ymid, ylim, part.hiMinimal);
+    }
+}
+
+void PathDiff::diffSequences(const std::vector<int> &x, const std::vector<int> &y,
+                             std::vector<char> &xOut, std::vector<char> &yOut)
+{
+    xOut.assign(x.size(), 0);
+    yOut.assign(y.size(), 0);
+
+    // 只在一边出现的元素一定是增删，先去掉，剩下的只有真正的重排需要搜索
+    std::unordered_map<int, uint8_t> presence; // bit0: 在x中，bit1: 在y中
+    for (int v : x)
+        presence[v] |= 1;
+    for (int v : y)
+        presence[v] |= 2;
+    std::vector<int> xf, yf;
+    std::vector<size_t> xMap, yMap;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        if (presence[x[i]] == 3)
+        {
+            xf.push_back(x[i]);
+            xMap.push_back(i);
+        }
+        else
+            xOut[i] = 1;
+    }
+    for (size_t i = 0; i < y.size(); i++)
+    {
+        if (presence[y[i]] == 3)
+        {
+            yf.push_back(y[i]);
+            yMap.push_back(i);
+        }
+        else
+            yOut[i] = 1;
+    }
+
+    std::vector<char> xc(xf.size(), 0), yc(yf.size(), 0);
+    size_t diags = xf.size() + yf.size() + 3;
+    fdiag.assign(diags, 0);
+    bdiag.assign(diags, 0);
+    diagOffset = static_cast<long>(yf.size()) + 1;
+    // 大约为对角线数的平方根，至少256；偏离最短结果的部分会在后面合并为移动
+    tooExpensive = 1;
+    for (size_t n = diags; n != 0; n >>= 2)
+        tooExpensive <<= 1;
+    tooExpensive = (std::max)(tooExpensive, 256L);
+    xv = &xf;
+    yv = &yf;
+    xChanged = &xc;
+    yChanged = &yc;
+    compareSeq(0, static_cast<long>(xf.size()), 0, static_cast<long>(yf.size()), false);
+    xv = yv = nullptr;
+    xChanged = yChanged = nullptr;
+
+    for (size_t i = 0; i < xc.size(); i++)
+    {
+        if (xc[i])
+            xOut[xMap[i]] = 1;
+    }
+    for (size_t i = 0; i < yc.size(); i++)
+    {
+        if (yc[i])
+            yOut[yMap[i]] = 1;
+    }
+}
+
+std::vector<PathDiffEntry_t> PathDiff::compare(const PathSnapshot_t &before, const PathSnapshot_t &after)
+{
+    std::vector<PathDiffEntry_t> result;
+    std::unordered_map<std::string, int> ids;
+    auto idOf = [this, &ids](const std::string &path) {
+        return ids.emplace(keyOf(path), static_cast<int>(ids.size())).first->second;
+    };
+
+    struct Pending {
+        bool user;
+        size_t index;
+        const EnvPathItem_t *item;
+    };
+    std::vector<Pending> removed;
+    std::unordered_map<int, std::deque<Pending>> inserted; // 目录 -> 新增的位置，按出现顺序
+    std::vector<std::pair<int, Pending>> insertedOrder;
+    bool ordered = before.ordered && after.ordered;
+
+    for (int h = 0; h < 2; h++)
+    {
+        bool user = h == 1;
+        const std::vector<EnvPathItem_t> &oldList = user ? before.userPaths : before.systemPaths;
+        const std::vector<EnvPathItem_t> &newList = user ? after.userPaths : after.systemPaths;
+
+        // 序列中的位置 -> 行号；有一边不记录顺序时按目录排序后比较，只看增删
+        std::vector<size_t> oldRows(oldList.size()), newRows(newList.size());
+        std::vector<int> oldIds(oldList.size()), newIds(newList.size());
+        for (size_t i = 0; i < oldList.size(); i++)
+        {
+            oldRows[i] = i;
+            oldIds[i] = idOf(oldList[i].path);
+        }
+        for (size_t i = 0; i < newList.size(); i++)
+        {
+            newRows[i] = i;
+            newIds[i] = idOf(newList[i].path);
+        }
+        if (!ordered)
+        {
+            std::stable_sort(oldRows.begin(), oldRows.end(), [&oldIds](size_t a, size_t b) { return oldIds[a] < oldIds[b]; });
+            std::stable_sort(newRows.begin(), newRows.end(), [&newIds](size_t a, size_t b) { return newIds[a] < newIds[b]; });
+        }
+        std::vector<int> x, y;
+        for (size_t row : oldRows)
+            x.push_back(oldIds[row]);
+        for (size_t row : newRows)
+            y.push_back(newIds[row]);
+
+        std::vector<char> xc, yc;
+        diffSequences(x, y, xc, yc);
+
+        size_t i = 0, j = 0;
+        while (i < x.size() || j < y.size())
+        {
+            if (i < x.size() && xc[i])
+            {
+                removed.push_back(Pending{user, oldRows[i], &oldList[oldRows[i]]});
+                i++;
+            }
+            else if (j < y.size() && yc[j])
+            {
+                Pending p{user, newRows[j], &newList[newRows[j]]};
+                inserted[y[j]].push_back(p);
+                insertedOrder.push_back(std::make_pair(y[j], p));
+                j++;
+            }
+            else if (i < x.size() && j < y.size())
+            {
+                // 公共子序列中的一对
+                const EnvPathItem_t &o = oldList[oldRows[i]];
+                const EnvPathItem_t &n = newList[newRows[j]];
+                PathDiffEntry_t entry{PathDiffEntry_t::TOGGLED, n.path, o.path, user, user, oldRows[i], newRows[j], o.enabled, n.enabled};
+                if (o.enabled != n.enabled)
+                    result.push_back(entry);
+                if (o.path != n.path)
+                {
+                    entry.kind = PathDiffEntry_t::RESPELLED;
+                    result.push_back(entry);
+                }
+                i++;
+                j++;
+            }
+            else
+            {
+                break;
+            }
+        }
+    }
+
+    // 删除和新增的同一目录合并为移动（包括跨系统/用户Path）
+    std::vector<char> consumed(insertedOrder.size(), 0);
+    std::unordered_map<const EnvPathItem_t *, size_t> insertedSlot;
+    for (size_t k = 0; k < insertedOrder.size(); k++)
+    {
+        insertedSlot[insertedOrder[k].second.item] = k;
+    }
+    for (const auto &r : removed)
+    {
+        int id = ids[keyOf(r.item->path)];
+        auto it = inserted.find(id);
+        if (it == inserted.end() || it->second.empty())
+        {
+            result.push_back(PathDiffEntry_t{PathDiffEntry_t::REMOVED, r.item->path, r.item->path, r.user, r.user,
+                                             r.index, 0, r.item->enabled, r.item->enabled});
+            continue;
+        }
+        Pending n = it->second.front();
+        it->second.pop_front();
+        consumed[insertedSlot[n.item]] = 1;
+        result.push_back(PathDiffEntry_t{PathDiffEntry_t::MOVED, n.item->path, r.item->path, r.user, n.user,
+                                         r.index, n.index, r.item->enabled, n.item->enabled});
+    }
+    for (size_t k = 0; k < insertedOrder.size(); k++)
+    {
+        if (consumed[k])
+            continue;
+        const Pending &n = insertedOrder[k].second;
+        result.push_back(PathDiffEntry_t{PathDiffEntry_t::INSERTED, n.item->path, n.item->path, n.user, n.user,
+                                         0, n.index, n.item->enabled, n.item->enabled});
+    }
+
+    // 按所在Path和行号排序，方便对照
+    std::stable_sort(result.begin(), result.end(), [](const PathDiffEntry_t &a, const PathDiffEntry_t &b) {
+        bool au = a.kind == PathDiffEntry_t::REMOVED ? a.oldUser : a.newUser;
+        bool bu = b.kind == PathDiffEntry_t::REMOVED ? b.oldUser : b.newUser;
+        if (au != bu)
+            return !au;
+        size_t ai = a.kind == PathDiffEntry_t::REMOVED ? a.oldIndex : a.newIndex;
+        size_t bi = b.kind == PathDiffEntry_t::REMOVED ? b.oldIndex : b.newIndex;
+        return ai < bi;
+    });
+    return result;
+}
+
+std::string PathDiff::formatReport(const PathSnapshot_t &before, const PathSnapshot_t &after,
+                                   const std::vector<PathDiffEntry_t> &entries)
+{
+    size_t counts[5] = {0, 0, 0, 0, 0};
+    for (const auto &entry : entries)
+    {
+        counts[entry.kind]++;
+    }
+    auto hive = [](bool user) { return user ? "用户" : "系统"; };
+    auto state = [](bool enabled) { return enabled ? "启用" : "禁用"; };
+
+    std::ostringstream out;
+    out << "旧: " << before.name << "（系统 " << before.systemPaths.size() << "，用户 " << before.userPaths.size() << "）\n";
+    out << "新: " << after.name << "（系统 " << after.systemPaths.size() << "，用户 " << after.userPaths.size() << "）\n";
+    out << "新增 " << counts[PathDiffEntry_t::INSERTED] << "，删除 " << counts[PathDiffEntry_t::REMOVED]
+        << "，移动 " << counts[PathDiffEntry_t::MOVED] << "，启用状态变化 " << counts[PathDiffEntry_t::TOGGLED]
+        << "，写法变化 " << counts[PathDiffEntry_t::RESPELLED] << "\n";
+    if (!before.ordered || !after.ordered)
+    {
+        out << "旧版本的 pathVars.json 不记录顺序，只比较增删和启用状态\n";
+    }
+    out << "行号为各自Path中的位置（从1开始）\n\n";
+    if (entries.empty())
+    {
+        out << "两份快照相同\n";
+        return out.str();
+    }
+
+    for (const auto &entry : entries)
+    {
+        switch (entry.kind)
+        {
+        case PathDiffEntry_t::INSERTED:
+            out << "+ [" << hive(entry.newUser) << " " << entry.newIndex + 1 << "] " << entry.path;
+            if (!entry.newEnabled)
+                out << "  (禁用)";
+            break;
+        case PathDiffEntry_t::REMOVED:
+            out << "- [" << hive(entry.oldUser) << " " << entry.oldIndex + 1 << "] " << entry.oldPath;
+            break;
+        case PathDiffEntry_t::MOVED:
+            out << "> [" << hive(entry.oldUser) << " " << entry.oldIndex + 1 << " → " << hive(entry.newUser) << " "
+                << entry.newIndex + 1 << "] " << entry.path;
+            if (entry.oldEnabled != entry.newEnabled)
+                out << "  (" << state(entry.oldEnabled) << " → " << state(entry.newEnabled) << ")";
+            break;
+        case PathDiffEntry_t::TOGGLED:
+            out << "* [" << hive(entry.newUser) << " " << entry.newIndex + 1 << "] " << entry.path << "  ("
+                << state(entry.oldEnabled) << " → " << state(entry.newEnabled) << ")";
+            break;
+        case PathDiffEntry_t::RESPELLED:
+            out << "~ [" << hive(entry.newUser) << " " << entry.newIndex + 1 << "] " << entry.oldPath << " → " << entry.path;
+            break;
+        }
+        out << "\n";
+    }
+    return out.str();
+}
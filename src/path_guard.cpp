@@ -0,0 +1,330 @@
+#include "path_guard.hpp"
+#include "path_utils.hpp"
+#include <algorithm>
+#include <unordered_set>
+#ifdef _WIN32
+#include <windows.h>
+#include "win_env_utils.hpp"
+#endif
+
+PathGuard::PathGuard()
+    : pinnedHash{0, 0}, pinnedSet(false), autoRevert(false), debounceMs(500), nextId(1), running(false),
+      stopEvent(nullptr)
+{
+#ifdef _WIN32
+    writer = [](bool user, const std::vector<EnvPathItem_t> &items) {
+        return user ? setUserPath(items) : setSystemPath(items);
+    };
+#endif
+}
+
+PathGuard::~PathGuard()
+{
+    stop();
+}
+
+// FNV-1a，覆盖顺序和写法
+uint64_t PathGuard::hashOf(const std::vector<EnvPathItem_t> &items)
+{
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](unsigned char c) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    };
+    for (const auto &item : items)
+    {
+        if (!item.enabled)
+            continue;
+        for (char c : item.path)
+            mix(static_cast<unsigned char>(c));
+        mix('\0');
+    }
+    return hash;
+}
+
+void PathGuard::pin(const std::vector<EnvPathItem_t> &systemPaths, const std::vector<EnvPathItem_t> &userPaths,
+                    bool keepPending)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::vector<EnvPathItem_t> *lists[2] = {&systemPaths, &userPaths};
+    for (int side = 0; side < 2; side++)
+    {
+        pinned[side].clear();
+        for (const auto &item : *lists[side])
+        {
+            if (item.enabled)
+                pinned[side].push_back(item);
+        }
+        pinnedHash[side] = hashOf(pinned[side]);
+    }
+    pinnedSet = true;
+    if (!keepPending)
+        pending.clear();
+}
+
+void PathGuard::setAutoRevert(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    autoRevert = enabled;
+}
+
+bool PathGuard::autoReverts() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return autoRevert;
+}
+
+void PathGuard::setDebounce(unsigned milliseconds)
+{
+    debounceMs = milliseconds;
+}
+
+void PathGuard::setWriter(Writer write)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    writer = std::move(write);
+}
+
+PathGuard::GuardChange_t PathGuard::diff(const std::vector<EnvPathItem_t> &pinnedItems,
+                                         const std::vector<EnvPathItem_t> &current)
+{
+    GuardChange_t change;
+    change.id = 0;
+    change.user = false;
+    change.reverted = false;
+    std::unordered_set<std::string> pinnedKeys;
+    std::unordered_set<std::string> currentKeys;
+    for (const auto &item : pinnedItems)
+    {
+        pinnedKeys.insert(normalizePathKey(item.path));
+    }
+    for (const auto &item : current)
+    {
+        if (!item.enabled)
+            continue;
+        change.current.push_back(item);
+        std::string key = normalizePathKey(item.path);
+        if (currentKeys.insert(key).second && pinnedKeys.count(key) == 0)
+            change.added.push_back(item.path);
+    }
+    for (const auto &item : pinnedItems)
+    {
+        if (currentKeys.count(normalizePathKey(item.path)) == 0)
+            change.removed.push_back(item.path);
+    }
+    change.reordered = change.added.empty() && change.removed.empty();
+    return change;
+}
+
+bool PathGuard::observe(bool user, const std::vector<EnvPathItem_t> &current)
+{
+    int side = user ? 1 : 0;
+    GuardChange_t change;
+    std::vector<EnvPathItem_t> restore;
+    Writer write;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pinnedSet)
+            return false;
+        auto sameSide = [user](const GuardChange_t &c) { return c.user == user; };
+        // 哈希相同：键中别的变量变了、自己还原的写入，或者外部又改了回来
+        if (hashOf(current) == pinnedHash[side])
+        {
+            pending.erase(std::remove_if(pending.begin(), pending.end(), sameSide), pending.end());
+            return false;
+        }
+        change = diff(pinned[side], current);
+        change.id = nextId++;
+        change.user = user;
+        if (autoRevert)
+        {
+            restore = pinned[side];
+            write = writer;
+        }
+    }
+    // 写注册表时不持锁，写入引起的通知由监视线程稍后处理
+    if (write)
+        change.reverted = write(user, restore);
+
+    Notify onChange;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto sameSide = [user](const GuardChange_t &c) { return c.user == user; };
+        pending.erase(std::remove_if(pending.begin(), pending.end(), sameSide), pending.end());
+        if (change.reverted)
+        {
+            recent.push_back(change);
+            if (recent.size() > 16)
+                recent.erase(recent.begin());
+        }
+        else
+        {
+            pending.push_back(change);
+        }
+        onChange = notify;
+    }
+    if (onChange)
+        onChange(change);
+    return true;
+}
+
+std::vector<PathGuard::GuardChange_t> PathGuard::pendingChanges() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending;
+}
+
+std::vector<PathGuard::GuardChange_t> PathGuard::recentReverts() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return recent;
+}
+
+bool PathGuard::approve(size_t id, GuardChange_t *accepted)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        if (pending[i].id != id)
+            continue;
+        int side = pending[i].user ? 1 : 0;
+        pinned[side] = pending[i].current;
+        pinnedHash[side] = hashOf(pinned[side]);
+        if (accepted)
+            *accepted = pending[i];
+        pending.erase(pending.begin() + i);
+        return true;
+    }
+    return false;
+}
+
+bool PathGuard::reject(size_t id)
+{
+    GuardChange_t change;
+    std::vector<EnvPathItem_t> restore;
+    Writer write;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = std::find_if(pending.begin(), pending.end(), [id](const GuardChange_t &c) { return c.id == id; });
+        if (it == pending.end() || !writer)
+            return false;
+        change = *it;
+        pending.erase(it);
+        restore = pinned[change.user ? 1 : 0];
+        write = writer;
+    }
+    if (write(change.user, restore))
+        return true;
+    // 写入失败（例如系统Path需要管理员权限）时保留待确认
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(change);
+    return false;
+}
+
+bool PathGuard::isRunning() const
+{
+    return running;
+}
+
+#ifdef _WIN32
+bool PathGuard::start(Notify onChange)
+{
+    if (running)
+        return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!pinnedSet)
+            return false;
+        notify = std::move(onChange);
+    }
+    stopEvent = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    if (!stopEvent)
+        return false;
+    running = true;
+    watcher = std::thread(&PathGuard::watchLoop, this);
+    return true;
+}
+
+void PathGuard::stop()
+{
+    if (!running)
+        return;
+    SetEvent(static_cast<HANDLE>(stopEvent));
+    watcher.join();
+    CloseHandle(static_cast<HANDLE>(stopEvent));
+    stopEvent = nullptr;
+    running = false;
+}
+
+void PathGuard::watchLoop()
+{
+    static const char *subKeys[2] = {"SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment", "Environment"};
+    HKEY roots[2] = {HKEY_LOCAL_MACHINE, HKEY_CURRENT_USER};
+    HKEY keys[2] = {nullptr, nullptr};
+    HANDLE events[3] = {static_cast<HANDLE>(stopEvent), CreateEventA(nullptr, FALSE, FALSE, nullptr),
+                        CreateEventA(nullptr, FALSE, FALSE, nullptr)};
+    // 通知只触发一次，每次收到后先重新挂上再去读值，中间的写入不会漏掉
+    auto arm = [&keys, &events](int side) {
+        if (keys[side] && events[side + 1])
+            RegNotifyChangeKeyValue(keys[side], FALSE, REG_NOTIFY_CHANGE_LAST_SET, events[side + 1], TRUE);
+    };
+    for (int side = 0; side < 2; side++)
+    {
+        if (RegOpenKeyExA(roots[side], subKeys[side], 0, KEY_NOTIFY, &keys[side]) != ERROR_SUCCESS)
+            keys[side] = nullptr;
+        arm(side);
+    }
+
+    bool stopping = false;
+    while (!stopping)
+    {
+        // 空闲时阻塞在这里
+        DWORD result = WaitForMultipleObjects(3, events, FALSE, INFINITE);
+        bool dirty[2] = {false, false};
+        DWORD burstStart = GetTickCount();
+        // 去抖：安装程序常常连续写好几次，等安静debounceMs再检查，最多推迟10倍的时间
+        while (result != WAIT_TIMEOUT)
+        {
+            if (result != WAIT_OBJECT_0 + 1 && result != WAIT_OBJECT_0 + 2)
+            {
+                stopping = true;
+                break;
+            }
+            int side = static_cast<int>(result - WAIT_OBJECT_0 - 1);
+            dirty[side] = true;
+            arm(side);
+            if (GetTickCount() - burstStart > debounceMs * 10)
+                break;
+            result = WaitForMultipleObjects(3, events, FALSE, debounceMs);
+        }
+        if (stopping)
+            break;
+        if (dirty[0])
+            observe(false, getSystemPath());
+        if (dirty[1])
+            observe(true, getUserPath());
+    }
+
+    for (int side = 0; side < 2; side++)
+    {
+        if (keys[side])
+            RegCloseKey(keys[side]);
+        if (events[side + 1])
+            CloseHandle(events[side + 1]);
+    }
+}
+#else
+bool PathGuard::start(Notify)
+{
+    // 只有Windows的注册表可以监视
+    return false;
+}
+
+void PathGuard::stop()
+{
+}
+
+void PathGuard::watchLoop()
+{
+}
+#endif
@@ -0,0 +1,263 @@
+#include "path_health_scanner.hpp"
+#include <filesystem>
+#include <memory>
+#include <thread>
+#include <condition_variable>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+
+PathHealthScanner::PathHealthScanner(size_t threadCount)
+    : probeTimeout(2000),
+      identityCache(std::make_shared<FileIdentityCache>()),
+      pool(threadCount != 0 ? threadCount : (std::thread::hardware_concurrency() > 4 ? std::thread::hardware_concurrency() : 4))
+{
+}
+
+PathHealthScanner::~PathHealthScanner()
+{
+    unwatchAll();
+}
+
+void PathHealthScanner::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+}
+
+void PathHealthScanner::setResultsReady(std::function<void()> callback)
+{
+    resultsReady = std::move(callback);
+}
+
+void PathHealthScanner::setProbeTimeout(std::chrono::milliseconds timeout)
+{
+    probeTimeout = timeout;
+}
+
+void PathHealthScanner::watch(PathListModel *model)
+{
+    int id = model->subscribe([this, model](const PathListChange_t &change) { onModelChange(model, change); });
+    watches.push_back(Watch{model, id});
+    for (size_t i = 0; i < model->size(); i++)
+    {
+        request(model->at(i).path);
+    }
+}
+
+void PathHealthScanner::unwatchAll()
+{
+    for (auto &w : watches)
+    {
+        w.model->unsubscribe(w.subscription);
+    }
+    watches.clear();
+}
+
+void PathHealthScanner::onModelChange(PathListModel *model, const PathListChange_t &change)
+{
+    // 只有出现新路径的变化才需要检查；切换、移动、删除不影响目录本身
+    switch (change.kind)
+    {
+    case PathListChange_t::INSERT:
+    case PathListChange_t::EDIT:
+        request(model->at(change.index).path);
+        break;
+    case PathListChange_t::RESET:
+        for (size_t i = 0; i < model->size(); i++)
+        {
+            request(model->at(i).path);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void PathHealthScanner::request(const std::string &path)
+{
+    if (results.count(path) || pending.count(path))
+        return;
+    pending.insert(path);
+
+    std::string expanded = expander ? expander(path) : path;
+    std::chrono::milliseconds timeout = probeTimeout;
+    std::shared_ptr<FileIdentityCache> cache = identityCache;
+    pool.submit([this, path, expanded, timeout, cache]() {
+        if (!isNetworkPath(expanded))
+        {
+            post(path, probeWithIdentity(expanded, *cache));
+            return;
+        }
+
+        // 网络路径放到独立线程里检查，超时后放弃等待，该线程结束时自行释放状态
+        struct ProbeState {
+            std::mutex mutex;
+            std::condition_variable done;
+            bool finished = false;
+            Result result = Result{HEALTH_UNKNOWN, false, FileIdentity_t{0, 0}};
+        };
+        auto state = std::make_shared<ProbeState>();
+        std::thread([state, expanded, cache]() {
+            Result result = probeWithIdentity(expanded, *cache);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->result = result;
+            state->finished = true;
+            state->done.notify_one();
+        }).detach();
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        bool finished = state->done.wait_for(lock, timeout, [&state]() { return state->finished; });
+        Result result = finished ? state->result : Result{HEALTH_TIMEOUT, false, FileIdentity_t{0, 0}};
+        lock.unlock();
+        post(path, result);
+    });
+}
+
+PathHealthScanner::Result PathHealthScanner::probeWithIdentity(const std::string &expandedPath, FileIdentityCache &cache)
+{
+    Result result{probe(expandedPath), false, FileIdentity_t{0, 0}};
+    if (result.health == HEALTH_OK)
+    {
+        result.hasIdentity = cache.lookup(expandedPath, result.identity);
+    }
+    return result;
+}
+
+void PathHealthScanner::post(const std::string &path, const Result &result)
+{
+    bool wasEmpty;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        wasEmpty = finished.empty();
+        finished.emplace_back(path, result);
+    }
+    // 一批结果只通知一次，主线程drain时一起取走
+    if (wasEmpty && resultsReady)
+    {
+        resultsReady();
+    }
+}
+
+void PathHealthScanner::recheck(const std::string &path)
+{
+    results.erase(path);
+    if (pending.count(path))
+    {
+        stale.insert(path);
+        return;
+    }
+    request(path);
+}
+
+void PathHealthScanner::rescanAll()
+{
+    results.clear();
+    for (auto &w : watches)
+    {
+        for (size_t i = 0; i < w.model->size(); i++)
+        {
+            request(w.model->at(i).path);
+        }
+    }
+}
+
+size_t PathHealthScanner::drain()
+{
+    std::vector<std::pair<std::string, Result>> batch;
+    {
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        batch.swap(finished);
+    }
+    for (auto &item : batch)
+    {
+        pending.erase(item.first);
+        if (stale.erase(item.first))
+        {
+            request(item.first);
+            continue;
+        }
+        results[item.first] = item.second;
+    }
+    return batch.size();
+}
+
+PathHealth_t PathHealthScanner::status(const std::string &path) const
+{
+    auto it = results.find(path);
+    return it == results.end() ? HEALTH_UNKNOWN : it->second.health;
+}
+
+bool PathHealthScanner::identity(const std::string &path, FileIdentity_t &id) const
+{
+    auto it = results.find(path);
+    if (it == results.end() || !it->second.hasIdentity)
+    {
+        return false;
+    }
+    id = it->second.identity;
+    return true;
+}
+
+PathHealth_t PathHealthScanner::probe(const std::string &expandedPath)
+{
+    std::error_code ec;
+    fs::path p(expandedPath);
+    fs::file_status st = fs::status(p, ec);
+    if (ec || !fs::exists(st))
+    {
+        if (ec == std::errc::permission_denied)
+            return HEALTH_NO_ACCESS;
+        return HEALTH_MISSING;
+    }
+    if (!fs::is_directory(st))
+    {
+        return HEALTH_NOT_DIRECTORY;
+    }
+    // 能打开目录才算可访问
+    fs::directory_iterator it(p, ec);
+    if (ec)
+    {
+        return HEALTH_NO_ACCESS;
+    }
+    return HEALTH_OK;
+}
+
+bool PathHealthScanner::isNetworkPath(const std::string &expandedPath)
+{
+    if (expandedPath.size() >= 2 &&
+        (expandedPath[0] == '\\' || expandedPath[0] == '/') &&
+        (expandedPath[1] == '\\' || expandedPath[1] == '/'))
+    {
+        return true; // UNC路径
+    }
+#ifdef _WIN32
+    // 映射的网络驱动器
+    if (expandedPath.size() >= 2 && expandedPath[1] == ':')
+    {
+        char root[4] = {expandedPath[0], ':', '\\', '\0'};
+        return GetDriveTypeA(root) == DRIVE_REMOTE;
+    }
+#endif
+    return false;
+}
+
+const char *PathHealthScanner::describe(PathHealth_t health)
+{
+    switch (health)
+    {
+    case HEALTH_OK:
+        return "目录正常";
+    case HEALTH_MISSING:
+        return "目录不存在";
+    case HEALTH_NOT_DIRECTORY:
+        return "不是目录";
+    case HEALTH_NO_ACCESS:
+        return "无法访问";
+    case HEALTH_TIMEOUT:
+        return "访问超时";
+    default:
+        return "检查中";
+    }
+}
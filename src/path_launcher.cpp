@@ -0,0 +1,368 @@
+#include "path_launcher.hpp"
+#include "path_state_store.hpp"
+#include "path_utils.hpp"
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef _WIN32
+static const char pathSeparator = ';';
+static const char defaultPathName[] = "Path";
+#else
+static const char pathSeparator = ':';
+static const char defaultPathName[] = "PATH";
+#endif
+
+// "名=值"中名字的长度；Windows中以'='开头的隐藏变量（如"=C:=C:\"）名字从第二个字符算起
+static size_t nameLength(const char *entry)
+{
+    const char *eq = strchr(entry + 1, '=');
+    return eq ? static_cast<size_t>(eq - entry) : strlen(entry);
+}
+
+static bool isPathEntry(const char *entry)
+{
+    size_t len = nameLength(entry);
+#ifdef _WIN32
+    return len == 4 && _strnicmp(entry, "Path", 4) == 0;
+#else
+    return len == 4 && strncmp(entry, "PATH", 4) == 0;
+#endif
+}
+
+// Windows要求环境块按名字不区分大小写排序
+static bool entryLess(const char *a, const char *b)
+{
+    size_t la = nameLength(a);
+    size_t lb = nameLength(b);
+    size_t n = (std::min)(la, lb);
+    for (size_t i = 0; i < n; i++)
+    {
+#ifdef _WIN32
+        char ca = a[i] >= 'a' && a[i] <= 'z' ? static_cast<char>(a[i] - 'a' + 'A') : a[i];
+        char cb = b[i] >= 'a' && b[i] <= 'z' ? static_cast<char>(b[i] - 'a' + 'A') : b[i];
+#else
+        char ca = a[i];
+        char cb = b[i];
+#endif
+        if (ca != cb)
+            return static_cast<unsigned char>(ca) < static_cast<unsigned char>(cb);
+    }
+    return la < lb;
+}
+
+EnvironmentBlock::EnvironmentBlock(const std::string &path) : pathValue(path)
+{
+    // 先只收集指向当前环境的指针，排序并算出总长度后一次性复制
+    std::vector<const char *> current;
+#ifdef _WIN32
+    char *environment = GetEnvironmentStringsA();
+    for (const char *p = environment; p && *p; p += strlen(p) + 1)
+        current.push_back(p);
+#else
+    for (char **e = environ; *e; e++)
+        current.push_back(*e);
+#endif
+    std::vector<const char *> entries;
+    entries.reserve(current.size() + 1);
+    std::string pathName = defaultPathName;
+    for (const char *p : current)
+    {
+        if (isPathEntry(p))
+        {
+            pathName.assign(p, 4); // 保留原来的大小写
+            continue;
+        }
+        entries.push_back(p);
+    }
+    std::string pathEntry = pathName + "=" + path;
+    entries.push_back(pathEntry.c_str());
+    std::sort(entries.begin(), entries.end(), entryLess);
+
+    std::vector<size_t> lengths;
+    lengths.reserve(entries.size());
+    size_t total = 1; // 结尾额外的'\0'
+    for (const char *entry : entries)
+    {
+        lengths.push_back(strlen(entry));
+        total += lengths.back() + 1;
+    }
+    data.resize(total);
+    pointers.reserve(entries.size() + 1);
+    char *out = data.data();
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        memcpy(out, entries[i], lengths[i] + 1);
+        pointers.push_back(out);
+        out += lengths[i] + 1;
+    }
+    *out = '\0';
+    pointers.push_back(nullptr);
+#ifdef _WIN32
+    FreeEnvironmentStringsA(environment);
+#endif
+}
+
+const char *EnvironmentBlock::block() const
+{
+    return data.data();
+}
+
+size_t EnvironmentBlock::blockSize() const
+{
+    return data.size();
+}
+
+char *const *EnvironmentBlock::envp() const
+{
+    return pointers.data();
+}
+
+const std::string &EnvironmentBlock::path() const
+{
+    return pathValue;
+}
+
+void PathLauncher::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+    invalidate();
+}
+
+void PathLauncher::invalidate()
+{
+    tableBlock.reset();
+    fileBlocks.clear();
+}
+
+// 与Windows合成进程PATH的方式一致
+std::vector<std::string> PathLauncher::effectiveEntries(const std::vector<EnvPathItem_t> &systemPaths,
+                                                        const std::vector<EnvPathItem_t> &userPaths,
+                                                        const Expander &expander)
+{
+    std::vector<std::string> entries;
+    entries.reserve(systemPaths.size() + userPaths.size());
+    for (const auto *list : {&systemPaths, &userPaths})
+    {
+        for (const auto &item : *list)
+        {
+            if (item.enabled)
+                entries.push_back(expander ? expander(item.path) : item.path);
+        }
+    }
+    return entries;
+}
+
+static std::string joinPath(const std::vector<std::string> &entries)
+{
+    std::string joined;
+    for (const auto &entry : entries)
+    {
+        if (!joined.empty())
+            joined.push_back(pathSeparator);
+        joined += entry;
+    }
+    return joined;
+}
+
+PathLauncher::BlockPtr PathLauncher::blockFor(const PersistentPathList &system, const PersistentPathList &user)
+{
+    if (tableBlock && cachedSystem.sameAs(system) && cachedUser.sameAs(user))
+    {
+        return tableBlock;
+    }
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    system.toVector(systemPaths);
+    user.toVector(userPaths);
+    tableBlock = std::make_shared<const EnvironmentBlock>(joinPath(effectiveEntries(systemPaths, userPaths, expander)));
+    cachedSystem = system;
+    cachedUser = user;
+    return tableBlock;
+}
+
+PathLauncher::BlockPtr PathLauncher::blockForFile(const fs::path &file)
+{
+    std::error_code ec;
+    fs::file_time_type mtime = fs::last_write_time(file, ec);
+    uintmax_t size = ec ? 0 : fs::file_size(file, ec);
+    if (ec)
+    {
+        return nullptr;
+    }
+    std::string key = file.string();
+    auto it = fileBlocks.find(key);
+    if (it != fileBlocks.end() && it->second.mtime == mtime && it->second.size == size)
+    {
+        return it->second.block;
+    }
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    bool ordered = false;
+    if (!PathStateStore::readAnyFile(file, systemPaths, userPaths, &ordered) || !ordered)
+    {
+        return nullptr;
+    }
+    BlockPtr block = std::make_shared<const EnvironmentBlock>(joinPath(effectiveEntries(systemPaths, userPaths, expander)));
+    fileBlocks[key] = FileEntry{mtime, size, block};
+    return block;
+}
+
+std::vector<std::string> PathLauncher::splitCommandLine(const std::string &commandLine)
+{
+    std::vector<std::string> args;
+    std::string current;
+    bool quoted = false;
+    bool pending = false; // ""表示一个空参数
+    for (char c : commandLine)
+    {
+        if (c == '"')
+        {
+            quoted = !quoted;
+            pending = true;
+        }
+        else if ((c == ' ' || c == '\t') && !quoted)
+        {
+            if (pending)
+                args.push_back(current);
+            current.clear();
+            pending = false;
+        }
+        else
+        {
+            current.push_back(c);
+            pending = true;
+        }
+    }
+    if (pending)
+        args.push_back(current);
+    return args;
+}
+
+#ifdef _WIN32
+// 按MSVC运行库解析命令行的规则加引号：引号前的反斜杠要成对
+static std::string quoteArgument(const std::string &arg)
+{
+    if (!arg.empty() && arg.find_first_of(" \t\"") == std::string::npos)
+        return arg;
+    std::string out = "\"";
+    size_t backslashes = 0;
+    for (char c : arg)
+    {
+        if (c == '\\')
+        {
+            backslashes++;
+            continue;
+        }
+        out.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+        backslashes = 0;
+        out.push_back(c);
+    }
+    out.append(backslashes * 2, '\\');
+    out.push_back('"');
+    return out;
+}
+#endif
+
+bool PathLauncher::launch(const EnvironmentBlock &block, const std::vector<std::string> &args, bool wait,
+                          int &exitCode, std::string &error)
+{
+    exitCode = 0;
+    if (args.empty())
+    {
+        error = "no program given";
+        return false;
+    }
+    // 系统按父进程的PATH查找程序，这里改为在新的PATH中查找
+    std::string program = args[0];
+#ifdef _WIN32
+    if (program.find_first_of("\\/:") == std::string::npos)
+    {
+        char found[MAX_PATH];
+        DWORD len = SearchPathA(block.path().c_str(), program.c_str(), ".exe", MAX_PATH, found, NULL);
+        if (len == 0 || len >= MAX_PATH)
+        {
+            error = program + ": not found in the PATH";
+            return false;
+        }
+        program.assign(found, len);
+    }
+    std::string commandLine = quoteArgument(program);
+    for (size_t i = 1; i < args.size(); i++)
+    {
+        commandLine += ' ';
+        commandLine += quoteArgument(args[i]);
+    }
+    STARTUPINFOA si = {0};
+    si.cb = sizeof(si);
+    PROCESS_INFORMATION pi = {0};
+    if (!CreateProcessA(program.c_str(), &commandLine[0], NULL, NULL, FALSE, 0,
+                        const_cast<char *>(block.block()), NULL, &si, &pi))
+    {
+        error = "CreateProcess failed with error " + std::to_string(GetLastError());
+        return false;
+    }
+    if (wait)
+    {
+        DWORD code = 0;
+        WaitForSingleObject(pi.hProcess, INFINITE);
+        GetExitCodeProcess(pi.hProcess, &code);
+        exitCode = static_cast<int>(code);
+    }
+    CloseHandle(pi.hThread);
+    CloseHandle(pi.hProcess);
+    return true;
+#else
+    if (program.find('/') == std::string::npos)
+    {
+        std::string found;
+        for (const auto &dir : splitList(block.path(), pathSeparator))
+        {
+            std::string candidate = (dir.empty() ? std::string(".") : dir) + "/" + program;
+            struct stat st;
+            if (stat(candidate.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(candidate.c_str(), X_OK) == 0)
+            {
+                found = candidate;
+                break;
+            }
+        }
+        if (found.empty())
+        {
+            error = program + ": not found in the PATH";
+            return false;
+        }
+        program = found;
+    }
+    std::vector<char *> argv;
+    argv.reserve(args.size() + 1);
+    for (const auto &arg : args)
+    {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    pid_t pid;
+    int rc = posix_spawn(&pid, program.c_str(), nullptr, nullptr, argv.data(), block.envp());
+    if (rc != 0)
+    {
+        error = program + ": " + strerror(rc);
+        return false;
+    }
+    if (wait)
+    {
+        int status = 0;
+        waitpid(pid, &status, 0);
+        exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    return true;
+#endif
+}
@@ -0,0 +1,154 @@
+#include "path_length_counter.hpp"
+#include <unordered_set>
+
+PathLengthCounter::PathLengthCounter() : model(nullptr), subscription(0), rawSum(0), expandedSum(0), enabled(0)
+{
+}
+
+PathLengthCounter::~PathLengthCounter()
+{
+    attach(nullptr);
+}
+
+void PathLengthCounter::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+    recount();
+}
+
+void PathLengthCounter::attach(PathListModel *target)
+{
+    if (model)
+    {
+        model->unsubscribe(subscription);
+    }
+    model = target;
+    if (model)
+    {
+        subscription = model->subscribe([this](const PathListChange_t &change) { onModelChange(change); });
+    }
+    recount();
+}
+
+PathLengthCounter::Row PathLengthCounter::measure(size_t index) const
+{
+    const EnvPathItem_t &item = model->at(index);
+    Row row{static_cast<uint32_t>(item.path.size()), static_cast<uint32_t>(item.path.size()),
+            !model->isDeleted(index) && item.enabled};
+    if (expander && item.path.find('%') != std::string::npos)
+    {
+        row.expanded = static_cast<uint32_t>(expander(item.path).size());
+    }
+    return row;
+}
+
+void PathLengthCounter::add(const Row &row)
+{
+    if (!row.counted)
+        return;
+    rawSum += row.raw;
+    expandedSum += row.expanded;
+    enabled++;
+}
+
+void PathLengthCounter::subtract(const Row &row)
+{
+    if (!row.counted)
+        return;
+    rawSum -= row.raw;
+    expandedSum -= row.expanded;
+    enabled--;
+}
+
+void PathLengthCounter::recount()
+{
+    rows.clear();
+    rawSum = 0;
+    expandedSum = 0;
+    enabled = 0;
+    if (!model)
+        return;
+    rows.reserve(model->size());
+    for (size_t i = 0; i < model->size(); i++)
+    {
+        rows.push_back(measure(i));
+        add(rows.back());
+    }
+}
+
+void PathLengthCounter::onModelChange(const PathListChange_t &change)
+{
+    switch (change.kind)
+    {
+    case PathListChange_t::INSERT:
+        rows.insert(rows.begin() + change.index, measure(change.index));
+        add(rows[change.index]);
+        break;
+    case PathListChange_t::REMOVE:
+    case PathListChange_t::RESTORE:
+    case PathListChange_t::TOGGLE:
+    case PathListChange_t::EDIT:
+        // 变化前的贡献记在rows中，减去后按新状态重新计入
+        subtract(rows[change.index]);
+        rows[change.index] = measure(change.index);
+        add(rows[change.index]);
+        break;
+    case PathListChange_t::MOVE:
+    {
+        // 长度与位置无关，只需要让镜像跟随移动
+        Row row = rows[change.index];
+        rows.erase(rows.begin() + change.index);
+        rows.insert(rows.begin() + change.toIndex, row);
+        break;
+    }
+    case PathListChange_t::RESET:
+    case PathListChange_t::COMPACT:
+        recount();
+        break;
+    }
+}
+
+void PathLengthCounter::reexpand(const std::vector<std::string> &rawPaths)
+{
+    if (!model || rawPaths.empty())
+        return;
+    std::unordered_set<std::string> changed;
+    for (const auto &raw : rawPaths)
+    {
+        if (model->contains(raw))
+            changed.insert(raw);
+    }
+    if (changed.empty())
+        return;
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        if (!changed.count(model->at(i).path))
+            continue;
+        subtract(rows[i]);
+        rows[i] = measure(i);
+        add(rows[i]);
+    }
+}
+
+size_t PathLengthCounter::enabledCount() const
+{
+    return enabled;
+}
+
+size_t PathLengthCounter::rawLength() const
+{
+    return enabled == 0 ? 0 : rawSum + enabled - 1;
+}
+
+size_t PathLengthCounter::expandedLength() const
+{
+    return enabled == 0 ? 0 : expandedSum + enabled - 1;
+}
+
+size_t PathLengthCounter::effectiveLength(const PathLengthCounter &system, const PathLengthCounter &user)
+{
+    size_t length = system.expandedLength() + user.expandedLength();
+    if (system.enabledCount() > 0 && user.enabledCount() > 0)
+        length++;
+    return length;
+}
@@ -0,0 +1,434 @@
+#include "path_list_model.hpp"
+
+PathListModel::PathListModel() : linkedModel(nullptr), nextListenerId(1), batchDepth(0)
+{
+}
+
+int PathListModel::subscribe(Listener listener)
+{
+    int id = nextListenerId++;
+    listeners.emplace_back(id, std::move(listener));
+    return id;
+}
+
+void PathListModel::unsubscribe(int id)
+{
+    for (size_t i = 0; i < listeners.size(); i++)
+    {
+        if (listeners[i].first == id)
+        {
+            listeners.erase(listeners.begin() + i);
+            return;
+        }
+    }
+}
+
+void PathListModel::notify(PathListChange_t::Kind kind, size_t index, size_t toIndex)
+{
+    PathListChange_t change{kind, index, toIndex};
+    for (size_t i = 0; i < listeners.size(); i++)
+    {
+        listeners[i].second(change);
+    }
+}
+
+void PathListModel::record()
+{
+    if (batchDepth > 0)
+        return;
+    closeStep();
+    undoStack.push_back(HistoryStep{entries, 0, {}});
+    redoStack.clear();
+}
+
+// 不记录历史的修改（首次加载）也并入栈顶，撤销时仍能回到该步的统计
+void PathListModel::closeStep()
+{
+    if (pendingCounts.empty())
+        return;
+    if (!undoStack.empty())
+    {
+        std::vector<std::pair<std::string, long>> &counts = undoStack.back().counts;
+        for (const auto &change : pendingCounts)
+        {
+            if (change.second != 0)
+                counts.emplace_back(change.first, change.second);
+        }
+    }
+    pendingCounts.clear();
+}
+
+void PathListModel::applyCounts(const std::vector<std::pair<std::string, long>> &counts, long sign)
+{
+    for (const auto &change : counts)
+    {
+        auto it = liveCounts.find(change.first);
+        long count = (it == liveCounts.end() ? 0 : static_cast<long>(it->second)) + sign * change.second;
+        if (count > 0)
+            liveCounts[change.first] = static_cast<size_t>(count);
+        else if (it != liveCounts.end())
+            liveCounts.erase(it);
+    }
+}
+
+void PathListModel::beginBatch()
+{
+    if (batchDepth++ == 0)
+    {
+        closeStep();
+        batchStart = entries;
+    }
+}
+
+void PathListModel::endBatch()
+{
+    if (batchDepth == 0 || --batchDepth > 0)
+        return;
+    if (!entries.sameAs(batchStart))
+    {
+        undoStack.push_back(HistoryStep{batchStart, 0, {}});
+        redoStack.clear();
+        closeStep();
+    }
+    batchStart = PersistentPathList();
+}
+
+void PathListModel::beginLinkedBatch(PathListModel &first, PathListModel &second)
+{
+    first.beginBatch();
+    second.beginBatch();
+}
+
+void PathListModel::endLinkedBatch(PathListModel &first, PathListModel &second)
+{
+    static unsigned long nextLink = 1;
+    size_t firstDepth = first.undoStack.size();
+    size_t secondDepth = second.undoStack.size();
+    first.endBatch();
+    second.endBatch();
+    // 只有一侧有修改时就是普通的一步
+    if (first.undoStack.size() == firstDepth || second.undoStack.size() == secondDepth)
+        return;
+    unsigned long link = nextLink++;
+    first.undoStack.back().link = link;
+    second.undoStack.back().link = link;
+    first.linkedModel = &second;
+    second.linkedModel = &first;
+}
+
+void PathListModel::rebuildCounts()
+{
+    // 只用于整体替换，变化由调用方对比前后两份统计得出，这里不计入pendingCounts
+    liveCounts.clear();
+    liveCounts.reserve(entries.liveSize());
+    entries.forEachLive([this](size_t, const EnvPathItem_t &item) { liveCounts[item.path]++; });
+}
+
+void PathListModel::countAdd(const std::string &path)
+{
+    liveCounts[path]++;
+    pendingCounts[path]++;
+}
+
+void PathListModel::countRemove(const std::string &path)
+{
+    auto it = liveCounts.find(path);
+    if (it == liveCounts.end())
+        return;
+    pendingCounts[path]--;
+    if (--it->second == 0)
+    {
+        liveCounts.erase(it);
+    }
+}
+
+const PersistentPathList &PathListModel::list() const
+{
+    return entries;
+}
+
+size_t PathListModel::size() const
+{
+    return entries.size();
+}
+
+size_t PathListModel::liveSize() const
+{
+    return entries.liveSize();
+}
+
+const EnvPathItem_t &PathListModel::at(size_t index) const
+{
+    return entries.at(index);
+}
+
+bool PathListModel::isDeleted(size_t index) const
+{
+    return entries.isDeleted(index);
+}
+
+size_t PathListModel::liveToIndex(size_t liveRow) const
+{
+    return entries.liveToIndex(liveRow);
+}
+
+bool PathListModel::contains(const std::string &path) const
+{
+    return liveCounts.find(path) != liveCounts.end();
+}
+
+size_t PathListModel::find(const std::string &path) const
+{
+    if (!contains(path))
+        return npos;
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (!entries.isDeleted(i) && entries.at(i).path == path)
+            return i;
+    }
+    return npos;
+}
+
+size_t PathListModel::deletedCount() const
+{
+    return entries.size() - entries.liveSize();
+}
+
+void PathListModel::toVector(std::vector<EnvPathItem_t> &out) const
+{
+    entries.toVector(out);
+}
+
+void PathListModel::enabledPaths(std::vector<std::string> &out) const
+{
+    std::vector<EnvPathItem_t> items;
+    entries.toVector(items);
+    for (auto &item : items)
+    {
+        if (item.enabled)
+            out.push_back(std::move(item.path));
+    }
+}
+
+void PathListModel::append(const EnvPathItem_t &item)
+{
+    record();
+    size_t index = entries.size();
+    entries = entries.pushBack(item);
+    countAdd(item.path);
+    notify(PathListChange_t::INSERT, index);
+}
+
+void PathListModel::appendAll(std::vector<EnvPathItem_t> &&items)
+{
+    if (items.empty())
+        return;
+    record();
+    liveCounts.reserve(liveCounts.size() + items.size());
+    for (const auto &item : items)
+    {
+        countAdd(item.path);
+    }
+    entries = entries.appended(std::move(items));
+    // 逐行通知会让表格和各个订阅者重复计算，大量追加时整体刷新一次更快
+    notify(PathListChange_t::RESET, 0);
+}
+
+void PathListModel::setEnabled(size_t index, bool enabled)
+{
+    if (entries.at(index).enabled == enabled)
+        return;
+    record();
+    entries = entries.setEnabled(index, enabled);
+    notify(PathListChange_t::TOGGLE, index);
+}
+
+void PathListModel::setEnabledRows(const std::vector<size_t> &rows, bool enabled)
+{
+    if (rows.empty())
+        return;
+    record();
+    PersistentPathList updated = entries;
+    for (size_t index : rows)
+    {
+        updated = updated.setEnabled(index, enabled);
+    }
+    entries = updated;
+    notify(PathListChange_t::RESET, 0);
+}
+
+void PathListModel::setPath(size_t index, const std::string &path)
+{
+    const EnvPathItem_t &item = entries.at(index);
+    if (item.path == path)
+        return;
+    record();
+    bool live = !entries.isDeleted(index);
+    if (live)
+        countRemove(item.path);
+    entries = entries.set(index, EnvPathItem_t{path, item.enabled});
+    if (live)
+        countAdd(path);
+    notify(PathListChange_t::EDIT, index);
+}
+
+void PathListModel::setPaths(const std::vector<std::pair<size_t, std::string>> &edits)
+{
+    if (edits.empty())
+        return;
+    record();
+    PersistentPathList updated = entries;
+    for (const auto &edit : edits)
+    {
+        const EnvPathItem_t &item = updated.at(edit.first);
+        if (item.path == edit.second)
+            continue;
+        bool live = !updated.isDeleted(edit.first);
+        if (live)
+            countRemove(item.path);
+        updated = updated.set(edit.first, EnvPathItem_t{edit.second, item.enabled});
+        if (live)
+            countAdd(edit.second);
+    }
+    entries = updated;
+    notify(PathListChange_t::RESET, 0);
+}
+
+void PathListModel::remove(size_t index)
+{
+    if (entries.isDeleted(index))
+        return;
+    record();
+    entries = entries.setDeleted(index, true);
+    countRemove(entries.at(index).path);
+    notify(PathListChange_t::REMOVE, index);
+}
+
+void PathListModel::restore(size_t index)
+{
+    if (!entries.isDeleted(index))
+        return;
+    record();
+    entries = entries.setDeleted(index, false);
+    countAdd(entries.at(index).path);
+    notify(PathListChange_t::RESTORE, index);
+}
+
+void PathListModel::move(size_t from, size_t to)
+{
+    if (from == to)
+        return;
+    record();
+    entries = entries.move(from, to);
+    notify(PathListChange_t::MOVE, from, to);
+}
+
+void PathListModel::replaceAll(std::vector<EnvPathItem_t> &&items)
+{
+    // 空表（首次加载）没有可以回退的内容，不记录历史
+    if (!entries.empty())
+    {
+        record();
+    }
+    else
+    {
+        redoStack.clear(); // 重做的各步以替换前的内容为起点
+    }
+    entries = PersistentPathList(std::move(items));
+    std::unordered_map<std::string, size_t> before;
+    before.swap(liveCounts);
+    rebuildCounts();
+    for (const auto &pair : liveCounts)
+    {
+        pendingCounts[pair.first] += static_cast<long>(pair.second);
+    }
+    for (const auto &pair : before)
+    {
+        pendingCounts[pair.first] -= static_cast<long>(pair.second);
+    }
+    notify(PathListChange_t::RESET, 0);
+}
+
+void PathListModel::clearHistory()
+{
+    undoStack.clear();
+    redoStack.clear();
+    pendingCounts.clear();
+    linkedModel = nullptr;
+}
+
+void PathListModel::permute(const std::vector<size_t> &order)
+{
+    if (order.size() != entries.size())
+        return;
+    std::vector<EnvPathItem_t> items;
+    items.reserve(order.size());
+    for (size_t from : order)
+    {
+        items.push_back(entries.at(from));
+    }
+    PersistentPathList permuted(std::move(items));
+    // 墓碑跟着原来的行走
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        if (entries.isDeleted(order[i]))
+            permuted = permuted.setDeleted(i, true);
+    }
+    record();
+    entries = permuted;
+    notify(PathListChange_t::RESET, 0);
+}
+
+void PathListModel::compact()
+{
+    if (deletedCount() == 0)
+        return;
+    entries = entries.compacted();
+    notify(PathListChange_t::COMPACT, 0);
+}
+
+bool PathListModel::canUndo() const
+{
+    return !undoStack.empty();
+}
+
+bool PathListModel::canRedo() const
+{
+    return !redoStack.empty();
+}
+
+// 从from取出一步恢复，当前内容带着同样的link放进to。
+// 另一个模型的同一侧栈顶是同一次联动修改时一起恢复；之后单独修改过则只恢复这一侧
+void PathListModel::restoreStep(std::vector<HistoryStep> &from, std::vector<HistoryStep> &to, bool followLink)
+{
+    closeStep();
+    bool undoing = &from == &undoStack;
+    HistoryStep step = std::move(from.back());
+    from.pop_back();
+    // 撤销时减去这一步带来的变化，重做时加上；放进另一个栈的一步保留同样的变化
+    applyCounts(step.counts, undoing ? -1 : 1);
+    to.push_back(HistoryStep{entries, step.link, std::move(step.counts)});
+    entries = step.list;
+    notify(PathListChange_t::RESET, 0);
+    if (!followLink || step.link == 0 || !linkedModel || linkedModel->batchDepth > 0)
+        return;
+    PathListModel &other = *linkedModel;
+    std::vector<HistoryStep> &otherFrom = undoing ? other.undoStack : other.redoStack;
+    std::vector<HistoryStep> &otherTo = undoing ? other.redoStack : other.undoStack;
+    if (!otherFrom.empty() && otherFrom.back().link == step.link)
+        other.restoreStep(otherFrom, otherTo, false);
+}
+
+void PathListModel::undo()
+{
+    if (undoStack.empty() || batchDepth > 0)
+        return;
+    restoreStep(undoStack, redoStack, true);
+}
+
+void PathListModel::redo()
+{
+    if (redoStack.empty() || batchDepth > 0)
+        return;
+    restoreStep(redoStack, undoStack, true);
+}
@@ -0,0 +1,261 @@
+#include "path_order_optimizer.hpp"
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cstdint>
+
+PathOrderOptimizer::PathOrderOptimizer(size_t entries, size_t probesPerDirectory, size_t systemEntries)
+    : entryCount(entries),
+      probesPerMiss(probesPerDirectory),
+      segmentEnd(systemEntries < entries ? systemEntries : entries),
+      entryWeight(entries, 0.0),
+      predecessors(entries),
+      totalWeight(0.0)
+{
+}
+
+void PathOrderOptimizer::addCommand(const std::string &name, double weight, const std::vector<std::pair<size_t, size_t>> &hits)
+{
+    if (hits.empty() || weight <= 0)
+    {
+        return;
+    }
+    // hits已按位置升序，第一个即生效的目录
+    commands.push_back(Command_t{name, weight, hits.front().first, hits.front().second});
+    entryWeight[hits.front().first] += weight;
+    totalWeight += weight;
+}
+
+void PathOrderOptimizer::addPrecedence(size_t before, size_t after)
+{
+    if (before < entryCount && after < entryCount && before != after)
+    {
+        predecessors[after].push_back(before);
+    }
+}
+
+double PathOrderOptimizer::totalUsage() const
+{
+    return totalWeight;
+}
+
+double PathOrderOptimizer::expectedProbes(const std::vector<size_t> &order) const
+{
+    if (totalWeight <= 0)
+    {
+        return 0.0;
+    }
+    std::vector<size_t> position(entryCount, 0);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        position[order[i]] = i;
+    }
+    double total = 0.0;
+    for (const auto &command : commands)
+    {
+        // 前面每个目录都要把所有扩展名试一遍
+        total += command.weight * static_cast<double>(probesPerMiss * position[command.winner] + command.probes);
+    }
+    return total / totalWeight;
+}
+
+bool PathOrderOptimizer::respectsPrecedence(const std::vector<size_t> &order) const
+{
+    std::vector<size_t> position(entryCount, 0);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        position[order[i]] = i;
+    }
+    for (size_t after = 0; after < entryCount; after++)
+    {
+        for (size_t before : predecessors[after])
+        {
+            if (position[before] > position[after])
+                return false;
+        }
+    }
+    return true;
+}
+
+std::vector<size_t> PathOrderOptimizer::optimize() const
+{
+    std::vector<size_t> order;
+    order.reserve(entryCount);
+    std::vector<uint8_t> placed(entryCount, 0);
+    std::vector<uint8_t> mark(entryCount, 0);
+    std::vector<size_t> stack;
+
+    // 系统和用户两段分别调整，不能跨表移动
+    size_t bounds[3] = {0, segmentEnd, entryCount};
+    for (int seg = 0; seg < 2; seg++)
+    {
+        size_t lo = bounds[seg];
+        size_t hi = bounds[seg + 1];
+        size_t remaining = hi - lo;
+        while (remaining > 0)
+        {
+            // 每次选"连同尚未放置的前驱一起放置时，平均每个位置带来的使用次数"最大的条目，
+            // 这样被低频目录挡住的高频目录也能被带到前面
+            double bestDensity = -1.0;
+            std::vector<size_t> bestGroup;
+            for (size_t v = lo; v < hi; v++)
+            {
+                if (placed[v])
+                    continue;
+                std::vector<size_t> group;
+                double weight = 0.0;
+                stack.assign(1, v);
+                mark[v] = 1;
+                while (!stack.empty())
+                {
+                    size_t u = stack.back();
+                    stack.pop_back();
+                    group.push_back(u);
+                    weight += entryWeight[u];
+                    for (size_t p : predecessors[u])
+                    {
+                        if (p >= lo && p < hi && !placed[p] && !mark[p])
+                        {
+                            mark[p] = 1;
+                            stack.push_back(p);
+                        }
+                    }
+                }
+                for (size_t u : group)
+                {
+                    mark[u] = 0;
+                }
+                double density = weight / static_cast<double>(group.size());
+                // 相同时保持原来的先后，减少不必要的移动
+                if (density > bestDensity)
+                {
+                    bestDensity = density;
+                    bestGroup.swap(group);
+                }
+            }
+            // 原顺序满足所有先后关系，按原位置排序即为合法的放置顺序
+            std::sort(bestGroup.begin(), bestGroup.end());
+            for (size_t u : bestGroup)
+            {
+                placed[u] = 1;
+                order.push_back(u);
+            }
+            remaining -= bestGroup.size();
+        }
+    }
+    return order;
+}
+
+std::string PathOrderOptimizer::formatReport(const std::vector<std::string> &entryNames, const std::vector<size_t> &proposed,
+                                             size_t unresolvedCommands, double unresolvedUsage) const
+{
+    std::vector<size_t> current(entryCount);
+    for (size_t i = 0; i < entryCount; i++)
+    {
+        current[i] = i;
+    }
+    double before = expectedProbes(current);
+    double after = expectedProbes(proposed);
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "使用记录中可在PATH中找到的命令 " << commands.size() << " 个，共 " << totalWeight << " 次启动\n";
+    if (unresolvedCommands > 0)
+    {
+        out << "另有 " << unresolvedCommands << " 个命令（" << unresolvedUsage
+            << " 次）在PATH中找不到（内建命令、别名或已卸载），与顺序无关，不计入\n";
+    }
+    out << "每个目录找不到时尝试 " << probesPerMiss << " 个文件\n\n";
+    out << "当前顺序：平均每次启动尝试 " << before << " 个文件\n";
+    out << "建议顺序：平均每次启动尝试 " << after << " 个文件";
+    if (before > 0)
+    {
+        out << "（减少 " << (before - after) * 100.0 / before << "%）";
+    }
+    out << "\n所有同名命令的先后关系保持不变，每个命令运行的文件不变\n\n";
+
+    out << "建议顺序:\n";
+    for (size_t i = 0; i < proposed.size(); i++)
+    {
+        size_t entry = proposed[i];
+        out << std::setw(4) << i + 1 << ". ";
+        if (entry != i)
+            out << "(原 " << entry + 1 << ") ";
+        out << entryNames[entry];
+        if (entryWeight[entry] > 0)
+            out << "    命中 " << entryWeight[entry] << " 次";
+        out << "\n";
+    }
+
+    // 当前顺序下开销最大的命令
+    std::vector<const Command_t *> costly;
+    for (const auto &command : commands)
+    {
+        costly.push_back(&command);
+    }
+    auto cost = [this](const Command_t *c) {
+        return c->weight * static_cast<double>(probesPerMiss * c->winner + c->probes);
+    };
+    std::sort(costly.begin(), costly.end(), [&cost](const Command_t *a, const Command_t *b) {
+        return cost(a) > cost(b);
+    });
+    if (costly.size() > 20)
+    {
+        costly.resize(20);
+    }
+    out << "\n当前顺序下开销最大的命令:\n";
+    for (const Command_t *c : costly)
+    {
+        out << "  " << std::left << std::setw(24) << c->name << std::right
+            << c->weight << " 次，每次尝试 " << probesPerMiss * c->winner + c->probes << " 个文件\n";
+    }
+    return out.str();
+}
+
+void PathOrderOptimizer::parseUsageHistory(std::istream &in, std::unordered_map<std::string, double> &usage)
+{
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        // zsh扩展历史 ": 1700000000:0;command"
+        if (line.size() > 2 && line[0] == ':' && line[1] == ' ')
+        {
+            size_t semi = line.find(';');
+            line = semi == std::string::npos ? std::string() : line.substr(semi + 1);
+        }
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+
+        double count = 1.0;
+        // "次数 命令" 形式的统计
+        size_t digitsEnd = line.find_first_not_of("0123456789", start);
+        if (digitsEnd != std::string::npos && digitsEnd > start && (line[digitsEnd] == ' ' || line[digitsEnd] == '\t'))
+        {
+            size_t next = line.find_first_not_of(" \t", digitsEnd);
+            if (next != std::string::npos)
+            {
+                count = std::stod(line.substr(start, digitsEnd - start));
+                start = next;
+            }
+        }
+
+        // 第一个词，可能带引号
+        std::string word;
+        if (line[start] == '"' || line[start] == '\'')
+        {
+            size_t close = line.find(line[start], start + 1);
+            word = line.substr(start + 1, close == std::string::npos ? std::string::npos : close - start - 1);
+        }
+        else
+        {
+            size_t end = line.find_first_of(" \t|;&", start);
+            word = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        }
+        // 带路径的调用不搜索PATH
+        if (!word.empty() && word.find_first_of("\\/") == std::string::npos)
+            usage[word] += count;
+    }
+}
@@ -0,0 +1,688 @@
+#include "path_policy.hpp"
+#include "path_state_store.hpp"
+#include "path_utils.hpp"
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+PathPolicy::PathPolicy()
+    : blockApply(false), maskWords(0), checked(false), models{nullptr, nullptr}, subscriptions{0, 0}, violationTotal(0),
+      errorTotal(0), listDirty(false)
+{
+}
+
+PathPolicy::~PathPolicy()
+{
+    attach(nullptr, nullptr);
+}
+
+void PathPolicy::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+    invalidate();
+}
+
+PathPolicy::Glob PathPolicy::compileGlob(const std::string &pattern)
+{
+    Glob glob;
+    glob.leadingStar = !pattern.empty() && pattern.front() == '*';
+    glob.trailingStar = !pattern.empty() && pattern.back() == '*';
+    std::string piece;
+    for (char c : pattern)
+    {
+        if (c == '*')
+        {
+            if (!piece.empty())
+                glob.pieces.push_back(piece);
+            piece.clear();
+        }
+        else
+        {
+            piece.push_back(c);
+        }
+    }
+    if (!piece.empty())
+        glob.pieces.push_back(piece);
+    return glob;
+}
+
+bool PathPolicy::matchPiece(const std::string &text, size_t pos, const std::string &piece)
+{
+    if (pos + piece.size() > text.size())
+        return false;
+    for (size_t i = 0; i < piece.size(); i++)
+    {
+        if (piece[i] != '?' && piece[i] != text[pos + i])
+            return false;
+    }
+    return true;
+}
+
+// 第一段固定在开头、最后一段固定在结尾，中间各段取最左的位置，不需要回溯
+bool PathPolicy::matchGlob(const Glob &glob, const std::string &text)
+{
+    if (glob.pieces.empty())
+        return glob.leadingStar || text.empty();
+    size_t first = 0;
+    size_t last = glob.pieces.size();
+    size_t pos = 0;
+    size_t end = text.size();
+    if (!glob.leadingStar)
+    {
+        if (!matchPiece(text, 0, glob.pieces[0]))
+            return false;
+        pos = glob.pieces[0].size();
+        first = 1;
+        if (glob.pieces.size() == 1 && !glob.trailingStar)
+            return pos == text.size();
+    }
+    if (!glob.trailingStar && last > first)
+    {
+        const std::string &tail = glob.pieces[last - 1];
+        if (tail.size() > end - pos || !matchPiece(text, end - tail.size(), tail))
+            return false;
+        end -= tail.size();
+        last--;
+    }
+    for (size_t p = first; p < last; p++)
+    {
+        const std::string &piece = glob.pieces[p];
+        bool found = false;
+        for (; pos + piece.size() <= end; pos++)
+        {
+            if (matchPiece(text, pos, piece))
+            {
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+            return false;
+        pos += piece.size();
+    }
+    return true;
+}
+
+void PathPolicy::compilePatterns()
+{
+    globs.clear();
+    globs.reserve(rawPatterns.size());
+    for (const auto &pattern : rawPatterns)
+    {
+        globs.push_back(compileGlob(normalizePathKey(expander ? expander(pattern) : pattern)));
+    }
+    maskWords = (rawPatterns.size() + 63) / 64;
+}
+
+void PathPolicy::invalidate()
+{
+    compilePatterns();
+    maskCache.clear();
+    // 镜像中的位图指向缓存，规则也可能变了，下次检查时全部重建
+    checked = false;
+    rowStates[0].clear();
+    rowStates[1].clear();
+    missing.clear();
+    requireCounts.clear();
+    violationTotal = 0;
+    errorTotal = 0;
+    listDirty = true;
+}
+
+// 按空白切分，双引号内的空白保留
+static bool tokenize(const std::string &line, std::vector<std::string> &tokens)
+{
+    tokens.clear();
+    size_t i = 0;
+    while (i < line.size())
+    {
+        if (line[i] == ' ' || line[i] == '\t')
+        {
+            i++;
+            continue;
+        }
+        if (line[i] == '#')
+            break;
+        std::string token;
+        if (line[i] == '"')
+        {
+            size_t close = line.find('"', i + 1);
+            if (close == std::string::npos)
+                return false;
+            token = line.substr(i + 1, close - i - 1);
+            i = close + 1;
+        }
+        else
+        {
+            while (i < line.size() && line[i] != ' ' && line[i] != '\t')
+                token.push_back(line[i++]);
+        }
+        tokens.push_back(token);
+    }
+    return true;
+}
+
+bool PathPolicy::compile(const std::string &text, std::string &error)
+{
+    std::vector<std::string> patterns;
+    std::vector<PolicyRule_t> parsed;
+    bool block = false;
+    std::istringstream in(text);
+    std::string line;
+    std::vector<std::string> tokens;
+    for (size_t lineNumber = 1; std::getline(in, line); lineNumber++)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        auto fail = [&error, lineNumber](const std::string &reason) {
+            error = "第" + std::to_string(lineNumber) + "行：" + reason;
+            return false;
+        };
+        if (!tokenize(line, tokens))
+            return fail("引号不成对");
+        if (tokens.empty())
+            continue;
+        if (tokens.size() == 1 && tokens[0] == "block-apply")
+        {
+            block = true;
+            continue;
+        }
+        if (tokens[0] != "error" && tokens[0] != "warn")
+            return fail("规则应以 error 或 warn 开头");
+        if (tokens.size() < 3)
+            return fail("缺少规则类型或模式");
+        PolicyRule_t rule;
+        rule.error = tokens[0] == "error";
+        rule.line = lineNumber;
+        size_t next = 2;
+        if (tokens[1] == "first")
+            rule.kind = RULE_FIRST;
+        else if (tokens[1] == "require")
+            rule.kind = RULE_REQUIRE;
+        else if (tokens[1] == "forbid")
+            rule.kind = RULE_FORBID;
+        else if (tokens[1] == "order")
+            rule.kind = RULE_ORDER;
+        else
+            return fail("未知的规则类型 " + tokens[1]);
+        rule.scope = 0;
+        if (tokens[next] == "system" || tokens[next] == "user")
+        {
+            rule.scope = tokens[next] == "system" ? 1 : 2;
+            next++;
+        }
+        size_t needed = rule.kind == RULE_ORDER ? 2 : 1;
+        if (tokens.size() - next != needed)
+            return fail(rule.kind == RULE_ORDER ? "order 需要两个模式" : "需要一个模式");
+        rule.pattern = patterns.size();
+        patterns.push_back(tokens[next]);
+        rule.other = npos;
+        if (rule.kind == RULE_ORDER)
+        {
+            rule.other = patterns.size();
+            patterns.push_back(tokens[next + 1]);
+        }
+        size_t begin = line.find_first_not_of(" \t");
+        size_t endPos = line.find_last_not_of(" \t");
+        rule.text = line.substr(begin, endPos - begin + 1);
+        parsed.push_back(std::move(rule));
+    }
+    rawPatterns = std::move(patterns);
+    rules = std::move(parsed);
+    blockApply = block;
+    invalidate();
+    return true;
+}
+
+bool PathPolicy::load(const fs::path &file, std::string &error)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in)
+    {
+        error = "无法读取文件";
+        return false;
+    }
+    std::ostringstream text;
+    text << in.rdbuf();
+    if (!compile(text.str(), error))
+        return false;
+    sourceFile = file;
+    return true;
+}
+
+const fs::path &PathPolicy::filePath() const
+{
+    return sourceFile;
+}
+
+void PathPolicy::clear()
+{
+    rawPatterns.clear();
+    rules.clear();
+    blockApply = false;
+    sourceFile.clear();
+    invalidate();
+}
+
+const std::vector<uint64_t> &PathPolicy::maskOf(const std::string &rawPath)
+{
+    auto it = maskCache.find(rawPath);
+    if (it != maskCache.end())
+        return it->second;
+    std::string key = normalizePathKey(expander ? expander(rawPath) : rawPath);
+    std::vector<uint64_t> mask(maskWords, 0);
+    for (size_t p = 0; p < globs.size(); p++)
+    {
+        if (matchGlob(globs[p], key))
+            mask[p / 64] |= uint64_t(1) << (p % 64);
+    }
+    return maskCache.emplace(rawPath, std::move(mask)).first->second;
+}
+
+void PathPolicy::measure(const PathListModel &model, size_t index, Row &row)
+{
+    const EnvPathItem_t &item = model.at(index);
+    row.active = !model.isDeleted(index) && item.enabled;
+    row.mask = maskOf(item.path).data();
+}
+
+static bool matches(const uint64_t *mask, size_t pattern)
+{
+    return (mask[pattern / 64] >> (pattern % 64)) & 1;
+}
+
+static bool inScope(const PathPolicy::PolicyRule_t &rule, int side)
+{
+    return rule.scope == 0 || rule.scope == side + 1;
+}
+
+void PathPolicy::setViolation(int side, size_t index, size_t rule, bool on)
+{
+    uint64_t &word = rowStates[side][index].rules[rule / 64];
+    uint64_t bit = uint64_t(1) << (rule % 64);
+    if (((word & bit) != 0) == on)
+        return;
+    word ^= bit;
+    on ? violationTotal++ : violationTotal--;
+    if (rules[rule].error)
+        on ? errorTotal++ : errorTotal--;
+    listDirty = true;
+}
+
+void PathPolicy::setMissing(size_t rule, bool on)
+{
+    if ((missing[rule] != 0) == on)
+        return;
+    missing[rule] = on;
+    on ? violationTotal++ : violationTotal--;
+    if (rules[rule].error)
+        on ? errorTotal++ : errorTotal--;
+    listDirty = true;
+}
+
+// 不满足的只可能是生效顺序中第一个启用的行；变化的那一行之外，它在变化后排第一或第二
+void PathPolicy::checkFirst(size_t r)
+{
+    const PolicyRule_t &rule = rules[r];
+    int found = 0;
+    for (int side = 0; side < 2 && found < 2; side++)
+    {
+        if (!inScope(rule, side))
+            continue;
+        for (size_t i = 0; i < rowStates[side].size() && found < 2; i++)
+        {
+            const Row &row = rowStates[side][i];
+            if (!row.active)
+                continue;
+            setViolation(side, i, r, found == 0 && !matches(row.mask, rule.pattern));
+            found++;
+        }
+    }
+    setMissing(r, found == 0);
+}
+
+// 从后往前扫描：后面还有匹配前者的条目时，匹配后者的条目排错了位置
+void PathPolicy::checkOrder(size_t r)
+{
+    const PolicyRule_t &rule = rules[r];
+    bool laterFirst = false;
+    for (int side = 1; side >= 0; side--)
+    {
+        if (!inScope(rule, side))
+            continue;
+        for (size_t i = rowStates[side].size(); i-- > 0;)
+        {
+            const Row &row = rowStates[side][i];
+            bool first = row.active && matches(row.mask, rule.pattern);
+            setViolation(side, i, r, row.active && laterFirst && !first && matches(row.mask, rule.other));
+            laterFirst = laterFirst || first;
+        }
+    }
+}
+
+void PathPolicy::checkRule(size_t r)
+{
+    const PolicyRule_t &rule = rules[r];
+    switch (rule.kind)
+    {
+    case RULE_FIRST:
+        checkFirst(r);
+        break;
+    case RULE_ORDER:
+        checkOrder(r);
+        break;
+    case RULE_REQUIRE:
+    case RULE_FORBID:
+    {
+        size_t count = 0;
+        for (int side = 0; side < 2; side++)
+        {
+            if (!inScope(rule, side))
+                continue;
+            for (size_t i = 0; i < rowStates[side].size(); i++)
+            {
+                const Row &row = rowStates[side][i];
+                bool hit = row.active && matches(row.mask, rule.pattern);
+                if (rule.kind == RULE_FORBID)
+                    setViolation(side, i, r, hit);
+                count += hit;
+            }
+        }
+        if (rule.kind == RULE_REQUIRE)
+        {
+            requireCounts[r] = count;
+            setMissing(r, count == 0);
+        }
+        break;
+    }
+    }
+}
+
+void PathPolicy::checkRow(int side, size_t index, bool wasActive, const uint64_t *oldMask)
+{
+    const Row &row = rowStates[side][index];
+    for (size_t r = 0; r < rules.size(); r++)
+    {
+        const PolicyRule_t &rule = rules[r];
+        if (!inScope(rule, side))
+            continue;
+        bool was = wasActive && matches(oldMask, rule.pattern);
+        bool is = row.active && matches(row.mask, rule.pattern);
+        switch (rule.kind)
+        {
+        case RULE_FORBID:
+            setViolation(side, index, r, is);
+            break;
+        case RULE_REQUIRE:
+            if (was != is)
+            {
+                requireCounts[r] = is ? requireCounts[r] + 1 : requireCounts[r] - 1;
+                setMissing(r, requireCounts[r] == 0);
+            }
+            break;
+        case RULE_FIRST:
+            if (wasActive || row.active)
+            {
+                setViolation(side, index, r, false);
+                checkFirst(r);
+            }
+            break;
+        case RULE_ORDER:
+            if (was || is || (wasActive && matches(oldMask, rule.other)) || (row.active && matches(row.mask, rule.other)))
+                checkOrder(r);
+            break;
+        }
+    }
+}
+
+void PathPolicy::rebuild(const PathListModel &system, const PathListModel &user)
+{
+    checkedSystem = system.list();
+    checkedUser = user.list();
+    checked = true;
+    violationTotal = 0;
+    errorTotal = 0;
+    listDirty = true;
+    missing.assign(rules.size(), 0);
+    requireCounts.assign(rules.size(), 0);
+    size_t ruleWords = (rules.size() + 63) / 64;
+    for (int side = 0; side < 2; side++)
+    {
+        const PathListModel &model = side == 0 ? system : user;
+        std::vector<Row> &rows = rowStates[side];
+        rows.clear();
+        if (rules.empty())
+            continue;
+        rows.resize(model.size());
+        for (size_t i = 0; i < rows.size(); i++)
+        {
+            // 每行取一次位图
+            measure(model, i, rows[i]);
+            rows[i].rules.assign(ruleWords, 0);
+        }
+    }
+    for (size_t r = 0; r < rules.size(); r++)
+    {
+        checkRule(r);
+    }
+}
+
+bool PathPolicy::evaluate(const PathListModel &system, const PathListModel &user)
+{
+    if (checked && checkedSystem.sameAs(system.list()) && checkedUser.sameAs(user.list()))
+    {
+        return false;
+    }
+    rebuild(system, user);
+    return true;
+}
+
+void PathPolicy::attach(PathListModel *system, PathListModel *user)
+{
+    for (int side = 0; side < 2; side++)
+    {
+        if (models[side])
+            models[side]->unsubscribe(subscriptions[side]);
+        models[side] = side == 0 ? system : user;
+        if (models[side])
+            subscriptions[side] = models[side]->subscribe(
+                [this, side](const PathListChange_t &change) { onModelChange(side, change); });
+    }
+    checked = false;
+}
+
+void PathPolicy::onModelChange(int side, const PathListChange_t &change)
+{
+    const PathListModel &system = *models[0];
+    const PathListModel &user = *models[1];
+    // 规则或变量变化后还没有检查过，位图缓存已清空，只能全部重新检查
+    if (!checked || change.kind == PathListChange_t::RESET || change.kind == PathListChange_t::COMPACT)
+    {
+        rebuild(system, user);
+        return;
+    }
+    checkedSystem = system.list();
+    checkedUser = user.list();
+    if (rules.empty())
+    {
+        return;
+    }
+    listDirty = true; // 插入和移动不改变位图，但后面各行的下标变了
+
+    const PathListModel &model = side == 0 ? system : user;
+    std::vector<Row> &rows = rowStates[side];
+    switch (change.kind)
+    {
+    case PathListChange_t::INSERT:
+    {
+        Row row;
+        measure(model, change.index, row);
+        row.rules.assign((rules.size() + 63) / 64, 0);
+        rows.insert(rows.begin() + change.index, std::move(row));
+        checkRow(side, change.index, false, nullptr);
+        break;
+    }
+    case PathListChange_t::REMOVE:
+    case PathListChange_t::RESTORE:
+    case PathListChange_t::TOGGLE:
+    case PathListChange_t::EDIT:
+    {
+        // 变化前的状态记在镜像中
+        bool wasActive = rows[change.index].active;
+        const uint64_t *oldMask = rows[change.index].mask;
+        measure(model, change.index, rows[change.index]);
+        checkRow(side, change.index, wasActive, oldMask);
+        break;
+    }
+    case PathListChange_t::MOVE:
+    {
+        // 启用状态和匹配结果随行移动，只有与顺序有关的规则需要重查
+        Row row = std::move(rows[change.index]);
+        rows.erase(rows.begin() + change.index);
+        rows.insert(rows.begin() + change.toIndex, std::move(row));
+        const Row &moved = rows[change.toIndex];
+        if (!moved.active)
+            break;
+        for (size_t r = 0; r < rules.size(); r++)
+        {
+            const PolicyRule_t &rule = rules[r];
+            if (!inScope(rule, side))
+                continue;
+            if (rule.kind == RULE_FIRST)
+            {
+                setViolation(side, change.toIndex, r, false);
+                checkFirst(r);
+            }
+            else if (rule.kind == RULE_ORDER && (matches(moved.mask, rule.pattern) || matches(moved.mask, rule.other)))
+            {
+                checkOrder(r);
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool PathPolicy::empty() const
+{
+    return rules.empty();
+}
+
+size_t PathPolicy::ruleCount() const
+{
+    return rules.size();
+}
+
+const std::vector<PathPolicy::PolicyRule_t> &PathPolicy::ruleList() const
+{
+    return rules;
+}
+
+// 按规则排列，同一规则内按生效顺序；只在报告和应用时用到，修改时只维护计数
+const std::vector<PathPolicy::PolicyViolation_t> &PathPolicy::violationList() const
+{
+    if (!listDirty)
+        return violations;
+    std::vector<std::vector<PolicyViolation_t>> byRule(rules.size());
+    for (size_t r = 0; r < missing.size(); r++)
+    {
+        if (missing[r])
+            byRule[r].push_back(PolicyViolation_t{r, rules[r].scope == 2, npos});
+    }
+    for (int side = 0; side < 2; side++)
+    {
+        for (size_t i = 0; i < rowStates[side].size(); i++)
+        {
+            const std::vector<uint64_t> &bits = rowStates[side][i].rules;
+            for (size_t w = 0; w < bits.size(); w++)
+            {
+                for (size_t b = 0; b < 64 && bits[w] >> b != 0; b++)
+                {
+                    if ((bits[w] >> b) & 1)
+                        byRule[w * 64 + b].push_back(PolicyViolation_t{w * 64 + b, side == 1, i});
+                }
+            }
+        }
+    }
+    violations.clear();
+    violations.reserve(violationTotal);
+    for (const auto &list : byRule)
+    {
+        violations.insert(violations.end(), list.begin(), list.end());
+    }
+    listDirty = false;
+    return violations;
+}
+
+size_t PathPolicy::violationCount() const
+{
+    return violationTotal;
+}
+
+size_t PathPolicy::errorCount() const
+{
+    return errorTotal;
+}
+
+bool PathPolicy::blocksApply() const
+{
+    return blockApply && errorCount() > 0;
+}
+
+const PathPolicy::PolicyRule_t *PathPolicy::violationAt(size_t index, bool user) const
+{
+    // 标出第一条不满足的规则
+    const std::vector<Row> &rows = rowStates[user ? 1 : 0];
+    if (index >= rows.size())
+        return nullptr;
+    const std::vector<uint64_t> &bits = rows[index].rules;
+    for (size_t w = 0; w < bits.size(); w++)
+    {
+        if (bits[w] == 0)
+            continue;
+        size_t r = w * 64;
+        for (uint64_t word = bits[w]; (word & 1) == 0; word >>= 1)
+            r++;
+        return &rules[r];
+    }
+    return nullptr;
+}
+
+std::string PathPolicy::formatReport() const
+{
+    std::ostringstream out;
+    out << "规则文件: " << (sourceFile.empty() ? std::string("（未加载）") : sourceFile.string()) << "\n";
+    out << "规则 " << rules.size() << " 条，不满足 " << violations.size() << " 处（error级 " << errorCount() << "）";
+    if (blockApply)
+        out << "，error级规则不满足时拒绝应用";
+    out << "\n\n";
+    if (violations.empty())
+    {
+        out << "全部满足\n";
+        return out.str();
+    }
+    for (const auto &violation : violations)
+    {
+        const PolicyRule_t &rule = rules[violation.rule];
+        out << (rule.error ? "[error] " : "[warn]  ") << "第" << rule.line << "行 " << rule.text << "\n";
+        if (violation.index == npos)
+        {
+            out << "        没有满足条件的条目\n";
+        }
+        else
+        {
+            const PersistentPathList &list = violation.user ? checkedUser : checkedSystem;
+            out << "        " << (violation.user ? "用户" : "系统") << " " << list.at(violation.index).path << "\n";
+        }
+    }
+    return out.str();
+}
+
+fs::path PathPolicy::defaultFilePath()
+{
+    fs::path state = PathStateStore::defaultFilePath();
+    return state.empty() ? fs::path() : state.parent_path() / "policy.rules";
+}
@@ -0,0 +1,310 @@
+#include "path_rewriter.hpp"
+#include <cctype>
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+
+static char lowerAscii(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+PathRewriter::PathRewriter() : compiled(false), useRegex(false), ignoreCase(false), stats{0, 0, 0.0}
+{
+}
+
+bool PathRewriter::compile(const std::string &find, const std::string &replace, bool regex, bool caseInsensitive,
+                           std::string &error)
+{
+    if (find.empty())
+    {
+        error = "查找内容为空";
+        return false;
+    }
+    std::regex compiledPattern;
+    if (regex)
+    {
+        auto flags = std::regex::ECMAScript | std::regex::optimize;
+        if (caseInsensitive)
+            flags |= std::regex::icase;
+        try
+        {
+            compiledPattern.assign(find, flags);
+        }
+        catch (const std::regex_error &e)
+        {
+            error = std::string("正则表达式有误：") + e.what();
+            return false;
+        }
+    }
+    pattern = std::move(compiledPattern);
+    compiled = true;
+    useRegex = regex;
+    ignoreCase = caseInsensitive;
+    findText = find;
+    replacement = replace;
+    literal = regex ? requiredLiteral(find) : find;
+    if (ignoreCase)
+    {
+        for (char &c : literal)
+        {
+            c = lowerAscii(c);
+        }
+        // 正则引擎对非ASCII字母的大小写处理与预筛不同，这时不预筛
+        auto nonAscii = [](char c) { return static_cast<unsigned char>(c) >= 0x80; };
+        if (regex && std::any_of(literal.begin(), literal.end(), nonAscii))
+            literal.clear();
+    }
+    rewrites.clear();
+    return true;
+}
+
+// 只看最外层：分组和字符类里的内容不一定出现，带 * ? {} 的字符可以不出现，
+// 最外层有'|'时没有必须出现的文本
+std::string PathRewriter::requiredLiteral(const std::string &regexText)
+{
+    std::string best;
+    std::string run;
+    auto finish = [&best, &run]() {
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    };
+    int depth = 0;
+    size_t n = regexText.size();
+    for (size_t i = 0; i < n; i++)
+    {
+        char c = regexText[i];
+        if (c == '[')
+        {
+            // 开头的']'属于字符类本身
+            finish();
+            size_t j = i + 1;
+            if (j < n && regexText[j] == '^')
+                j++;
+            if (j < n && regexText[j] == ']')
+                j++;
+            while (j < n && regexText[j] != ']')
+            {
+                j += regexText[j] == '\\' ? 2 : 1;
+            }
+            i = j;
+            continue;
+        }
+        if (c == '(')
+        {
+            finish();
+            depth++;
+            continue;
+        }
+        if (c == ')')
+        {
+            finish();
+            depth = depth > 0 ? depth - 1 : 0;
+            continue;
+        }
+        if (depth > 0)
+        {
+            if (c == '\\')
+                i++;
+            continue;
+        }
+        if (c == '|')
+            return std::string();
+        if (c == '{')
+        {
+            finish();
+            while (i < n && regexText[i] != '}')
+                i++;
+            continue;
+        }
+        if (c == '.' || c == '^' || c == '$' || c == '*' || c == '+' || c == '?')
+        {
+            finish();
+            continue;
+        }
+        size_t next = i + 1;
+        if (c == '\\')
+        {
+            // \d \w \b \1 等是字符类、断言或反向引用，其余转义的标点按字面匹配
+            if (next >= n || isalnum(static_cast<unsigned char>(regexText[next])))
+            {
+                finish();
+                i = next;
+                continue;
+            }
+            c = regexText[next++];
+        }
+        char quantifier = next < n ? regexText[next] : '\0';
+        if (quantifier == '*' || quantifier == '?' || quantifier == '{')
+        {
+            finish();
+        }
+        else
+        {
+            run += c;
+            if (quantifier == '+')
+                finish();
+        }
+        i = next - 1;
+    }
+    finish();
+    return best;
+}
+
+const std::string &PathRewriter::prefilter() const
+{
+    return literal;
+}
+
+size_t PathRewriter::findLiteral(const std::string &text, const std::string &needle, size_t from) const
+{
+    if (!ignoreCase)
+        return text.find(needle, from);
+    auto it = std::search(text.begin() + from, text.end(), needle.begin(), needle.end(),
+                          [](char a, char b) { return lowerAscii(a) == b; });
+    return it == text.end() ? std::string::npos : static_cast<size_t>(it - text.begin());
+}
+
+bool PathRewriter::rewriteCandidate(const std::string &path, std::string &out) const
+{
+    if (useRegex)
+    {
+        out = std::regex_replace(path, pattern, replacement);
+        return out != path;
+    }
+    // 字面模式：literal就是（ignoreCase时小写的）查找文本
+    out.clear();
+    size_t start = 0;
+    size_t pos;
+    while ((pos = findLiteral(path, literal, start)) != std::string::npos)
+    {
+        out.append(path, start, pos - start);
+        out += replacement;
+        start = pos + literal.size();
+    }
+    if (start == 0)
+        return false;
+    out.append(path, start, std::string::npos);
+    return out != path;
+}
+
+bool PathRewriter::rewrite(const std::string &path, std::string &out) const
+{
+    if (!compiled || (!literal.empty() && findLiteral(path, literal, 0) == std::string::npos))
+        return false;
+    return rewriteCandidate(path, out);
+}
+
+void PathRewriter::planModel(const PathListModel &model, bool user)
+{
+    // 同一写法在表格中重复出现时只改写一次
+    std::unordered_map<std::string, std::string> results;
+    std::string out;
+    model.list().forEachLive([&](size_t index, const EnvPathItem_t &item) {
+        const std::string &path = item.path;
+        stats.scanned++;
+        if (!literal.empty() && findLiteral(path, literal, 0) == std::string::npos)
+            return;
+        stats.candidates++;
+        auto found = results.find(path);
+        if (found == results.end())
+        {
+            if (!rewriteCandidate(path, out))
+                out = path;
+            found = results.emplace(path, out).first;
+        }
+        if (found->second != path)
+            rewrites.push_back(Rewrite_t{user, index, path, found->second});
+    });
+}
+
+size_t PathRewriter::plan(const PathListModel &system, const PathListModel &user)
+{
+    auto start = std::chrono::steady_clock::now();
+    rewrites.clear();
+    stats = RewriteStats_t{0, 0, 0.0};
+    plannedSystem = system.list();
+    plannedUser = user.list();
+    if (compiled)
+    {
+        planModel(system, false);
+        planModel(user, true);
+    }
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return rewrites.size();
+}
+
+const std::vector<PathRewriter::Rewrite_t> &PathRewriter::rewriteList() const
+{
+    return rewrites;
+}
+
+const PathRewriter::RewriteStats_t &PathRewriter::lastStats() const
+{
+    return stats;
+}
+
+bool PathRewriter::commit(PathListModel &system, PathListModel &user, PathTags *tags) const
+{
+    if (!system.list().sameAs(plannedSystem) || !user.list().sameAs(plannedUser))
+        return false;
+    std::vector<std::pair<size_t, std::string>> edits[2];
+    for (const auto &rewrite : rewrites)
+    {
+        edits[rewrite.user ? 1 : 0].emplace_back(rewrite.index, rewrite.after);
+    }
+    PathListModel::beginLinkedBatch(system, user);
+    system.setPaths(edits[0]);
+    user.setPaths(edits[1]);
+    PathListModel::endLinkedBatch(system, user);
+    if (tags)
+    {
+        // 标签按规范化写法记录，改写后要改记到新写法上；标签的修改计数变化，状态文件随之需要保存
+        std::vector<std::pair<std::string, std::string>> renames;
+        renames.reserve(rewrites.size());
+        for (const auto &rewrite : rewrites)
+        {
+            renames.emplace_back(rewrite.before, rewrite.after);
+        }
+        tags->rename(renames);
+    }
+    return true;
+}
+
+std::string PathRewriter::formatPreview(size_t maxRows) const
+{
+    std::ostringstream out;
+    out << (useRegex ? "正则表达式 " : "查找 ") << findText << "  →  " << replacement
+        << (ignoreCase ? "（不区分大小写）" : "") << "\n";
+    out << "检查 " << stats.scanned << " 个条目，" << stats.candidates << " 个含有 \""
+        << (literal.empty() ? std::string("（不预筛）") : literal) << "\"，改写 " << rewrites.size() << " 个，用时 "
+        << stats.milliseconds << " 毫秒\n";
+    size_t shown = 0;
+    for (int side = 0; side < 2; side++)
+    {
+        bool header = false;
+        for (const auto &rewrite : rewrites)
+        {
+            if (rewrite.user != (side == 1) || shown >= maxRows)
+                continue;
+            if (!header)
+            {
+                out << (side == 0 ? "\n系统Path:\n" : "\n用户Path:\n");
+                header = true;
+            }
+            out << "  - " << rewrite.before << "\n  + " << rewrite.after << "\n";
+            shown++;
+        }
+    }
+    if (shown < rewrites.size())
+    {
+        out << "\n……另有 " << rewrites.size() - shown << " 个条目未列出\n";
+    }
+    if (rewrites.empty())
+    {
+        out << "\n没有需要改写的条目\n";
+    }
+    return out.str();
+}
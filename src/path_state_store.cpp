@@ -0,0 +1,411 @@
+#include "path_state_store.hpp"
+#include "path_utils.hpp"
+#include <fstream>
+#include <cstdlib>
+#include <unordered_map>
+#include <unordered_set>
+#include "nlohmann/json.hpp"
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+PathStateStore::PathStateStore() : systemModel(nullptr), userModel(nullptr), systemSubscription(0), userSubscription(0), dirty(false), savedTags(0)
+{
+}
+
+PathStateStore::~PathStateStore()
+{
+    detach();
+}
+
+fs::path PathStateStore::defaultFilePath()
+{
+#ifdef _WIN32
+    // 获取用户目录
+    char *userProfile = nullptr;
+    size_t len = 0;
+    if (_dupenv_s(&userProfile, &len, "USERPROFILE") != 0 || userProfile == nullptr)
+    {
+        return fs::path();
+    }
+
+    // 使用 userProfile
+    fs::path appDataPath = fs::path(userProfile) / "AppData/Local/QuickManPath";
+
+    // 释放分配的内存
+    free(userProfile);
+#else
+    const char *home = std::getenv("HOME");
+    if (home == nullptr)
+    {
+        return fs::path();
+    }
+    fs::path appDataPath = fs::path(home) / ".local/share/QuickManPath";
+#endif
+    return appDataPath / "pathVars.json";
+}
+
+// 读取一侧的条目；返回是否保留了顺序（缺少这一项时视为空表）
+static bool readEntries(const json &pathData, const char *key, std::vector<EnvPathItem_t> &paths)
+{
+    paths.clear();
+    auto it = pathData.find(key);
+    if (it == pathData.end())
+    {
+        return true;
+    }
+    if (it->is_array())
+    {
+        for (const auto &entry : *it)
+        {
+            if (!entry.is_object())
+                continue;
+            auto path = entry.find("path");
+            if (path == entry.end() || !path->is_string())
+                continue;
+            auto enabled = entry.find("enabled");
+            paths.push_back(EnvPathItem_t{path->get<std::string>(),
+                                          enabled == entry.end() || !enabled->is_boolean() || enabled->get<bool>()});
+        }
+        return true;
+    }
+    // 旧版本的 {路径: 是否启用}，按键排序
+    if (it->is_object())
+    {
+        for (const auto &item : it->items())
+        {
+            if (item.value().is_boolean())
+                paths.push_back(EnvPathItem_t{item.key(), item.value().get<bool>()});
+        }
+    }
+    return false;
+}
+
+static json writeEntries(const std::vector<EnvPathItem_t> &paths)
+{
+    json entries = json::array();
+    for (const auto &item : paths)
+    {
+        entries.push_back({{"path", item.path}, {"enabled", item.enabled}});
+    }
+    return entries;
+}
+
+bool PathStateStore::readFile(const fs::path &file,
+                              std::vector<EnvPathItem_t> &systemPaths,
+                              std::vector<EnvPathItem_t> &userPaths,
+                              std::map<std::string, std::vector<std::string>> *tags,
+                              bool *ordered)
+{
+    std::ifstream inFile(file);
+    if (!inFile.is_open())
+    {
+        return false;
+    }
+    json pathData = json::parse(inFile, nullptr, false);
+    if (pathData.is_discarded() || !pathData.is_object())
+    {
+        return false;
+    }
+
+    // 从 JSON 数据中加载路径
+    bool systemOrdered = readEntries(pathData, "systemPaths", systemPaths);
+    bool userOrdered = readEntries(pathData, "userPaths", userPaths);
+    if (ordered)
+    {
+        *ordered = systemOrdered && userOrdered;
+    }
+    if (tags)
+    {
+        // 标签 -> 目录列表，旧版本的文件没有这一项
+        tags->clear();
+        auto it = pathData.find("tags");
+        if (it != pathData.end() && it->is_object())
+        {
+            for (const auto &tag : it->items())
+            {
+                if (!tag.value().is_array())
+                    continue;
+                std::vector<std::string> &paths = (*tags)[tag.key()];
+                for (const auto &path : tag.value())
+                {
+                    if (path.is_string())
+                        paths.push_back(path.get<std::string>());
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool PathStateStore::writeFile(const fs::path &file,
+                               const std::vector<EnvPathItem_t> &systemPaths,
+                               const std::vector<EnvPathItem_t> &userPaths,
+                               const std::map<std::string, std::vector<std::string>> *tags)
+{
+    // 写入 JSON 文件，条目按表中的顺序
+    json pathData = {
+        {"systemPaths", writeEntries(systemPaths)},
+        {"userPaths", writeEntries(userPaths)}};
+    if (tags && !tags->empty())
+    {
+        pathData["tags"] = *tags;
+    }
+    std::ofstream outFile(file);
+    if (!outFile.is_open())
+    {
+        return false;
+    }
+    outFile << pathData.dump(4); // 格式化输出
+    return outFile.good();
+}
+
+bool PathStateStore::readPathList(const fs::path &file,
+                                  std::vector<EnvPathItem_t> &systemPaths,
+                                  std::vector<EnvPathItem_t> &userPaths)
+{
+    std::ifstream inFile(file);
+    if (!inFile.is_open())
+    {
+        return false;
+    }
+    systemPaths.clear();
+    userPaths.clear();
+    std::vector<EnvPathItem_t> *section = &systemPaths; // 没有分节时都算系统路径
+    std::string line;
+    while (std::getline(inFile, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line == "[system]")
+        {
+            section = &systemPaths;
+            continue;
+        }
+        if (line == "[user]")
+        {
+            section = &userPaths;
+            continue;
+        }
+        bool enabled = true;
+        if (line.compare(0, 2, "# ") == 0)
+        {
+            enabled = false;
+            line.erase(0, 2);
+        }
+        if (line.empty() || line[0] == '#')
+            continue;
+        section->push_back(EnvPathItem_t{line, enabled});
+    }
+    return true;
+}
+
+bool PathStateStore::writePathList(const fs::path &file,
+                                   const std::vector<EnvPathItem_t> &systemPaths,
+                                   const std::vector<EnvPathItem_t> &userPaths)
+{
+    std::ofstream outFile(file);
+    if (!outFile.is_open())
+    {
+        return false;
+    }
+    outFile << "[system]\n";
+    for (const auto &item : systemPaths)
+    {
+        outFile << (item.enabled ? "" : "# ") << item.path << "\n";
+    }
+    outFile << "[user]\n";
+    for (const auto &item : userPaths)
+    {
+        outFile << (item.enabled ? "" : "# ") << item.path << "\n";
+    }
+    return outFile.good();
+}
+
+bool PathStateStore::readAnyFile(const fs::path &file,
+                                 std::vector<EnvPathItem_t> &systemPaths,
+                                 std::vector<EnvPathItem_t> &userPaths,
+                                 bool *ordered)
+{
+    if (toLowerAscii(file.extension().string()) != ".json")
+    {
+        if (ordered)
+        {
+            *ordered = true;
+        }
+        return readPathList(file, systemPaths, userPaths);
+    }
+    return readFile(file, systemPaths, userPaths, nullptr, ordered);
+}
+
+bool PathStateStore::isOrderedFile(const fs::path &file)
+{
+    std::vector<EnvPathItem_t> systemPaths;
+    std::vector<EnvPathItem_t> userPaths;
+    bool ordered = true;
+    return !readAnyFile(file, systemPaths, userPaths, &ordered) || ordered;
+}
+
+bool PathStateStore::open(const fs::path &file)
+{
+    jsonFilePath = file;
+    std::error_code ec;
+
+    // 如果目录不存在，则创建
+    fs::path appDataPath = file.parent_path();
+    if (!appDataPath.empty() && !fs::exists(appDataPath, ec))
+    {
+        fs::create_directories(appDataPath, ec);
+        if (ec)
+        {
+            return false;
+        }
+    }
+
+    // 如果文件不存在，则创建并写入默认内容
+    if (!fs::exists(file, ec))
+    {
+        return writeFile(file, std::vector<EnvPathItem_t>(), std::vector<EnvPathItem_t>());
+    }
+    return true;
+}
+
+const fs::path &PathStateStore::filePath() const
+{
+    return jsonFilePath;
+}
+
+bool PathStateStore::load(std::vector<EnvPathItem_t> &systemPaths, std::vector<EnvPathItem_t> &userPaths)
+{
+    std::map<std::string, std::vector<std::string>> tagData;
+    if (!readFile(jsonFilePath, systemPaths, userPaths, &tagData))
+    {
+        return false;
+    }
+    pathTags.assign(tagData);
+    savedTags = pathTags.changeCount();
+    return true;
+}
+
+bool PathStateStore::loadMerged(const std::vector<EnvPathItem_t> &registrySystem,
+                                const std::vector<EnvPathItem_t> &registryUser,
+                                std::vector<EnvPathItem_t> &systemPaths,
+                                std::vector<EnvPathItem_t> &userPaths)
+{
+    // 从 JSON 数据中加载路径，目录或文件不存在时创建默认内容
+    std::vector<EnvPathItem_t> fileSystem;
+    std::vector<EnvPathItem_t> fileUser;
+    bool ok = open(defaultFilePath()) && load(fileSystem, fileUser);
+
+    mergeEntries(registrySystem, fileSystem, systemPaths);
+    mergeEntries(registryUser, fileUser, userPaths);
+    return ok;
+}
+
+void PathStateStore::mergeEntries(const std::vector<EnvPathItem_t> &registry,
+                                  const std::vector<EnvPathItem_t> &file,
+                                  std::vector<EnvPathItem_t> &merged)
+{
+    std::unordered_set<std::string> inRegistry;
+    for (const auto &item : registry)
+    {
+        inRegistry.insert(item.path);
+    }
+
+    // 只在文件中的条目按它在文件中前面最近的注册表条目分组，排在那个条目之后；前面没有注册表条目的排在最前
+    std::unordered_map<std::string, std::vector<const EnvPathItem_t *>> after;
+    std::vector<const EnvPathItem_t *> leading;
+    std::unordered_set<std::string> seen;
+    const std::string *anchor = nullptr;
+    for (const auto &item : file)
+    {
+        if (inRegistry.count(item.path))
+        {
+            anchor = &item.path;
+            continue;
+        }
+        if (!seen.insert(item.path).second)
+            continue;
+        (anchor ? after[*anchor] : leading).push_back(&item);
+    }
+
+    merged.clear();
+    merged.reserve(registry.size() + seen.size());
+    for (const EnvPathItem_t *item : leading)
+    {
+        merged.push_back(*item);
+    }
+    for (const auto &item : registry)
+    {
+        merged.push_back(item);
+        auto it = after.find(item.path);
+        if (it == after.end())
+            continue;
+        // 注册表里重复的条目只在第一次出现处接上
+        for (const EnvPathItem_t *fileItem : it->second)
+        {
+            merged.push_back(*fileItem);
+        }
+        after.erase(it);
+    }
+}
+
+void PathStateStore::attach(PathListModel *system, PathListModel *user)
+{
+    detach();
+    systemModel = system;
+    userModel = user;
+    // 变化只是标记为脏，真正的序列化推迟到save()；墓碑本来就不写入文件，压缩不算修改
+    auto markDirty = [this](const PathListChange_t &change) {
+        if (change.kind != PathListChange_t::COMPACT)
+            dirty = true;
+    };
+    systemSubscription = systemModel->subscribe(markDirty);
+    userSubscription = userModel->subscribe(markDirty);
+}
+
+void PathStateStore::detach()
+{
+    if (systemModel)
+    {
+        systemModel->unsubscribe(systemSubscription);
+        systemModel = nullptr;
+    }
+    if (userModel)
+    {
+        userModel->unsubscribe(userSubscription);
+        userModel = nullptr;
+    }
+}
+
+bool PathStateStore::isDirty() const
+{
+    return dirty || pathTags.changeCount() != savedTags;
+}
+
+PathTags &PathStateStore::tags()
+{
+    return pathTags;
+}
+
+bool PathStateStore::save()
+{
+    if (!systemModel || !userModel)
+    {
+        return false;
+    }
+
+    // 获取当前路径数据
+    std::vector<EnvPathItem_t> systemPaths;
+    systemModel->toVector(systemPaths);
+    std::vector<EnvPathItem_t> userPaths;
+    userModel->toVector(userPaths);
+
+    if (!writeFile(jsonFilePath, systemPaths, userPaths, &pathTags.data()))
+    {
+        return false;
+    }
+    dirty = false;
+    savedTags = pathTags.changeCount();
+    return true;
+}
@@ -2,9 +2,34 @@
 #include <FL/fl_draw.H>
 #include <FL/Fl.H>
 #include <FL/fl_ask.H>
+#include <FL/Fl_Menu_Item.H>
+#include <algorithm>
 
-PathTable::PathTable(int X, int Y, int W, int H, const char *L) : Fl_Table_Row(X, Y, W, H, L), selectedRow(-1), focusCallback(nullptr)
+// 右键菜单项对应的操作
+enum ContextAction
 {
+    ACTION_SELECT_ALL = 1,
+    ACTION_ENABLE_SELECTED,
+    ACTION_DISABLE_SELECTED,
+    ACTION_DELETE_SELECTED,
+    ACTION_MOVE_UP,
+    ACTION_MOVE_DOWN,
+    ACTION_RESTORE_DELETED,
+    ACTION_UNDO,
+    ACTION_REDO,
+    ACTION_REMOVE_ALIASES,
+    ACTION_RESTORE_ROW // 之后的值依次对应子菜单中列出的已删除行
+};
+
+static const size_t maxRestoreItems = 30; // 右键菜单中逐条列出的已删除行数
+
+PathTable::PathTable(int X, int Y, int W, int H, const char *L) : Fl_Table_Row(X, Y, W, H, L), model(nullptr), modelSubscription(0), healthScanner(nullptr), executableIndex(nullptr), aliasDetector(nullptr), envExpander(nullptr), policy(nullptr), tags(nullptr), userScope(false), selectedCount(0), anchorRow(-1), focusCallback(nullptr), compactDeferred(false)
+{
+    for (int i = 0; i < buttonPoolSize; i++)
+    {
+        buttonPool[i] = ButtonData{0, this, false};
+    }
+
     col_header(1);
     col_resize(1);
     col_header_height(25);
@@ -12,154 +37,686 @@ PathTable::PathTable(int X, int Y, int W, int H, const char *L) : Fl_Table_Row(X
     end();
 }
 
+PathTable::~PathTable()
+{
+    // 窗口关闭时可能还有挂起的定时器和空闲回调
+    for (int i = 0; i < buttonPoolSize; i++)
+    {
+        if (buttonPool[i].inUse)
+        {
+            Fl::remove_timeout(resetButtonState, &buttonPool[i]);
+        }
+    }
+    Fl::remove_idle(compactIdle, this);
+    setModel(nullptr);
+}
+
 void PathTable::setFocusCallback(void (*callback)(PathTable*))
 {
     focusCallback = callback;
 }
 
-void PathTable::getPaths(std::vector<EnvPathItem_t> &outPathList)
+void PathTable::setModel(PathListModel *pathModel)
+{
+    if (model)
+    {
+        model->unsubscribe(modelSubscription);
+    }
+    model = pathModel;
+    if (model)
+    {
+        modelSubscription = model->subscribe([this](const PathListChange_t &change) { onModelChange(change); });
+    }
+    std::fill(rowSelected.begin(), rowSelected.end(), 0);
+    syncRowState();
+    rows(static_cast<int>(getPathLength()));
+    redraw();
+}
+
+PathListModel *PathTable::getModel() const
+{
+    return model;
+}
+
+void PathTable::setHealthScanner(const PathHealthScanner *scanner)
+{
+    healthScanner = scanner;
+    redraw();
+}
+
+void PathTable::setUserScope(bool user)
+{
+    userScope = user;
+}
+
+void PathTable::setExecutableIndex(const ExecutableIndex *index)
 {
-    outPathList.clear();
-    outPathList = envPaths; // copy
+    executableIndex = index;
+    redraw();
 }
 
-void PathTable::setPaths(const std::vector<EnvPathItem_t> &pathList)
+void PathTable::setEnvExpander(EnvExpander *expander)
 {
-    envPaths.clear();
-    envPaths = pathList; // copy
-    delBtnClicked.clear();
-    delBtnClicked.resize(pathList.size(), 0);
+    envExpander = expander;
+    redraw();
+}
 
-    rows(static_cast<int>(envPaths.size()));
+void PathTable::setAliasDetector(const PathAliasDetector *detector)
+{
+    aliasDetector = detector;
     redraw();
 }
 
+void PathTable::setPolicy(const PathPolicy *pathPolicy)
+{
+    policy = pathPolicy;
+    redraw();
+}
+
+void PathTable::setTags(const PathTags *pathTags)
+{
+    tags = pathTags;
+    redraw();
+}
+
+size_t PathTable::getAliasCount() const
+{
+    return aliasDetector ? aliasDetector->count(userScope) : 0;
+}
+
+void PathTable::removeAliases()
+{
+    if (!model || !aliasDetector)
+        return;
+    // 打墓碑，可以撤销或在应用前恢复
+    model->beginBatch();
+    for (size_t i = 0; i < model->size(); i++)
+    {
+        if (!model->isDeleted(i) && model->at(i).enabled && aliasDetector->aliasOf(model->at(i).path, userScope))
+        {
+            model->remove(i);
+        }
+    }
+    model->endBatch();
+}
+
 size_t PathTable::getPathLength()
 {
-    return envPaths.size();
+    return model ? model->liveSize() : 0;
+}
+
+size_t PathTable::rowToIndex(int R) const
+{
+    return model->liveToIndex(static_cast<size_t>(R));
+}
+
+void PathTable::syncRowState()
+{
+    size_t n = model ? model->size() : 0;
+    delBtnClicked.resize(n, 0);
+    rowSelected.resize(n, 0);
+
+    // 恢复出来的版本里可能有已经被删除的行，取消它们的选中
+    selectedCount = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (rowSelected[i] && model->isDeleted(i))
+        {
+            rowSelected[i] = 0;
+        }
+        selectedCount += rowSelected[i];
+    }
+    if (anchorRow >= static_cast<int>(getPathLength()))
+    {
+        anchorRow = -1;
+    }
+}
+
+void PathTable::onModelChange(const PathListChange_t &change)
+{
+    switch (change.kind)
+    {
+    case PathListChange_t::INSERT:
+        rowSelected.insert(rowSelected.begin() + change.index, 0);
+        delBtnClicked.insert(delBtnClicked.begin() + change.index, 0);
+        rows(static_cast<int>(getPathLength()));
+        break;
+    case PathListChange_t::REMOVE:
+        if (rowSelected[change.index])
+        {
+            rowSelected[change.index] = 0;
+            selectedCount--;
+        }
+        anchorRow = -1;
+        rows(static_cast<int>(getPathLength()));
+        break;
+    case PathListChange_t::RESTORE:
+        rows(static_cast<int>(getPathLength()));
+        break;
+    case PathListChange_t::TOGGLE:
+    case PathListChange_t::EDIT:
+        break;
+    case PathListChange_t::MOVE:
+    {
+        // 选中标记跟随移动的行
+        uint8_t selected = rowSelected[change.index];
+        uint8_t clicked = delBtnClicked[change.index];
+        rowSelected.erase(rowSelected.begin() + change.index);
+        delBtnClicked.erase(delBtnClicked.begin() + change.index);
+        rowSelected.insert(rowSelected.begin() + change.toIndex, selected);
+        delBtnClicked.insert(delBtnClicked.begin() + change.toIndex, clicked);
+        break;
+    }
+    case PathListChange_t::RESET:
+    case PathListChange_t::COMPACT:
+        syncRowState();
+        rows(static_cast<int>(getPathLength()));
+        break;
+    }
+    redraw();
+}
+
+bool PathTable::canUndo() const
+{
+    return model && model->canUndo();
+}
+
+bool PathTable::canRedo() const
+{
+    return model && model->canRedo();
+}
+
+void PathTable::undo()
+{
+    if (model)
+        model->undo();
+}
+
+void PathTable::redo()
+{
+    if (model)
+        model->redo();
 }
 
 void PathTable::clearSelection()
 {
-    if (selectedRow != -1)
+    anchorRow = -1;
+    if (selectedCount != 0)
     {
-        selectedRow = -1;
+        std::fill(rowSelected.begin(), rowSelected.end(), 0);
+        selectedCount = 0;
         redraw(); // 重绘以恢复原始背景色
     }
 }
 
-// 静态回调函数实现 - 恢复按钮状态
-void PathTable::resetButtonState(void *data)
+size_t PathTable::getSelectedCount() const
 {
-    ButtonData *btnData = static_cast<ButtonData *>(data);
-    if (btnData && btnData->table)
+    return selectedCount;
+}
+
+std::vector<size_t> PathTable::getSelectedIndices() const
+{
+    std::vector<size_t> indices;
+    indices.reserve(selectedCount);
+    for (size_t i = 0; i < rowSelected.size(); i++)
+    {
+        if (rowSelected[i] && model && i < model->size() && !model->isDeleted(i))
+            indices.push_back(i);
+    }
+    return indices;
+}
+
+void PathTable::selectAll()
+{
+    if (getPathLength() == 0)
+        return;
+    for (size_t i = 0; i < rowSelected.size(); i++)
     {
-        // 重置按钮点击状态
-        if (btnData->row >= 0 && btnData->row < static_cast<int>(btnData->table->delBtnClicked.size()))
+        rowSelected[i] = model->isDeleted(i) ? 0 : 1;
+    }
+    selectedCount = getPathLength();
+    anchorRow = 0;
+    redraw();
+}
+
+void PathTable::clickSelect(int R)
+{
+    bool ctrl = Fl::event_state(FL_CTRL) != 0;
+    bool shift = Fl::event_state(FL_SHIFT) != 0;
+    size_t index = rowToIndex(R);
+
+    if (shift && anchorRow >= 0 && anchorRow < rows())
+    {
+        // Shift: 选中锚点到当前行的区间，按住Ctrl时保留原有选择
+        if (!ctrl)
         {
-            btnData->table->delBtnClicked[btnData->row] = 0;
-            btnData->table->redraw(); // 重绘以更新按钮状态
+            std::fill(rowSelected.begin(), rowSelected.end(), 0);
+            selectedCount = 0;
         }
+        int lo = anchorRow < R ? anchorRow : R;
+        int hi = anchorRow < R ? R : anchorRow;
+        for (int row = lo; row <= hi; row++)
+        {
+            size_t i = rowToIndex(row);
+            if (!rowSelected[i])
+            {
+                rowSelected[i] = 1;
+                selectedCount++;
+            }
+        }
+    }
+    else if (ctrl)
+    {
+        // Ctrl: 切换当前行
+        rowSelected[index] = !rowSelected[index];
+        if (rowSelected[index])
+            selectedCount++;
+        else
+            selectedCount--;
+        anchorRow = R;
     }
+    else
+    {
+        std::fill(rowSelected.begin(), rowSelected.end(), 0);
+        rowSelected[index] = 1;
+        selectedCount = 1;
+        anchorRow = R;
+    }
+    redraw(); // 重绘以更新选中行的背景色
+}
 
-    // 询问用户是否确定删除
-    if (btnData && btnData->table && btnData->row >= 0 && btnData->row < static_cast<int>(btnData->table->envPaths.size()))
+void PathTable::setSelectedEnabled(bool enabled)
+{
+    if (!model || selectedCount == 0)
+        return;
+    model->beginBatch();
+    for (size_t i = 0; i < rowSelected.size(); i++)
     {
-        std::string pathToDelete = btnData->table->envPaths[btnData->row].path;
-        std::string confirmMessage = "确定要删除路径 \"" + pathToDelete + "\" 吗？\n删除的路径将在下一次应用后失效";
+        if (rowSelected[i])
+        {
+            model->setEnabled(i, enabled);
+        }
+    }
+    model->endBatch();
+}
+
+void PathTable::deleteSelected()
+{
+    if (!model || selectedCount == 0)
+        return;
 
-        if (fl_ask("%s", confirmMessage.c_str()))
+    // 弹出对话框会导致失去焦点并清除选择，先保存一份
+    std::vector<uint8_t> doomed = rowSelected;
+    size_t count = selectedCount;
+
+    std::string confirmMessage;
+    if (count == 1)
+    {
+        for (size_t i = 0; i < doomed.size(); i++)
         {
-            // 用户确认删除，执行删除操作
-            btnData->table->envPaths.erase(btnData->table->envPaths.begin() + btnData->row);
-            btnData->table->delBtnClicked.erase(btnData->table->delBtnClicked.begin() + btnData->row);
-            btnData->table->rows(static_cast<int>(btnData->table->envPaths.size()));
-            btnData->table->redraw();
+            if (doomed[i])
+            {
+                confirmMessage = "确定要删除路径 \"" + model->at(i).path + "\" 吗？\n删除的路径可在下一次应用前恢复";
+                break;
+            }
+        }
+    }
+    else
+    {
+        confirmMessage = "确定要删除选中的 " + std::to_string(count) + " 条路径吗？\n删除的路径可在下一次应用前恢复";
+    }
 
-            fl_message("路径已删除");
+    if (fl_choice("%s", "取消", "删除", nullptr, confirmMessage.c_str()) != 1)
+        return;
+
+    // 只打墓碑，不移动数据
+    model->beginBatch();
+    for (size_t i = 0; i < doomed.size(); i++)
+    {
+        if (doomed[i])
+        {
+            model->remove(i);
         }
     }
+    model->endBatch();
+}
 
-    // 释放内存
-    delete btnData;
+void PathTable::moveSelected(int delta)
+{
+    if (!model || selectedCount == 0)
+        return;
+
+    // 按移动方向从前往后处理，连续选中的行作为一个整体移动，碰到边界的不动
+    int n = rows();
+    model->beginBatch();
+    if (delta < 0)
+    {
+        for (int R = 1; R < n; R++)
+        {
+            size_t i = rowToIndex(R);
+            size_t prev = rowToIndex(R - 1);
+            if (rowSelected[i] && !rowSelected[prev])
+            {
+                model->move(i, prev);
+            }
+        }
+    }
+    else
+    {
+        for (int R = n - 2; R >= 0; R--)
+        {
+            size_t i = rowToIndex(R);
+            size_t next = rowToIndex(R + 1);
+            if (rowSelected[i] && !rowSelected[next])
+            {
+                model->move(i, next);
+            }
+        }
+    }
+    model->endBatch();
+
+    if (anchorRow >= 0)
+    {
+        anchorRow += delta;
+        if (anchorRow < 0 || anchorRow >= n)
+            anchorRow = -1;
+    }
 }
 
-int PathTable::handle(int event)
+size_t PathTable::getDeletedCount() const
 {
-    if (event == FL_PUSH)
+    return model ? model->deletedCount() : 0;
+}
+
+void PathTable::restoreDeleted()
+{
+    if (getDeletedCount() == 0)
+        return;
+    model->beginBatch();
+    for (size_t i = 0; i < model->size(); i++)
+    {
+        if (model->isDeleted(i))
+        {
+            model->restore(i);
+        }
+    }
+    model->endBatch();
+}
+
+void PathTable::restoreDeletedAt(size_t index)
+{
+    if (model && index < model->size() && model->isDeleted(index))
     {
-        // 获取鼠标点击位置
-        int X = Fl::event_x();
-        int Y = Fl::event_y();
+        model->restore(index);
+    }
+}
 
-        // 检查点击是否在表格范围内
-        if (X >= this->x() && Y >= this->y() &&
-            X <= this->x() + this->w() && Y <= this->y() + this->h())
+void PathTable::commitDeletes()
+{
+    // 应用之后墓碑不再需要恢复，放到空闲时统一压缩
+    if (getDeletedCount() > 0 && !Fl::has_idle(compactIdle, this))
+    {
+        Fl::add_idle(compactIdle, this);
+    }
+}
+
+void PathTable::compactIdle(void *data)
+{
+    PathTable *table = static_cast<PathTable *>(data);
+    Fl::remove_idle(compactIdle, data);
+    table->compactRows();
+}
+
+void PathTable::compactRows()
+{
+    if (!model)
+        return;
+
+    // 按下中的删除按钮记录的是下标，这时不压缩，由resetButtonState在最后一个按钮复位时补做
+    for (int i = 0; i < buttonPoolSize; i++)
+    {
+        if (buttonPool[i].inUse)
         {
+            compactDeferred = true;
+            return;
+        }
+    }
+    compactDeferred = false;
 
-            // 转换为表格相对坐标
-            int rel_x = X - this->x();
-            int rel_y = Y - this->y();
+    // 下标会整体变化，选中状态一并清除
+    std::fill(rowSelected.begin(), rowSelected.end(), 0);
+    std::fill(delBtnClicked.begin(), delBtnClicked.end(), 0);
+    anchorRow = -1;
+    model->compact();
+}
 
-            // 计算行号（跳过表头）
-            int R = 0;
-            int row_start = col_header_height();
-            for (R = 0; R < rows(); R++)
-            {
-                int row_h = row_height(R);
-                if (rel_y >= row_start && rel_y < row_start + row_h)
-                    break;
-                row_start += row_h;
-            }
+void PathTable::showContextMenu()
+{
+    int hasSelection = selectedCount > 0 ? 0 : FL_MENU_INACTIVE;
+    int hasDeleted = getDeletedCount() > 0 ? 0 : FL_MENU_INACTIVE;
+    int hasUndo = canUndo() ? 0 : FL_MENU_INACTIVE;
+    int hasRedo = canRedo() ? 0 : FL_MENU_INACTIVE;
+    int hasAliases = getAliasCount() > 0 ? 0 : FL_MENU_INACTIVE;
+    std::string restoreLabel = "恢复已删除 (" + std::to_string(getDeletedCount()) + ")";
+    std::string aliasLabel = "删除目录别名 (" + std::to_string(getAliasCount()) + ")";
+
+    // 已删除的行不显示在表格中，无法选中，在子菜单中逐条列出；菜单文字中'&'和'@'有特殊含义
+    std::vector<size_t> deletedRows;
+    std::vector<std::string> deletedLabels;
+    for (size_t i = 0; model && i < model->size() && deletedRows.size() < maxRestoreItems; i++)
+    {
+        if (!model->isDeleted(i))
+            continue;
+        std::string label;
+        for (char c : model->at(i).path)
+        {
+            if (c == '&' || c == '@')
+                label += c;
+            label += c;
+        }
+        deletedRows.push_back(i);
+        deletedLabels.push_back(label);
+    }
+    std::string moreLabel = "……其余 " + std::to_string(getDeletedCount() - deletedRows.size()) + " 条请全部恢复";
+
+    std::vector<Fl_Menu_Item> menu = {
+        {"撤销", FL_CTRL + 'z', 0, (void *)(intptr_t)ACTION_UNDO, hasUndo},
+        {"重做", FL_CTRL + 'y', 0, (void *)(intptr_t)ACTION_REDO, hasRedo | FL_MENU_DIVIDER},
+        {"全选", FL_CTRL + 'a', 0, (void *)(intptr_t)ACTION_SELECT_ALL, FL_MENU_DIVIDER},
+        {"启用所选", 0, 0, (void *)(intptr_t)ACTION_ENABLE_SELECTED, hasSelection},
+        {"禁用所选", 0, 0, (void *)(intptr_t)ACTION_DISABLE_SELECTED, hasSelection | FL_MENU_DIVIDER},
+        {"上移", FL_ALT + FL_Up, 0, (void *)(intptr_t)ACTION_MOVE_UP, hasSelection},
+        {"下移", FL_ALT + FL_Down, 0, (void *)(intptr_t)ACTION_MOVE_DOWN, hasSelection | FL_MENU_DIVIDER},
+        {"删除所选", FL_Delete, 0, (void *)(intptr_t)ACTION_DELETE_SELECTED, hasSelection},
+        {aliasLabel.c_str(), 0, 0, (void *)(intptr_t)ACTION_REMOVE_ALIASES, hasAliases},
+        {restoreLabel.c_str(), 0, 0, 0, FL_SUBMENU | hasDeleted},
+        {"全部恢复", 0, 0, (void *)(intptr_t)ACTION_RESTORE_DELETED, FL_MENU_DIVIDER}};
+    for (size_t k = 0; k < deletedRows.size(); k++)
+    {
+        menu.push_back({deletedLabels[k].c_str(), 0, 0, (void *)(intptr_t)(ACTION_RESTORE_ROW + k), 0});
+    }
+    if (deletedRows.size() < getDeletedCount())
+    {
+        menu.push_back({moreLabel.c_str(), 0, 0, 0, FL_MENU_INACTIVE});
+    }
+    menu.push_back({0}); // 子菜单结束
+    menu.push_back({0});
+
+    const Fl_Menu_Item *m = menu[0].popup(Fl::event_x(), Fl::event_y());
+    if (!m)
+        return;
 
-            // 计算列号（跳过表头）
-            int C = 0;
-            int col_start = 0;
-            for (C = 0; C < cols(); C++)
+    if (m->argument() >= ACTION_RESTORE_ROW)
+    {
+        restoreDeletedAt(deletedRows[m->argument() - ACTION_RESTORE_ROW]);
+        return;
+    }
+    switch (m->argument())
+    {
+    case ACTION_SELECT_ALL:
+        selectAll();
+        break;
+    case ACTION_ENABLE_SELECTED:
+        setSelectedEnabled(true);
+        break;
+    case ACTION_DISABLE_SELECTED:
+        setSelectedEnabled(false);
+        break;
+    case ACTION_DELETE_SELECTED:
+        deleteSelected();
+        break;
+    case ACTION_MOVE_UP:
+        moveSelected(-1);
+        break;
+    case ACTION_MOVE_DOWN:
+        moveSelected(1);
+        break;
+    case ACTION_RESTORE_DELETED:
+        restoreDeleted();
+        break;
+    case ACTION_UNDO:
+        undo();
+        break;
+    case ACTION_REDO:
+        redo();
+        break;
+    case ACTION_REMOVE_ALIASES:
+        removeAliases();
+        break;
+    default:
+        break;
+    }
+}
+
+bool PathTable::hitCell(int &R, int &C)
+{
+    // 使用Fl_Table自身的换算，滚动后也能得到正确的行列
+    ResizeFlag resizeFlag;
+    TableContext context = cursor2rowcol(R, C, resizeFlag);
+    return context == CONTEXT_CELL && R >= 0 && R < rows();
+}
+
+// 静态回调函数实现 - 恢复按钮状态
+void PathTable::resetButtonState(void *data)
+{
+    ButtonData *btnData = static_cast<ButtonData *>(data);
+    PathTable *table = btnData->table;
+    size_t index = btnData->index;
+    btnData->inUse = false; // 归还到池中
+
+    // 补做推迟的压缩，按钮对应的下标换成压缩后的位置；已删除的行压缩后不再询问
+    bool idle = true;
+    for (int i = 0; i < buttonPoolSize; i++)
+    {
+        idle = idle && !table->buttonPool[i].inUse;
+    }
+    if (table->compactDeferred && idle && table->model)
+    {
+        size_t live = 0;
+        for (size_t i = 0; i < index && i < table->model->size(); i++)
+        {
+            if (!table->model->isDeleted(i))
+                live++;
+        }
+        bool deleted = index >= table->model->size() || table->model->isDeleted(index);
+        table->compactRows();
+        index = deleted ? table->model->size() : live;
+    }
+
+    // 重置按钮点击状态
+    if (index < table->delBtnClicked.size())
+    {
+        table->delBtnClicked[index] = 0;
+        table->redraw(); // 重绘以更新按钮状态
+    }
+
+    // 询问用户是否确定删除
+    if (table->model && index < table->model->size() && !table->model->isDeleted(index))
+    {
+        // 点击的行不在多选范围内时只删除这一行
+        if (!table->rowSelected[index])
+        {
+            std::fill(table->rowSelected.begin(), table->rowSelected.end(), 0);
+            table->rowSelected[index] = 1;
+            table->selectedCount = 1;
+        }
+        table->deleteSelected();
+    }
+}
+
+int PathTable::handle(int event)
+{
+    if (event == FL_PUSH)
+    {
+        int R = -1;
+        int C = -1;
+        if (hitCell(R, C))
+        {
+            take_focus(); // 获取焦点
+            size_t index = rowToIndex(R);
+
+            // 右键：未选中的行先单选，再弹出批量操作菜单
+            if (Fl::event_button() == FL_RIGHT_MOUSE)
             {
-                int col_w = col_width(C);
-                if (rel_x >= col_start && rel_x < col_start + col_w)
-                    break;
-                col_start += col_w;
+                if (!rowSelected[index])
+                {
+                    std::fill(rowSelected.begin(), rowSelected.end(), 0);
+                    rowSelected[index] = 1;
+                    selectedCount = 1;
+                    anchorRow = R;
+                    redraw();
+                }
+                if (focusCallback)
+                {
+                    focusCallback(this);
+                }
+                showContextMenu();
+                return 1;
             }
 
             // 如果点击的是有效的行（不是复选框或删除按钮），设置选中状态
-            if (R >= 0 && R < static_cast<int>(envPaths.size()) && C != 2 && C != 3)
+            if (C != 2 && C != 3)
             {
-                if (selectedRow != R)
+                clickSelect(R);
+
+                // 通知MainWindow焦点变化
+                if (focusCallback)
                 {
-                    selectedRow = R;
-                    take_focus(); // 获取焦点
-                    redraw(); // 重绘以更新选中行的背景色
-                    
-                    // 通知MainWindow焦点变化
-                    if (focusCallback)
-                    {
-                        focusCallback(this);
-                    }
+                    focusCallback(this);
                 }
                 return 1; // 事件已处理
             }
 
             // 检查是否点击了复选框列（第2列）
-            if (C == 2 && R >= 0 && R < static_cast<int>(envPaths.size()))
+            if (C == 2)
             {
                 // 切换复选框状态
-                envPaths[R].enabled = !envPaths[R].enabled;
-                redraw(); // 重绘以更新复选框状态
+                model->setEnabled(index, !model->at(index).enabled); // 模型通知后重绘复选框
                 return 1; // 事件已处理
             }
 
             // 检查是否点击了删除按钮列（第3列）
-            if (C == 3 && R >= 0 && R < static_cast<int>(envPaths.size()))
+            if (C == 3)
             {
+                // 从池中取一个空闲槽位，全部占用时忽略这次点击
+                ButtonData *data = nullptr;
+                for (int i = 0; i < buttonPoolSize; i++)
+                {
+                    if (!buttonPool[i].inUse)
+                    {
+                        data = &buttonPool[i];
+                        break;
+                    }
+                }
+                if (!data)
+                    return 1;
+
                 // 设置按钮点击状态并设置定时器恢复
-                delBtnClicked[R] = 1;
+                data->index = index;
+                data->inUse = true;
+                delBtnClicked[index] = 1;
                 redraw();
 
-                // 创建包含行号和this指针的结构用于回调
-                PathTable::ButtonData *data = new PathTable::ButtonData{R, this};
-
                 // 设置定时器，200毫秒后恢复按钮状态
                 Fl::add_timeout(0.2, resetButtonState, data);
 
@@ -167,14 +724,43 @@ int PathTable::handle(int event)
             }
         }
     }
-    else if (event == FL_UNFOCUS)
+    else if (event == FL_KEYBOARD)
     {
-        // 失去焦点时清除选中状态
-        if (selectedRow != -1)
+        int key = Fl::event_key();
+        if (key == 'a' && Fl::event_state(FL_CTRL))
+        {
+            selectAll();
+            return 1;
+        }
+        if (key == FL_Delete && selectedCount > 0)
+        {
+            deleteSelected();
+            return 1;
+        }
+        if ((key == FL_Up || key == FL_Down) && Fl::event_state(FL_ALT) && selectedCount > 0)
         {
-            selectedRow = -1;
-            redraw(); // 重绘以恢复原始背景色
+            moveSelected(key == FL_Up ? -1 : 1);
+            return 1;
         }
+        if (key == 'z' && Fl::event_state(FL_CTRL))
+        {
+            // Ctrl+Shift+Z 同样视为重做
+            if (Fl::event_state(FL_SHIFT))
+                redo();
+            else
+                undo();
+            return 1;
+        }
+        if (key == 'y' && Fl::event_state(FL_CTRL))
+        {
+            redo();
+            return 1;
+        }
+    }
+    else if (event == FL_UNFOCUS)
+    {
+        // 失去焦点时清除选中状态
+        clearSelection();
     }
 
     return Fl_Table_Row::handle(event);
@@ -211,8 +797,9 @@ void PathTable::draw_cell(TableContext context, int R, int C, int X, int Y, int
     case CONTEXT_CELL:
         fl_push_clip(X, Y, W, H);
         {
+            size_t index = rowToIndex(R); // 跳过墓碑后的实际下标
             // 背景色 - 如果是选中的行，使用Windows蓝色，否则使用默认颜色
-            if (R == selectedRow)
+            if (index < rowSelected.size() && rowSelected[index])
             {
                 // Windows蓝色高亮色 (类似系统选中颜色)
                 fl_color(fl_rgb_color(204, 232, 255));
@@ -229,11 +816,83 @@ void PathTable::draw_cell(TableContext context, int R, int C, int X, int Y, int
             {
                 fl_draw(std::to_string(R + 1).c_str(), X, Y, W, H, FL_ALIGN_CENTER);
             }
-            else if (C == 1 && R < envPaths.size())
+            else if (C == 1 && index < model->size())
             {
-                fl_draw(envPaths[R].path.c_str(), X + 2, Y, W - 4, H, FL_ALIGN_LEFT);
+                const EnvPathItem_t &item = model->at(index);
+                int textX = X + 2;
+                if (healthScanner)
+                {
+                    // 目录状态图标：绿色正常，红色不存在，橙色不是目录或无权限，灰色检查中或超时
+                    PathHealth_t health = healthScanner->status(item.path);
+                    Fl_Color iconColor = FL_GRAY;
+                    if (health == HEALTH_OK)
+                        iconColor = fl_rgb_color(46, 160, 67);
+                    else if (health == HEALTH_MISSING)
+                        iconColor = fl_rgb_color(218, 54, 51);
+                    else if (health == HEALTH_NOT_DIRECTORY || health == HEALTH_NO_ACCESS)
+                        iconColor = fl_rgb_color(227, 140, 0);
+                    int iconSize = H / 2;
+                    fl_color(iconColor);
+                    fl_pie(X + 4, Y + (H - iconSize) / 2, iconSize, iconSize, 0, 360);
+                    if (health == HEALTH_TIMEOUT)
+                    {
+                        // 超时额外画一道斜线与检查中区分
+                        fl_color(FL_BLACK);
+                        fl_line(X + 4, Y + (H + iconSize) / 2, X + 4 + iconSize, Y + (H - iconSize) / 2);
+                    }
+                    fl_color(FL_BLACK);
+                    textX = X + 8 + iconSize;
+                }
+                if (executableIndex && item.enabled && executableIndex->isFullyShadowed(item.path, userScope))
+                {
+                    // 其中的命令全部被前面的目录遮蔽，灰显
+                    fl_color(fl_rgb_color(150, 150, 150));
+                }
+                fl_draw(item.path.c_str(), textX, Y, W - (textX - X) - 2, H, FL_ALIGN_LEFT);
+                int suffixX = textX + static_cast<int>(fl_width(item.path.c_str())) + 8;
+                if (envExpander && item.path.find('%') != std::string::npos)
+                {
+                    // 带%VAR%的条目在后面显示展开结果，变量互相引用时标红
+                    bool cyclic = envExpander->isCyclic(item.path);
+                    std::string suffix = cyclic ? "(变量循环引用)" : "→ " + envExpander->expand(item.path);
+                    fl_color(cyclic ? FL_RED : fl_rgb_color(120, 120, 120));
+                    fl_draw(suffix.c_str(), suffixX, Y, W - (suffixX - X) - 2, H, FL_ALIGN_LEFT);
+                    suffixX += static_cast<int>(fl_width(suffix.c_str())) + 8;
+                }
+                const std::string *aliasTarget = (aliasDetector && item.enabled) ? aliasDetector->aliasOf(item.path, userScope) : nullptr;
+                if (aliasTarget)
+                {
+                    // 别名：在路径后面标出它和哪个条目是同一个目录
+                    std::string suffix = "= " + *aliasTarget;
+                    fl_color(fl_rgb_color(227, 140, 0));
+                    fl_draw(suffix.c_str(), suffixX, Y, W - (suffixX - X) - 2, H, FL_ALIGN_LEFT);
+                    suffixX += static_cast<int>(fl_width(suffix.c_str())) + 8;
+                }
+                const std::vector<std::string> *rowTags = tags ? tags->tagsOf(item.path) : nullptr;
+                if (rowTags)
+                {
+                    // 标签：蓝色的 #名称
+                    std::string suffix;
+                    for (const auto &tag : *rowTags)
+                    {
+                        suffix += (suffix.empty() ? "#" : " #") + tag;
+                    }
+                    fl_color(fl_rgb_color(40, 110, 200));
+                    fl_draw(suffix.c_str(), suffixX, Y, W - (suffixX - X) - 2, H, FL_ALIGN_LEFT);
+                    suffixX += static_cast<int>(fl_width(suffix.c_str())) + 8;
+                }
+                const PathPolicy::PolicyRule_t *rule = policy ? policy->violationAt(index, userScope) : nullptr;
+                if (rule)
+                {
+                    // 不满足策略：左侧色条，error红色、warn橙色，后面注明规则
+                    Fl_Color ruleColor = rule->error ? fl_rgb_color(218, 54, 51) : fl_rgb_color(227, 140, 0);
+                    fl_color(ruleColor);
+                    fl_rectf(X, Y, 3, H);
+                    std::string suffix = "违反: " + rule->text;
+                    fl_draw(suffix.c_str(), suffixX, Y, W - (suffixX - X) - 2, H, FL_ALIGN_LEFT);
+                }
             }
-            else if (C == 2 && R < envPaths.size())
+            else if (C == 2 && index < model->size())
             {
                 // 绘制复选框
                 int checkbox_size = H - 4; // 复选框大小略小于单元格高度
@@ -247,7 +906,7 @@ void PathTable::draw_cell(TableContext context, int R, int C, int X, int Y, int
                 fl_draw_box(FL_DOWN_BOX, checkbox_x, checkbox_y, checkbox_size, checkbox_size, FL_WHITE);
 
                 // 如果选中，绘制勾选标记
-                if (envPaths[R].enabled)
+                if (model->at(index).enabled)
                 {
                     fl_color(FL_BLACK);
                     fl_line(checkbox_x + 2, checkbox_y + checkbox_size / 2,
@@ -256,9 +915,9 @@ void PathTable::draw_cell(TableContext context, int R, int C, int X, int Y, int
                             checkbox_x + checkbox_size - 2, checkbox_y + 2);
                 }
             }
-            else if (C == 3 && R < envPaths.size())
+            else if (C == 3 && index < model->size())
             {
-                if (delBtnClicked[R] == 0)
+                if (delBtnClicked[index] == 0)
                 {
                     fl_color(FL_BACKGROUND_COLOR);
                     fl_rectf(X + 2, Y + 2, W - 4, H - 4);
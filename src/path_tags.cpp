@@ -0,0 +1,262 @@
+#include "path_tags.hpp"
+#include "path_utils.hpp"
+#include <algorithm>
+
+PathTags::PathTags() : revision(0)
+{
+}
+
+void PathTags::rebuildKeys()
+{
+    keyTags.clear();
+    for (const auto &pair : tagPaths)
+    {
+        for (const auto &path : pair.second)
+        {
+            keyTags[normalizePathKey(path)].push_back(pair.first); // tagPaths按名称有序
+        }
+    }
+    revision++;
+}
+
+void PathTags::assign(const std::map<std::string, std::vector<std::string>> &data)
+{
+    tagPaths.clear();
+    for (const auto &pair : data)
+    {
+        if (!validName(pair.first))
+            continue;
+        std::vector<std::string> &paths = tagPaths[pair.first];
+        std::vector<std::string> keys;
+        for (const auto &path : pair.second)
+        {
+            std::string key = normalizePathKey(path);
+            if (path.empty() || std::find(keys.begin(), keys.end(), key) != keys.end())
+                continue;
+            keys.push_back(key);
+            paths.push_back(path);
+        }
+        if (paths.empty())
+            tagPaths.erase(pair.first);
+    }
+    rebuildKeys();
+}
+
+const std::map<std::string, std::vector<std::string>> &PathTags::data() const
+{
+    return tagPaths;
+}
+
+unsigned long PathTags::changeCount() const
+{
+    return revision;
+}
+
+bool PathTags::validName(const std::string &tag)
+{
+    if (tag.empty())
+        return false;
+    for (char c : tag)
+    {
+        if (c == '/' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            return false;
+    }
+    return true;
+}
+
+bool PathTags::add(const std::string &tag, const std::string &path)
+{
+    if (!validName(tag) || path.empty())
+        return false;
+    const std::vector<std::string> *tags = tagsOf(path);
+    if (tags && std::find(tags->begin(), tags->end(), tag) != tags->end())
+        return false;
+    tagPaths[tag].push_back(path);
+    rebuildKeys();
+    return true;
+}
+
+bool PathTags::remove(const std::string &tag, const std::string &path)
+{
+    auto it = tagPaths.find(tag);
+    if (it == tagPaths.end())
+        return false;
+    std::string key = normalizePathKey(path);
+    std::vector<std::string> &paths = it->second;
+    auto found = std::find_if(paths.begin(), paths.end(),
+                              [&key](const std::string &p) { return normalizePathKey(p) == key; });
+    if (found == paths.end())
+        return false;
+    paths.erase(found);
+    if (paths.empty())
+        tagPaths.erase(it);
+    rebuildKeys();
+    return true;
+}
+
+bool PathTags::removeTag(const std::string &tag)
+{
+    if (tagPaths.erase(tag) == 0)
+        return false;
+    rebuildKeys();
+    return true;
+}
+
+size_t PathTags::rename(const std::vector<std::pair<std::string, std::string>> &renames)
+{
+    // 先按旧写法建好映射再统一替换，A改成B、B改成C同时发生时A的标签不会被连带移到C
+    std::unordered_map<std::string, const std::string *> targets;
+    for (const auto &pair : renames)
+    {
+        std::string key = normalizePathKey(pair.first);
+        if (keyTags.count(key) && normalizePathKey(pair.second) != key)
+            targets.emplace(key, &pair.second);
+    }
+    if (targets.empty())
+        return 0;
+
+    size_t moved = 0;
+    for (auto &pair : tagPaths)
+    {
+        std::vector<std::string> paths;
+        std::vector<std::string> keys;
+        for (const auto &path : pair.second)
+        {
+            auto target = targets.find(normalizePathKey(path));
+            const std::string &renamed = target == targets.end() ? path : *target->second;
+            if (target != targets.end())
+                moved++;
+            std::string key = normalizePathKey(renamed);
+            if (std::find(keys.begin(), keys.end(), key) != keys.end())
+                continue; // 改写后与标签中已有的目录重合
+            keys.push_back(key);
+            paths.push_back(renamed);
+        }
+        pair.second.swap(paths);
+    }
+    if (moved > 0)
+        rebuildKeys();
+    return moved;
+}
+
+std::vector<std::string> PathTags::tagNames() const
+{
+    std::vector<std::string> names;
+    names.reserve(tagPaths.size());
+    for (const auto &pair : tagPaths)
+    {
+        names.push_back(pair.first);
+    }
+    return names;
+}
+
+const std::vector<std::string> *PathTags::tagsOf(const std::string &path) const
+{
+    if (keyTags.empty())
+        return nullptr;
+    auto it = keyTags.find(normalizePathKey(path));
+    return it == keyTags.end() ? nullptr : &it->second;
+}
+
+size_t PathTags::tagSlot(const std::string &tag) const
+{
+    auto it = tagPaths.find(tag);
+    return it == tagPaths.end() ? npos : static_cast<size_t>(std::distance(tagPaths.begin(), it));
+}
+
+// 模型或标签变化后一次遍历重建：每行查一次所属标签，置位对应的成员位
+const PathTags::RowBits &PathTags::bitsFor(const PathListModel &model) const
+{
+    RowBits *bits = nullptr;
+    for (auto &entry : cache)
+    {
+        if (entry.model == &model)
+            bits = &entry;
+    }
+    if (!bits)
+    {
+        cache.push_back(RowBits{&model, PersistentPathList(), revision + 1, {}, {}});
+        bits = &cache.back();
+    }
+    if (bits->revision == revision && bits->list.sameAs(model.list()))
+        return *bits;
+
+    size_t words = (model.size() + 63) / 64;
+    bits->members.assign(tagPaths.size(), std::vector<uint64_t>(words, 0));
+    bits->enabled.assign(words, 0);
+    std::unordered_map<std::string, size_t> slots;
+    size_t slot = 0;
+    for (const auto &pair : tagPaths)
+    {
+        slots[pair.first] = slot++;
+    }
+    model.list().forEachLive([&](size_t index, const EnvPathItem_t &item) {
+        uint64_t bit = uint64_t(1) << (index % 64);
+        if (item.enabled)
+            bits->enabled[index / 64] |= bit;
+        const std::vector<std::string> *tags = tagsOf(item.path);
+        if (!tags)
+            return;
+        for (const auto &tag : *tags)
+        {
+            bits->members[slots[tag]][index / 64] |= bit;
+        }
+    });
+    bits->list = model.list();
+    bits->revision = revision;
+    return *bits;
+}
+
+static size_t popCount(uint64_t word)
+{
+    size_t count = 0;
+    for (; word; word &= word - 1)
+        count++;
+    return count;
+}
+
+void PathTags::count(const std::string &tag, const PathListModel &model, size_t &members, size_t &enabledCount) const
+{
+    members = 0;
+    enabledCount = 0;
+    size_t slot = tagSlot(tag);
+    if (slot == npos)
+        return;
+    const RowBits &bits = bitsFor(model);
+    const std::vector<uint64_t> &mask = bits.members[slot];
+    for (size_t w = 0; w < mask.size(); w++)
+    {
+        members += popCount(mask[w]);
+        enabledCount += popCount(mask[w] & bits.enabled[w]);
+    }
+}
+
+size_t PathTags::setEnabled(const std::string &tag, bool enabled, PathListModel &model) const
+{
+    size_t slot = tagSlot(tag);
+    if (slot == npos)
+        return 0;
+    const RowBits &bits = bitsFor(model);
+    const std::vector<uint64_t> &mask = bits.members[slot];
+    // 启用：成员中尚未启用的行；禁用：成员中已启用的行
+    std::vector<size_t> rows;
+    for (size_t w = 0; w < mask.size(); w++)
+    {
+        uint64_t flip = enabled ? mask[w] & ~bits.enabled[w] : mask[w] & bits.enabled[w];
+        for (size_t bit = 0; flip; bit++, flip >>= 1)
+        {
+            if (flip & 1)
+                rows.push_back(w * 64 + bit);
+        }
+    }
+    model.setEnabledRows(rows, enabled);
+    return rows.size();
+}
+
+size_t PathTags::setEnabled(const std::string &tag, bool enabled, PathListModel &system, PathListModel &user) const
+{
+    PathListModel::beginLinkedBatch(system, user);
+    size_t changed = setEnabled(tag, enabled, system) + setEnabled(tag, enabled, user);
+    PathListModel::endLinkedBatch(system, user);
+    return changed;
+}
@@ -0,0 +1,709 @@
+#include "path_transfer.hpp"
+#include "path_utils.hpp"
+#include "path_state_store.hpp"
+#include <cstring>
+#include <fstream>
+#include "nlohmann/json.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+static const char systemKey[] = "HKEY_LOCAL_MACHINE\\SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment";
+static const char userKey[] = "HKEY_CURRENT_USER\\Environment";
+
+// 注册表通过ANSI接口读写，条目按系统代码页编码；其它平台按UTF-8
+static std::string narrow(const std::u16string &text)
+{
+    std::string out;
+    if (text.empty())
+        return out;
+#ifdef _WIN32
+    const wchar_t *wide = reinterpret_cast<const wchar_t *>(text.data());
+    int len = WideCharToMultiByte(CP_ACP, 0, wide, static_cast<int>(text.size()), NULL, 0, NULL, NULL);
+    out.resize(len);
+    WideCharToMultiByte(CP_ACP, 0, wide, static_cast<int>(text.size()), &out[0], len, NULL, NULL);
+#else
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        uint32_t cp = text[i];
+        if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < text.size() && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF)
+        {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (text[++i] - 0xDC00);
+        }
+        if (cp < 0x80)
+        {
+            out.push_back(static_cast<char>(cp));
+        }
+        else if (cp < 0x800)
+        {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000)
+        {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else
+        {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+#endif
+    return out;
+}
+
+static std::u16string widen(const std::string &text)
+{
+    std::u16string out;
+    if (text.empty())
+        return out;
+#ifdef _WIN32
+    int len = MultiByteToWideChar(CP_ACP, 0, text.data(), static_cast<int>(text.size()), NULL, 0);
+    out.resize(len);
+    MultiByteToWideChar(CP_ACP, 0, text.data(), static_cast<int>(text.size()), reinterpret_cast<wchar_t *>(&out[0]), len);
+#else
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size();)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        size_t extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+        for (size_t k = 1; k <= extra; k++)
+        {
+            if (i + k >= text.size() || (static_cast<unsigned char>(text[i + k]) & 0xC0) != 0x80)
+            {
+                extra = 0; // 截断或非法的序列按单字节处理
+                break;
+            }
+        }
+        uint32_t cp = extra == 0 ? c : (c & (0x3F >> extra));
+        for (size_t k = 1; k <= extra; k++)
+        {
+            cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+        }
+        i += extra + 1;
+        if (cp >= 0x10000)
+        {
+            cp -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+        }
+        else
+        {
+            out.push_back(static_cast<char16_t>(cp));
+        }
+    }
+#endif
+    return out;
+}
+
+PathImporter::PathImporter(PathFileFormat fileFormat, Sink recordSink, bool unsectionedUser)
+    : format(fileFormat), sink(std::move(recordSink)), defaultUser(unsectionedUser), user(unsectionedUser),
+      started(false), utf16(false), errorCount(0), regScope(OTHER_KEY), inHexValue(false), hexDone(false), hexLowByte(-1)
+{
+}
+
+PathFileFormat PathImporter::formatOf(const fs::path &file)
+{
+    std::string ext = toLowerAscii(file.extension().string());
+    if (ext == ".reg")
+        return PATH_FORMAT_REG;
+    if (ext == ".jsonl" || ext == ".ndjson")
+        return PATH_FORMAT_JSON_LINES;
+    return PATH_FORMAT_TEXT;
+}
+
+size_t PathImporter::errors() const
+{
+    return errorCount;
+}
+
+void PathImporter::emit(const std::string &path, bool enabled, bool inUser)
+{
+    if (path.empty())
+        return;
+    sink(PathRecord_t{path, enabled, inUser});
+}
+
+void PathImporter::emitList(const std::string &value, bool enabled, bool inUser)
+{
+    size_t start = 0;
+    while (start <= value.size())
+    {
+        size_t end = value.find(';', start);
+        if (end == std::string::npos)
+            end = value.size();
+        emit(value.substr(start, end - start), enabled, inUser);
+        start = end + 1;
+    }
+}
+
+void PathImporter::feed(const char *data, size_t size)
+{
+    if (!started)
+    {
+        // 凑够3个字节再判断BOM
+        pendingBytes.append(data, size);
+        if (pendingBytes.size() < 3)
+            return;
+        started = true;
+        std::string head;
+        head.swap(pendingBytes);
+        size_t skip = 0;
+        if (head.compare(0, 2, "\xFF\xFE") == 0)
+        {
+            utf16 = true;
+            skip = 2;
+        }
+        else if (head.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        {
+            skip = 3;
+        }
+        feed(head.data() + skip, head.size() - skip);
+        return;
+    }
+    if (utf16)
+        appendWide(data, size);
+    else
+        appendBytes(data, size);
+}
+
+void PathImporter::appendBytes(const char *data, size_t size)
+{
+    const char *end = data + size;
+    while (data < end)
+    {
+        const char *newline = static_cast<const char *>(memchr(data, '\n', end - data));
+        if (!newline)
+        {
+            line.append(data, end - data);
+            return;
+        }
+        line.append(data, newline - data);
+        processLine(line);
+        line.clear();
+        data = newline + 1;
+    }
+}
+
+void PathImporter::appendWide(const char *data, size_t size)
+{
+    auto take = [this](unsigned char low, unsigned char high) {
+        char16_t unit = static_cast<char16_t>(low | (high << 8));
+        if (unit != u'\n')
+        {
+            wideLine.push_back(unit);
+            return;
+        }
+        line = narrow(wideLine);
+        wideLine.clear();
+        processLine(line);
+        line.clear();
+    };
+    size_t i = 0;
+    if (!pendingBytes.empty() && size > 0)
+    {
+        // 上一块末尾剩下的半个码元
+        take(static_cast<unsigned char>(pendingBytes[0]), static_cast<unsigned char>(data[0]));
+        pendingBytes.clear();
+        i = 1;
+    }
+    for (; i + 1 < size; i += 2)
+    {
+        take(static_cast<unsigned char>(data[i]), static_cast<unsigned char>(data[i + 1]));
+    }
+    if (i < size)
+        pendingBytes.assign(data + i, 1);
+}
+
+void PathImporter::finish()
+{
+    if (!started)
+    {
+        started = true;
+        std::string head;
+        head.swap(pendingBytes);
+        utf16 = head.compare(0, 2, "\xFF\xFE") == 0;
+        size_t skip = utf16 ? 2 : 0;
+        if (utf16)
+            appendWide(head.data() + skip, head.size() - skip);
+        else
+            appendBytes(head.data(), head.size());
+    }
+    if (utf16 && !wideLine.empty())
+        line = narrow(wideLine);
+    if (!line.empty())
+        processLine(line);
+    line.clear();
+    wideLine.clear();
+    if (inHexValue)
+    {
+        flushHexEntry();
+        inHexValue = false;
+    }
+}
+
+void PathImporter::processLine(std::string &text)
+{
+    if (!text.empty() && text.back() == '\r')
+        text.pop_back();
+    switch (format)
+    {
+    case PATH_FORMAT_REG:
+        processRegLine(text);
+        break;
+    case PATH_FORMAT_TEXT:
+        processTextLine(text);
+        break;
+    case PATH_FORMAT_JSON_LINES:
+        processJsonLine(text);
+        break;
+    }
+}
+
+// 与 PathStateStore::readPathList 的格式相同，另外允许一行中用';'连接多个路径
+void PathImporter::processTextLine(std::string &text)
+{
+    if (text == "[system]")
+    {
+        user = false;
+        return;
+    }
+    if (text == "[user]")
+    {
+        user = true;
+        return;
+    }
+    bool enabled = true;
+    if (text.compare(0, 2, "# ") == 0)
+    {
+        enabled = false;
+        text.erase(0, 2);
+    }
+    if (text.empty() || text[0] == '#')
+        return;
+    emitList(text, enabled, user);
+}
+
+void PathImporter::processJsonLine(const std::string &text)
+{
+    if (text.find_first_not_of(" \t") == std::string::npos)
+        return;
+    json record = json::parse(text, nullptr, false);
+    if (record.is_string())
+    {
+        emit(record.get<std::string>(), true, defaultUser);
+        return;
+    }
+    if (!record.is_object())
+    {
+        errorCount++;
+        return;
+    }
+    auto path = record.find("path");
+    auto enabled = record.find("enabled");
+    auto scope = record.find("scope");
+    if (path == record.end() || !path->is_string() || (enabled != record.end() && !enabled->is_boolean()) ||
+        (scope != record.end() && !scope->is_string()))
+    {
+        errorCount++;
+        return;
+    }
+    bool inUser = defaultUser;
+    if (scope != record.end())
+    {
+        std::string name = scope->get<std::string>();
+        if (name != "system" && name != "user")
+        {
+            errorCount++;
+            return;
+        }
+        inUser = name == "user";
+    }
+    emit(path->get<std::string>(), enabled == record.end() || enabled->get<bool>(), inUser);
+}
+
+void PathImporter::processRegLine(const std::string &text)
+{
+    if (inHexValue)
+    {
+        parseHexBytes(text, 0);
+        return;
+    }
+    size_t pos = text.find_first_not_of(" \t");
+    if (pos == std::string::npos || text[pos] == ';')
+        return;
+
+    if (text[pos] == '[')
+    {
+        size_t close = text.rfind(']');
+        std::string key = close == std::string::npos || close < pos ? std::string() : toLowerAscii(text.substr(pos + 1, close - pos - 1));
+        if (key == toLowerAscii(systemKey))
+            regScope = SYSTEM_KEY;
+        else if (key == toLowerAscii(userKey))
+            regScope = USER_KEY;
+        else
+            regScope = OTHER_KEY; // 包括 [-键名] 形式的删除
+        return;
+    }
+    if (regScope == OTHER_KEY || text[pos] != '"')
+        return;
+
+    // "值名"=数据；值名中的 \\ 和 \" 是转义
+    std::string name;
+    size_t i = pos + 1;
+    for (; i < text.size() && text[i] != '"'; i++)
+    {
+        if (text[i] == '\\' && i + 1 < text.size())
+            i++;
+        name.push_back(text[i]);
+    }
+    if (i >= text.size() || i + 1 >= text.size() || text[i + 1] != '=')
+    {
+        errorCount++;
+        return;
+    }
+    if (toLowerAscii(name) != "path")
+        return;
+    i += 2;
+    bool inUser = regScope == USER_KEY;
+
+    if (i < text.size() && text[i] == '"')
+    {
+        // REG_SZ
+        std::string value;
+        for (i++; i < text.size() && text[i] != '"'; i++)
+        {
+            if (text[i] == '\\' && i + 1 < text.size())
+                i++;
+            value.push_back(text[i]);
+        }
+        if (i >= text.size())
+        {
+            errorCount++;
+            return;
+        }
+        emitList(value, true, inUser);
+        return;
+    }
+    static const char expandPrefix[] = "hex(2):";
+    if (text.compare(i, sizeof(expandPrefix) - 1, expandPrefix) == 0)
+    {
+        // REG_EXPAND_SZ：UTF-16LE字节，可能用行尾的反斜杠续到后面很多行
+        inHexValue = true;
+        hexDone = false;
+        hexLowByte = -1;
+        hexEntry.clear();
+        parseHexBytes(text, i + sizeof(expandPrefix) - 1);
+    }
+    // 其它类型（如"-"表示删除）不是路径列表
+}
+
+static int hexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+void PathImporter::parseHexBytes(const std::string &text, size_t pos)
+{
+    size_t i = pos;
+    while (i < text.size())
+    {
+        char c = text[i];
+        if (c == ' ' || c == '\t' || c == ',')
+        {
+            i++;
+            continue;
+        }
+        if (c == '\\' && text.find_first_not_of(" \t", i + 1) == std::string::npos)
+        {
+            return; // 续行
+        }
+        int high = hexDigit(c);
+        int low = i + 1 < text.size() ? hexDigit(text[i + 1]) : -1;
+        if (high < 0 || low < 0)
+        {
+            errorCount++;
+            break;
+        }
+        int byte = high * 16 + low;
+        i += 2;
+        if (hexLowByte < 0)
+        {
+            hexLowByte = byte;
+            continue;
+        }
+        hexCodeUnit(static_cast<char16_t>(hexLowByte | (byte << 8)));
+        hexLowByte = -1;
+    }
+    flushHexEntry();
+    inHexValue = false;
+}
+
+void PathImporter::hexCodeUnit(char16_t unit)
+{
+    if (hexDone)
+        return;
+    if (unit == 0)
+    {
+        flushHexEntry();
+        hexDone = true;
+        return;
+    }
+    if (unit == u';')
+    {
+        flushHexEntry();
+        return;
+    }
+    hexEntry.push_back(unit);
+}
+
+void PathImporter::flushHexEntry()
+{
+    if (hexEntry.empty())
+        return;
+    emit(narrow(hexEntry), true, regScope == USER_KEY);
+    hexEntry.clear();
+}
+
+bool PathImporter::readFile(const fs::path &file, PathFileFormat fileFormat, bool unsectionedUser,
+                            const Sink &recordSink, size_t &errorCount)
+{
+    std::ifstream inFile(file, std::ios::binary);
+    if (!inFile.is_open())
+    {
+        return false;
+    }
+    PathImporter importer(fileFormat, recordSink, unsectionedUser);
+    std::vector<char> buffer(1 << 16);
+    while (inFile)
+    {
+        inFile.read(buffer.data(), buffer.size());
+        std::streamsize count = inFile.gcount();
+        if (count <= 0)
+            break;
+        importer.feed(buffer.data(), static_cast<size_t>(count));
+    }
+    importer.finish();
+    errorCount = importer.errors();
+    return !inFile.bad();
+}
+
+// 导入去重用的开放寻址表：槽中只放键的哈希和下标，哈希相同时再比较字符串。
+// 比std::unordered_set<std::string>少一次节点分配，十万级条目时明显更快
+class PathKeySet
+{
+private:
+    struct Slot {
+        size_t hash; // 0表示空槽
+        size_t index;
+    };
+    std::vector<Slot> slots;
+    std::vector<std::string> keys;
+
+    void rehash(size_t capacity)
+    {
+        std::vector<Slot> old(capacity);
+        old.swap(slots);
+        for (const Slot &slot : old)
+        {
+            if (slot.hash != 0)
+                place(slot);
+        }
+    }
+
+    void place(const Slot &slot)
+    {
+        size_t mask = slots.size() - 1;
+        size_t i = slot.hash & mask;
+        while (slots[i].hash != 0)
+            i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+
+public:
+    void reserve(size_t count)
+    {
+        size_t capacity = 64;
+        while (capacity < count * 2)
+            capacity *= 2;
+        if (capacity > slots.size())
+            rehash(capacity);
+        keys.reserve(count);
+    }
+
+    bool insert(std::string &&key)
+    {
+        if ((keys.size() + 1) * 2 > slots.size())
+            rehash(slots.empty() ? 64 : slots.size() * 2);
+        size_t hash = std::hash<std::string>()(key) | 1;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash & mask; slots[i].hash != 0; i = (i + 1) & mask)
+        {
+            if (slots[i].hash == hash && keys[slots[i].index] == key)
+                return false;
+        }
+        place(Slot{hash, keys.size()});
+        keys.push_back(std::move(key));
+        return true;
+    }
+};
+
+bool PathImporter::importInto(const fs::path &file, PathFileFormat fileFormat, bool unsectionedUser,
+                              PathListModel &systemModel, PathListModel &userModel, PathImportResult_t &result)
+{
+    result = PathImportResult_t{0, 0, 0, 0};
+    PathListModel *models[2] = {&systemModel, &userModel};
+    PathKeySet seen[2];
+    std::vector<EnvPathItem_t> added[2];
+    for (int m = 0; m < 2; m++)
+    {
+        // 按顺序遍历整棵树，比逐行按下标查找少很多次指针跳转
+        std::vector<EnvPathItem_t> existing;
+        models[m]->toVector(existing);
+        seen[m].reserve(existing.size() + 1024);
+        for (const auto &item : existing)
+        {
+            seen[m].insert(normalizePathKey(item.path));
+        }
+    }
+
+    bool ok = readFile(file, fileFormat, unsectionedUser, [&](const PathRecord_t &record) {
+        result.records++;
+        int m = record.user ? 1 : 0;
+        if (!seen[m].insert(normalizePathKey(record.path)))
+        {
+            result.duplicates++;
+            return;
+        }
+        added[m].push_back(EnvPathItem_t{record.path, record.enabled});
+    }, result.errors);
+    if (!ok)
+    {
+        return false;
+    }
+    result.added = added[0].size() + added[1].size();
+    for (int m = 0; m < 2; m++)
+    {
+        models[m]->appendAll(std::move(added[m]));
+    }
+    return true;
+}
+
+// regedit的格式：每行不超过80列，逗号后用反斜杠续行，续行缩进两个空格
+static void appendHexValue(std::string &out, const std::u16string &value)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string head = "\"Path\"=hex(2):";
+    out += head;
+    size_t column = head.size();
+    size_t byteCount = (value.size() + 1) * 2; // 含结尾的0
+    for (size_t b = 0; b < byteCount; b++)
+    {
+        size_t unit = b / 2;
+        unsigned value16 = unit < value.size() ? value[unit] : 0;
+        unsigned byte = (b % 2 == 0) ? (value16 & 0xFF) : (value16 >> 8);
+        out.push_back(digits[byte >> 4]);
+        out.push_back(digits[byte & 0xF]);
+        column += 2;
+        if (b + 1 == byteCount)
+            break;
+        out.push_back(',');
+        column++;
+        if (column >= 76)
+        {
+            out += "\\\r\n  ";
+            column = 2;
+        }
+    }
+    out += "\r\n";
+}
+
+static bool writeRegFile(const fs::path &file, const std::vector<EnvPathItem_t> &systemPaths,
+                         const std::vector<EnvPathItem_t> &userPaths)
+{
+    std::ofstream outFile(file, std::ios::binary);
+    if (!outFile.is_open())
+    {
+        return false;
+    }
+    std::string text = "Windows Registry Editor Version 5.00\r\n";
+    const char *keys[2] = {systemKey, userKey};
+    const std::vector<EnvPathItem_t> *lists[2] = {&systemPaths, &userPaths};
+    for (int m = 0; m < 2; m++)
+    {
+        std::string joined;
+        for (const auto &item : *lists[m])
+        {
+            if (!item.enabled)
+                continue;
+            if (!joined.empty())
+                joined.push_back(';');
+            joined += item.path;
+        }
+        text += "\r\n[" + std::string(keys[m]) + "]\r\n";
+        appendHexValue(text, widen(joined));
+    }
+
+    // 整个文件为带BOM的UTF-16LE；其余部分都是ASCII，按字节扩展即可
+    std::string bytes = "\xFF\xFE";
+    bytes.reserve(2 + text.size() * 2);
+    for (char c : text)
+    {
+        bytes.push_back(c);
+        bytes.push_back('\0');
+    }
+    outFile.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    return outFile.good();
+}
+
+static bool writeJsonLines(const fs::path &file, const std::vector<EnvPathItem_t> &systemPaths,
+                           const std::vector<EnvPathItem_t> &userPaths)
+{
+    std::ofstream outFile(file, std::ios::binary);
+    if (!outFile.is_open())
+    {
+        return false;
+    }
+    const char *scopes[2] = {"system", "user"};
+    const std::vector<EnvPathItem_t> *lists[2] = {&systemPaths, &userPaths};
+    for (int m = 0; m < 2; m++)
+    {
+        for (const auto &item : *lists[m])
+        {
+            json record = {{"scope", scopes[m]}, {"path", item.path}, {"enabled", item.enabled}};
+            outFile << record.dump(-1, ' ', false, json::error_handler_t::replace) << '\n';
+        }
+    }
+    return outFile.good();
+}
+
+bool PathExporter::writeFile(const fs::path &file, PathFileFormat fileFormat,
+                             const std::vector<EnvPathItem_t> &systemPaths,
+                             const std::vector<EnvPathItem_t> &userPaths)
+{
+    switch (fileFormat)
+    {
+    case PATH_FORMAT_REG:
+        return writeRegFile(file, systemPaths, userPaths);
+    case PATH_FORMAT_JSON_LINES:
+        return writeJsonLines(file, systemPaths, userPaths);
+    case PATH_FORMAT_TEXT:
+        break;
+    }
+    return PathStateStore::writePathList(file, systemPaths, userPaths);
+}
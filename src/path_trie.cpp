@@ -0,0 +1,433 @@
+#include "path_trie.hpp"
+#include "path_utils.hpp"
+#include <sstream>
+#include <unordered_set>
+
+#ifdef _WIN32
+static const char componentSeparator = '\\';
+#else
+static const char componentSeparator = '/';
+#endif
+
+PathTrie::PathTrie() : nodes(0)
+{
+    root.parent = nullptr;
+    root.subtree = 0;
+    for (auto &side : sides)
+    {
+        side.model = nullptr;
+        side.subscription = 0;
+    }
+}
+
+PathTrie::~PathTrie()
+{
+    for (auto &side : sides)
+    {
+        if (side.model)
+            side.model->unsubscribe(side.subscription);
+    }
+}
+
+void PathTrie::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+    clear();
+    resync(0);
+    resync(1);
+}
+
+void PathTrie::clear()
+{
+    root.children.clear();
+    root.holders.clear();
+    root.subtree = 0;
+    held.clear();
+    nodes = 0;
+    for (auto &side : sides)
+    {
+        side.rows.clear();
+    }
+}
+
+void PathTrie::attach(PathListModel *system, PathListModel *user)
+{
+    PathListModel *targets[2] = {system, user};
+    for (int side = 0; side < 2; side++)
+    {
+        Side &s = sides[side];
+        if (s.model)
+            s.model->unsubscribe(s.subscription);
+        s.model = targets[side];
+        if (s.model)
+        {
+            s.subscription =
+                s.model->subscribe([this, side](const PathListChange_t &change) { onModelChange(side, change); });
+        }
+        resync(side);
+    }
+}
+
+PathTrie::Row PathTrie::measure(const PathListModel &model, size_t index) const
+{
+    const EnvPathItem_t &item = model.at(index);
+    bool counted = !model.isDeleted(index) && item.enabled;
+    return Row{counted ? item.path : std::string(), counted};
+}
+
+void PathTrie::onModelChange(int side, const PathListChange_t &change)
+{
+    Side &s = sides[side];
+    bool user = side == 1;
+    switch (change.kind)
+    {
+    case PathListChange_t::INSERT:
+        s.rows.insert(s.rows.begin() + change.index, measure(*s.model, change.index));
+        if (s.rows[change.index].counted)
+            insert(user, s.rows[change.index].path, 1);
+        break;
+    case PathListChange_t::REMOVE:
+    case PathListChange_t::RESTORE:
+    case PathListChange_t::TOGGLE:
+    case PathListChange_t::EDIT:
+    {
+        // 镜像中是变化前的写法：先移走这一行原来的条目，再按新状态放回
+        Row row = measure(*s.model, change.index);
+        Row &old = s.rows[change.index];
+        if (old.counted == row.counted && old.path == row.path)
+            break;
+        if (old.counted)
+            erase(user, old.path, 1);
+        if (row.counted)
+            insert(user, row.path, 1);
+        old = std::move(row);
+        break;
+    }
+    case PathListChange_t::MOVE:
+    {
+        // 树与顺序无关，只需要让镜像跟随移动
+        Row row = std::move(s.rows[change.index]);
+        s.rows.erase(s.rows.begin() + change.index);
+        s.rows.insert(s.rows.begin() + change.toIndex, std::move(row));
+        break;
+    }
+    case PathListChange_t::COMPACT:
+    {
+        // 去掉的都是墓碑，树中的条目不变，只重建镜像
+        std::vector<Row> rows;
+        rows.reserve(s.model->size());
+        for (size_t i = 0; i < s.model->size(); i++)
+        {
+            rows.push_back(measure(*s.model, i));
+        }
+        s.rows = std::move(rows);
+        break;
+    }
+    case PathListChange_t::RESET:
+        resync(side);
+        break;
+    }
+}
+
+void PathTrie::resync(int side)
+{
+    Side &s = sides[side];
+    bool user = side == 1;
+    // 原始写法 -> 新次数减旧次数
+    std::unordered_map<std::string, long long> delta;
+    for (const auto &row : s.rows)
+    {
+        if (row.counted)
+            delta[row.path]--;
+    }
+    s.rows.clear();
+    if (s.model)
+    {
+        s.rows.reserve(s.model->size());
+        for (size_t i = 0; i < s.model->size(); i++)
+        {
+            s.rows.push_back(measure(*s.model, i));
+            if (s.rows.back().counted)
+                delta[s.rows.back().path]++;
+        }
+    }
+    // 先减后加，同一节点上的条目不会先被删掉分支再重建
+    for (const auto &change : delta)
+    {
+        if (change.second < 0)
+            erase(user, change.first, static_cast<size_t>(-change.second));
+    }
+    for (const auto &change : delta)
+    {
+        if (change.second > 0)
+            insert(user, change.first, static_cast<size_t>(change.second));
+    }
+}
+
+size_t PathTrie::nodeCount() const
+{
+    return nodes;
+}
+
+std::vector<std::string> PathTrie::components(const std::string &key) const
+{
+    std::vector<std::string> parts;
+    // 根的形式作为第一个分量，避免相对路径与根目录下的同名目录混在一起
+    if (key.size() >= 2 && key[0] == componentSeparator && key[1] == componentSeparator)
+        parts.push_back(std::string(2, componentSeparator)); // UNC
+    else if (!key.empty() && key[0] == componentSeparator)
+        parts.push_back(std::string(1, componentSeparator));
+    std::vector<std::string> rest = splitList(key, componentSeparator);
+    parts.insert(parts.end(), rest.begin(), rest.end());
+    return parts;
+}
+
+void PathTrie::insert(bool user, const std::string &rawPath, size_t count)
+{
+    auto heldIt = held.find(std::make_pair(user, rawPath));
+    Node *node = nullptr;
+    if (heldIt != held.end())
+    {
+        node = heldIt->second.node;
+        heldIt->second.count += count;
+    }
+    else
+    {
+        std::string key = normalizePathKey(expander ? expander(rawPath) : rawPath);
+        node = &root;
+        for (const auto &part : components(key))
+        {
+            auto &child = node->children[part];
+            if (!child)
+            {
+                child.reset(new Node());
+                child->parent = node;
+                child->subtree = 0;
+                if (node == &root || node->key.back() == componentSeparator)
+                    child->key = node->key + part;
+                else
+                    child->key = node->key + componentSeparator + part;
+                nodes++;
+            }
+            node = child.get();
+        }
+        held.emplace(std::make_pair(user, rawPath), Held{count, node});
+    }
+    node->holders[std::make_pair(user, rawPath)] += count;
+    for (Node *n = node; n; n = n->parent)
+    {
+        n->subtree += count;
+    }
+}
+
+void PathTrie::erase(bool user, const std::string &rawPath, size_t count)
+{
+    auto heldIt = held.find(std::make_pair(user, rawPath));
+    if (heldIt == held.end())
+        return;
+    Node *node = heldIt->second.node;
+    if (count > heldIt->second.count)
+        count = heldIt->second.count;
+    heldIt->second.count -= count;
+    if (heldIt->second.count == 0)
+        held.erase(heldIt);
+
+    auto holder = node->holders.find(std::make_pair(user, rawPath));
+    holder->second -= count;
+    if (holder->second == 0)
+        node->holders.erase(holder);
+    for (Node *n = node; n; n = n->parent)
+    {
+        n->subtree -= count;
+    }
+    // 去掉已经没有条目的分支
+    while (node != &root && node->subtree == 0)
+    {
+        Node *parent = node->parent;
+        for (auto it = parent->children.begin(); it != parent->children.end(); ++it)
+        {
+            if (it->second.get() == node)
+            {
+                parent->children.erase(it);
+                nodes--;
+                break;
+            }
+        }
+        node = parent;
+    }
+}
+
+void PathTrie::reexpand(const std::vector<std::string> &rawPaths)
+{
+    for (const auto &raw : rawPaths)
+    {
+        for (bool user : {false, true})
+        {
+            auto it = held.find(std::make_pair(user, raw));
+            if (it == held.end())
+                continue;
+            size_t count = it->second.count;
+            erase(user, raw, count);
+            insert(user, raw, count);
+        }
+    }
+}
+
+PathTrie::Entry_t PathTrie::makeEntry(const std::pair<const std::pair<bool, std::string>, size_t> &holder)
+{
+    return Entry_t{holder.first.second, holder.first.first, holder.second};
+}
+
+bool PathTrie::differsOnlyInTrailing(const std::string &a, const std::string &b)
+{
+    auto trimmed = [](const std::string &value) {
+        size_t end = value.size();
+        while (end > 1 && (value[end - 1] == '\\' || value[end - 1] == '/'))
+            end--;
+        return value.substr(0, end);
+    };
+    return a != b && trimmed(a) == trimmed(b);
+}
+
+std::vector<PathTrie::Group_t> PathTrie::duplicateGroups() const
+{
+    std::vector<Group_t> groups;
+    std::vector<const Node *> stack(1, &root);
+    while (!stack.empty())
+    {
+        const Node *node = stack.back();
+        stack.pop_back();
+        // 只有子树中条目数大于1的分支才可能有重复
+        for (const auto &child : node->children)
+        {
+            if (child.second->subtree > 1)
+                stack.push_back(child.second.get());
+        }
+        size_t total = 0;
+        for (const auto &holder : node->holders)
+        {
+            total += holder.second;
+        }
+        if (total < 2)
+            continue;
+
+        Group_t group{node->key, std::vector<Entry_t>(), total, false, true};
+        bool hasSystem = false;
+        bool hasUser = false;
+        for (const auto &holder : node->holders)
+        {
+            group.entries.push_back(makeEntry(holder));
+            (holder.first.first ? hasUser : hasSystem) = true;
+        }
+        group.crossTable = hasSystem && hasUser;
+        for (size_t i = 1; i < group.entries.size(); i++)
+        {
+            if (!differsOnlyInTrailing(group.entries[0].path, group.entries[i].path))
+                group.trailingOnly = false;
+        }
+        if (group.entries.size() == 1)
+            group.trailingOnly = false;
+        groups.push_back(std::move(group));
+    }
+    return groups;
+}
+
+std::vector<PathTrie::Nested_t> PathTrie::nestedEntries() const
+{
+    std::vector<Nested_t> result;
+    // (节点, 最近的有条目的上级)
+    std::vector<std::pair<const Node *, const Node *>> stack(1, std::make_pair(&root, (const Node *)nullptr));
+    while (!stack.empty())
+    {
+        const Node *node = stack.back().first;
+        const Node *ancestor = stack.back().second;
+        stack.pop_back();
+        if (!node->holders.empty())
+        {
+            if (ancestor)
+            {
+                for (const auto &holder : node->holders)
+                {
+                    result.push_back(Nested_t{makeEntry(*ancestor->holders.begin()), makeEntry(holder)});
+                }
+            }
+            // 没有下级条目时不用继续
+            size_t own = 0;
+            for (const auto &holder : node->holders)
+            {
+                own += holder.second;
+            }
+            if (node->subtree == own)
+                continue;
+            ancestor = node;
+        }
+        for (const auto &child : node->children)
+        {
+            stack.push_back(std::make_pair(child.second.get(), ancestor));
+        }
+    }
+    return result;
+}
+
+void PathTrie::redundantRows(const PathListModel &system, const PathListModel &user,
+                             std::vector<size_t> &systemRows, std::vector<size_t> &userRows) const
+{
+    std::unordered_set<const Node *> seen;
+    const PathListModel *models[2] = {&system, &user};
+    std::vector<size_t> *rows[2] = {&systemRows, &userRows};
+    for (int m = 0; m < 2; m++)
+    {
+        for (size_t i = 0; i < models[m]->size(); i++)
+        {
+            if (models[m]->isDeleted(i) || !models[m]->at(i).enabled)
+                continue;
+            auto it = held.find(std::make_pair(m == 1, models[m]->at(i).path));
+            if (it == held.end())
+                continue; // 树尚未同步到该条目
+            if (!seen.insert(it->second.node).second)
+                rows[m]->push_back(i);
+        }
+    }
+}
+
+std::string PathTrie::formatReport() const
+{
+    auto describe = [](const Entry_t &entry) {
+        std::string text = std::string(entry.user ? "[用户] " : "[系统] ") + entry.path;
+        if (entry.count > 1)
+            text += "  ×" + std::to_string(entry.count);
+        return text;
+    };
+
+    std::vector<Group_t> groups = duplicateGroups();
+    std::vector<Nested_t> nested = nestedEntries();
+    size_t redundant = 0;
+    for (const auto &group : groups)
+    {
+        redundant += group.total - 1;
+    }
+
+    std::ostringstream out;
+    out << "重复的目录 " << groups.size() << " 个，可删除 " << redundant << " 个条目\n";
+    out << "清理时按系统在前、用户在后的生效顺序保留第一次出现的条目，PATH的查找结果不变\n\n";
+    for (const auto &group : groups)
+    {
+        out << group.key;
+        if (group.crossTable)
+            out << "    (系统和用户Path中都有)";
+        else if (group.trailingOnly)
+            out << "    (只差结尾分隔符)";
+        out << "\n";
+        for (const auto &entry : group.entries)
+        {
+            out << "    " << describe(entry) << "\n";
+        }
+    }
+
+    out << "\n互为上下级的目录 " << nested.size() << " 对（PATH不搜索子目录，两者都有效，仅供参考）\n";
+    for (const auto &pair : nested)
+    {
+        out << "    " << describe(pair.descendant) << "\n        在 " << describe(pair.ancestor) << " 之下\n";
+    }
+    return out.str();
+}
@@ -0,0 +1,71 @@
+#include "path_utils.hpp"
+#include <cstdlib>
+
+std::string toLowerAscii(const std::string &value)
+{
+    std::string result(value);
+    for (auto &ch : result)
+    {
+        if (ch >= 'A' && ch <= 'Z')
+            ch = static_cast<char>(ch - 'A' + 'a');
+    }
+    return result;
+}
+
+std::string normalizePathKey(const std::string &path)
+{
+    std::string key;
+    key.reserve(path.size());
+    for (char ch : path)
+    {
+#ifdef _WIN32
+        if (ch == '/')
+            ch = '\\';
+        if (ch >= 'A' && ch <= 'Z')
+            ch = static_cast<char>(ch - 'A' + 'a');
+#endif
+        key.push_back(ch);
+    }
+    // 保留根目录本身的分隔符，例如 "C:\" 和 "/"
+    while (key.size() > 1 && (key.back() == '\\' || key.back() == '/') &&
+           !(key.size() == 3 && key[1] == ':'))
+    {
+        key.pop_back();
+    }
+    return key;
+}
+
+std::vector<std::string> splitList(const std::string &value, char separator)
+{
+    std::vector<std::string> result;
+    size_t start = 0;
+    while (start <= value.size())
+    {
+        size_t end = value.find(separator, start);
+        if (end == std::string::npos)
+            end = value.size();
+        if (end > start)
+            result.push_back(value.substr(start, end - start));
+        start = end + 1;
+    }
+    return result;
+}
+
+std::vector<std::string> executableExtensions()
+{
+#ifdef _WIN32
+    std::string pathExt = ".COM;.EXE;.BAT;.CMD;.VBS;.VBE;.JS;.JSE;.WSF;.WSH;.MSC";
+    char *buffer = nullptr;
+    size_t len = 0;
+    if (_dupenv_s(&buffer, &len, "PATHEXT") == 0 && buffer != nullptr)
+    {
+        if (buffer[0] != '\0')
+            pathExt = buffer;
+        free(buffer);
+    }
+    std::vector<std::string> result = splitList(toLowerAscii(pathExt), ';');
+    return result;
+#else
+    return std::vector<std::string>();
+#endif
+}
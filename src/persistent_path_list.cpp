@@ -0,0 +1,359 @@
+#include "persistent_path_list.hpp"
+#include <stdexcept>
+
+PersistentPathList::PersistentPathList() : root(nullptr)
+{
+}
+
+PersistentPathList::PersistentPathList(NodePtr r) : root(std::move(r))
+{
+}
+
+PersistentPathList::PersistentPathList(const std::vector<EnvPathItem_t> &items) : root(build(items, 0, items.size()))
+{
+}
+
+PersistentPathList::PersistentPathList(std::vector<EnvPathItem_t> &&items) : root(build(std::move(items), 0, items.size()))
+{
+}
+
+int PersistentPathList::heightOf(const NodePtr &n)
+{
+    return n ? n->height : 0;
+}
+
+size_t PersistentPathList::sizeOf(const NodePtr &n)
+{
+    return n ? n->size : 0;
+}
+
+size_t PersistentPathList::liveOf(const NodePtr &n)
+{
+    return n ? n->live : 0;
+}
+
+PersistentPathList::NodePtr PersistentPathList::makeNode(const ItemPtr &item, bool deleted, const NodePtr &left, const NodePtr &right)
+{
+    int lh = heightOf(left);
+    int rh = heightOf(right);
+    return std::make_shared<const Node>(Node{
+        item,
+        deleted,
+        (lh > rh ? lh : rh) + 1,
+        sizeOf(left) + sizeOf(right) + 1,
+        liveOf(left) + liveOf(right) + (deleted ? 0 : 1),
+        left,
+        right});
+}
+
+// 构造节点时顺带做AVL旋转，左右子树高度差不超过1
+PersistentPathList::NodePtr PersistentPathList::balance(const ItemPtr &item, bool deleted, const NodePtr &left, const NodePtr &right)
+{
+    int lh = heightOf(left);
+    int rh = heightOf(right);
+    if (lh > rh + 1)
+    {
+        if (heightOf(left->left) >= heightOf(left->right))
+        {
+            // 右旋
+            return makeNode(left->item, left->deleted, left->left,
+                            makeNode(item, deleted, left->right, right));
+        }
+        // 先左旋再右旋
+        const NodePtr &lr = left->right;
+        return makeNode(lr->item, lr->deleted,
+                        makeNode(left->item, left->deleted, left->left, lr->left),
+                        makeNode(item, deleted, lr->right, right));
+    }
+    if (rh > lh + 1)
+    {
+        if (heightOf(right->right) >= heightOf(right->left))
+        {
+            // 左旋
+            return makeNode(right->item, right->deleted,
+                            makeNode(item, deleted, left, right->left), right->right);
+        }
+        // 先右旋再左旋
+        const NodePtr &rl = right->left;
+        return makeNode(rl->item, rl->deleted,
+                        makeNode(item, deleted, left, rl->left),
+                        makeNode(right->item, right->deleted, rl->right, right->right));
+    }
+    return makeNode(item, deleted, left, right);
+}
+
+PersistentPathList::NodePtr PersistentPathList::build(const std::vector<EnvPathItem_t> &items, size_t lo, size_t hi)
+{
+    if (lo >= hi)
+        return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    NodePtr left = build(items, lo, mid);
+    NodePtr right = build(items, mid + 1, hi);
+    return makeNode(std::make_shared<const EnvPathItem_t>(items[mid]), false, left, right);
+}
+
+PersistentPathList::NodePtr PersistentPathList::build(std::vector<EnvPathItem_t> &&items, size_t lo, size_t hi)
+{
+    if (lo >= hi)
+        return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    NodePtr left = build(std::move(items), lo, mid);
+    NodePtr right = build(std::move(items), mid + 1, hi);
+    return makeNode(std::make_shared<const EnvPathItem_t>(std::move(items[mid])), false, left, right);
+}
+
+// AVL拼接：left中的行都在item之前，right中的都在之后。
+// 沿较高一侧的边缘下降到高度相近处再挂上，路径上逐层旋转，其余节点原样共享
+PersistentPathList::NodePtr PersistentPathList::join(const NodePtr &left, const ItemPtr &item, const NodePtr &right)
+{
+    int lh = heightOf(left);
+    int rh = heightOf(right);
+    if (lh > rh + 1)
+        return balance(left->item, left->deleted, left->left, join(left->right, item, right));
+    if (rh > lh + 1)
+        return balance(right->item, right->deleted, join(left, item, right->left), right->right);
+    return makeNode(item, false, left, right);
+}
+
+PersistentPathList::NodePtr PersistentPathList::insertAt(const NodePtr &n, size_t index, const ItemPtr &item)
+{
+    if (!n)
+        return makeNode(item, false, nullptr, nullptr);
+    size_t leftSize = sizeOf(n->left);
+    if (index <= leftSize)
+        return balance(n->item, n->deleted, insertAt(n->left, index, item), n->right);
+    return balance(n->item, n->deleted, n->left, insertAt(n->right, index - leftSize - 1, item));
+}
+
+PersistentPathList::NodePtr PersistentPathList::eraseAt(const NodePtr &n, size_t index)
+{
+    size_t leftSize = sizeOf(n->left);
+    if (index < leftSize)
+        return balance(n->item, n->deleted, eraseAt(n->left, index), n->right);
+    if (index > leftSize)
+        return balance(n->item, n->deleted, n->left, eraseAt(n->right, index - leftSize - 1));
+    if (!n->left)
+        return n->right;
+    if (!n->right)
+        return n->left;
+    // 用右子树最左边的节点顶替当前节点
+    const Node *successor = n->right.get();
+    while (successor->left)
+    {
+        successor = successor->left.get();
+    }
+    return balance(successor->item, successor->deleted, n->left, eraseAt(n->right, 0));
+}
+
+PersistentPathList::NodePtr PersistentPathList::replaceAt(const NodePtr &n, size_t index, const ItemPtr &item, bool deleted)
+{
+    // 结构不变，只沿路径复制节点
+    size_t leftSize = sizeOf(n->left);
+    if (index < leftSize)
+        return makeNode(n->item, n->deleted, replaceAt(n->left, index, item, deleted), n->right);
+    if (index > leftSize)
+        return makeNode(n->item, n->deleted, n->left, replaceAt(n->right, index - leftSize - 1, item, deleted));
+    return makeNode(item, deleted, n->left, n->right);
+}
+
+const PersistentPathList::Node *PersistentPathList::nodeAt(const NodePtr &n, size_t index)
+{
+    const Node *cur = n.get();
+    while (cur)
+    {
+        size_t leftSize = sizeOf(cur->left);
+        if (index < leftSize)
+        {
+            cur = cur->left.get();
+        }
+        else if (index > leftSize)
+        {
+            index -= leftSize + 1;
+            cur = cur->right.get();
+        }
+        else
+        {
+            return cur;
+        }
+    }
+    throw std::out_of_range("PersistentPathList index out of range");
+}
+
+void PersistentPathList::collect(const NodePtr &n, std::vector<EnvPathItem_t> &out, bool includeDeleted)
+{
+    if (!n)
+        return;
+    collect(n->left, out, includeDeleted);
+    if (includeDeleted || !n->deleted)
+    {
+        out.push_back(*n->item);
+    }
+    collect(n->right, out, includeDeleted);
+}
+
+void PersistentPathList::visitLive(const NodePtr &n, size_t &index,
+                                   const std::function<void(size_t, const EnvPathItem_t &)> &visit)
+{
+    if (!n)
+        return;
+    // 整棵子树都是墓碑时直接跳过
+    if (n->live == 0)
+    {
+        index += n->size;
+        return;
+    }
+    visitLive(n->left, index, visit);
+    if (!n->deleted)
+    {
+        visit(index, *n->item);
+    }
+    index++;
+    visitLive(n->right, index, visit);
+}
+
+size_t PersistentPathList::size() const
+{
+    return sizeOf(root);
+}
+
+size_t PersistentPathList::liveSize() const
+{
+    return liveOf(root);
+}
+
+bool PersistentPathList::empty() const
+{
+    return root == nullptr;
+}
+
+const EnvPathItem_t &PersistentPathList::at(size_t index) const
+{
+    return *nodeAt(root, index)->item;
+}
+
+bool PersistentPathList::isDeleted(size_t index) const
+{
+    return nodeAt(root, index)->deleted;
+}
+
+size_t PersistentPathList::liveToIndex(size_t liveRow) const
+{
+    const Node *cur = root.get();
+    size_t base = 0;
+    while (cur)
+    {
+        size_t leftLive = liveOf(cur->left);
+        if (liveRow < leftLive)
+        {
+            cur = cur->left.get();
+            continue;
+        }
+        liveRow -= leftLive;
+        if (!cur->deleted)
+        {
+            if (liveRow == 0)
+                return base + sizeOf(cur->left);
+            liveRow--;
+        }
+        base += sizeOf(cur->left) + 1;
+        cur = cur->right.get();
+    }
+    throw std::out_of_range("PersistentPathList live row out of range");
+}
+
+PersistentPathList PersistentPathList::set(size_t index, const EnvPathItem_t &item) const
+{
+    const Node *n = nodeAt(root, index);
+    return PersistentPathList(replaceAt(root, index, std::make_shared<const EnvPathItem_t>(item), n->deleted));
+}
+
+PersistentPathList PersistentPathList::setEnabled(size_t index, bool enabled) const
+{
+    const Node *n = nodeAt(root, index);
+    if (n->item->enabled == enabled)
+        return *this;
+    return PersistentPathList(replaceAt(root, index, std::make_shared<const EnvPathItem_t>(EnvPathItem_t{n->item->path, enabled}), n->deleted));
+}
+
+PersistentPathList PersistentPathList::setDeleted(size_t index, bool deleted) const
+{
+    const Node *n = nodeAt(root, index);
+    if (n->deleted == deleted)
+        return *this;
+    // 条目本身不变，直接共享
+    return PersistentPathList(replaceAt(root, index, n->item, deleted));
+}
+
+PersistentPathList PersistentPathList::insert(size_t index, const EnvPathItem_t &item) const
+{
+    if (index > size())
+        throw std::out_of_range("PersistentPathList insert position out of range");
+    return PersistentPathList(insertAt(root, index, std::make_shared<const EnvPathItem_t>(item)));
+}
+
+PersistentPathList PersistentPathList::pushBack(const EnvPathItem_t &item) const
+{
+    return insert(size(), item);
+}
+
+PersistentPathList PersistentPathList::appended(std::vector<EnvPathItem_t> &&items) const
+{
+    if (items.empty())
+        return *this;
+    // 第一项作为拼接点，其余项先建成一棵平衡树
+    ItemPtr first = std::make_shared<const EnvPathItem_t>(std::move(items[0]));
+    NodePtr rest = build(std::move(items), 1, items.size());
+    return PersistentPathList(join(root, first, rest));
+}
+
+PersistentPathList PersistentPathList::erase(size_t index) const
+{
+    if (index >= size())
+        throw std::out_of_range("PersistentPathList erase position out of range");
+    return PersistentPathList(eraseAt(root, index));
+}
+
+PersistentPathList PersistentPathList::move(size_t from, size_t to) const
+{
+    if (from == to)
+        return *this;
+    const Node *n = nodeAt(root, from);
+    ItemPtr item = n->item;
+    bool deleted = n->deleted;
+    NodePtr removed = eraseAt(root, from);
+    if (to > sizeOf(removed))
+        throw std::out_of_range("PersistentPathList move target out of range");
+    NodePtr inserted = insertAt(removed, to, item);
+    // insertAt插入的是未删除的行，墓碑行移动时还原标记
+    if (deleted)
+        inserted = replaceAt(inserted, to, item, true);
+    return PersistentPathList(inserted);
+}
+
+PersistentPathList PersistentPathList::compacted() const
+{
+    if (liveSize() == size())
+        return *this;
+    std::vector<EnvPathItem_t> items;
+    items.reserve(liveSize());
+    collect(root, items, false);
+    return PersistentPathList(items);
+}
+
+bool PersistentPathList::sameAs(const PersistentPathList &other) const
+{
+    return root == other.root;
+}
+
+void PersistentPathList::toVector(std::vector<EnvPathItem_t> &out, bool includeDeleted) const
+{
+    out.clear();
+    out.reserve(includeDeleted ? size() : liveSize());
+    collect(root, out, includeDeleted);
+}
+
+void PersistentPathList::forEachLive(const std::function<void(size_t index, const EnvPathItem_t &item)> &visit) const
+{
+    size_t index = 0;
+    visitLive(root, index, visit);
+}
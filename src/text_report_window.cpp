@@ -0,0 +1,41 @@
+#include "text_report_window.hpp"
+#include <FL/Fl.H>
+
+TextReportWindow::TextReportWindow(int W, int H, const char *title) : Fl_Double_Window(W, H)
+{
+    copy_label(title);
+    buffer = new Fl_Text_Buffer();
+    display = new Fl_Text_Display(5, 5, W - 10, H - 10);
+    display->buffer(buffer);
+    display->textfont(FL_COURIER);
+    end();
+    resizable(display);
+    callback(closeCallback, this);
+}
+
+TextReportWindow::~TextReportWindow()
+{
+    // 显示控件析构时还会访问缓冲区，先断开
+    display->buffer(nullptr);
+    delete buffer;
+}
+
+void TextReportWindow::closeCallback(Fl_Widget *w, void *data)
+{
+    TextReportWindow *win = static_cast<TextReportWindow *>(data);
+    win->hide();
+    Fl::delete_widget(win);
+}
+
+void TextReportWindow::setText(const std::string &text)
+{
+    buffer->text(text.c_str());
+}
+
+TextReportWindow *TextReportWindow::open(const char *title, const std::string &text)
+{
+    TextReportWindow *win = new TextReportWindow(760, 520, title);
+    win->setText(text);
+    win->show();
+    return win;
+}
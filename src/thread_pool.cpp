@@ -0,0 +1,76 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(size_t threadCount) : running(0), stopping(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::thread::hardware_concurrency();
+        if (threadCount == 0)
+            threadCount = 2;
+    }
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++)
+    {
+        workers.emplace_back([this]() { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        tasks.clear();
+    }
+    taskReady.notify_all();
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskReady.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping)
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            running++;
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            if (running == 0 && tasks.empty())
+                allDone.notify_all();
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    taskReady.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this]() { return running == 0 && tasks.empty(); });
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size();
+}
@@ -0,0 +1,251 @@
+#include "which_resolver.hpp"
+#include "path_utils.hpp"
+#include <algorithm>
+
+namespace fs = std::filesystem;
+
+WhichResolver::WhichResolver(size_t threadCount)
+    : extensions(executableExtensions()),
+      revalidateInterval(2000),
+      validated(false),
+      enumerations(0),
+      pool(threadCount != 0 ? threadCount : (std::thread::hardware_concurrency() > 4 ? std::thread::hardware_concurrency() : 4))
+{
+}
+
+void WhichResolver::setExpander(Expander exp)
+{
+    expander = std::move(exp);
+    invalidate();
+}
+
+void WhichResolver::setRevalidateInterval(std::chrono::milliseconds interval)
+{
+    revalidateInterval = interval;
+}
+
+void WhichResolver::setSearchPath(const std::vector<std::string> &paths)
+{
+    if (paths == rawPaths)
+    {
+        return;
+    }
+    rawPaths = paths;
+    searchDirs.clear();
+    searchKeys.clear();
+    for (const auto &raw : rawPaths)
+    {
+        std::string expanded = expander ? expander(raw) : raw;
+        searchKeys.push_back(normalizePathKey(expanded));
+        searchDirs.push_back(std::move(expanded));
+    }
+    // 目录列表按目录缓存，换顺序不需要重新列出，只有查询结果失效
+    memo.clear();
+    validated = false;
+}
+
+const std::vector<std::string> &WhichResolver::searchPath() const
+{
+    return rawPaths;
+}
+
+void WhichResolver::reexpand(const std::vector<std::string> &changedPaths)
+{
+    std::unordered_map<std::string, bool> changed;
+    for (const auto &raw : changedPaths)
+    {
+        changed.emplace(raw, true);
+    }
+    bool any = false;
+    for (size_t i = 0; i < rawPaths.size(); i++)
+    {
+        if (!changed.count(rawPaths[i]))
+            continue;
+        searchDirs[i] = expander ? expander(rawPaths[i]) : rawPaths[i];
+        searchKeys[i] = normalizePathKey(searchDirs[i]);
+        any = true;
+    }
+    if (any)
+    {
+        invalidate();
+    }
+}
+
+void WhichResolver::invalidate()
+{
+    memo.clear();
+    validated = false;
+}
+
+size_t WhichResolver::enumerationCount() const
+{
+    return enumerations;
+}
+
+void WhichResolver::revalidate()
+{
+    // 每个目录一个任务：先比较修改时间，变化了才重新列出
+    struct Slot {
+        std::string key;
+        std::string dir;
+        bool known;
+        Listing cached; // 只带mtime/exists，用于比较
+        bool changed;
+        Listing fresh;
+    };
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, bool> seen;
+    for (size_t i = 0; i < searchKeys.size(); i++)
+    {
+        if (!seen.emplace(searchKeys[i], true).second)
+            continue;
+        Slot slot{searchKeys[i], searchDirs[i], false, Listing(), false, Listing()};
+        auto it = listings.find(searchKeys[i]);
+        if (it != listings.end())
+        {
+            slot.known = true;
+            slot.cached.mtime = it->second.mtime;
+            slot.cached.exists = it->second.exists;
+        }
+        slots.push_back(std::move(slot));
+    }
+
+    const std::vector<std::string> &exts = extensions;
+    for (auto &slot : slots)
+    {
+        Slot *target = &slot;
+        pool.submit([target, &exts]() {
+            std::error_code ec;
+            fs::file_time_type mtime = fs::last_write_time(fs::path(target->dir), ec);
+            bool exists = !ec;
+            if (target->known && exists == target->cached.exists && (!exists || mtime == target->cached.mtime))
+                return;
+            target->changed = true;
+            target->fresh = exists ? listDirectory(target->dir, exts) : Listing();
+            target->fresh.mtime = mtime;
+            target->fresh.exists = exists;
+        });
+    }
+    pool.waitIdle();
+
+    for (auto &slot : slots)
+    {
+        if (!slot.changed)
+            continue;
+        if (slot.fresh.exists)
+            enumerations++;
+        listings[slot.key] = std::move(slot.fresh);
+        memo.clear();
+    }
+    lastValidated = std::chrono::steady_clock::now();
+    validated = true;
+}
+
+std::vector<std::string> WhichResolver::candidates(const std::string &command) const
+{
+    std::vector<std::string> names;
+    if (extensions.empty())
+    {
+        names.push_back(command);
+        return names;
+    }
+    // 已经带了PATHEXT中的扩展名时只找这个文件，否则依次尝试各扩展名
+    std::string name = toLowerAscii(command);
+    size_t dot = name.rfind('.');
+    if (dot != std::string::npos &&
+        std::find(extensions.begin(), extensions.end(), name.substr(dot)) != extensions.end())
+    {
+        names.push_back(name);
+        return names;
+    }
+    for (const auto &ext : extensions)
+    {
+        names.push_back(name + ext);
+    }
+    return names;
+}
+
+std::vector<WhichHit_t> WhichResolver::resolve(const std::string &command)
+{
+    if (command.empty() || command.find_first_of("\\/") != std::string::npos)
+    {
+        return std::vector<WhichHit_t>();
+    }
+
+    if (!validated || std::chrono::steady_clock::now() - lastValidated >= revalidateInterval)
+    {
+        revalidate();
+    }
+
+    std::string memoKey = extensions.empty() ? command : toLowerAscii(command);
+    auto cached = memo.find(memoKey);
+    if (cached != memo.end())
+    {
+        return cached->second;
+    }
+
+    std::vector<WhichHit_t> hits;
+    std::vector<std::string> names = candidates(command);
+    std::unordered_map<std::string, bool> seen;
+    for (size_t i = 0; i < searchKeys.size(); i++)
+    {
+        if (!seen.emplace(searchKeys[i], true).second)
+            continue; // 同一目录出现多次只算第一次
+        auto it = listings.find(searchKeys[i]);
+        if (it == listings.end())
+            continue;
+        for (const auto &name : names)
+        {
+            auto file = it->second.files.find(name);
+            if (file != it->second.files.end())
+            {
+                hits.push_back(WhichHit_t{(fs::path(searchDirs[i]) / file->second).string(), i});
+                break; // 一个目录里按扩展名顺序只取第一个
+            }
+        }
+    }
+    memo.emplace(memoKey, hits);
+    return hits;
+}
+
+WhichResolver::Listing WhichResolver::listDirectory(const std::string &expandedPath, const std::vector<std::string> &extensions)
+{
+    Listing listing;
+    listing.exists = true;
+    std::error_code ec;
+    fs::directory_iterator it(fs::path(expandedPath), ec);
+    fs::directory_iterator end;
+    for (; !ec && it != end; it.increment(ec))
+    {
+        std::error_code statEc;
+        if (!it->is_regular_file(statEc))
+            continue;
+        std::string fileName;
+        try
+        {
+            fileName = it->path().filename().string();
+        }
+        catch (...)
+        {
+            continue; // 文件名无法转换为当前代码页
+        }
+        if (extensions.empty())
+        {
+            // 没有PATHEXT的平台按可执行权限判断
+            fs::perms perms = it->status(statEc).permissions();
+            if (statEc || (perms & (fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec)) == fs::perms::none)
+                continue;
+            listing.files.emplace(fileName, fileName);
+        }
+        else
+        {
+            // 只保留PATHEXT中的扩展名，其它文件不会被搜索到
+            std::string lower = toLowerAscii(fileName);
+            size_t dot = lower.rfind('.');
+            if (dot == std::string::npos || std::find(extensions.begin(), extensions.end(), lower.substr(dot)) == extensions.end())
+                continue;
+            listing.files.emplace(std::move(lower), std::move(fileName));
+        }
+    }
+    return listing;
+}
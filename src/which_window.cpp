@@ -0,0 +1,49 @@
+#include "which_window.hpp"
+#include <chrono>
+#include <string>
+
+WhichWindow::WhichWindow(WhichResolver *whichResolver) : Fl_Double_Window(640, 300, "查找命令"), resolver(whichResolver)
+{
+    commandInput = new Fl_Input(60, 10, 570, 25, "命令:");
+    commandInput->when(FL_WHEN_CHANGED);
+    commandInput->callback(inputCallback, this);
+
+    resultBrowser = new Fl_Hold_Browser(10, 45, 620, 210);
+    resultBrowser->textfont(FL_COURIER);
+
+    statusBox = new Fl_Box(10, 265, 620, 25);
+    statusBox->align(FL_ALIGN_LEFT | FL_ALIGN_INSIDE);
+    end();
+    resizable(resultBrowser);
+}
+
+void WhichWindow::inputCallback(Fl_Widget *w, void *data)
+{
+    static_cast<WhichWindow *>(data)->refresh();
+}
+
+void WhichWindow::refresh()
+{
+    resultBrowser->clear();
+    std::string command = commandInput->value();
+    if (command.empty())
+    {
+        statusBox->copy_label("");
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<WhichHit_t> hits = resolver->resolve(command);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    const std::vector<std::string> &searchPath = resolver->searchPath();
+    for (size_t i = 0; i < hits.size(); i++)
+    {
+        // 第一个匹配生效，其余被它遮蔽
+        std::string line = (i == 0 ? "运行  " : "遮蔽  ") + hits[i].file + "    (" + searchPath[hits[i].entry] + ")";
+        resultBrowser->add(line.c_str());
+    }
+    std::string status = hits.empty() ? "在PATH中找不到该命令" : "共 " + std::to_string(hits.size()) + " 个匹配";
+    status += "，用时 " + std::to_string(elapsed.count()) + " 微秒";
+    statusBox->copy_label(status.c_str());
+}
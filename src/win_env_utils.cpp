@@ -1,6 +1,8 @@
 #include "win_env_utils.hpp"
+#include "path_utils.hpp"
 #include <windows.h>
 #include <sstream>
+#include <cstdio>
 
 // 获取Windows系统标题栏高度
 int getTitleBarHeight()
@@ -14,6 +16,40 @@ int getTitleBarHeight()
     return 30; // 默认值，如果获取失败
 }
 
+std::string expandEnvironmentString(const std::string &value)
+{
+    if (value.find('%') == std::string::npos)
+    {
+        return value;
+    }
+    DWORD needed = ExpandEnvironmentStringsA(value.c_str(), NULL, 0);
+    if (needed == 0)
+    {
+        return value;
+    }
+    std::string result(needed, '\0');
+    DWORD written = ExpandEnvironmentStringsA(value.c_str(), &result[0], needed);
+    if (written == 0 || written > needed)
+    {
+        return value;
+    }
+    result.resize(written - 1); // 去掉结尾的'\0'
+    return result;
+}
+
+bool attachParentConsole()
+{
+    // GUI程序默认没有控制台
+    if (!AttachConsole(ATTACH_PARENT_PROCESS))
+    {
+        return false;
+    }
+    FILE *fp = nullptr;
+    freopen_s(&fp, "CONOUT$", "w", stdout);
+    freopen_s(&fp, "CONOUT$", "w", stderr);
+    return true;
+}
+
 static std::vector<EnvPathItem_t> getEnvironmentVariable(const std::string &varName, HKEY hive)
 {
     std::vector<EnvPathItem_t> result;
@@ -90,6 +126,12 @@ bool setSystemPath(const std::vector<EnvPathItem_t>& systemPaths)
         }
     }
 
+    // 超过环境变量上限时新进程拿到的Path会被截断，不写入
+    if (systemPathStr.length() + 1 > pathValueLimit)
+    {
+        return false;
+    }
+
     HKEY hKey;
     if (RegOpenKeyExA(HKEY_LOCAL_MACHINE, "SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment",
                       0, KEY_SET_VALUE, &hKey) == ERROR_SUCCESS)
@@ -122,6 +164,12 @@ bool setUserPath(const std::vector<EnvPathItem_t>& userPaths)
         }
     }
 
+    // 超过环境变量上限时新进程拿到的Path会被截断，不写入
+    if (userPathStr.length() + 1 > pathValueLimit)
+    {
+        return false;
+    }
+
     HKEY hKey;
     if (RegOpenKeyExA(HKEY_CURRENT_USER, "Environment",
                       0, KEY_SET_VALUE, &hKey) == ERROR_SUCCESS)
@@ -138,3 +186,76 @@ bool setUserPath(const std::vector<EnvPathItem_t>& userPaths)
     }
     return false;
 }
+
+bool sameAsRegistry(const std::vector<EnvPathItem_t> &items, const std::vector<EnvPathItem_t> &registry)
+{
+    size_t next = 0;
+    for (const auto &item : items)
+    {
+        if (!item.enabled)
+            continue;
+        if (next >= registry.size() || registry[next].path != item.path)
+            return false;
+        next++;
+    }
+    return next == registry.size();
+}
+
+std::vector<EnvVariable_t> getEnvironmentVariables(bool system)
+{
+    std::vector<EnvVariable_t> result;
+    HKEY hKey;
+    HKEY hive = system ? HKEY_LOCAL_MACHINE : HKEY_CURRENT_USER;
+    const char *subKey = system ? "SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment" : "Environment";
+    if (RegOpenKeyExA(hive, subKey, 0, KEY_READ, &hKey) != ERROR_SUCCESS)
+    {
+        return result;
+    }
+    DWORD maxNameLen = 0;
+    DWORD maxValueLen = 0;
+    if (RegQueryInfoKeyA(hKey, NULL, NULL, NULL, NULL, NULL, NULL, NULL, &maxNameLen, &maxValueLen, NULL, NULL) == ERROR_SUCCESS)
+    {
+        std::vector<char> name(maxNameLen + 1);
+        std::vector<BYTE> value(maxValueLen + 1);
+        for (DWORD i = 0;; i++)
+        {
+            DWORD nameLen = (DWORD)name.size();
+            DWORD valueLen = (DWORD)value.size();
+            DWORD dwType;
+            LONG rc = RegEnumValueA(hKey, i, name.data(), &nameLen, NULL, &dwType, value.data(), &valueLen);
+            if (rc == ERROR_NO_MORE_ITEMS)
+                break;
+            if (rc != ERROR_SUCCESS || (dwType != REG_SZ && dwType != REG_EXPAND_SZ))
+                continue;
+            std::string varName(name.data(), nameLen);
+            if (_stricmp(varName.c_str(), "Path") == 0)
+                continue;
+            // 值可能不带结尾的'\0'
+            std::string varValue((const char *)value.data(), valueLen);
+            while (!varValue.empty() && varValue.back() == '\0')
+                varValue.pop_back();
+            result.push_back(EnvVariable_t{varName, varValue, dwType == REG_EXPAND_SZ});
+        }
+    }
+    RegCloseKey(hKey);
+    return result;
+}
+
+bool setEnvironmentVariableValue(const std::string &name, const std::string &value, bool system)
+{
+    HKEY hKey;
+    HKEY hive = system ? HKEY_LOCAL_MACHINE : HKEY_CURRENT_USER;
+    const char *subKey = system ? "SYSTEM\\CurrentControlSet\\Control\\Session Manager\\Environment" : "Environment";
+    if (RegOpenKeyExA(hive, subKey, 0, KEY_SET_VALUE, &hKey) != ERROR_SUCCESS)
+    {
+        return false;
+    }
+    bool ok = RegSetValueExA(hKey, name.c_str(), 0, REG_SZ,
+                             (const BYTE *)value.c_str(), (DWORD)(value.length() + 1)) == ERROR_SUCCESS;
+    RegCloseKey(hKey);
+    if (ok)
+    {
+        SetEnvironmentVariableA(name.c_str(), value.c_str());
+    }
+    return ok;
+}
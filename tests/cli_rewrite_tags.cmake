@@ -0,0 +1,26 @@
+# 命令行测试：给条目打标签后批量改写，标签应跟随到新写法
+# 用法：cmake -DCLI=<QuickManPathCli> -DWORK=<临时目录> -P cli_rewrite_tags.cmake
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}")
+# pathVars.json 放在临时的用户目录下，不碰真实的状态文件
+set(ENV{HOME} "${WORK}")
+set(ENV{USERPROFILE} "${WORK}")
+
+function(run_cli)
+    execute_process(COMMAND "${CLI}" ${ARGN}
+                    RESULT_VARIABLE rc OUTPUT_VARIABLE out ERROR_VARIABLE err)
+    if(NOT rc EQUAL 0)
+        message(FATAL_ERROR "QuickManPathCli ${ARGN} failed (${rc}):\n${out}${err}")
+    endif()
+    set(output "${out}" PARENT_SCOPE)
+endfunction()
+
+run_cli(add /opt/qmp-tool-1.0/bin)
+run_cli(add /opt/qmp-other/bin)
+run_cli(tag toolchain /opt/qmp-tool-1.0/bin)
+run_cli(rewrite qmp-tool-1.0 qmp-tool-2.0)
+run_cli(tags)
+
+if(NOT output MATCHES "toolchain\t1/1" OR NOT output MATCHES "/opt/qmp-tool-2.0/bin" OR output MATCHES "qmp-tool-1.0")
+    message(FATAL_ERROR "the tag did not follow the rewritten entry:\n${output}")
+endif()